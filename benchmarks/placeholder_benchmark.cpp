@@ -5,7 +5,10 @@
 
 #include <benchmark/benchmark.h>
 
+#include <cstddef>
 #include <cstdint>
+#include <memory_resource>
+#include <span>
 #include <string>
 #include <thread>
 #include <vector>
@@ -14,11 +17,8 @@ using namespace automerge_cpp;
 
 // One pool for the entire benchmark suite. Every Document and every
 // parallelize_loop shares this pool — no extra threads are ever created.
-// sleep_duration=0 uses yield instead of 500us sleep for low-latency dispatch.
 static auto make_pool() -> std::shared_ptr<thread_pool> {
-    auto p = std::make_shared<thread_pool>(std::thread::hardware_concurrency());
-    p->sleep_duration = 0;
-    return p;
+    return std::make_shared<thread_pool>(std::thread::hardware_concurrency());
 }
 static auto g_pool = make_pool();
 
@@ -55,6 +55,23 @@ static void bm_map_put_batch(benchmark::State& state) {
 }
 BENCHMARK(bm_map_put_batch)->Range(10, 1000);
 
+// put_many with the same keys and values as bm_map_put_batch
+static void bm_map_put_many(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    auto doc = make_doc();
+    auto keys = std::vector<std::string>{};
+    for (std::size_t i = 0; i < n; ++i) keys.push_back("key" + std::to_string(i));
+    std::int64_t val = 0;
+    auto entries = std::vector<std::pair<std::string_view, ScalarValue>>{};
+    for (auto _ : state) {
+        entries.clear();
+        for (const auto& key : keys) entries.emplace_back(key, ScalarValue{val++});
+        doc.transact([&](auto& tx) { tx.put_many(root, entries); });
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * n));
+}
+BENCHMARK(bm_map_put_many)->Range(10, 1000);
+
 static void bm_map_get(benchmark::State& state) {
     auto doc = make_doc();
     doc.transact([](auto& tx) {
@@ -87,6 +104,24 @@ static void bm_map_keys(benchmark::State& state) {
 }
 BENCHMARK(bm_map_keys);
 
+static void bm_map_keys_view(benchmark::State& state) {
+    auto doc = make_doc();
+    doc.transact([](auto& tx) {
+        for (int i = 0; i < 100; ++i) {
+            tx.put(root, "key" + std::to_string(i), std::int64_t{i});
+        }
+    });
+
+    for (auto _ : state) {
+        auto view = doc.read_view();
+        auto bytes = std::size_t{0};
+        for (auto key : view.keys(root)) bytes += key.size();
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_map_keys_view);
+
 // =============================================================================
 // List operations
 // =============================================================================
@@ -124,6 +159,27 @@ static void bm_list_insert_front(benchmark::State& state) {
 }
 BENCHMARK(bm_list_insert_front);
 
+// Fill a new 1000-element list: one insert() per element (0) or a single
+// insert_range (1).
+static void bm_list_insert_range(benchmark::State& state) {
+    const auto batched = state.range(0) != 0;
+    auto doc = make_doc();
+    auto values = std::vector<ScalarValue>{};
+    for (std::int64_t i = 0; i < 1000; ++i) values.emplace_back(i);
+    for (auto _ : state) {
+        doc.transact([&](auto& tx) {
+            auto list_id = tx.put_object(root, "list", ObjType::list);
+            if (batched) {
+                tx.insert_range(list_id, 0, std::span<const ScalarValue>{values});
+            } else {
+                for (std::size_t i = 0; i < values.size(); ++i) tx.insert(list_id, i, values[i]);
+            }
+        });
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * values.size()));
+}
+BENCHMARK(bm_list_insert_range)->Arg(0)->Arg(1);
+
 static void bm_list_get(benchmark::State& state) {
     auto doc = make_doc();
     ObjId list_id;
@@ -142,6 +198,41 @@ static void bm_list_get(benchmark::State& state) {
 }
 BENCHMARK(bm_list_get);
 
+// Visit all 1000 elements: Arg(0) get(obj, i) per index, Arg(1) for_each_element,
+// Arg(2) scalar_chunks
+static void bm_list_iterate(benchmark::State& state) {
+    auto doc = make_doc();
+    ObjId list_id;
+    doc.transact([&](auto& tx) {
+        list_id = tx.put_object(root, "list", ObjType::list);
+        for (int i = 0; i < 1000; ++i) {
+            tx.insert(list_id, static_cast<std::size_t>(i), std::int64_t{i});
+        }
+    });
+
+    for (auto _ : state) {
+        auto sum = std::int64_t{0};
+        if (state.range(0) == 0) {
+            const auto len = doc.length(list_id);
+            for (std::size_t i = 0; i < len; ++i) {
+                sum += *get_scalar<std::int64_t>(doc.get(list_id, i));
+            }
+        } else if (state.range(0) == 1) {
+            doc.for_each_element(list_id, [&](const ElementRef& element) {
+                sum += *get_scalar<std::int64_t>(element.value);
+            });
+        } else {
+            auto view = doc.read_view();
+            for (auto chunk : view.scalar_chunks<std::int64_t>(list_id)) {
+                for (auto x : chunk) sum += x;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(bm_list_iterate)->Arg(0)->Arg(1)->Arg(2);
+
 // =============================================================================
 // Text operations
 // =============================================================================
@@ -199,6 +290,67 @@ static void bm_text_read(benchmark::State& state) {
 }
 BENCHMARK(bm_text_read);
 
+static void bm_text_read_view(benchmark::State& state) {
+    auto doc = make_doc();
+    ObjId text_id;
+    doc.transact([&](auto& tx) {
+        text_id = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(text_id, 0, 0, std::string(1000, 'x'));
+    });
+
+    for (auto _ : state) {
+        auto view = doc.read_view();
+        auto bytes = std::size_t{0};
+        for (auto chunk : view.text_chunks(text_id)) bytes += chunk.size();
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_text_read_view);
+
+// One-character edits in the middle of a 50000-element text whose runs are
+// fragmented (each element typed at a scattered position). Arg: 1 = snapshot
+// reads on, so the text is shared with the published snapshot at every
+// edit and each edit copies only its path through the tree.
+static void bm_text_type_fragmented(benchmark::State& state) {
+    auto doc = make_doc();
+    doc.set_snapshot_reads(state.range(0) != 0);
+    ObjId text_id;
+    doc.transact([&](auto& tx) {
+        text_id = tx.put_object(root, "text", ObjType::text);
+        for (std::size_t i = 0; i < 50'000; ++i) {
+            tx.splice_text(text_id, (i * 7919) % (i + 1), 0, "x");
+        }
+    });
+
+    auto pos = std::size_t{25'000};
+    for (auto _ : state) {
+        doc.transact([&](auto& tx) { tx.splice_text(text_id, pos++, 0, "y"); });
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_text_type_fragmented)->Arg(0)->Arg(1);
+
+// One-key commits to a document of 200000 map objects. Arg: 1 = snapshot
+// reads on, so every commit publishes a snapshot; that shares the object
+// table rather than copying it and should cost about the same as Arg 0.
+static void bm_commit_many_objects(benchmark::State& state) {
+    auto doc = make_doc();
+    doc.set_snapshot_reads(state.range(0) != 0);
+    doc.transact([](auto& tx) {
+        for (int i = 0; i < 200'000; ++i) {
+            tx.put_object(root, "obj" + std::to_string(i), ObjType::map);
+        }
+    });
+
+    auto i = std::int64_t{0};
+    for (auto _ : state) {
+        doc.transact([&](auto& tx) { tx.put(root, "counter", i++); });
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_commit_many_objects)->Arg(0)->Arg(1);
+
 // =============================================================================
 // Save / Load
 // =============================================================================
@@ -236,7 +388,46 @@ static void bm_load(benchmark::State& state) {
 }
 BENCHMARK(bm_load);
 
+// A 10000-element text document loaded with checksum verification on (1)
+// or off (0).
+static void bm_load_verify_checksum(benchmark::State& state) {
+    auto doc = Document{};
+    doc.transact([](auto& tx) {
+        auto text = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(text, 0, 0, std::string(10000, 'x'));
+    });
+    auto bytes = doc.save({.compression_level = 0});
+    const auto options = LoadOptions{.verify_checksum = state.range(0) != 0};
+
+    for (auto _ : state) {
+        auto loaded = Document::load(bytes, options);
+        benchmark::DoNotOptimize(loaded);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * bytes.size()));
+}
+BENCHMARK(bm_load_verify_checksum)->Arg(1)->Arg(0);
+
+// Args: list length, then 1 to save on g_pool or 0 on the calling thread.
 static void bm_save_large(benchmark::State& state) {
+    const auto n = static_cast<int>(state.range(0));
+    auto doc = state.range(1) != 0 ? make_doc() : Document{};
+    ObjId list_id;
+    doc.transact([&](auto& tx) {
+        list_id = tx.put_object(root, "data", ObjType::list);
+        for (int i = 0; i < n; ++i) {
+            tx.insert(list_id, static_cast<std::size_t>(i), std::int64_t{i});
+        }
+    });
+
+    for (auto _ : state) {
+        auto bytes = doc.save();
+        benchmark::DoNotOptimize(bytes);
+        state.SetBytesProcessed(static_cast<std::int64_t>(bytes.size()));
+    }
+}
+BENCHMARK(bm_save_large)->Args({1000, 0})->Args({1000, 1})->Args({100000, 0})->Args({100000, 1});
+
+static void bm_save_to_large(benchmark::State& state) {
     auto doc = make_doc();
     ObjId list_id;
     doc.transact([&](auto& tx) {
@@ -246,13 +437,123 @@ static void bm_save_large(benchmark::State& state) {
         }
     });
 
+    for (auto _ : state) {
+        auto written = doc.save_to([](std::span<const std::byte> bytes) {
+            benchmark::DoNotOptimize(bytes.data());
+        });
+        state.SetBytesProcessed(static_cast<std::int64_t>(written));
+    }
+}
+BENCHMARK(bm_save_to_large);
+
+static void bm_save_many_changes(benchmark::State& state) {
+    auto doc = make_doc();
+    auto text_id = doc.transact([](auto& tx) {
+        return tx.put_object(root, "text", ObjType::text);
+    });
+    for (int i = 0; i < 1000; ++i) {
+        doc.transact([&](auto& tx) {
+            tx.splice_text(text_id, static_cast<std::size_t>(i), 0, "a");
+        });
+    }
+
     for (auto _ : state) {
         auto bytes = doc.save();
         benchmark::DoNotOptimize(bytes);
         state.SetBytesProcessed(static_cast<std::int64_t>(bytes.size()));
     }
 }
-BENCHMARK(bm_save_large);
+BENCHMARK(bm_save_many_changes);
+
+static void bm_save_incremental(benchmark::State& state) {
+    auto doc = make_doc();
+    auto text_id = doc.transact([](auto& tx) {
+        return tx.put_object(root, "text", ObjType::text);
+    });
+    for (int i = 0; i < 1000; ++i) {
+        doc.transact([&](auto& tx) {
+            tx.splice_text(text_id, static_cast<std::size_t>(i), 0, "a");
+        });
+    }
+    doc.save_incremental();
+
+    auto pos = std::size_t{1000};
+    for (auto _ : state) {
+        doc.transact([&](auto& tx) { tx.splice_text(text_id, pos++, 0, "a"); });
+        auto bytes = doc.save_incremental();
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_save_incremental);
+
+// Arg: compression level (-1 = zlib default, 0 = uncompressed)
+static void bm_save_compression_level(benchmark::State& state) {
+    auto doc = make_doc();
+    auto list_id = doc.transact([](auto& tx) {
+        return tx.put_object(root, "items", ObjType::list);
+    });
+    for (int i = 0; i < 1000; ++i) {
+        doc.transact([&](auto& tx) {
+            tx.insert(list_id, static_cast<std::size_t>(i), "item " + std::to_string(i));
+        });
+    }
+    auto options = SaveOptions{.compression_level = static_cast<int>(state.range(0))};
+
+    for (auto _ : state) {
+        auto bytes = doc.save(options);
+        benchmark::DoNotOptimize(bytes);
+        state.SetBytesProcessed(static_cast<std::int64_t>(bytes.size()));
+    }
+}
+BENCHMARK(bm_save_compression_level)->Arg(-1)->Arg(0)->Arg(1);
+
+// 2000 changes from 2000 actors (one per session): actor lookups dominate
+// unless they are hashed.
+static void bm_save_many_actors(benchmark::State& state) {
+    auto doc = make_doc();
+    for (std::uint16_t i = 0; i < 2000; ++i) {
+        std::uint8_t raw[16] = {static_cast<std::uint8_t>(i >> 8), static_cast<std::uint8_t>(i)};
+        doc.set_actor_id(ActorId{raw});
+        doc.transact([&](auto& tx) { tx.put(root, "k", std::int64_t{i}); });
+    }
+
+    for (auto _ : state) {
+        auto bytes = doc.save();
+        benchmark::DoNotOptimize(bytes);
+    }
+}
+BENCHMARK(bm_save_many_actors);
+
+// Every change as its own chunk: one column set per change
+static void bm_save_since_all_changes(benchmark::State& state) {
+    auto doc = make_doc();
+    doc.transact([](auto& tx) { tx.put(root, "text", std::string(400, 'x')); });
+    for (int i = 0; i < 500; ++i) {
+        doc.transact([&](auto& tx) { tx.put(root, "k", std::string(300, static_cast<char>('a' + i % 26))); });
+    }
+
+    for (auto _ : state) {
+        auto bytes = doc.save_since({});
+        benchmark::DoNotOptimize(bytes);
+    }
+}
+BENCHMARK(bm_save_since_all_changes);
+
+// Tailing a long history: the last few changes since the previous heads
+static void bm_get_changes_since_tail(benchmark::State& state) {
+    auto doc = make_doc();
+    for (int i = 0; i < 5000; ++i) {
+        doc.transact([&](auto& tx) { tx.put(root, "k", std::int64_t{i}); });
+    }
+    auto seen = doc.get_changes()[4990].deps;
+
+    for (auto _ : state) {
+        auto changes = doc.get_changes_since(seen);
+        benchmark::DoNotOptimize(changes);
+    }
+}
+BENCHMARK(bm_get_changes_since_tail);
 
 // =============================================================================
 // Fork / Merge
@@ -307,6 +608,25 @@ static void bm_merge(benchmark::State& state) {
 }
 BENCHMARK(bm_merge);
 
+// 1000 changes delivered newest first: each is held until its dep arrives.
+// Arg: 0 = in causal order, 1 = reversed.
+static void bm_apply_changes_out_of_order(benchmark::State& state) {
+    auto source = make_doc();
+    for (int i = 0; i < 1000; ++i) {
+        source.transact([&](auto& tx) { tx.put(root, "k", std::int64_t{i}); });
+    }
+    auto changes = source.get_changes();
+    if (state.range(0) == 1) std::ranges::reverse(changes);
+
+    for (auto _ : state) {
+        auto doc = make_doc();
+        doc.apply_changes(changes);
+        benchmark::DoNotOptimize(doc);
+    }
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(bm_apply_changes_out_of_order)->Arg(0)->Arg(1);
+
 // =============================================================================
 // Sync protocol
 // =============================================================================
@@ -453,6 +773,50 @@ static void bm_text_at(benchmark::State& state) {
 }
 BENCHMARK(bm_text_at);
 
+static void bm_view_at_reads(benchmark::State& state) {
+    auto doc = make_doc();
+    doc.transact([](auto& tx) {
+        for (int i = 0; i < 50; ++i) {
+            tx.put(root, "field" + std::to_string(i), std::int64_t{i});
+        }
+    });
+    auto heads_v1 = doc.get_heads();
+    for (int round = 0; round < 100; ++round) {
+        doc.transact([&](auto& tx) {
+            tx.put(root, "field" + std::to_string(round % 50), std::int64_t{round});
+        });
+    }
+
+    // 50 field reads at the same past heads through one view
+    for (auto _ : state) {
+        auto view = doc.view_at(heads_v1);
+        for (int i = 0; i < 50; ++i) {
+            auto val = view.get(root, "field" + std::to_string(i));
+            benchmark::DoNotOptimize(val);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 50);
+}
+BENCHMARK(bm_view_at_reads);
+
+static void bm_get_at_long_history(benchmark::State& state) {
+    auto doc = make_doc();
+    auto heads = std::vector<std::vector<ChangeHash>>{};
+    for (int i = 0; i < 10000; ++i) {
+        doc.transact([&](auto& tx) { tx.put(root, "n", std::int64_t{i}); });
+        if (i % 1000 == 999) heads.push_back(doc.get_heads());
+    }
+
+    // Cycle through more heads than the snapshot cache holds
+    auto i = std::size_t{0};
+    for (auto _ : state) {
+        auto val = doc.get_at(root, "n", heads[i++ % heads.size()]);
+        benchmark::DoNotOptimize(val);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_get_at_long_history);
+
 // =============================================================================
 // Cursors
 // =============================================================================
@@ -495,6 +859,28 @@ static void bm_cursor_resolve(benchmark::State& state) {
 }
 BENCHMARK(bm_cursor_resolve);
 
+// 200 cursors over a long text, re-resolved as after each remote keystroke.
+static void bm_cursor_resolve_batch(benchmark::State& state) {
+    auto doc = make_doc();
+    ObjId text_id;
+    doc.transact([&](auto& tx) {
+        text_id = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(text_id, 0, 0, std::string(100'000, 'x'));
+    });
+
+    auto indices = std::vector<std::size_t>{};
+    for (std::size_t i = 0; i < 200; ++i) indices.push_back(i * 499);
+    auto curs = std::vector<Cursor>{};
+    for (const auto& cur : doc.cursors(text_id, indices)) curs.push_back(*cur);
+
+    for (auto _ : state) {
+        auto resolved = doc.resolve_cursors(text_id, curs);
+        benchmark::DoNotOptimize(resolved);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(curs.size()));
+}
+BENCHMARK(bm_cursor_resolve_batch);
+
 // =============================================================================
 // Fork/merge batch put — 4000 keys total
 //
@@ -629,6 +1015,98 @@ static void bm_load_docs(benchmark::State& state) {
 }
 BENCHMARK(bm_load_docs)->Arg(0)->Arg(1);
 
+// =============================================================================
+// Load / inspect / discard one small document
+//
+// Per-request pattern. Arg: 0 = no pool (never starts threads),
+// 1 = share g_pool, 2 = a fresh 2-thread pool per load (thread startup cost),
+// 3 = no pool, document state in a per-request monotonic arena.
+// =============================================================================
+
+static void bm_load_inspect_discard(benchmark::State& state) {
+    const auto mode = state.range(0);
+    auto doc = make_doc();
+    doc.transact([](auto& tx) {
+        for (int k = 0; k < 20; ++k) {
+            tx.put(root, "f" + std::to_string(k), std::int64_t{k});
+        }
+    });
+    auto bytes = doc.save();
+
+    std::byte buffer[16384];
+    for (auto _ : state) {
+        if (mode == 3) {
+            auto arena = std::pmr::monotonic_buffer_resource{buffer, sizeof(buffer)};
+            auto loaded = Document::load(bytes, arena);
+            auto value = loaded->get(root, "f7");
+            benchmark::DoNotOptimize(value);
+            continue;
+        }
+        auto pool = mode == 0 ? nullptr
+                  : mode == 1 ? g_pool
+                              : std::make_shared<thread_pool>(2);
+        auto loaded = Document::load(bytes, std::move(pool));
+        auto value = loaded->get(root, "f7");
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(mode == 0 ? "no pool" : mode == 1 ? "shared pool"
+                 : mode == 2 ? "pool per load" : "arena");
+}
+BENCHMARK(bm_load_inspect_discard)->Arg(0)->Arg(1)->Arg(2)->Arg(3);
+
+// =============================================================================
+// Load one large document — sequential vs pool-decoded
+//
+// 2000 changes of text. Arg: 0 = sequential, 1 = decode on g_pool.
+// =============================================================================
+
+static void bm_load_large(benchmark::State& state) {
+    const bool parallel = state.range(0) != 0;
+
+    auto doc = make_doc();
+    auto text_id = doc.transact([](auto& tx) {
+        return tx.put_object(root, "text", ObjType::text);
+    });
+    for (int i = 0; i < 2000; ++i) {
+        doc.transact([&](auto& tx) {
+            tx.splice_text(text_id, static_cast<std::size_t>(i), 0, "word ");
+        });
+    }
+    auto bytes = doc.save();
+
+    for (auto _ : state) {
+        auto loaded = parallel ? Document::load(bytes, g_pool) : Document::load(bytes);
+        benchmark::DoNotOptimize(loaded);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                            static_cast<std::int64_t>(bytes.size()));
+    state.SetLabel(parallel ? "parallel" : "sequential");
+}
+BENCHMARK(bm_load_large)->Arg(0)->Arg(1);
+
+// Lazy load of the same 2000-change document, reading only the heads.
+static void bm_load_lazy_heads(benchmark::State& state) {
+    auto doc = make_doc();
+    auto text_id = doc.transact([](auto& tx) {
+        return tx.put_object(root, "text", ObjType::text);
+    });
+    for (int i = 0; i < 2000; ++i) {
+        doc.transact([&](auto& tx) {
+            tx.splice_text(text_id, static_cast<std::size_t>(i), 0, "word ");
+        });
+    }
+    auto bytes = doc.save();
+
+    for (auto _ : state) {
+        auto loaded = Document::load_lazy(bytes);
+        auto heads = loaded->get_heads();
+        benchmark::DoNotOptimize(heads);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_load_lazy_heads);
+
 // =============================================================================
 // Read 1000 keys from one document — sequential vs parallel
 //
@@ -671,15 +1149,54 @@ static void bm_concurrent_reads(benchmark::State& state) {
 BENCHMARK(bm_concurrent_reads)->Arg(0)->Arg(1);
 
 // =============================================================================
-// Tree reduce merge — 64 peers, sequential vs parallel
+// Document::get scaling from 1 to 64 threads
+//
+// Every thread reads the same document. Locked readers all write the
+// shared_mutex reader count; snapshot readers reuse their thread's cached
+// snapshot and write no shared memory.
+// Arg: 0 = read lock, 1 = snapshot reads.
+// =============================================================================
+
+static void bm_read_scaling(benchmark::State& state) {
+    constexpr int key_count = 1000;
+    static const auto keys = [] {
+        auto k = std::vector<std::string>{};
+        for (int i = 0; i < key_count; ++i) k.push_back("key_" + std::to_string(i));
+        return k;
+    }();
+    static const auto docs = [] {
+        auto d = std::vector<Document>(2);
+        for (auto& doc : d) {
+            doc.transact([](auto& tx) {
+                for (int i = 0; i < key_count; ++i) tx.put(root, keys[i], std::int64_t{i});
+            });
+        }
+        d[1].set_snapshot_reads(true);
+        return d;
+    }();
+    const auto& doc = docs[static_cast<std::size_t>(state.range(0))];
+
+    auto i = static_cast<std::size_t>(state.thread_index()) * 37;
+    for (auto _ : state) {
+        auto val = doc.get(root, keys[i++ % key_count]);
+        benchmark::DoNotOptimize(val);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+    state.SetLabel(state.range(0) ? "snapshot" : "locked");
+}
+BENCHMARK(bm_read_scaling)->Arg(0)->Arg(1)->ThreadRange(1, 64)->UseRealTime();
+
+// =============================================================================
+// Tree reduce merge — 64 peers, sequential vs parallel vs merge_all
 //
 // Sequential: fold left into one accumulator.
 // Parallel: pairwise tree reduce via g_pool.
-// Arg: 0 = sequential, 1 = parallel.
+// merge_all: one deduplicated pass over every peer.
+// Arg: 0 = sequential, 1 = parallel, 2 = merge_all.
 // =============================================================================
 
 static void bm_merge_reduce(benchmark::State& state) {
-    const bool parallel = state.range(0) != 0;
+    const auto mode = state.range(0);
     constexpr int peer_count = 64;
 
     auto base_peers = std::vector<Document>(peer_count);
@@ -702,10 +1219,12 @@ static void bm_merge_reduce(benchmark::State& state) {
             work.push_back(std::move(copy));
         }
 
-        if (!parallel) {
+        if (mode == 0) {
             for (std::size_t i = 1; i < work.size(); ++i) {
                 work[0].merge(work[i]);
             }
+        } else if (mode == 2) {
+            work[0].merge_all(std::span<const Document>{work}.subspan(1));
         } else {
             while (work.size() > 1) {
                 auto pairs = work.size() / 2;
@@ -727,9 +1246,9 @@ static void bm_merge_reduce(benchmark::State& state) {
         benchmark::DoNotOptimize(work);
     }
     state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * peer_count);
-    state.SetLabel(parallel ? "parallel" : "sequential");
+    state.SetLabel(mode == 0 ? "sequential" : mode == 1 ? "parallel" : "merge_all");
 }
-BENCHMARK(bm_merge_reduce)->Arg(0)->Arg(1);
+BENCHMARK(bm_merge_reduce)->Arg(0)->Arg(1)->Arg(2);
 
 // =============================================================================
 // Massive put at scale — sequential vs parallel
@@ -0,0 +1,283 @@
+// automerge-cpp sync simulation benchmarks — many peers, lossy summaries.
+//
+// Each benchmark builds a network of documents joined by links (one
+// SyncState per side) and runs the sync protocol in rounds until it is
+// quiet. In a round every due message is delivered, then every link
+// direction may generate one; a message sent in round r is delivered in
+// round r + 1 + latency. Messages travel
+// encoded, so their bytes are what a socket would carry.
+//
+// Topologies:
+//   - hub: one server document and N peers, each with its own edits;
+//   - mesh: N peers gossiping over a ring plus random extra links;
+//   - catch_up: a peer that has been offline for C changes.
+//
+// Counters: rounds to convergence, bytes on the wire, time per round,
+// changes delivered beyond the ones each document was missing (resends: a
+// change reaching a document over two links, or sent again after a reset)
+// and hashes requested through need, mostly after bloom filter false
+// positives, plus whether every document ended with the same heads.
+
+#include <automerge-cpp/automerge.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace automerge_cpp;
+
+namespace {
+
+auto make_peer(std::uint32_t id) -> std::unique_ptr<Document> {
+    std::uint8_t raw[16] = {static_cast<std::uint8_t>(id), static_cast<std::uint8_t>(id >> 8),
+                            static_cast<std::uint8_t>(id >> 16), 1};
+    auto doc = std::make_unique<Document>();
+    doc->set_actor_id(ActorId{raw});
+    return doc;
+}
+
+// `count` edits of the peer's own keys, one change each.
+void edit(Document& doc, std::uint32_t peer, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        doc.transact([&](auto& tx) {
+            tx.put(root, "p" + std::to_string(peer) + "_" + std::to_string(i % 16),
+                   static_cast<std::int64_t>(i));
+        });
+    }
+}
+
+struct SimulationResult {
+    std::size_t rounds = 0;
+    std::size_t messages = 0;
+    std::size_t bytes = 0;
+    std::size_t changes = 0;     // changes carried by all messages
+    std::size_t need_hashes = 0; // hashes requested explicitly
+    bool converged = false;
+};
+
+class Network {
+public:
+    explicit Network(std::size_t latency) : latency_{latency} {}
+
+    auto add(std::unique_ptr<Document> doc) -> Document& {
+        docs_.push_back(std::move(doc));
+        return *docs_.back();
+    }
+
+    void link(std::size_t a, std::size_t b, std::size_t max_changes = 0) {
+        auto& l = links_.emplace_back(Link{.a = a, .b = b, .state_a = {}, .state_b = {}});
+        l.state_a.set_message_budget(max_changes, 0);
+        l.state_b.set_message_budget(max_changes, 0);
+    }
+
+    // Changes some document is missing now: the least a sync must carry.
+    auto missing_changes() const -> std::size_t {
+        auto distinct = std::set<std::pair<ActorId, std::uint64_t>>{};
+        auto held = std::size_t{0};
+        for (const auto& doc : docs_) {
+            for (const auto& change : doc->get_changes()) {
+                distinct.emplace(change.actor, change.seq);
+                ++held;
+            }
+        }
+        return distinct.size() * docs_.size() - held;
+    }
+
+    auto run(std::size_t max_rounds) -> SimulationResult {
+        auto result = SimulationResult{};
+        for (std::size_t round = 0; round < max_rounds; ++round) {
+            while (!in_flight_.empty() && in_flight_.front().deliver_at <= round) {
+                auto message = std::move(in_flight_.front());
+                in_flight_.pop_front();
+                auto decoded = SyncMessage::decode(message.bytes);
+                result.changes += decoded->changes.size();
+                result.need_hashes += decoded->need.size();
+                docs_[message.to]->receive_sync_message(*message.state, *decoded);
+            }
+            auto sent = false;
+            for (auto& l : links_) {
+                sent = send(l.a, l.state_a, l.b, l.state_b, round, result) || sent;
+                sent = send(l.b, l.state_b, l.a, l.state_a, round, result) || sent;
+            }
+            if (!sent && in_flight_.empty()) break;
+            result.rounds = round + 1;
+        }
+        auto heads = docs_.front()->get_heads();
+        std::ranges::sort(heads);
+        result.converged = std::ranges::all_of(docs_, [&](const auto& doc) {
+            auto h = doc->get_heads();
+            std::ranges::sort(h);
+            return h == heads;
+        });
+        return result;
+    }
+
+private:
+    struct Link {
+        std::size_t a;
+        std::size_t b;
+        SyncState state_a;  // a's state for b
+        SyncState state_b;  // b's state for a
+    };
+
+    struct InFlight {
+        std::size_t deliver_at;
+        std::size_t to;
+        SyncState* state;
+        std::vector<std::byte> bytes;
+    };
+
+    auto send(std::size_t from, SyncState& from_state, std::size_t to, SyncState& to_state,
+              std::size_t round, SimulationResult& result) -> bool {
+        auto bytes = docs_[from]->generate_sync_message_encoded(from_state);
+        if (!bytes) return false;
+        ++result.messages;
+        result.bytes += bytes->size();
+        in_flight_.push_back(InFlight{.deliver_at = round + 1 + latency_, .to = to,
+                                      .state = &to_state, .bytes = std::move(*bytes)});
+        return true;
+    }
+
+    std::size_t latency_;
+    std::vector<std::unique_ptr<Document>> docs_;
+    std::deque<Link> links_;  // stable addresses for in-flight SyncState pointers
+    std::deque<InFlight> in_flight_;  // in send order, so deliver_at is sorted
+};
+
+constexpr auto max_rounds = std::size_t{10'000};
+
+void report(benchmark::State& state, const SimulationResult& result, std::size_t missing,
+            std::chrono::duration<double> elapsed) {
+    state.counters["rounds"] = static_cast<double>(result.rounds);
+    state.counters["messages"] = static_cast<double>(result.messages);
+    state.counters["wire_bytes"] = benchmark::Counter(static_cast<double>(result.bytes),
+                                                      benchmark::Counter::kDefaults,
+                                                      benchmark::Counter::kIs1024);
+    state.counters["us_per_round"] =
+        std::chrono::duration<double, std::micro>(elapsed).count() / static_cast<double>(std::max<std::size_t>(result.rounds, 1));
+    state.counters["resends"] = static_cast<double>(result.changes - std::min(result.changes, missing));
+    state.counters["need_hashes"] = static_cast<double>(result.need_hashes);
+    state.counters["converged"] = result.converged ? 1.0 : 0.0;
+}
+
+}  // namespace
+
+// =============================================================================
+// Hub: one server, N peers
+// =============================================================================
+
+// Args: peers, changes per peer (divergence), latency in rounds
+static void bm_sync_hub(benchmark::State& state) {
+    const auto peers = static_cast<std::size_t>(state.range(0));
+    const auto divergence = static_cast<std::size_t>(state.range(1));
+    const auto latency = static_cast<std::size_t>(state.range(2));
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto net = Network{latency};
+        edit(net.add(make_peer(0)), 0, divergence);
+        for (std::size_t p = 1; p <= peers; ++p) {
+            edit(net.add(make_peer(static_cast<std::uint32_t>(p))), static_cast<std::uint32_t>(p), divergence);
+            net.link(0, p);
+        }
+        auto missing = net.missing_changes();
+        state.ResumeTiming();
+
+        auto start = std::chrono::steady_clock::now();
+        auto result = net.run(max_rounds);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        state.PauseTiming();
+        report(state, result, missing, elapsed);
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(bm_sync_hub)
+    ->Args({10, 10, 0})->Args({100, 1, 0})->Args({100, 1, 3})->Args({1000, 1, 0})
+    ->Unit(benchmark::kMillisecond)->Iterations(1);
+
+// =============================================================================
+// Mesh gossip
+// =============================================================================
+
+// Args: peers, changes per peer, latency. Each peer links to the next one
+// on a ring and to two random others.
+static void bm_sync_mesh(benchmark::State& state) {
+    const auto peers = static_cast<std::size_t>(state.range(0));
+    const auto divergence = static_cast<std::size_t>(state.range(1));
+    const auto latency = static_cast<std::size_t>(state.range(2));
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto net = Network{latency};
+        for (std::size_t p = 0; p < peers; ++p) {
+            edit(net.add(make_peer(static_cast<std::uint32_t>(p))), static_cast<std::uint32_t>(p), divergence);
+        }
+        auto rng = std::mt19937_64{11};
+        auto pick = std::uniform_int_distribution<std::size_t>{0, peers - 1};
+        for (std::size_t p = 0; p < peers; ++p) {
+            net.link(p, (p + 1) % peers);
+            for (int extra = 0; extra < 2; ++extra) {
+                auto q = pick(rng);
+                if (q != p) net.link(p, q);
+            }
+        }
+        auto missing = net.missing_changes();
+        state.ResumeTiming();
+
+        auto start = std::chrono::steady_clock::now();
+        auto result = net.run(max_rounds);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        state.PauseTiming();
+        report(state, result, missing, elapsed);
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(bm_sync_mesh)
+    ->Args({16, 10, 0})->Args({64, 4, 0})->Args({64, 4, 2})->Args({256, 1, 0})
+    ->Unit(benchmark::kMillisecond)->Iterations(1);
+
+// =============================================================================
+// Long-offline peer catching up
+// =============================================================================
+
+// Args: changes the peer missed, message budget in changes (0 = unlimited)
+static void bm_sync_catch_up(benchmark::State& state) {
+    const auto changes = static_cast<std::size_t>(state.range(0));
+    const auto budget = static_cast<std::size_t>(state.range(1));
+
+    auto server = make_peer(0);
+    edit(*server, 0, changes);
+    const auto saved = server->save();
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto net = Network{1};
+        net.add(std::make_unique<Document>(*Document::load(saved)));
+        net.add(make_peer(1));
+        net.link(0, 1, budget);
+        auto missing = net.missing_changes();
+        state.ResumeTiming();
+
+        auto start = std::chrono::steady_clock::now();
+        auto result = net.run(max_rounds);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        state.PauseTiming();
+        report(state, result, missing, elapsed);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * changes));
+}
+BENCHMARK(bm_sync_catch_up)
+    ->Args({10'000, 0})->Args({100'000, 0})->Args({100'000, 1'000})
+    ->Unit(benchmark::kMillisecond)->Iterations(1);
@@ -0,0 +1,365 @@
+// automerge-cpp trace benchmarks — replays realistic editing workloads.
+//
+// The text benchmarks replay an editing trace: a list of (position,
+// deleted, inserted) patches as typed by a person. Point AUTOMERGE_CPP_TRACE
+// at a trace file to replay it:
+//
+//   AUTOMERGE_CPP_TRACE=automerge-paper.json.gz ./automerge_cpp_trace_benchmarks
+//
+// Two layouts are read, gzipped or not:
+//   - the editing-traces format ({"startContent", "endContent",
+//     "txns": [{"patches": [[pos, del, ins], ...]}, ...]}), e.g. the
+//     automerge-perf LaTeX paper trace (~260k keystrokes) from
+//     https://github.com/josephg/editing-traces (sequential_traces/);
+//   - a bare array of patches ([[pos, del, "ins"], ...]).
+// Configuring with -DAUTOMERGE_CPP_DOWNLOAD_TRACES=ON fetches the paper
+// trace and makes it the default. Without a trace file a synthetic one of
+// the same length is generated: mostly sequential typing with cursor jumps
+// and backspaces, from a fixed seed.
+//
+// Counters: edits/s (items_per_second), final save() size, load time (the
+// load benchmarks) and peak RSS. Peak RSS is the process high-water mark, so
+// it is only meaningful for the first benchmark of a run; use
+// --benchmark_filter to measure one at a time.
+
+#include <automerge-cpp/automerge.hpp>
+#include <automerge-cpp/thread_pool.hpp>
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <zlib.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace automerge_cpp;
+
+static auto make_pool() -> std::shared_ptr<thread_pool> {
+    return std::make_shared<thread_pool>(std::thread::hardware_concurrency());
+}
+static auto g_pool = make_pool();
+
+static auto make_doc(std::uint8_t actor = 1) -> Document {
+    std::uint8_t raw[16] = {actor};
+    auto doc = Document{g_pool};
+    doc.set_actor_id(ActorId{raw});
+    return doc;
+}
+
+// =============================================================================
+// Traces
+// =============================================================================
+
+struct TracePatch {
+    std::size_t pos;
+    std::size_t del;
+    std::string ins;
+};
+
+struct Trace {
+    std::string name;
+    std::string start_content;
+    std::string end_content;  // empty if unknown
+    std::vector<TracePatch> patches;
+};
+
+// Read a whole file, inflating it if it is gzipped.
+static auto read_file(const std::string& path) -> std::optional<std::string> {
+    auto* file = gzopen(path.c_str(), "rb");
+    if (!file) return std::nullopt;
+    auto data = std::string{};
+    char buffer[1 << 16];
+    int n = 0;
+    while ((n = gzread(file, buffer, sizeof(buffer))) > 0) data.append(buffer, static_cast<std::size_t>(n));
+    gzclose(file);
+    if (n < 0) return std::nullopt;
+    return data;
+}
+
+static auto parse_patch(const nlohmann::json& p) -> TracePatch {
+    auto patch = TracePatch{.pos = p.at(0).get<std::size_t>(), .del = p.at(1).get<std::size_t>(), .ins = {}};
+    for (std::size_t i = 2; i < p.size(); ++i) patch.ins += p.at(i).get<std::string>();
+    return patch;
+}
+
+static auto load_trace_file(const std::string& path) -> std::optional<Trace> {
+    auto data = read_file(path);
+    if (!data) return std::nullopt;
+    auto json = nlohmann::json::parse(*data, nullptr, false);
+    if (json.is_discarded()) return std::nullopt;
+
+    auto trace = Trace{.name = path, .start_content = {}, .end_content = {}, .patches = {}};
+    if (json.is_array()) {
+        for (const auto& p : json) trace.patches.push_back(parse_patch(p));
+        return trace;
+    }
+    trace.start_content = json.value("startContent", std::string{});
+    trace.end_content = json.value("endContent", std::string{});
+    for (const auto& txn : json.at("txns")) {
+        for (const auto& p : txn.at("patches")) trace.patches.push_back(parse_patch(p));
+    }
+    return trace;
+}
+
+// Typing with the shape of a real session: runs of keystrokes at a cursor,
+// backspaces, and occasional jumps elsewhere in the text.
+static auto synthetic_trace(std::size_t edits) -> Trace {
+    auto trace = Trace{.name = "synthetic", .start_content = {}, .end_content = {}, .patches = {}};
+    trace.patches.reserve(edits);
+    auto rng = std::mt19937_64{42};
+    auto chance = std::uniform_int_distribution<int>{0, 99};
+    auto letter = std::uniform_int_distribution<int>{'a', 'z'};
+    auto text = std::string{};
+    std::size_t cursor = 0;
+    for (std::size_t i = 0; i < edits; ++i) {
+        auto roll = chance(rng);
+        if (roll < 2 && !text.empty()) {
+            cursor = std::uniform_int_distribution<std::size_t>{0, text.size()}(rng);
+        }
+        if (roll >= 2 && roll < 14 && cursor > 0) {
+            --cursor;
+            text.erase(cursor, 1);
+            trace.patches.push_back(TracePatch{.pos = cursor, .del = 1, .ins = {}});
+            continue;
+        }
+        auto c = roll >= 90 ? ' ' : static_cast<char>(letter(rng));
+        text.insert(cursor, 1, c);
+        trace.patches.push_back(TracePatch{.pos = cursor, .del = 0, .ins = std::string(1, c)});
+        ++cursor;
+    }
+    trace.end_content = std::move(text);
+    return trace;
+}
+
+// The trace every text benchmark replays, loaded once.
+static auto trace() -> const Trace& {
+    static const auto instance = [] {
+        auto path = std::string{};
+        if (const auto* env = std::getenv("AUTOMERGE_CPP_TRACE")) path = env;
+#ifdef AUTOMERGE_CPP_DEFAULT_TRACE
+        if (path.empty()) path = AUTOMERGE_CPP_DEFAULT_TRACE;
+#endif
+        if (!path.empty()) {
+            if (auto loaded = load_trace_file(path)) return std::move(*loaded);
+            std::fprintf(stderr, "could not read trace %s; using a synthetic one\n", path.c_str());
+        }
+        return synthetic_trace(260'000);
+    }();
+    return instance;
+}
+
+static auto peak_rss_bytes() -> double {
+#if defined(__APPLE__)
+    auto usage = rusage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_maxrss);  // bytes
+#elif defined(__unix__)
+    auto usage = rusage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_maxrss) * 1024.0;  // kilobytes
+#else
+    return 0.0;
+#endif
+}
+
+// Replay patches [first, last) of the trace into text_id, one transaction
+// per patch (one keystroke each, as an editor would commit them).
+static void replay(Document& doc, const ObjId& text_id, std::span<const TracePatch> patches) {
+    for (const auto& p : patches) {
+        doc.transact([&](auto& tx) { tx.splice_text(text_id, p.pos, p.del, p.ins); });
+    }
+}
+
+static auto new_text_doc(std::uint8_t actor = 1) -> std::pair<Document, ObjId> {
+    auto doc = make_doc(actor);
+    auto text_id = ObjId{};
+    doc.transact([&](auto& tx) {
+        text_id = tx.put_object(root, "text", ObjType::text);
+        if (!trace().start_content.empty()) tx.splice_text(text_id, 0, 0, trace().start_content);
+    });
+    return {std::move(doc), text_id};
+}
+
+// The trace replayed once, shared by the save and load benchmarks.
+static auto replayed_doc() -> const Document& {
+    static const auto doc = [] {
+        auto [doc, text_id] = new_text_doc();
+        replay(doc, text_id, trace().patches);
+        return std::move(doc);
+    }();
+    return doc;
+}
+
+// =============================================================================
+// Text editing trace
+// =============================================================================
+
+static void bm_trace_replay(benchmark::State& state) {
+    const auto& t = trace();
+    auto save_bytes = std::size_t{0};
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto [doc, text_id] = new_text_doc();
+        state.ResumeTiming();
+
+        replay(doc, text_id, t.patches);
+
+        state.PauseTiming();
+        if (!t.end_content.empty() && doc.text(text_id) != t.end_content) {
+            state.SkipWithError("replayed text does not match the trace's end content");
+            return;
+        }
+        save_bytes = doc.save().size();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * t.patches.size()));
+    state.counters["save_bytes"] = static_cast<double>(save_bytes);
+    state.counters["peak_rss"] = benchmark::Counter(peak_rss_bytes(), benchmark::Counter::kDefaults,
+                                                    benchmark::Counter::kIs1024);
+    state.SetLabel(t.name);
+}
+BENCHMARK(bm_trace_replay)->Unit(benchmark::kMillisecond)->Iterations(1);
+
+// The whole trace as one transaction: the floor for per-edit overhead
+static void bm_trace_replay_one_transaction(benchmark::State& state) {
+    const auto& t = trace();
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto [doc, text_id] = new_text_doc();
+        state.ResumeTiming();
+
+        doc.transact([&](auto& tx) {
+            for (const auto& p : t.patches) tx.splice_text(text_id, p.pos, p.del, p.ins);
+        });
+        benchmark::DoNotOptimize(doc);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * t.patches.size()));
+    state.SetLabel(t.name);
+}
+BENCHMARK(bm_trace_replay_one_transaction)->Unit(benchmark::kMillisecond);
+
+static void bm_trace_save(benchmark::State& state) {
+    const auto& doc = replayed_doc();
+    auto save_bytes = std::size_t{0};
+    for (auto _ : state) {
+        auto bytes = doc.save();
+        save_bytes = bytes.size();
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.counters["save_bytes"] = static_cast<double>(save_bytes);
+    state.SetLabel(trace().name);
+}
+BENCHMARK(bm_trace_save)->Unit(benchmark::kMillisecond);
+
+static void bm_trace_load(benchmark::State& state) {
+    const auto bytes = replayed_doc().save();
+    for (auto _ : state) {
+        auto doc = Document::load(bytes, g_pool);
+        benchmark::DoNotOptimize(doc);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * bytes.size()));
+    state.counters["save_bytes"] = static_cast<double>(bytes.size());
+    state.SetLabel(trace().name);
+}
+BENCHMARK(bm_trace_load)->Unit(benchmark::kMillisecond);
+
+// Load and read the text: what opening a stored document costs
+static void bm_trace_load_and_read(benchmark::State& state) {
+    const auto bytes = replayed_doc().save();
+    for (auto _ : state) {
+        auto doc = Document::load_lazy(bytes, g_pool);
+        auto text_id = doc->get_obj_id(root, "text");
+        auto text = doc->text(*text_id);
+        benchmark::DoNotOptimize(text);
+    }
+    state.SetLabel(trace().name);
+}
+BENCHMARK(bm_trace_load_and_read)->Unit(benchmark::kMillisecond);
+
+// =============================================================================
+// Concurrent multi-actor text
+// =============================================================================
+
+// N actors fork one document and each type a share of the trace into the
+// same text concurrently; the timed part merges all forks into one.
+static void bm_trace_concurrent_merge(benchmark::State& state) {
+    const auto actors = static_cast<std::size_t>(state.range(0));
+    const auto& patches = trace().patches;
+    const auto share = std::min(patches.size(), std::size_t{20'000}) / actors;
+
+    auto [base, text_id] = new_text_doc();
+    auto forks = std::vector<Document>{};
+    for (std::size_t a = 0; a < actors; ++a) {
+        auto fork = base.fork();
+        std::uint8_t raw[16] = {static_cast<std::uint8_t>(a + 2)};
+        fork.set_actor_id(ActorId{raw});
+        replay(fork, text_id, std::span{patches}.first(share));
+        forks.push_back(std::move(fork));
+    }
+
+    auto merged_length = std::size_t{0};
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto doc = base;
+        state.ResumeTiming();
+
+        doc.merge_all(forks);
+
+        state.PauseTiming();
+        merged_length = doc.length(text_id);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * share * actors));
+    state.counters["merged_length"] = static_cast<double>(merged_length);
+}
+BENCHMARK(bm_trace_concurrent_merge)->Arg(2)->Arg(8)->Arg(32)->Unit(benchmark::kMillisecond);
+
+// =============================================================================
+// Large map churn
+// =============================================================================
+
+// Random puts and deletes over a large key space, one op per transaction,
+// as a session store or presence map sees them.
+static void bm_map_churn(benchmark::State& state) {
+    const auto keys = static_cast<std::size_t>(state.range(0));
+    constexpr auto edits = std::size_t{100'000};
+    auto save_bytes = std::size_t{0};
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto doc = make_doc();
+        auto rng = std::mt19937_64{7};
+        auto pick = std::uniform_int_distribution<std::size_t>{0, keys - 1};
+        auto chance = std::uniform_int_distribution<int>{0, 99};
+        state.ResumeTiming();
+
+        for (std::size_t i = 0; i < edits; ++i) {
+            auto key = "k" + std::to_string(pick(rng));
+            if (chance(rng) < 20) {
+                doc.transact([&](auto& tx) { tx.delete_key(root, key); });
+            } else {
+                doc.transact([&](auto& tx) { tx.put(root, key, static_cast<std::int64_t>(i)); });
+            }
+        }
+
+        state.PauseTiming();
+        save_bytes = doc.save().size();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * edits));
+    state.counters["save_bytes"] = static_cast<double>(save_bytes);
+    state.counters["peak_rss"] = benchmark::Counter(peak_rss_bytes(), benchmark::Counter::kDefaults,
+                                                    benchmark::Counter::kIs1024);
+}
+BENCHMARK(bm_map_churn)->Arg(1'000)->Arg(100'000)->Unit(benchmark::kMillisecond)->Iterations(1);
@@ -36,7 +36,6 @@ int main() {
     // All documents share one pool — no extra threads are ever created.
     auto pool = std::make_shared<am::thread_pool>(
         std::thread::hardware_concurrency());
-    pool->sleep_duration = 0;  // yield instead of 500us sleep
 
     std::printf("Thread pool: %lu threads\n",
                 static_cast<unsigned long>(pool->get_thread_count()));
@@ -232,6 +231,15 @@ int main() {
                     t.ms(), work[0].length(am::root));
     }
 
+    // One deduplicated pass over every peer
+    {
+        auto t = Timer{};
+        auto result = am::Document{pool};
+        result.merge_all(peers);
+        std::printf("  merge_all:         %.1f ms, %zu keys\n",
+                    t.ms(), result.length(am::root));
+    }
+
     // =========================================================================
     // 5. Parallel sync — each pair syncs independently
     // =========================================================================
@@ -3,18 +3,24 @@
 ///
 /// Include this single header for access to all public types:
 /// Document, Transaction, ActorId, ObjId, Value, Change, Patch,
-/// SyncState, Cursor, Mark, and Error.
+/// SyncState, SyncSession, Cursor, Mark, Error and DocumentStore.
 
 #pragma once
 
 #include <automerge-cpp/change.hpp>
 #include <automerge-cpp/cursor.hpp>
 #include <automerge-cpp/document.hpp>
+#include <automerge-cpp/document_store.hpp>
 #include <automerge-cpp/error.hpp>
 #include <automerge-cpp/mark.hpp>
+#include <automerge-cpp/metrics.hpp>
 #include <automerge-cpp/op.hpp>
 #include <automerge-cpp/patch.hpp>
+#include <automerge-cpp/read_view.hpp>
+#include <automerge-cpp/sync_session.hpp>
 #include <automerge-cpp/sync_state.hpp>
 #include <automerge-cpp/transaction.hpp>
+#include <automerge-cpp/tree_visitor.hpp>
 #include <automerge-cpp/types.hpp>
 #include <automerge-cpp/value.hpp>
+#include <automerge-cpp/value_ref.hpp>
@@ -6,18 +6,24 @@
 #include <automerge-cpp/change.hpp>
 #include <automerge-cpp/cursor.hpp>
 #include <automerge-cpp/mark.hpp>
+#include <automerge-cpp/metrics.hpp>
 #include <automerge-cpp/patch.hpp>
+#include <automerge-cpp/read_view.hpp>
 #include <automerge-cpp/sync_state.hpp>
 #include <automerge-cpp/transaction.hpp>
+#include <automerge-cpp/tree_visitor.hpp>
 #include <automerge-cpp/types.hpp>
 #include <automerge-cpp/value.hpp>
 
 #include <automerge-cpp/thread_pool.hpp>
 
+#include <atomic>
 #include <concepts>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <shared_mutex>
 #include <span>
@@ -33,6 +39,93 @@ namespace detail {
 struct DocState;
 }  // namespace detail
 
+/// Options for Document::save, save_since and save_incremental.
+///
+/// @code
+/// auto fast = doc.save({.compression_level = 1});
+/// auto raw  = doc.save({.compression_level = 0});  // no DEFLATE at all
+/// @endcode
+struct SaveOptions {
+    /// DEFLATE level for large columns: 1 (fastest) to 9 (smallest), -1 for
+    /// zlib's default, or 0 to store every column uncompressed.
+    int compression_level = -1;
+};
+
+/// Options for Document::load, load_lazy and load_incremental.
+///
+/// The defaults validate everything, as untrusted input needs. A caller
+/// reading back bytes from a store that already guarantees their integrity
+/// can skip the chunk checksums:
+/// @code
+/// auto doc = Document::load(bytes, {.verify_checksum = false});
+/// @endcode
+/// Structural checks still apply, so malformed bytes are still rejected
+/// rather than misread; only corruption that keeps the bytes well formed
+/// goes undetected. Change hashes are always computed from the changes
+/// themselves (they are needed to resolve dependencies) and heads are
+/// taken as stored.
+struct LoadOptions {
+    /// Verify each chunk's checksum (a SHA-256 of the whole chunk body).
+    bool verify_checksum = true;
+};
+
+/// Structure and estimated memory of one object, or of every object of a
+/// type (see Document::stats and Document::object_stats).
+struct ObjectStats {
+    std::size_t objects = 0;        ///< Objects counted (1 for a single object).
+    std::size_t map_entries = 0;    ///< Keys with a value (map, table).
+    std::size_t conflicts = 0;      ///< Of those, keys with concurrent values.
+    std::size_t list_elements = 0;  ///< Visible elements (list, text).
+    std::size_t tombstones = 0;     ///< Deleted elements still kept (see compact()).
+    std::size_t marks = 0;          ///< Rich-text marks.
+    std::size_t heap_bytes = 0;     ///< Estimated heap use.
+
+    auto operator+=(const ObjectStats& other) -> ObjectStats&;
+};
+
+/// Estimated heap bytes of each part of a document's state.
+///
+/// Estimates count container capacity and the strings they own, not
+/// allocator overhead. Objects and changes shared with forks or copies are
+/// counted in full by each document.
+struct DocumentMemoryStats {
+    std::size_t objects = 0;          ///< The object table and every object.
+    std::size_t strings = 0;          ///< Interned map keys and mark names.
+    std::size_t change_history = 0;   ///< Changes and their ops.
+    std::size_t hash_index = 0;       ///< Change hash to history index.
+    std::size_t change_dag = 0;       ///< Dependency index used by sync.
+    std::size_t actor_table = 0;      ///< Actors of the history, for save().
+    std::size_t encoded_changes = 0;  ///< Change chunks cached for sync messages.
+    std::size_t history_cache = 0;    ///< Snapshot and checkpoint bookkeeping for *_at reads.
+    std::size_t pending_changes = 0;  ///< Changes waiting for missing deps.
+    std::size_t pending_load = 0;     ///< Saved bytes not yet decoded (load_lazy).
+
+    /// Sum of the above.
+    auto total() const -> std::size_t;
+};
+
+/// What a document holds and roughly how much memory it takes (see
+/// Document::stats).
+struct DocumentStats {
+    ObjectStats maps;    ///< Map objects, including the root.
+    ObjectStats tables;  ///< Table objects.
+    ObjectStats lists;   ///< List objects.
+    ObjectStats texts;   ///< Text objects.
+
+    std::size_t changes = 0;             ///< Changes in the history.
+    std::size_t ops = 0;                 ///< Ops in those changes.
+    std::size_t actors = 0;              ///< Actors that made them.
+    std::size_t heads = 0;               ///< Current heads.
+    std::size_t hash_index_entries = 0;  ///< Changes the hash index covers.
+    std::size_t pending_changes = 0;     ///< Changes waiting for missing deps.
+    bool decoded = true;                 ///< False while a load_lazy document is still encoded.
+
+    DocumentMemoryStats memory;
+
+    /// Totals over every object type.
+    auto objects() const -> ObjectStats;
+};
+
 /// A CRDT document that supports concurrent editing and deterministic merge.
 ///
 /// Document is the primary user-facing type in automerge-cpp. It owns the
@@ -54,7 +147,8 @@ struct DocState;
 class Document {
 public:
     /// Construct a new empty document with a random actor ID.
-    /// Creates an internal thread pool with hardware_concurrency() threads.
+    /// No thread pool is created and no threads are started; pass a thread
+    /// count or a shared pool for internal parallelism.
     Document();
 
     /// Construct with an explicit thread count.
@@ -67,6 +161,36 @@ public:
     /// @param pool The thread pool to use. nullptr = sequential (no pool).
     explicit Document(std::shared_ptr<thread_pool> pool);
 
+    /// Construct a document whose state allocates from a memory resource.
+    ///
+    /// The object table, every object, and their map tables and list/text
+    /// element storage are allocated from resource, so a short-lived
+    /// document can live in an arena (e.g. a monotonic_buffer_resource)
+    /// that is released in one go. Values' own strings and bytes, and the
+    /// change history, still use the default allocator. Copies and fork()
+    /// share the resource; transactions allocate new objects from it.
+    ///
+    /// The resource must outlive the document and every copy, fork and
+    /// ReadView of it. With snapshot reads enabled, reader threads do not
+    /// keep such a document's snapshot in their cache (see
+    /// set_snapshot_reads): each read holds it only while it runs, so no
+    /// snapshot outlives the document.
+    ///
+    /// With a thread pool, applying a large batch of changes (merge, load,
+    /// sync) allocates from several threads at once, so it is done in
+    /// parallel only if resource is thread-safe: new_delete_resource() or a
+    /// synchronized_pool_resource. Any other resource gets the serial path;
+    /// wrap it in a synchronized_pool_resource to keep the parallel one.
+    ///
+    /// @code
+    /// auto arena = std::pmr::monotonic_buffer_resource{};
+    /// auto doc = Document{arena};
+    /// @endcode
+    /// @param resource The memory resource to allocate from.
+    /// @param pool The thread pool to use. nullptr = sequential (no pool).
+    explicit Document(std::pmr::memory_resource& resource,
+                      std::shared_ptr<thread_pool> pool = nullptr);
+
     ~Document();
 
     Document(Document&&) noexcept;
@@ -152,6 +276,59 @@ public:
     /// Get the text content of a text object as a string.
     auto text(const ObjId& obj) const -> std::string;
 
+    // -- Reading: whole subtree -----------------------------------------------
+
+    /// Walk obj and everything beneath it in a single depth-first pass,
+    /// reporting each value to the visitor.
+    ///
+    /// Unlike repeated get() calls, this takes the read guard once and
+    /// visits each element once, so a list of n elements costs O(n).
+    /// @code
+    /// doc.walk(root, my_visitor);
+    /// @endcode
+    void walk(const ObjId& obj, TreeVisitor& visitor) const;
+
+    // -- Reading: borrowed views ----------------------------------------------
+
+    /// Open a ReadView for copy-free reads: values come back as ValueRefs
+    /// whose strings and bytes view the document's storage, and keys, values
+    /// and list elements as ranges over it.
+    ///
+    /// With snapshot reads enabled the view pins the current snapshot and
+    /// never blocks writers; otherwise it reads the live state, under the
+    /// read lock if read locking is enabled. See ReadView.
+    /// @code
+    /// auto view = doc.read_view();
+    /// for (const auto& [key, value] : view.entries(root)) { ... }
+    /// @endcode
+    auto read_view() const -> ReadView;
+
+    /// Call fn(const MapEntryRef&) for each entry of a map or table, in key
+    /// order, under one read guard.
+    ///
+    /// Replaces keys() followed by get() per key, which copies every key and
+    /// looks each one up again. The entry's strings are borrowed: copy them
+    /// to keep them past the call. fn must not modify the document.
+    /// @code
+    /// doc.for_each_entry(root, [&](const MapEntryRef& e) { names.emplace_back(e.key); });
+    /// @endcode
+    template <typename Fn>
+        requires std::invocable<Fn&, const MapEntryRef&>
+    void for_each_entry(const ObjId& obj, Fn&& fn) const;
+
+    /// Call fn(const ElementRef&) for each visible element of a list or text
+    /// object, in order, under one read guard. O(n) where get(obj, i) per
+    /// index is O(n log n). fn must not modify the document.
+    template <typename Fn>
+        requires std::invocable<Fn&, const ElementRef&>
+    void for_each_element(const ObjId& obj, Fn&& fn) const;
+
+    /// Like for_each_element(obj, fn), for the elements with index in
+    /// [first, last) only (clamped to the length).
+    template <typename Fn>
+        requires std::invocable<Fn&, const ElementRef&>
+    void for_each_element(const ObjId& obj, std::size_t first, std::size_t last, Fn&& fn) const;
+
     // -- Typed getters --------------------------------------------------------
 
     /// Get a typed scalar value from a map key.
@@ -197,6 +374,17 @@ public:
         requires (sizeof...(Props) > 0)
     auto get_path(Props&&... props) const -> std::optional<Value>;
 
+    /// Get the path from root to an object: the inverse of get_path().
+    ///
+    /// Each object records its parent and key, so this walks up one step per
+    /// level instead of searching down from root.
+    /// @code
+    /// auto path = doc.path_of(item_id);  // e.g. {"todos", 3}
+    /// @endcode
+    /// @return The path (empty for root), or nullopt if the object does not
+    ///         exist or is no longer reachable (overwritten or deleted).
+    auto path_of(const ObjId& obj) const -> std::optional<Path>;
+
     // -- Object type query ----------------------------------------------------
 
     /// Get the type of an object (map, list, text, table).
@@ -222,34 +410,183 @@ public:
     /// Create an independent copy with a new actor ID.
     auto fork() const -> Document;
 
+    /// Fork onto another memory resource. The fork's objects are copied
+    /// onto resource rather than shared, so it does not depend on this
+    /// document's resource.
+    auto fork(std::pmr::memory_resource& resource) const -> Document;
+
     /// Merge another document's unseen changes into this one.
     ///
     /// Merge is commutative, associative, and idempotent.
     void merge(const Document& other);
 
+    /// Merge the unseen changes of many documents in one pass.
+    ///
+    /// Changes are deduplicated across all inputs by hash, put in a single
+    /// causal order and applied together, on the thread pool when there is
+    /// one (lazily loaded inputs are also decoded in parallel). Equivalent to
+    /// merging each input in turn, without a history walk per pairwise merge.
+    /// Null pointers, repeats and this document itself are skipped.
+    void merge_all(std::span<const Document* const> others);
+
+    /// Merge the unseen changes of every document in others in one pass.
+    void merge_all(std::span<const Document> others);
+
     /// Get all changes in this document's history.
     auto get_changes() const -> std::vector<Change>;
 
+    /// Get the changes not covered by `heads`, in history order.
+    ///
+    /// The history is walked back from the current heads only as far as the
+    /// oldest change the caller is missing, so tailing a long history with
+    /// the heads seen last time costs the new changes, not the whole log.
+    /// Hashes this document does not have are ignored.
+    /// @param heads Heads the caller already has (empty = every change).
+    auto get_changes_since(const std::vector<ChangeHash>& heads) const -> std::vector<Change>;
+
+    /// Call fn with each change not covered by `heads`, in history order,
+    /// without copying them.
+    ///
+    /// The changes are picked as in get_changes_since; fn runs after the
+    /// document lock has been released and may read the document. For the
+    /// same changes encoded as change chunks, use save_since.
+    void for_each_change_since(const std::vector<ChangeHash>& heads,
+                               const std::function<void(const Change&)>& fn) const;
+
+    /// Look up a single change by its hash (nullopt if it is not in the history).
+    auto get_change_by_hash(const ChangeHash& hash) const -> std::optional<Change>;
+
     /// Apply a set of changes from another document.
+    ///
+    /// Changes may arrive in any order: one whose deps are not all here yet
+    /// is held back and applied as soon as its last dep arrives, in this
+    /// call or a later one, or by merge or load_incremental. Changes already
+    /// applied or held are skipped.
     void apply_changes(const std::vector<Change>& changes);
 
+    /// Number of changes held back for missing deps (by apply_changes or
+    /// receive_sync_message).
+    auto pending_change_count() const -> std::size_t;
+
     /// Get the current DAG leaf hashes (heads).
     auto get_heads() const -> std::vector<ChangeHash>;
 
     // -- Binary Serialization -------------------------------------------------
 
     /// Serialize the document to binary format.
+    /// @param options Compression settings (any level loads the same way).
     /// @return The serialized bytes (v2 chunk-based format).
-    auto save() const -> std::vector<std::byte>;
+    auto save(const SaveOptions& options = {}) const -> std::vector<std::byte>;
+
+    /// Serialize the document as save() does, handing the bytes to sink.
+    ///
+    /// The chunk is encoded once into a single buffer (its header is
+    /// back-patched once the body's checksum and length are known) and
+    /// passed to sink without a further copy; an untouched lazily loaded
+    /// document passes its loaded bytes as they are. The sink may be called
+    /// more than once: the bytes it receives, concatenated, are the
+    /// document. It runs after the document lock has been released.
+    /// @code
+    /// doc.save_to([&](std::span<const std::byte> bytes) {
+    ///     file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    /// });
+    /// @endcode
+    /// @return The number of bytes written.
+    auto save_to(const std::function<void(std::span<const std::byte>)>& sink,
+                 const SaveOptions& options = {}) const -> std::size_t;
+
+    /// Serialize the changes not covered by `heads` as change chunks.
+    ///
+    /// The result is a concatenation of one change chunk per change, in
+    /// history order. Append it to a saved document (or pass it to
+    /// load_incremental) to bring the reader up to date.
+    /// @param heads Heads the reader already has (empty = every change).
+    auto save_since(const std::vector<ChangeHash>& heads,
+                    const SaveOptions& options = {}) const -> std::vector<std::byte>;
+
+    /// Serialize the changes added since the last load or save_incremental().
+    ///
+    /// Changes received by merge, sync or load_incremental count as new.
+    ///
+    /// Returns change chunks only (empty if nothing changed), so persisting
+    /// costs O(new changes) instead of O(document):
+    /// @code
+    /// auto base = doc.save();             // full snapshot
+    /// // ... edits ...
+    /// auto delta = doc.save_incremental();  // just the new changes
+    /// base.insert(base.end(), delta.begin(), delta.end());
+    /// auto restored = Document::load(base);  // document + change chunks
+    /// @endcode
+    auto save_incremental(const SaveOptions& options = {}) -> std::vector<std::byte>;
+
+    /// Apply a concatenation of chunks (document and/or change chunks).
+    ///
+    /// Changes already in this document are skipped. Nothing is applied if
+    /// any chunk is malformed.
+    /// @return The number of changes applied, or nullopt on malformed data.
+    auto load_incremental(std::span<const std::byte> data, const LoadOptions& options = {})
+        -> std::optional<std::size_t>;
 
     /// Load a document from binary data.
     ///
     /// Supports both v2 (chunk-based) and v1 (row-based) formats with
-    /// automatic detection.
+    /// automatic detection. Change chunks following a v2 document chunk
+    /// (see save_incremental()) are applied too. The loaded document has no
+    /// thread pool, so loading never starts threads; use the pool overload
+    /// to share one.
     /// @param data The binary data to load from.
     /// @return The loaded document, or nullopt if the data is invalid.
     static auto load(std::span<const std::byte> data) -> std::optional<Document>;
 
+    /// Load a document, decoding its changes on a thread pool.
+    ///
+    /// Change bodies (or, for the columnar layout, the compressed columns)
+    /// are decoded in parallel; ops are then replayed in order. The loaded
+    /// document keeps the pool. Must not be called from a task running on
+    /// the same pool.
+    /// @param data The binary data to load from.
+    /// @param pool The pool to decode on. nullptr = sequential.
+    /// @return The loaded document, or nullopt if the data is invalid.
+    static auto load(std::span<const std::byte> data,
+                     std::shared_ptr<thread_pool> pool) -> std::optional<Document>;
+
+    /// Load a document with the given options (see LoadOptions).
+    static auto load(std::span<const std::byte> data, const LoadOptions& options,
+                     std::shared_ptr<thread_pool> pool = nullptr) -> std::optional<Document>;
+
+    /// Load a document whose state allocates from a memory resource (see
+    /// the Document(std::pmr::memory_resource&) constructor).
+    static auto load(std::span<const std::byte> data, std::pmr::memory_resource& resource,
+                     std::shared_ptr<thread_pool> pool = nullptr,
+                     const LoadOptions& options = {}) -> std::optional<Document>;
+
+    /// Load a document, deferring decode of its changes until first use.
+    ///
+    /// The chunk is validated and its heads, local metadata and change and
+    /// op counts are read; the bytes are kept and the changes are decoded and replayed on the
+    /// first read or write that needs objects or history. get_heads(),
+    /// actor_id() and save() on an untouched document do not decode it.
+    /// If the deferred decode fails the document is left empty. Data with
+    /// change chunks after the document chunk is loaded eagerly.
+    ///
+    /// @code
+    /// auto doc = Document::load_lazy(bytes);
+    /// auto heads = doc->get_heads();  // no decode
+    /// auto title = doc->get(root, "title");  // decodes now
+    /// @endcode
+    /// @param data The binary data to load from (copied).
+    /// @param pool Thread pool for the deferred decode. nullptr = sequential.
+    /// @param options Validation options, applied when the chunk is read.
+    /// @return The document, or nullopt if the data is invalid.
+    static auto load_lazy(std::span<const std::byte> data,
+                          std::shared_ptr<thread_pool> pool = nullptr,
+                          const LoadOptions& options = {})
+        -> std::optional<Document>;
+
+    /// Whether the changes have been decoded (always true unless the
+    /// document came from load_lazy and has not been accessed yet).
+    auto is_materialized() const -> bool;
+
     // -- Sync Protocol --------------------------------------------------------
 
     /// Generate the next sync message to send to a peer.
@@ -257,11 +594,69 @@ public:
     /// @return The message to send, or nullopt if no message is needed.
     auto generate_sync_message(SyncState& sync_state) const -> std::optional<SyncMessage>;
 
+    /// Generate the next sync message to send to a peer, already encoded.
+    ///
+    /// The bytes equal generate_sync_message()->encode(), but each change is
+    /// encoded once per document and the chunk is reused for every peer it
+    /// is sent to.
+    /// @param sync_state The per-peer sync state (modified in place).
+    /// @return The encoded message, or nullopt if no message is needed.
+    auto generate_sync_message_encoded(SyncState& sync_state) const
+        -> std::optional<std::vector<std::byte>>;
+
+    /// Generate the next sync message for each of several peers at once.
+    ///
+    /// Equivalent to calling generate_sync_message() for each state in turn,
+    /// but the bloom filter summary is built once per distinct set of shared
+    /// heads, and the per-peer work runs on the document's thread pool when
+    /// it has one (it may be called from a task on that pool). Each message
+    /// holds its own copy of the changes it carries; use
+    /// generate_sync_messages_encoded() to share them.
+    /// @param sync_states One distinct SyncState per peer (modified in place).
+    /// @return result[i] is the message for sync_states[i], or nullopt.
+    auto generate_sync_messages(std::span<SyncState* const> sync_states) const
+        -> std::vector<std::optional<SyncMessage>>;
+
+    /// generate_sync_messages(), with each message already encoded.
+    ///
+    /// result[i] equals generate_sync_message_encoded(*sync_states[i]): each
+    /// change is encoded once per document and its chunk copied into every
+    /// peer's message, so no Change is copied.
+    /// @param sync_states One distinct SyncState per peer (modified in place).
+    /// @return result[i] is the encoded message for sync_states[i], or nullopt.
+    auto generate_sync_messages_encoded(std::span<SyncState* const> sync_states) const
+        -> std::vector<std::optional<std::vector<std::byte>>>;
+
     /// Process a sync message received from a peer.
+    ///
+    /// Its changes are applied like apply_changes applies them: ones already
+    /// here are skipped, and ones whose deps are missing are held back.
     /// @param sync_state The per-peer sync state (modified in place).
     /// @param message The received message to process.
     void receive_sync_message(SyncState& sync_state, const SyncMessage& message);
 
+    /// Process several messages from the same peer, in order, under one
+    /// acquisition of the write lock (and one snapshot publish). Equivalent
+    /// to calling receive_sync_message() for each in turn.
+    /// @param sync_state The per-peer sync state (modified in place).
+    /// @param messages The received messages, oldest first.
+    void receive_sync_messages(SyncState& sync_state, std::span<const SyncMessage> messages);
+
+    // -- Tombstone compaction -------------------------------------------------
+
+    /// Drop deleted list and text elements that can no longer be referenced.
+    ///
+    /// Deleted elements are normally kept forever as tombstones so that
+    /// concurrent inserts next to them still merge correctly. Once a set of
+    /// heads is known to every peer (e.g. SyncState::shared_heads()), and no
+    /// change concurrent with them can still arrive, tombstones deleted at or
+    /// before those heads are dead weight. Compaction only touches the
+    /// in-memory state: the change history, save() output and historical
+    /// reads are unchanged.
+    /// @param stable_heads Heads that all peers have merged.
+    /// @return Approximate number of bytes reclaimed.
+    auto compact(const std::vector<ChangeHash>& stable_heads) -> std::size_t;
+
     // -- Patches --------------------------------------------------------------
 
     /// Execute a transaction and return patches describing the changes.
@@ -284,8 +679,49 @@ public:
     auto transact_with_patches(Fn&& fn)
         -> std::pair<std::invoke_result_t<Fn, Transaction&>, std::vector<Patch>>;
 
+    /// Apply changes and return patches describing their visible effects.
+    ///
+    /// Patches are produced while the ops are applied, with list positions
+    /// resolved to visible indices at that moment, so the cost is
+    /// proportional to the changes rather than to the document. Applying
+    /// the patches in order to a view of the document before the call
+    /// yields the document after it. Ops are applied serially (not on the
+    /// thread pool) so that patches come out in op order.
+    /// @code
+    /// auto patches = doc.receive_sync_message_with_patches(state, msg);
+    /// for (const auto& p : patches) ui.apply(p);
+    /// @endcode
+    auto apply_changes_with_patches(const std::vector<Change>& changes) -> std::vector<Patch>;
+
+    /// Merge another document and return patches for the merged-in changes.
+    /// @see apply_changes_with_patches
+    auto merge_with_patches(const Document& other) -> std::vector<Patch>;
+
+    /// Process a sync message and return patches for the changes it carried.
+    /// @see apply_changes_with_patches
+    auto receive_sync_message_with_patches(SyncState& sync_state, const SyncMessage& message)
+        -> std::vector<Patch>;
+
     // -- Historical reads (time travel) ---------------------------------------
 
+    /// Materialise the document as it was at a given point in history.
+    ///
+    /// The state is built once; every read on the returned Document (get,
+    /// keys, text, marks, get_path, get_heads, ...) then costs the same as
+    /// on a live document. Use this instead of the *_at methods when reading
+    /// many fields at the same heads. Recently materialised states are
+    /// cached, so a view at the same or later heads replays only the
+    /// changes it is missing.
+    ///
+    /// The view holds exactly the changes visible at heads (shared, not
+    /// copied) and, like fork(), gets its own actor ID.
+    /// @code
+    /// auto past = doc.view_at(heads_v1);
+    /// auto title = past.get<std::string>(root, "title");
+    /// auto body  = past.text(body_id);
+    /// @endcode
+    auto view_at(const std::vector<ChangeHash>& heads) const -> Document;
+
     /// Get a map value as it was at a given point in history.
     /// @param obj The map object.
     /// @param key The key to look up.
@@ -327,18 +763,67 @@ public:
     /// @return The current index, or nullopt if the element was deleted.
     auto resolve_cursor(const ObjId& obj, const Cursor& cursor) const -> std::optional<std::size_t>;
 
+    /// Create cursors at many positions under one read of the document.
+    /// @return One entry per index, nullopt where the index is out of bounds.
+    auto cursors(const ObjId& obj, std::span<const std::size_t> indices) const
+        -> std::vector<std::optional<Cursor>>;
+
+    /// Resolve many cursors under one read of the document, e.g. every
+    /// participant's cursor and selection after a remote edit. Each lookup
+    /// is O(log n).
+    /// @return One entry per cursor, nullopt where the element was deleted.
+    auto resolve_cursors(const ObjId& obj, std::span<const Cursor> cursors) const
+        -> std::vector<std::optional<std::size_t>>;
+
     // -- Rich text marks ------------------------------------------------------
 
-    /// Get all marks on a text or list object.
+    /// Get all marks on a text or list object, ordered by start.
+    ///
+    /// A mark with the same name and range as an earlier one replaces it.
     auto marks(const ObjId& obj) const -> std::vector<Mark>;
 
+    /// Get the marks that overlap the visible range [start, end), ordered
+    /// by start (e.g. the marks needed to render a viewport).
+    ///
+    /// Marks are indexed by position: a binary search finds those starting
+    /// before end, and the scan back from there stops as soon as no earlier
+    /// mark reaches start, so marks far from the range are not visited.
+    /// @code
+    /// auto visible = doc.marks(text_id, first_char, last_char);
+    /// @endcode
+    auto marks(const ObjId& obj, std::size_t start, std::size_t end) const -> std::vector<Mark>;
+
     /// Get marks at a given point in history.
     auto marks_at(const ObjId& obj,
                   const std::vector<ChangeHash>& heads) const -> std::vector<Mark>;
 
+    // -- Statistics -----------------------------------------------------------
+
+    /// Count what the document holds and estimate the memory it takes, by
+    /// object type and by part of the internal state.
+    ///
+    /// Walks every object and change, so it costs about as much as a
+    /// save() without the encoding. A document from load_lazy is not
+    /// decoded: until first use, its stats are its saved bytes (decoded is
+    /// false).
+    /// @code
+    /// auto stats = doc.stats();
+    /// if (stats.lists.tombstones > 10 * stats.lists.list_elements) doc.compact(stable);
+    /// log(stats.memory.total(), stats.memory.change_history, stats.texts.heap_bytes);
+    /// @endcode
+    auto stats() const -> DocumentStats;
+
+    /// Stats for a single object (its own entries and elements, not those of
+    /// nested objects).
+    /// @return nullopt if obj does not exist.
+    auto object_stats(const ObjId& obj) const -> std::optional<ObjectStats>;
+
     /// Get the thread pool (may be nullptr if sequential mode).
     auto get_thread_pool() const -> std::shared_ptr<thread_pool>;
 
+    /// The memory resource the document's state allocates from.
+    auto memory_resource() const -> std::pmr::memory_resource*;
+
     // -- Locking control ------------------------------------------------------
 
     /// Enable or disable internal read locking.
@@ -354,22 +839,131 @@ public:
     /// Check whether internal read locking is enabled.
     auto read_locking() const -> bool;
 
+    /// Enable or disable snapshot (MVCC) reads.
+    ///
+    /// When enabled, every mutation publishes an immutable snapshot of the
+    /// document when it commits, and the current-state reads (get, get_all,
+    /// keys, values, length, text, object_type, get_obj_id, get_path,
+    /// get_heads, get_changes, cursor, resolve_cursor, marks) load that
+    /// snapshot with an atomic pointer instead of taking the lock — they
+    /// never wait on a writer, and see the last committed version while a
+    /// long merge or sync catch-up is running. Historical (*_at), sync and
+    /// save reads, and those that look changes up by hash (get_changes_since,
+    /// for_each_change_since, get_change_by_hash), still take the read lock:
+    /// they share the document's change indexes rather than rebuild them for
+    /// each snapshot. Publishing shares objects and change history
+    /// copy-on-write, so the writer's next mutation clones only the objects
+    /// it touches. Toggle while no other thread is using the document.
+    ///
+    /// Each reader thread caches the last snapshot it read, so repeat reads
+    /// of an unchanged document load one atomic version number and write no
+    /// shared memory — reads scale with cores. The cached snapshot stays alive
+    /// until that thread reads a newer one (or exits). A document on its own
+    /// memory resource is not cached, as its resource may be released before
+    /// then: each read takes a reference to the snapshot for its duration.
+    void set_snapshot_reads(bool enabled);
+
+    /// Check whether snapshot reads are enabled.
+    auto snapshot_reads() const -> bool;
+
 private:
+    friend class DocumentStore;  // estimates a resident document's memory use
+
     /// RAII guard that conditionally acquires a shared_lock.
     struct ReadGuard {
         std::shared_lock<std::shared_mutex> lock_;
         bool engaged_;
+        [[no_unique_address]] metrics::detail::LockTimer timer_;  // empty unless metrics are on
 
         explicit ReadGuard(std::shared_mutex& mtx, bool engage)
             : lock_{mtx, std::defer_lock}, engaged_{engage} {
-            if (engaged_) lock_.lock();
+            if (engaged_) {
+                timer_.lock(lock_, metrics::Phase::read_lock_wait, metrics::Phase::read_lock_hold);
+            }
         }
     };
 
     auto read_guard() const -> ReadGuard;
 
-    /// Internal: convert pending ops to patches.
-    static auto ops_to_patches_internal(const std::vector<Op>& ops) -> std::vector<Patch>;
+    /// Guard for current-state reads: state points at the published snapshot
+    /// (kept alive by the calling thread's reader cache) or, holding the read
+    /// lock, at the live state.
+    struct SnapshotGuard {
+        ReadGuard lock_;
+        const detail::DocState* state;
+        std::shared_ptr<const detail::DocState> pin_;  // a snapshot the reader cache doesn't hold
+    };
+
+    auto snapshot_guard() const -> SnapshotGuard;
+
+    /// Internal: the published snapshot (nullptr if none is published). A
+    /// snapshot on the heap is kept in the calling thread's reader cache;
+    /// one on the document's own memory resource is held in pin instead,
+    /// for this read only, as the resource may be gone by the thread's next.
+    auto current_snapshot(std::shared_ptr<const detail::DocState>& pin) const
+        -> const detail::DocState*;
+
+    /// RAII guard that holds the write lock and publishes a snapshot of the
+    /// new state (when snapshot reads are enabled) before releasing it.
+    struct WriteGuard {
+        const Document& doc_;
+        std::unique_lock<std::shared_mutex> lock_;
+        [[no_unique_address]] metrics::detail::LockTimer timer_;  // empty unless metrics are on
+
+        explicit WriteGuard(const Document& doc) : doc_{doc}, lock_{doc.mutex_, std::defer_lock} {
+            timer_.lock(lock_, metrics::Phase::write_lock_wait, metrics::Phase::write_lock_hold);
+        }
+        ~WriteGuard() { doc_.publish_snapshot(); }
+        WriteGuard(const WriteGuard&) = delete;
+        auto operator=(const WriteGuard&) -> WriteGuard& = delete;
+    };
+
+    /// Internal: publish the current state for snapshot reads (write lock held).
+    void publish_snapshot() const;
+
+    /// Internal: withdraw the published snapshot, if any (write lock held).
+    void unpublish_snapshot() const;
+
+    /// Internal: decode a lazily loaded document's changes, if still pending.
+    void materialize() const;
+
+    /// Internal: append the document chunk to output, with the read guard
+    /// held and changes materialized. Returns the chunk's offset.
+    auto write_document_chunk(const SaveOptions& options, std::vector<std::byte>& output) const
+        -> std::size_t;
+
+    /// Internal: generate_sync_message with the read guard already held.
+    /// The message's changes are left empty; change_indices receives the
+    /// change_history indices of the changes to send.
+    auto generate_sync_message_unlocked(SyncState& sync_state,
+                                        std::vector<std::size_t>& change_indices) const
+        -> std::optional<SyncMessage>;
+
+    /// Internal: bring sync_state's "have" summary up to date with state.
+    static void update_have_cache(const detail::DocState& state, SyncState& sync_state);
+
+    /// Internal: the multi-peer part of generate_sync_messages with the read
+    /// guard held. Shares one "have" summary per distinct set of shared
+    /// heads, then calls generate(start, end) over blocks of peers, on the
+    /// pool when there are enough of them.
+    void generate_for_peers(std::span<SyncState* const> sync_states,
+                            const std::function<void(std::size_t, std::size_t)>& generate) const;
+
+    /// Internal: apply_changes, merge_all and receive_sync_message,
+    /// appending patches for applied ops when patches is non-null.
+    void apply_changes_impl(const std::vector<Change>& changes, std::vector<Patch>* patches);
+    void merge_all_impl(std::span<const Document* const> others, std::vector<Patch>* patches);
+    void receive_sync_message_impl(SyncState& sync_state, const SyncMessage& message,
+                                   std::vector<Patch>* patches);
+
+    /// Internal: receive_sync_message with the write lock held and changes
+    /// materialized.
+    void receive_sync_message_locked(SyncState& sync_state, const SyncMessage& message,
+                                     std::vector<Patch>* patches);
+
+    /// Internal: convert a committed transaction's ops to patches, with
+    /// paths resolved against the state after the transaction.
+    auto ops_to_patches_internal(const std::vector<Op>& ops) const -> std::vector<Patch>;
 
     /// Internal: walk a path of Props to resolve a nested value.
     auto get_path_impl(std::span<const Prop> path) const -> std::optional<Value>;
@@ -378,15 +972,41 @@ private:
     std::shared_ptr<thread_pool> pool_;
     mutable std::shared_mutex mutex_;
     bool read_locking_ = true;
+    bool snapshot_reads_ = false;
+    mutable std::atomic<std::shared_ptr<const detail::DocState>> snapshot_;
+    mutable std::atomic<std::uint64_t> snapshot_version_{0};  // 0: none published
 };
 
 // -- Template implementations (must be in header) ----------------------------
 
+template <typename Fn>
+    requires std::invocable<Fn&, const MapEntryRef&>
+void Document::for_each_entry(const ObjId& obj, Fn&& fn) const {
+    auto view = read_view();
+    for (const auto& entry : view.entries(obj)) fn(entry);
+}
+
+template <typename Fn>
+    requires std::invocable<Fn&, const ElementRef&>
+void Document::for_each_element(const ObjId& obj, Fn&& fn) const {
+    auto view = read_view();
+    for (const auto& element : view.elements(obj)) fn(element);
+}
+
+template <typename Fn>
+    requires std::invocable<Fn&, const ElementRef&>
+void Document::for_each_element(const ObjId& obj, std::size_t first, std::size_t last,
+                                Fn&& fn) const {
+    auto view = read_view();
+    for (const auto& element : view.elements(obj, first, last)) fn(element);
+}
+
 template <typename Fn>
     requires std::invocable<Fn, Transaction&> &&
              (!std::is_void_v<std::invoke_result_t<Fn, Transaction&>>)
 auto Document::transact(Fn&& fn) -> std::invoke_result_t<Fn, Transaction&> {
-    auto lock = std::unique_lock{mutex_};
+    auto lock = WriteGuard{*this};
+    materialize();
     auto tx = Transaction{*state_};
     auto result = fn(tx);
     tx.commit();
@@ -398,7 +1018,8 @@ template <typename Fn>
              std::is_void_v<std::invoke_result_t<Fn, Transaction&>> &&
              (!std::convertible_to<Fn, std::function<void(Transaction&)>>)
 void Document::transact(Fn&& fn) {
-    auto lock = std::unique_lock{mutex_};
+    auto lock = WriteGuard{*this};
+    materialize();
     auto tx = Transaction{*state_};
     fn(tx);
     tx.commit();
@@ -409,7 +1030,8 @@ template <typename Fn>
              (!std::is_void_v<std::invoke_result_t<Fn, Transaction&>>)
 auto Document::transact_with_patches(Fn&& fn)
     -> std::pair<std::invoke_result_t<Fn, Transaction&>, std::vector<Patch>> {
-    auto lock = std::unique_lock{mutex_};
+    auto lock = WriteGuard{*this};
+    materialize();
     auto tx = Transaction{*state_};
     auto result = fn(tx);
     auto ops = tx.pending_ops_;
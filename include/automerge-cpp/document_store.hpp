@@ -0,0 +1,192 @@
+/// @file document_store.hpp
+/// @brief DocumentStore: many documents by id, with LRU residency.
+
+#pragma once
+
+#include <automerge-cpp/document.hpp>
+#include <automerge-cpp/thread_pool.hpp>
+#include <automerge-cpp/types.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace automerge_cpp {
+
+/// Where a DocumentStore keeps the saved bytes of evicted documents.
+///
+/// The bytes a store hands over load with Document::load: a document chunk
+/// optionally followed by change chunks. Implementations must be safe to
+/// call from the thread using the store (calls are made one at a time).
+class DocumentBackend {
+public:
+    virtual ~DocumentBackend() = default;
+
+    /// Replace the bytes stored for id.
+    virtual void store(const std::string& id, std::vector<std::byte> bytes) = 0;
+
+    /// Append change chunks to the bytes stored for id. The default
+    /// fetches, appends and stores.
+    virtual void append(const std::string& id, std::span<const std::byte> bytes);
+
+    /// The bytes stored for id, or nullopt if there are none.
+    virtual auto fetch(const std::string& id) -> std::optional<std::vector<std::byte>> = 0;
+
+    /// Drop the bytes stored for id (if any).
+    virtual void remove(const std::string& id) = 0;
+};
+
+/// Options for DocumentStore.
+struct DocumentStoreOptions {
+    /// At most this many documents are kept materialized (0 = no limit).
+    std::size_t max_resident = 1024;
+
+    /// Estimated bytes the resident documents may use (0 = no limit).
+    std::size_t memory_budget = 0;
+
+    /// Where evicted documents go. nullptr = an in-memory backend owned by
+    /// the store, which keeps each evicted document as its saved bytes.
+    std::shared_ptr<DocumentBackend> backend = nullptr;
+
+    /// The pool every document of the store uses. nullptr = sequential.
+    std::shared_ptr<thread_pool> pool = nullptr;
+
+    /// Estimate a resident document's memory use. Called on every open(),
+    /// under the store's lock, so it should be cheap. nullptr = an O(1)
+    /// guess from the document's change, op and object counts, near
+    /// Document::stats().memory.total() (which walks the document). A
+    /// document still encoded (Document::load_lazy) is sized as decoded,
+    /// from the change and op counts stored with it.
+    std::function<std::size_t(const Document&)> estimate_memory = nullptr;
+
+    /// Used when evicting a document.
+    SaveOptions save_options = {};
+
+    /// Used when bringing an evicted document back.
+    LoadOptions load_options = {};
+};
+
+/// Counters for a DocumentStore (see DocumentStore::metrics).
+struct DocumentStoreMetrics {
+    std::uint64_t hits = 0;              ///< open() found the document resident.
+    std::uint64_t misses = 0;            ///< open() loaded it from the backend.
+    std::uint64_t load_failures = 0;     ///< Backend bytes that did not load.
+    std::uint64_t evictions = 0;         ///< Documents dropped from memory.
+    std::uint64_t full_saves = 0;        ///< Evictions or flushes that stored save().
+    std::uint64_t incremental_saves = 0; ///< Evictions or flushes that appended changes.
+    std::uint64_t bytes_written = 0;     ///< Bytes handed to the backend.
+    std::size_t documents = 0;           ///< Documents known to the store.
+    std::size_t resident_documents = 0;  ///< Of those, materialized now.
+    std::size_t resident_bytes = 0;      ///< Their estimated memory use.
+};
+
+/// An in-process set of documents keyed by id, of which only a working set
+/// is kept in memory.
+///
+/// open() hands out a shared_ptr to a resident document, loading it from
+/// the backend first if it was evicted. Documents are kept in LRU order;
+/// once more than max_resident are resident, or their estimated memory use
+/// exceeds memory_budget, the least recently opened ones are saved to the
+/// backend and dropped. A document is never evicted while a shared_ptr
+/// from open() is held outside the store, so edits through it are never
+/// lost. Evicting an unchanged document writes nothing; a changed one
+/// that came from the backend appends just its new changes
+/// (Document::save_incremental) until they outgrow the stored snapshot,
+/// when a full save() replaces it.
+///
+/// Documents the store creates or loads use the store's thread pool; one
+/// given to insert() keeps its own until it is evicted and loaded back.
+/// Evicted documents come back with Document::load_lazy, so their changes
+/// are decoded on first use; until then they count as their decoded size.
+///
+/// The store is thread-safe; loads and saves run under its lock.
+///
+/// @code
+/// auto store = DocumentStore{{.max_resident = 10'000}};
+/// auto doc = store.create("doc-42");
+/// doc->transact([](auto& tx) { tx.put(root, "title", std::string{"hi"}); });
+/// doc.reset();  // now evictable
+/// auto again = store.open("doc-42");  // resident, or loaded back
+/// @endcode
+class DocumentStore {
+public:
+    explicit DocumentStore(DocumentStoreOptions options = {});
+    ~DocumentStore();
+
+    DocumentStore(const DocumentStore&) = delete;
+    auto operator=(const DocumentStore&) -> DocumentStore& = delete;
+
+    /// Create an empty document under id (replacing any other document
+    /// with that id) and return it, resident.
+    auto create(const std::string& id) -> std::shared_ptr<Document>;
+
+    /// Add a document under id (replacing any other document with that id)
+    /// and return it, resident. It keeps its own pool while resident; loaded
+    /// back after an eviction, it uses the store's.
+    auto insert(const std::string& id, Document doc) -> std::shared_ptr<Document>;
+
+    /// The document with this id, made resident and most recently used.
+    /// An id the store does not know is looked up in the backend.
+    /// @return nullptr if there is no such document or its bytes do not load.
+    auto open(const std::string& id) -> std::shared_ptr<Document>;
+
+    /// Whether the store knows a document with this id (resident or not).
+    auto contains(const std::string& id) const -> bool;
+
+    /// Whether the document with this id is resident.
+    auto is_resident(const std::string& id) const -> bool;
+
+    /// Forget the document with this id and drop its bytes from the backend.
+    /// @return false if the store did not know it.
+    auto erase(const std::string& id) -> bool;
+
+    /// Evict the document with this id now, if it is resident and not held.
+    /// @return true if it was evicted.
+    auto evict(const std::string& id) -> bool;
+
+    /// Write every changed resident document to the backend, keeping it
+    /// resident.
+    void flush();
+
+    /// Counters and current residency.
+    auto metrics() const -> DocumentStoreMetrics;
+
+    /// The pool documents of this store use (may be nullptr).
+    auto get_thread_pool() const -> std::shared_ptr<thread_pool>;
+
+private:
+    struct Entry {
+        std::shared_ptr<Document> doc;               // nullptr while evicted
+        std::list<std::string>::iterator lru;        // valid while resident
+        std::size_t estimated_bytes = 0;             // while resident
+        bool in_backend = false;                     // bytes stored for it
+        std::vector<ChangeHash> stored_heads;        // heads of the stored bytes
+        std::size_t stored_snapshot_bytes = 0;       // size of the last full save
+        std::size_t stored_appended_bytes = 0;       // change chunks appended since
+    };
+
+    auto make_resident(const std::string& id, Entry& entry, std::shared_ptr<Document> doc)
+        -> std::shared_ptr<Document>;
+    auto estimate(const Document& doc) const -> std::size_t;
+    void write_back(const std::string& id, Entry& entry);
+    void drop(Entry& entry);
+    auto evictable(const Entry& entry) const -> bool;
+    void enforce_limits();
+
+    DocumentStoreOptions options_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::list<std::string> lru_;  // resident ids, most recently used first
+    std::size_t resident_bytes_ = 0;
+    DocumentStoreMetrics metrics_;
+};
+
+}  // namespace automerge_cpp
@@ -22,6 +22,7 @@
 
 #include <map>
 #include <optional>
+#include <ostream>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -85,6 +86,20 @@ namespace json {
 /// @param obj The root of the subtree to export (default: document root).
 auto export_json(const Document& doc, const ObjId& obj = root) -> nlohmann::json;
 
+/// Serialize a document (or subtree) straight to JSON text.
+///
+/// Produces the same JSON as export_json(doc, obj).dump() but in one pass
+/// over the document, without building an intermediate nlohmann::json
+/// tree. Output is flushed to the stream in large blocks.
+/// @param doc The document to serialize.
+/// @param out The stream to write to.
+/// @param obj The root of the subtree to serialize (default: document root).
+void write_json(const Document& doc, std::ostream& out, const ObjId& obj = root);
+
+/// Serialize a document (or subtree) to a compact JSON string.
+/// @see write_json
+auto dump_json(const Document& doc, const ObjId& obj = root) -> std::string;
+
 /// Export a document subtree as it was at a historical point.
 auto export_json_at(const Document& doc,
                     const std::vector<ChangeHash>& heads,
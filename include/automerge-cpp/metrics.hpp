@@ -0,0 +1,238 @@
+/// @file metrics.hpp
+/// @brief Optional timing of hot phases and document lock waits.
+///
+/// Off unless the library is built with AUTOMERGE_CPP_ENABLE_METRICS=1
+/// (CMake option AUTOMERGE_CPP_ENABLE_METRICS). When off, the timers
+/// compile to nothing, snapshot() returns zeros and set_sink() is a no-op.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+#ifndef AUTOMERGE_CPP_ENABLE_METRICS
+#define AUTOMERGE_CPP_ENABLE_METRICS 0
+#endif
+
+#if AUTOMERGE_CPP_ENABLE_METRICS
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <memory>
+#include <utility>
+#endif
+
+namespace automerge_cpp::metrics {
+
+/// Whether this build records anything.
+inline constexpr bool enabled = AUTOMERGE_CPP_ENABLE_METRICS != 0;
+
+/// What is timed. Each event is one call (a batch counts once).
+enum class Phase : std::uint8_t {
+    apply_op,            ///< Applying one op to the object tree.
+    hash_changes,        ///< SHA-256 of a change, or of a batch of changes.
+    bloom_build,         ///< Building the "have" bloom filter for a sync message.
+    column_encode,       ///< Encoding the columns of a document or change chunk.
+    column_decode,       ///< Decoding the changes of a document or change chunk.
+    deflate,             ///< Compressing one column.
+    inflate,             ///< Decompressing one column.
+    transaction_commit,  ///< Turning a transaction's ops into a change.
+    save,                ///< Document::save.
+    load,                ///< Document::load and load_lazy (not the deferred decode).
+    sync_generate,       ///< Generating one sync message.
+    sync_receive,        ///< Applying one sync message.
+    write_lock_wait,     ///< Waiting for a document's write lock.
+    write_lock_hold,     ///< Holding it.
+    read_lock_wait,      ///< Waiting for a document's read lock.
+    read_lock_hold,      ///< Holding it.
+};
+
+inline constexpr std::size_t phase_count = static_cast<std::size_t>(Phase::read_lock_hold) + 1;
+
+/// Histogram buckets: bucket b counts durations of n nanoseconds with
+/// std::bit_width(n) == b, i.e. in [2^(b-1), 2^b); the last is open-ended.
+inline constexpr std::size_t histogram_buckets = 40;
+
+/// The name of a phase, e.g. for a metric label.
+constexpr auto to_string_view(Phase phase) noexcept -> std::string_view {
+    constexpr auto names = std::array<std::string_view, phase_count>{
+        "apply_op", "hash_changes", "bloom_build", "column_encode", "column_decode",
+        "deflate", "inflate", "transaction_commit", "save", "load", "sync_generate",
+        "sync_receive", "write_lock_wait", "write_lock_hold", "read_lock_wait",
+        "read_lock_hold",
+    };
+    return names[static_cast<std::size_t>(phase)];
+}
+
+/// Totals for one phase since start-up or the last reset().
+struct PhaseStats {
+    std::uint64_t count = 0;     ///< Events.
+    std::uint64_t total_ns = 0;  ///< Their summed duration.
+    std::uint64_t max_ns = 0;    ///< The longest.
+    std::array<std::uint64_t, histogram_buckets> histogram{};  ///< By duration (see histogram_buckets).
+};
+
+/// Every phase's totals, read one counter at a time (not an atomic snapshot
+/// across counters).
+struct Snapshot {
+    std::array<PhaseStats, phase_count> phases{};
+
+    auto operator[](Phase phase) const -> const PhaseStats& {
+        return phases[static_cast<std::size_t>(phase)];
+    }
+};
+
+/// Called with every event as it is recorded, on the thread that recorded
+/// it (often with a document lock held): keep it short.
+using Sink = std::function<void(Phase, std::uint64_t nanoseconds)>;
+
+#if AUTOMERGE_CPP_ENABLE_METRICS
+
+namespace detail {
+
+struct alignas(64) PhaseCounters {
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> total_ns{0};
+    std::atomic<std::uint64_t> max_ns{0};
+    std::array<std::atomic<std::uint64_t>, histogram_buckets> histogram{};
+};
+
+inline std::array<PhaseCounters, phase_count> counters;
+inline std::atomic<std::shared_ptr<const Sink>> sink;
+inline std::atomic<bool> has_sink{false};
+
+inline void record(Phase phase, std::uint64_t ns) {
+    auto& c = counters[static_cast<std::size_t>(phase)];
+    c.count.fetch_add(1, std::memory_order_relaxed);
+    c.total_ns.fetch_add(ns, std::memory_order_relaxed);
+    auto max = c.max_ns.load(std::memory_order_relaxed);
+    while (ns > max && !c.max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+    auto bucket = std::min<std::size_t>(std::bit_width(ns), histogram_buckets - 1);
+    c.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    if (has_sink.load(std::memory_order_relaxed)) {
+        if (auto s = sink.load(std::memory_order_acquire)) (*s)(phase, ns);
+    }
+}
+
+inline auto now() -> std::chrono::steady_clock::time_point {
+    return std::chrono::steady_clock::now();
+}
+
+inline auto elapsed_ns(std::chrono::steady_clock::time_point since) -> std::uint64_t {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now() - since).count());
+}
+
+// Records the time from construction to destruction.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Phase phase) : phase_{phase}, start_{now()} {}
+    ~ScopedTimer() { record(phase_, elapsed_ns(start_)); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    auto operator=(const ScopedTimer&) -> ScopedTimer& = delete;
+
+private:
+    Phase phase_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Times acquiring a lock, and holding it until the timer is destroyed
+// (declare it after the lock so it goes first). Moves with its guard.
+class LockTimer {
+public:
+    LockTimer() = default;
+    LockTimer(LockTimer&& other) noexcept
+        : hold_{other.hold_}, acquired_{other.acquired_}, armed_{std::exchange(other.armed_, false)} {}
+    auto operator=(LockTimer&&) -> LockTimer& = delete;
+    ~LockTimer() {
+        if (armed_) record(hold_, elapsed_ns(acquired_));
+    }
+
+    template <typename Lock>
+    void lock(Lock& lock, Phase wait, Phase hold) {
+        auto start = now();
+        lock.lock();
+        acquired_ = now();
+        record(wait, static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(acquired_ - start).count()));
+        hold_ = hold;
+        armed_ = true;
+    }
+
+private:
+    Phase hold_{};
+    std::chrono::steady_clock::time_point acquired_{};
+    bool armed_ = false;
+};
+
+}  // namespace detail
+
+/// Every phase's totals.
+inline auto snapshot() -> Snapshot {
+    auto result = Snapshot{};
+    for (std::size_t p = 0; p < phase_count; ++p) {
+        const auto& c = detail::counters[p];
+        auto& out = result.phases[p];
+        out.count = c.count.load(std::memory_order_relaxed);
+        out.total_ns = c.total_ns.load(std::memory_order_relaxed);
+        out.max_ns = c.max_ns.load(std::memory_order_relaxed);
+        for (std::size_t b = 0; b < histogram_buckets; ++b) {
+            out.histogram[b] = c.histogram[b].load(std::memory_order_relaxed);
+        }
+    }
+    return result;
+}
+
+/// Zero every phase's totals.
+inline void reset() {
+    for (auto& c : detail::counters) {
+        c.count.store(0, std::memory_order_relaxed);
+        c.total_ns.store(0, std::memory_order_relaxed);
+        c.max_ns.store(0, std::memory_order_relaxed);
+        for (auto& bucket : c.histogram) bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+/// Forward every event to sink (nullptr or an empty function = none).
+/// Events being recorded concurrently may still reach the previous sink.
+inline void set_sink(Sink sink) {
+    auto shared = sink ? std::make_shared<const Sink>(std::move(sink)) : nullptr;
+    detail::has_sink.store(shared != nullptr, std::memory_order_relaxed);
+    detail::sink.store(std::move(shared), std::memory_order_release);
+}
+
+#define AUTOMERGE_CPP_METRICS_CONCAT_(a, b) a##b
+#define AUTOMERGE_CPP_METRICS_CONCAT(a, b) AUTOMERGE_CPP_METRICS_CONCAT_(a, b)
+
+/// Time the rest of the enclosing scope as phase.
+#define AUTOMERGE_CPP_TIME_PHASE(phase)                                           \
+    ::automerge_cpp::metrics::detail::ScopedTimer AUTOMERGE_CPP_METRICS_CONCAT(  \
+        automerge_cpp_phase_timer_, __LINE__){phase}
+
+#else  // !AUTOMERGE_CPP_ENABLE_METRICS
+
+namespace detail {
+
+class LockTimer {
+public:
+    template <typename Lock>
+    void lock(Lock& lock, Phase, Phase) {
+        lock.lock();
+    }
+};
+
+}  // namespace detail
+
+inline auto snapshot() -> Snapshot { return {}; }
+inline void reset() {}
+inline void set_sink(Sink) {}
+
+#define AUTOMERGE_CPP_TIME_PHASE(phase) static_cast<void>(0)
+
+#endif  // AUTOMERGE_CPP_ENABLE_METRICS
+
+}  // namespace automerge_cpp::metrics
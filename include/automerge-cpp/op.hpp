@@ -8,6 +8,7 @@
 
 #include <cstdint>
 #include <optional>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -52,6 +53,18 @@ struct Op {
     std::vector<OpId> pred;                  ///< Predecessor ops (for conflict tracking).
     std::optional<OpId> insert_after{};      ///< For insert/splice: the element to insert after.
 
+    /// Number of consecutive OpIds this operation occupies.
+    ///
+    /// A splice_text op inserting n bytes covers counters
+    /// [id.counter, id.counter + n), one text element per byte, each
+    /// inserted after the previous one. Every other operation occupies one.
+    auto width() const -> std::uint64_t {
+        if (action != OpType::splice_text) return 1;
+        const auto* sv = std::get_if<ScalarValue>(&value);
+        const auto* s = sv ? std::get_if<std::string>(sv) : nullptr;
+        return s && !s->empty() ? static_cast<std::uint64_t>(s->size()) : 1;
+    }
+
     auto operator==(const Op&) const -> bool = default;
 };
 
@@ -66,12 +66,16 @@ using PatchAction = std::variant<
 
 /// A single patch describing one atomic change to the document.
 ///
-/// Patches are produced by Document::transact_with_patches() and
-/// describe the externally visible effects of a transaction.
+/// Patches are produced by Document::transact_with_patches() for local
+/// transactions, and by apply_changes_with_patches(), merge_with_patches()
+/// and receive_sync_message_with_patches() for remote changes. They
+/// describe the externally visible effects of those changes.
 struct Patch {
     ObjId obj;            ///< The object that was modified.
     Prop key;             ///< The property or index that was modified.
     PatchAction action;   ///< What happened.
+    Path path = {};       ///< Path from the root to obj (empty for root, or
+                          ///< if obj was not reachable from the root).
 
     auto operator==(const Patch&) const -> bool = default;
 };
@@ -0,0 +1,289 @@
+/// @file read_view.hpp
+/// @brief ReadView: borrowed, copy-free reads of a Document.
+
+#pragma once
+
+#include <automerge-cpp/types.hpp>
+#include <automerge-cpp/value.hpp>
+#include <automerge-cpp/value_ref.hpp>
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <shared_mutex>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace automerge_cpp {
+
+namespace detail {
+struct DocState;
+
+/// Internal: a position in a list or text object's element sequence.
+struct SequencePosition {
+    const void* leaf = nullptr;
+    std::size_t run = 0;
+    std::size_t offset = 0;
+    const void* tree = nullptr;
+    std::size_t leaf_start = 0;
+
+    auto operator==(const SequencePosition&) const -> bool = default;
+};
+}  // namespace detail
+
+/// A map key and its winning value, borrowed from a document.
+struct MapEntryRef {
+    std::string_view key;  ///< The key.
+    ValueRef value;        ///< The winning value at the key.
+    OpId id;               ///< The op that set it; a nested object's ObjId is ObjId{id}.
+};
+
+/// A visible list or text element, borrowed from a document.
+struct ElementRef {
+    std::size_t index;  ///< The element's index among visible elements.
+    ValueRef value;     ///< The element's value.
+    OpId id;            ///< The op that inserted it; a nested object's ObjId is ObjId{id}.
+};
+
+/// The entries of a map or table in ascending key order.
+///
+/// Holds one array of borrowed entries; no key or value is copied.
+class MapRange {
+public:
+    using iterator = std::vector<MapEntryRef>::const_iterator;
+
+    auto begin() const -> iterator { return entries_.begin(); }
+    auto end() const -> iterator { return entries_.end(); }
+    auto size() const -> std::size_t { return entries_.size(); }
+    auto empty() const -> bool { return entries_.empty(); }
+
+private:
+    friend class ReadView;
+    std::vector<MapEntryRef> entries_;
+};
+
+/// Visible elements of a list or text object, in order.
+///
+/// Iterates the document's element storage directly: nothing is allocated
+/// or copied. Each element of a text object is a one-byte string_view.
+class ListRange {
+public:
+    /// Forward iterator yielding an ElementRef per visible element.
+    class iterator {
+    public:
+        using value_type = ElementRef;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::forward_iterator_tag;
+
+        iterator() = default;
+
+        auto operator*() const -> ElementRef;
+        auto operator++() -> iterator&;
+        auto operator++(int) -> iterator {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        auto operator==(const iterator& other) const -> bool { return at_ == other.at_; }
+
+    private:
+        friend class ReadView;
+        iterator(detail::SequencePosition at, std::size_t index) : at_{at}, index_{index} {}
+        detail::SequencePosition at_;
+        std::size_t index_ = 0;
+    };
+
+    auto begin() const -> iterator { return begin_; }
+    auto end() const -> iterator { return end_; }
+    auto size() const -> std::size_t { return size_; }
+    auto empty() const -> bool { return size_ == 0; }
+
+private:
+    friend class ReadView;
+    iterator begin_;
+    iterator end_;
+    std::size_t size_ = 0;
+};
+
+/// The visible content of a text object as contiguous chunks, in order.
+///
+/// Concatenating the chunks gives Document::text(). Each chunk views the
+/// document's own text buffer; nothing is allocated or copied.
+class TextChunks {
+public:
+    /// Forward iterator yielding a non-empty string_view per chunk.
+    class iterator {
+    public:
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::forward_iterator_tag;
+
+        iterator() = default;
+
+        auto operator*() const -> std::string_view;
+        auto operator++() -> iterator&;
+        auto operator++(int) -> iterator {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        auto operator==(const iterator&) const -> bool = default;
+
+    private:
+        friend class ReadView;
+        explicit iterator(detail::SequencePosition at) : at_{at} {}
+        detail::SequencePosition at_;
+    };
+
+    auto begin() const -> iterator { return begin_; }
+    auto end() const -> iterator { return {}; }
+
+private:
+    friend class ReadView;
+    iterator begin_;
+};
+
+/// The visible T values of a list as contiguous spans, in order, where T
+/// is double or std::int64_t.
+///
+/// A run of T values appended one after another is stored packed, so a
+/// list of samples reads as a few long spans of the document's own
+/// storage; nothing is allocated or copied. Elements of any other type are
+/// skipped: the list holds only T values when the span sizes add up to
+/// ReadView::length().
+template <typename T>
+class ScalarChunks {
+public:
+    /// Forward iterator yielding a non-empty span per chunk.
+    class iterator {
+    public:
+        using value_type = std::span<const T>;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::forward_iterator_tag;
+
+        iterator() = default;
+
+        auto operator*() const -> std::span<const T>;
+        auto operator++() -> iterator&;
+        auto operator++(int) -> iterator {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        auto operator==(const iterator&) const -> bool = default;
+
+    private:
+        friend class ReadView;
+        explicit iterator(detail::SequencePosition at) : at_{at} {}
+        detail::SequencePosition at_;
+    };
+
+    auto begin() const -> iterator { return begin_; }
+    auto end() const -> iterator { return {}; }
+
+private:
+    friend class ReadView;
+    iterator begin_;
+};
+
+extern template class ScalarChunks<double>;
+extern template class ScalarChunks<std::int64_t>;
+
+/// Copy-free reads of a Document, obtained from Document::read_view().
+///
+/// Strings, bytes and keys returned by a ReadView are views of the
+/// document's own storage, and ranges iterate that storage in place. They
+/// stay valid as long as the ReadView does.
+///
+/// With snapshot reads enabled, a ReadView pins the snapshot published when
+/// it was created: it sees that state throughout, and writers go on without
+/// waiting for it. Otherwise it reads the live state, holding the read lock
+/// if read locking is enabled (so writes block, and a write from the same
+/// thread deadlocks), and its views are invalidated by the next write.
+///
+/// @code
+/// auto view = doc.read_view();
+/// for (auto key : view.keys(root)) { ... }            // string_view
+/// auto name = get_scalar<std::string_view>(view.get(root, "name"));
+/// for (auto chunk : view.text_chunks(text_id)) out.append(chunk);
+/// @endcode
+class ReadView {
+public:
+    ReadView(ReadView&&) noexcept = default;
+    auto operator=(ReadView&&) noexcept -> ReadView& = default;
+    ~ReadView() = default;
+
+    /// Get the winning value at a map key (see Document::get).
+    auto get(const ObjId& obj, std::string_view key) const -> std::optional<ValueRef>;
+
+    /// Get the value at a list index (see Document::get).
+    auto get(const ObjId& obj, std::size_t index) const -> std::optional<ValueRef>;
+
+    /// The entries of a map or table in ascending key order (empty for
+    /// other objects). Allocates one array to order the keys.
+    auto entries(const ObjId& obj) const -> MapRange;
+
+    /// The keys of a map or table in ascending order, as string_views.
+    auto keys(const ObjId& obj) const {
+        return entries(obj) | std::views::transform(&MapEntryRef::key);
+    }
+
+    /// The values of a map or table in key order. For a list or text
+    /// object use elements().
+    auto values(const ObjId& obj) const {
+        return entries(obj) | std::views::transform(&MapEntryRef::value);
+    }
+
+    /// The visible elements of a list or text object (empty for others).
+    auto elements(const ObjId& obj) const -> ListRange;
+
+    /// The visible elements with index in [first, last), clamped to the
+    /// object's length. Finding first is O(log n).
+    auto elements(const ObjId& obj, std::size_t first, std::size_t last) const -> ListRange;
+
+    /// The content of a text object as contiguous chunks (empty for others).
+    auto text_chunks(const ObjId& obj) const -> TextChunks;
+
+    /// The double or int64_t values of a list as contiguous spans (empty
+    /// for other objects).
+    /// @code
+    /// for (auto chunk : view.scalar_chunks<double>(samples)) sum += kernel(chunk);
+    /// @endcode
+    template <typename T>
+        requires std::same_as<T, double> || std::same_as<T, std::int64_t>
+    auto scalar_chunks(const ObjId& obj) const -> ScalarChunks<T>;
+
+    /// Number of keys (map/table) or visible elements (list/text).
+    auto length(const ObjId& obj) const -> std::size_t;
+
+    /// The type of an object, or nullopt if it does not exist.
+    auto object_type(const ObjId& obj) const -> std::optional<ObjType>;
+
+    /// The ObjId of the nested object at a map key (see Document::get_obj_id).
+    auto get_obj_id(const ObjId& obj, std::string_view key) const -> std::optional<ObjId>;
+
+    /// The ObjId of the nested object at a list index.
+    auto get_obj_id(const ObjId& obj, std::size_t index) const -> std::optional<ObjId>;
+
+private:
+    friend class Document;
+
+    ReadView(std::shared_ptr<const detail::DocState> pinned,
+             std::shared_lock<std::shared_mutex> lock, const detail::DocState* state)
+        : pinned_{std::move(pinned)}, lock_{std::move(lock)}, state_{state} {}
+
+    std::shared_ptr<const detail::DocState> pinned_;  // the snapshot read, if any
+    std::shared_lock<std::shared_mutex> lock_;        // held when reading the live state
+    const detail::DocState* state_;
+};
+
+}  // namespace automerge_cpp
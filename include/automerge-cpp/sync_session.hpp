@@ -0,0 +1,249 @@
+/// @file sync_session.hpp
+/// @brief SyncSession: drives the sync protocol with one peer over a transport.
+
+#pragma once
+
+#include <automerge-cpp/document.hpp>
+#include <automerge-cpp/sync_state.hpp>
+#include <automerge-cpp/thread_pool.hpp>
+
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace automerge_cpp {
+
+/// Something a SyncSession can hand encoded sync messages to.
+///
+/// send() may be called from any thread, but never concurrently for the
+/// same session.
+template <typename T>
+concept SyncTransport = requires(T& transport, std::vector<std::byte> message) {
+    transport.send(std::move(message));
+};
+
+/// Counters for a SyncSession (see SyncSession::metrics).
+struct SyncSessionMetrics {
+    std::uint64_t messages_received = 0;  ///< Messages queued by receive().
+    std::uint64_t messages_rejected = 0;  ///< Encoded messages that did not decode.
+    std::uint64_t receive_batches = 0;    ///< Write-lock acquisitions to apply them.
+    std::uint64_t messages_sent = 0;      ///< Messages handed to the transport.
+    std::uint64_t rounds = 0;             ///< Times queued work was processed.
+    std::uint64_t rounds_failed = 0;      ///< Rounds ended by an exception.
+};
+
+/// Drives the sync protocol with one peer: owns the peer's SyncState,
+/// applies the messages it sends and hands ours to a transport.
+///
+/// Work is queued, not done on the caller's thread: receive() queues an
+/// incoming message and notify_local_change() notes that the document has
+/// changed. A round then applies every queued message with a single
+/// Document::receive_sync_messages() (one write lock however many arrived
+/// meanwhile) and generates and sends messages until the protocol has
+/// nothing more to say. Local changes made while a round is pending are
+/// covered by that round, so a burst of transactions costs one round.
+///
+/// With a thread pool (the document's, unless one is given), rounds are
+/// scheduled on it, at most one per session at a time. Without one, call
+/// poll() to run a round on the calling thread. The document and transport
+/// must outlive the session; the destructor waits for a scheduled round.
+///
+/// If the transport or the document throws, the round stops and the session
+/// goes idle. The message being sent is lost, so the peer's sync state is
+/// reset to what SyncState::encode() keeps (the shared heads), as after a
+/// reconnect, and a local change is noted: the next round (on the next
+/// receive(), notify_local_change() or poll()) starts the exchange again.
+/// The exception reaches the caller of poll(), or, from a scheduled round,
+/// the next caller of wait_idle(). Messages the round had taken off the
+/// queue are dropped; the peer resends what it is still missing.
+///
+/// @code
+/// struct Socket { void send(std::vector<std::byte> bytes); };
+/// auto session = SyncSession{doc, socket};
+/// session.notify_local_change();       // say hello
+/// // on each incoming frame:
+/// session.receive(frame);
+/// // after local edits:
+/// doc.transact(...);
+/// session.notify_local_change();
+/// @endcode
+template <SyncTransport Transport>
+class SyncSession {
+public:
+    /// @param doc The document to sync.
+    /// @param transport Where outgoing messages go.
+    /// @param state The peer's sync state (e.g. SyncState::decode of a saved one).
+    SyncSession(Document& doc, Transport& transport, SyncState state = {})
+        : SyncSession{doc, transport, doc.get_thread_pool(), std::move(state)} {}
+
+    /// As above, scheduling rounds on pool (nullptr = only poll()).
+    SyncSession(Document& doc, Transport& transport, std::shared_ptr<thread_pool> pool,
+                SyncState state = {})
+        : doc_{doc}, transport_{transport}, pool_{std::move(pool)}, state_{std::move(state)} {}
+
+    ~SyncSession() {
+        auto lock = std::unique_lock{mutex_};
+        idle_.wait(lock, [&] { return !busy_; });
+    }
+
+    SyncSession(const SyncSession&) = delete;
+    auto operator=(const SyncSession&) -> SyncSession& = delete;
+
+    /// Queue an encoded message from the peer.
+    /// @return false (and nothing is queued) if the bytes do not decode.
+    auto receive(std::span<const std::byte> bytes) -> bool {
+        auto message = SyncMessage::decode(bytes);
+        if (!message) {
+            auto lock = std::scoped_lock{mutex_};
+            ++metrics_.messages_rejected;
+            return false;
+        }
+        receive(std::move(*message));
+        return true;
+    }
+
+    /// Queue a decoded message from the peer.
+    void receive(SyncMessage message) {
+        {
+            auto lock = std::scoped_lock{mutex_};
+            incoming_.push_back(std::move(message));
+            ++metrics_.messages_received;
+        }
+        schedule();
+    }
+
+    /// Note that the document changed (or that a first message is due).
+    void notify_local_change() {
+        {
+            auto lock = std::scoped_lock{mutex_};
+            changed_ = true;
+        }
+        schedule();
+    }
+
+    /// Run queued work on the calling thread.
+    /// @return The number of messages sent (0 if a scheduled round is
+    ///   already running; it picks up anything queued).
+    auto poll() -> std::size_t {
+        {
+            auto lock = std::scoped_lock{mutex_};
+            if (busy_) return 0;
+            busy_ = true;
+        }
+        return run(false);
+    }
+
+    /// Wait until no round is scheduled or running.
+    /// @throws The exception that ended a scheduled round since the last
+    ///   call, if any.
+    void wait_idle() {
+        auto lock = std::unique_lock{mutex_};
+        idle_.wait(lock, [&] { return !busy_; });
+        if (auto failure = std::exchange(failure_, nullptr)) std::rethrow_exception(failure);
+    }
+
+    /// A copy of the peer's sync state, for persisting (SyncState::encode).
+    auto sync_state() const -> SyncState {
+        auto lock = std::scoped_lock{state_mutex_};
+        return state_;
+    }
+
+    auto metrics() const -> SyncSessionMetrics {
+        auto lock = std::scoped_lock{mutex_};
+        return metrics_;
+    }
+
+private:
+    void schedule() {
+        if (!pool_) return;
+        {
+            auto lock = std::scoped_lock{mutex_};
+            if (busy_) return;  // the running round will see the new work
+            busy_ = true;
+        }
+        pool_->push_task([this] { run(true); });
+    }
+
+    // Rounds until nothing is queued; busy_ is held by the caller and
+    // released here, also if a round throws. A scheduled round keeps the
+    // exception for wait_idle(), as nothing could catch it on the pool.
+    auto run(bool scheduled) -> std::size_t {
+        try {
+            return run_rounds();
+        } catch (...) {
+            {
+                auto lock = std::scoped_lock{state_mutex_};
+                auto reset = SyncState::decode(state_.encode()).value_or(SyncState{});
+                reset.set_message_budget(state_.max_changes_per_message(),
+                                         state_.max_bytes_per_message());
+                state_ = std::move(reset);
+            }
+            auto lock = std::scoped_lock{mutex_};
+            changed_ = true;
+            ++metrics_.rounds_failed;
+            busy_ = false;
+            idle_.notify_all();
+            if (!scheduled) throw;
+            failure_ = std::current_exception();
+            return 0;
+        }
+    }
+
+    auto run_rounds() -> std::size_t {
+        auto sent = std::size_t{0};
+        auto batch = std::vector<SyncMessage>{};
+        for (;;) {
+            {
+                auto lock = std::scoped_lock{mutex_};
+                if (incoming_.empty() && !changed_) {
+                    busy_ = false;
+                    idle_.notify_all();
+                    return sent;
+                }
+                batch.swap(incoming_);
+                changed_ = false;
+                ++metrics_.rounds;
+                if (!batch.empty()) ++metrics_.receive_batches;
+            }
+
+            auto round_sent = std::uint64_t{0};
+            {
+                auto lock = std::scoped_lock{state_mutex_};
+                doc_.receive_sync_messages(state_, batch);
+                while (auto message = doc_.generate_sync_message_encoded(state_)) {
+                    transport_.send(std::move(*message));
+                    ++round_sent;
+                }
+            }
+            batch.clear();
+            sent += round_sent;
+
+            auto lock = std::scoped_lock{mutex_};
+            metrics_.messages_sent += round_sent;
+        }
+    }
+
+    Document& doc_;
+    Transport& transport_;
+    std::shared_ptr<thread_pool> pool_;
+
+    mutable std::mutex state_mutex_;  // held by a round, and by sync_state()
+    SyncState state_;
+
+    mutable std::mutex mutex_;  // guards what follows
+    std::condition_variable idle_;
+    std::vector<SyncMessage> incoming_;
+    bool changed_ = false;
+    bool busy_ = false;  // a round is scheduled or running
+    std::exception_ptr failure_;  // from a scheduled round, for wait_idle()
+    SyncSessionMetrics metrics_;
+};
+
+}  // namespace automerge_cpp
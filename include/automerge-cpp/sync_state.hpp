@@ -8,9 +8,10 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <optional>
-#include <set>
 #include <span>
+#include <unordered_set>
 #include <vector>
 
 namespace automerge_cpp {
@@ -35,6 +36,14 @@ struct SyncMessage {
     std::vector<Have> have;           ///< Bloom filter summaries of what the sender has.
     std::vector<Change> changes;      ///< Changes for the recipient to apply.
 
+    /// Encode in the Automerge sync wire format: message type 0x42, heads,
+    /// need, have, then each change as a length-prefixed change chunk.
+    auto encode() const -> std::vector<std::byte>;
+
+    /// Decode a message produced by encode().
+    /// @return The decoded message, or nullopt if the data is invalid.
+    static auto decode(std::span<const std::byte> data) -> std::optional<SyncMessage>;
+
     auto operator==(const SyncMessage&) const -> bool = default;
 };
 
@@ -59,6 +68,26 @@ public:
         return last_sent_heads_;
     }
 
+    /// Limit the changes one sync message carries (0 = unlimited, the default).
+    ///
+    /// A catch-up larger than the budget is streamed over several messages in
+    /// causal order: generate_sync_message() keeps returning the next batch
+    /// without waiting for the peer's reply until everything has been sent.
+    /// Every message carries at least one change, so a single change larger
+    /// than max_bytes is still sent. Not persisted by encode().
+    /// @param max_changes Maximum number of changes per message.
+    /// @param max_bytes Maximum encoded change bytes per message.
+    void set_message_budget(std::size_t max_changes, std::size_t max_bytes) {
+        max_changes_per_message_ = max_changes;
+        max_bytes_per_message_ = max_bytes;
+    }
+
+    /// Maximum number of changes per message (0 = unlimited).
+    auto max_changes_per_message() const -> std::size_t { return max_changes_per_message_; }
+
+    /// Maximum encoded change bytes per message (0 = unlimited).
+    auto max_bytes_per_message() const -> std::size_t { return max_bytes_per_message_; }
+
     /// Encode persistent state (shared_heads only) for storage.
     auto encode() const -> std::vector<std::byte>;
 
@@ -85,13 +114,32 @@ private:
     std::optional<std::vector<Have>> their_have_;
 
     // Hashes we've already sent in this session
-    std::set<ChangeHash> sent_hashes_;
+    std::unordered_set<ChangeHash> sent_hashes_;
 
     // Whether there's a message in-flight (waiting for ack)
     bool in_flight_{false};
 
     // Whether we've sent at least one message
     bool have_responded_{false};
+
+    // Message budget (0 = unlimited)
+    std::size_t max_changes_per_message_{0};
+    std::size_t max_bytes_per_message_{0};
+
+    // Our last "have" summary: the changes since shared_heads and their
+    // bloom bytes, computed when our heads were our_heads and our history
+    // held history_size changes. Reused while neither heads set moves, and
+    // extended with the newly appended changes when only ours do. Immutable
+    // once built, so peers with the same shared heads share one summary.
+    struct HaveCache {
+        std::vector<ChangeHash> our_heads;
+        std::vector<ChangeHash> shared_heads;
+        std::size_t history_size{0};
+        bool shared_heads_known{false};  // every shared head was in our history
+        std::vector<ChangeHash> changes_since;
+        std::vector<std::byte> bloom_bytes;
+    };
+    std::shared_ptr<const HaveCache> have_cache_;
 };
 
 }  // namespace automerge_cpp
@@ -10,28 +10,33 @@
  *
  * @brief A C++17 thread pool for high-performance scientific computing.
  * @details A modern C++17-compatible thread pool implementation, built from scratch with high-performance scientific computing in mind. The thread pool is implemented as a single lightweight and self-contained class, and does not have any dependencies other than the C++17 standard library, thus allowing a great degree of portability. In particular, this implementation does not utilize OpenMP or any other high-level multithreading APIs, and thus gives the programmer precise low-level control over the details of the parallelization, which permits more robust optimizations. The thread pool was extensively tested on both AMD and Intel CPUs with up to 40 cores and 80 threads. Other features include automatic generation of futures and easy parallelization of loops. Two helper classes enable synchronizing printing to an output stream by different threads and measuring execution time for benchmarking purposes. Please visit the GitHub repository at https://github.com/bshoshany/thread-pool for documentation and updates, or to submit feature requests and bug reports.
+ *
+ * automerge-cpp changes: the single locked task queue and sleep-polling workers were replaced by a work-stealing scheduler (one deque per worker, idle workers parked on a condition variable) with small-buffer task storage. The public interface is unchanged.
  */
 
 #define THREAD_POOL_VERSION "v2.0.0 (2021-08-14)"
 
-#include <atomic>      // std::atomic
-#include <chrono>      // std::chrono
-#include <cstdint>     // std::int_fast64_t, std::uint_fast32_t
-#include <functional>  // std::function
-#include <future>      // std::future, std::promise
-#include <iostream>    // std::cout, std::ostream
-#include <memory>      // std::shared_ptr, std::unique_ptr
-#include <mutex>       // std::mutex, std::scoped_lock
-#include <queue>       // std::queue
-#include <thread>      // std::this_thread, std::thread
-#include <type_traits> // std::common_type_t, std::decay_t, std::enable_if_t, std::is_void_v, std::invoke_result_t
-#include <utility>     // std::move
+#include <atomic>             // std::atomic
+#include <chrono>             // std::chrono
+#include <condition_variable> // std::condition_variable
+#include <cstddef>            // std::byte, std::max_align_t, std::size_t
+#include <cstdint>            // std::int_fast64_t, std::uint_fast32_t
+#include <deque>              // std::deque
+#include <future>             // std::future, std::promise
+#include <iostream>           // std::cout, std::ostream
+#include <memory>             // std::unique_ptr
+#include <mutex>              // std::mutex, std::scoped_lock, std::unique_lock
+#include <new>                // placement new
+#include <thread>             // std::this_thread, std::thread
+#include <type_traits>        // std::common_type_t, std::decay_t, std::enable_if_t, std::is_void_v, std::invoke_result_t
+#include <utility>            // std::move
+#include <vector>             // std::vector
 
 // ============================================================================================= //
 //                                    Begin class thread_pool                                    //
 
 /**
- * @brief A C++17 thread pool class. The user submits tasks to be executed into a queue. Whenever a thread becomes available, it pops a task from the queue and executes it. Each task is automatically assigned a future, which can be used to wait for the task to finish executing and/or obtain its eventual return value.
+ * @brief A C++17 thread pool class. The user submits tasks to be executed by the threads. Each thread owns a deque of tasks; tasks submitted from inside a worker go to that worker's deque, other submissions are spread across the deques round-robin, and a worker whose deque is empty steals from the others. Idle workers park on a condition variable and are woken when a task is submitted. Each task submitted with submit() is automatically assigned a future, which can be used to wait for the task to finish executing and/or obtain its eventual return value.
  */
 namespace automerge_cpp {
 
@@ -49,9 +54,10 @@ public:
      * @brief Construct a new thread pool.
      *
      * @param _thread_count The number of threads to use. The default value is the total number of hardware threads available, as reported by the implementation. With a hyperthreaded CPU, this will be twice the number of CPU cores. If the argument is zero, the default value will be used instead.
+     * @param _max_tasks The number of unfinished tasks above which submitting from outside the pool blocks until a task finishes.
      */
     thread_pool(const ui32 &_thread_count = std::thread::hardware_concurrency(), const ui32 _max_tasks = 100 )
-            : thread_count(_thread_count ? _thread_count : std::thread::hardware_concurrency()), threads(new std::thread[_thread_count ? _thread_count : std::thread::hardware_concurrency()]), max_tasks(_max_tasks)
+            : thread_count(_thread_count ? _thread_count : std::thread::hardware_concurrency()), threads(new std::thread[_thread_count ? _thread_count : std::thread::hardware_concurrency()]), queues(new worker_queue[_thread_count ? _thread_count : std::thread::hardware_concurrency()]), max_tasks(_max_tasks)
     {
         create_threads();
     }
@@ -62,7 +68,6 @@ public:
     ~thread_pool()
     {
         wait_for_tasks();
-        running = false;
         destroy_threads();
     }
 
@@ -71,14 +76,13 @@ public:
     // =======================
 
     /**
-     * @brief Get the number of tasks currently waiting in the queue to be executed by the threads.
+     * @brief Get the number of tasks currently waiting in the queues to be executed by the threads.
      *
      * @return The number of queued tasks.
      */
     ui64 get_tasks_queued() const
     {
-        const std::scoped_lock lock(queue_mutex);
-        return tasks.size();
+        return tasks_queued;
     }
 
     /**
@@ -125,7 +129,7 @@ public:
 
 
     /**
-     * @brief Parallelize a loop by splitting it into blocks, submitting each block separately to the thread pool, and waiting for all blocks to finish executing. The user supplies a loop function, which will be called once per block and should iterate over the block's range.
+     * @brief Parallelize a loop by splitting it into blocks, submitting each block separately to the thread pool, and waiting for all blocks to finish executing. The user supplies a loop function, which will be called once per block and should iterate over the block's range. While waiting, the calling thread runs queued tasks itself, so parallelize_loop may be called from inside a task without deadlocking the pool.
      *
      * @tparam T1 The type of the first index in the loop. Should be a signed or unsigned integer.
      * @tparam T2 The type of the index after the last index in the loop. Should be a signed or unsigned integer. If T1 is not the same as T2, a common type will be automatically inferred.
@@ -159,21 +163,26 @@ public:
             block_size = 1;
             num_blocks = (ui32)total_size > 1 ? (ui32)total_size : 1;
         }
-        std::atomic<ui32> blocks_running = 0;
+        loop_state blocks;
+        blocks.running = num_blocks;
         for (ui32 t = 0; t < num_blocks; t++)
         {
             T start = ((T)(t * block_size) + the_first_index);
             T end = (t == num_blocks - 1) ? last_index + 1 : ((T)((t + 1) * block_size) + the_first_index);
-            blocks_running++;
-            push_task([start, end, &loop, &blocks_running]
+            push_task([start, end, &loop, &blocks]
                       {
                           loop(start, end);
-                          blocks_running--;
+                          blocks.finish_one();
                       });
         }
-        while (blocks_running != 0)
+        // Help with queued work; sleep only once every block has been taken
+        while (!blocks.done())
         {
-            sleep_or_yield();
+            if (!run_pending_task())
+            {
+                blocks.wait();
+                break;
+            }
         }
     }
 
@@ -186,22 +195,12 @@ public:
     template <typename F>
     void push_task(const F &task)
     {
-
-        //block on max tasks
-        while( tasks_total > max_tasks ){
-            sleep_or_yield();
-        }
-
-        tasks_total++;
-        {
-            const std::scoped_lock lock(queue_mutex);
-            tasks.push(std::function<void()>(task));
-        }
+        enqueue(task_function(task));
     }
 
     /**
      * @brief Push a function with arguments, but no return value, into the task queue.
-     * @details The function is wrapped inside a lambda in order to hide the arguments, as the tasks in the queue must be of type std::function<void()>, so they cannot have any arguments or return value. If no arguments are provided, the other overload will be used, in order to avoid the (slight) overhead of using a lambda.
+     * @details The function is wrapped inside a lambda in order to hide the arguments, as the tasks in the queue cannot have any arguments or return value. If no arguments are provided, the other overload will be used, in order to avoid the (slight) overhead of using a lambda.
      *
      * @tparam F The type of the function.
      * @tparam A The types of the arguments.
@@ -225,10 +224,18 @@ public:
         bool was_paused = paused;
         paused = true;
         wait_for_tasks();
-        running = false;
         destroy_threads();
+        std::vector<task_function> pending;
+        for (ui32 i = 0; i < thread_count; i++)
+        {
+            for (auto &task : queues[i].tasks)
+                pending.push_back(std::move(task));
+        }
         thread_count = _thread_count ? _thread_count : std::thread::hardware_concurrency();
         threads.reset(new std::thread[thread_count]);
+        queues.reset(new worker_queue[thread_count]);
+        for (ui64 i = 0; i < pending.size(); i++)
+            queues[i % thread_count].tasks.push_back(std::move(pending[i]));
         paused = was_paused;
         running = true;
         create_threads();
@@ -246,27 +253,27 @@ public:
     template <typename F, typename... A, typename = std::enable_if_t<std::is_void_v<std::invoke_result_t<std::decay_t<F>, std::decay_t<A>...>>>>
     std::future<bool> submit(const F &task, const A &...args)
     {
-        std::shared_ptr<std::promise<bool>> task_promise(new std::promise<bool>);
-        std::future<bool> future = task_promise->get_future();
-        push_task([task, args..., task_promise]
-                  {
-                      try
-                      {
-                          task(args...);
-                          task_promise->set_value(true);
-                      }
-                      catch (...)
-                      {
-                          try
-                          {
-                              task_promise->set_exception(std::current_exception());
-                          }
-                          catch (...) // NOLINT(bugprone-empty-catch)
-                          {
-                              // set_exception failed; promise is broken — nothing to do
-                          }
-                      }
-                  });
+        std::promise<bool> task_promise;
+        std::future<bool> future = task_promise.get_future();
+        enqueue(task_function([task, args..., task_promise = std::move(task_promise)]() mutable
+                              {
+                                  try
+                                  {
+                                      task(args...);
+                                      task_promise.set_value(true);
+                                  }
+                                  catch (...)
+                                  {
+                                      try
+                                      {
+                                          task_promise.set_exception(std::current_exception());
+                                      }
+                                      catch (...) // NOLINT(bugprone-empty-catch)
+                                      {
+                                          // set_exception failed; promise is broken — nothing to do
+                                      }
+                                  }
+                              }));
         return future;
     }
 
@@ -283,26 +290,26 @@ public:
     template <typename F, typename... A, typename R = std::invoke_result_t<std::decay_t<F>, std::decay_t<A>...>, typename = std::enable_if_t<!std::is_void_v<R>>>
     std::future<R> submit(const F &task, const A &...args)
     {
-        std::shared_ptr<std::promise<R>> task_promise(new std::promise<R>);
-        std::future<R> future = task_promise->get_future();
-        push_task([task, args..., task_promise]
-                  {
-                      try
-                      {
-                          task_promise->set_value(task(args...));
-                      }
-                      catch (...)
-                      {
-                          try
-                          {
-                              task_promise->set_exception(std::current_exception());
-                          }
-                          catch (...) // NOLINT(bugprone-empty-catch)
-                          {
-                              // set_exception failed; promise is broken — nothing to do
-                          }
-                      }
-                  });
+        std::promise<R> task_promise;
+        std::future<R> future = task_promise.get_future();
+        enqueue(task_function([task, args..., task_promise = std::move(task_promise)]() mutable
+                              {
+                                  try
+                                  {
+                                      task_promise.set_value(task(args...));
+                                  }
+                                  catch (...)
+                                  {
+                                      try
+                                      {
+                                          task_promise.set_exception(std::current_exception());
+                                      }
+                                      catch (...) // NOLINT(bugprone-empty-catch)
+                                      {
+                                          // set_exception failed; promise is broken — nothing to do
+                                      }
+                                  }
+                              }));
         return future;
     }
 
@@ -311,20 +318,16 @@ public:
      */
     void wait_for_tasks()
     {
-        while (true)
+        std::unique_lock lock(park_mutex);
+        waiters++;
+        while (!(paused ? get_tasks_running() == 0 : tasks_total == 0))
         {
-            if (!paused)
-            {
-                if (tasks_total == 0)
-                    break;
-            }
+            if (paused)
+                done_cv.wait_for(lock, std::chrono::milliseconds(1)); // notice a resume
             else
-            {
-                if (get_tasks_running() == 0)
-                    break;
-            }
-            sleep_or_yield();
+                done_cv.wait(lock);
         }
+        waiters--;
     }
 
     // ===========
@@ -337,11 +340,158 @@ public:
     std::atomic<bool> paused = false;
 
     /**
-     * @brief The duration, in microseconds, that the worker function should sleep for when it cannot find any tasks in the queue. If set to 0, then instead of sleeping, the worker function will execute std::this_thread::yield() if there are no tasks in the queue. The default value is 1000.
+     * @brief The duration, in microseconds, that an idle worker keeps yielding and looking for tasks before it parks on the condition variable. Parked workers are woken as soon as a task is submitted, so this only trades idle CPU time for a faster pickup of bursts of short tasks. The default value is 0 (park immediately).
      */
-    ui32 sleep_duration = 500;
+    ui32 sleep_duration = 0;
 
 private:
+    // ============
+    // Task storage
+    // ============
+
+    /**
+     * @brief A move-only type-erased callable with no arguments or return value. Callables of up to inline_size bytes (loop blocks, submit() wrappers around small functions) are stored in place; larger ones are allocated on the heap.
+     */
+    class task_function
+    {
+    public:
+        static constexpr std::size_t inline_size = 56;
+
+        task_function() = default;
+
+        template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, task_function>>>
+        explicit task_function(F &&f)
+        {
+            typedef std::decay_t<F> D;
+            if constexpr (sizeof(D) <= inline_size && alignof(D) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<D>)
+            {
+                ::new (static_cast<void *>(storage)) D(std::forward<F>(f));
+                ops = &inline_ops<D>;
+            }
+            else
+            {
+                ::new (static_cast<void *>(storage)) D *(new D(std::forward<F>(f)));
+                ops = &heap_ops<D>;
+            }
+        }
+
+        task_function(task_function &&other) noexcept
+            : ops(other.ops)
+        {
+            if (ops)
+            {
+                ops->move(other.storage, storage);
+                other.ops = nullptr;
+            }
+        }
+
+        task_function &operator=(task_function &&other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                ops = other.ops;
+                if (ops)
+                {
+                    ops->move(other.storage, storage);
+                    other.ops = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        task_function(const task_function &) = delete;
+        task_function &operator=(const task_function &) = delete;
+
+        ~task_function()
+        {
+            reset();
+        }
+
+        void operator()()
+        {
+            ops->invoke(storage);
+        }
+
+    private:
+        struct operations
+        {
+            void (*invoke)(std::byte *);
+            void (*move)(std::byte *from, std::byte *to) noexcept; // also destroys from
+            void (*destroy)(std::byte *) noexcept;
+        };
+
+        template <typename D>
+        static constexpr operations inline_ops = {
+            [](std::byte *s) { (*std::launder(reinterpret_cast<D *>(s)))(); },
+            [](std::byte *from, std::byte *to) noexcept
+            {
+                D *f = std::launder(reinterpret_cast<D *>(from));
+                ::new (static_cast<void *>(to)) D(std::move(*f));
+                f->~D();
+            },
+            [](std::byte *s) noexcept { std::launder(reinterpret_cast<D *>(s))->~D(); },
+        };
+
+        template <typename D>
+        static constexpr operations heap_ops = {
+            [](std::byte *s) { (**std::launder(reinterpret_cast<D **>(s)))(); },
+            [](std::byte *from, std::byte *to) noexcept
+            { ::new (static_cast<void *>(to)) D *(*std::launder(reinterpret_cast<D **>(from))); },
+            [](std::byte *s) noexcept { delete *std::launder(reinterpret_cast<D **>(s)); },
+        };
+
+        void reset() noexcept
+        {
+            if (ops)
+            {
+                ops->destroy(storage);
+                ops = nullptr;
+            }
+        }
+
+        const operations *ops = nullptr;
+        alignas(std::max_align_t) std::byte storage[inline_size];
+    };
+
+    /**
+     * @brief A worker's task deque. The owner pops from the front; other threads steal from the back. Padded to a cache line so that neighbouring deques do not share one.
+     */
+    struct alignas(64) worker_queue
+    {
+        std::mutex mutex = {};
+        std::deque<task_function> tasks = {};
+    };
+
+    /**
+     * @brief Completion state of one parallelize_loop() call. The last block notifies while holding the mutex, so the waiting caller cannot return (and destroy this object) before the notification is done.
+     */
+    struct loop_state
+    {
+        std::mutex mutex = {};
+        std::condition_variable cv = {};
+        ui32 running = 0;
+
+        void finish_one()
+        {
+            const std::scoped_lock lock(mutex);
+            if (--running == 0)
+                cv.notify_all();
+        }
+
+        bool done()
+        {
+            const std::scoped_lock lock(mutex);
+            return running == 0;
+        }
+
+        void wait()
+        {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [this] { return running == 0; });
+        }
+    };
+
     // ========================
     // Private member functions
     // ========================
@@ -353,15 +503,20 @@ private:
     {
         for (ui32 i = 0; i < thread_count; i++)
         {
-            threads[i] = std::thread(&thread_pool::worker, this);
+            threads[i] = std::thread(&thread_pool::worker, this, i);
         }
     }
 
     /**
-     * @brief Destroy the threads in the pool by joining them.
+     * @brief Tell the workers to stop, wake the parked ones, and join all threads.
      */
     void destroy_threads()
     {
+        {
+            const std::scoped_lock lock(park_mutex);
+            running = false;
+        }
+        park_cv.notify_all();
         for (ui32 i = 0; i < thread_count; i++)
         {
             threads[i].join();
@@ -369,54 +524,154 @@ private:
     }
 
     /**
-     * @brief Try to pop a new task out of the queue.
+     * @brief Add a task to a deque: the calling worker's own deque if called from inside the pool, otherwise the next deque round-robin. Wakes one parked worker, if any.
      *
-     * @param task A reference to the task. Will be populated with a function if the queue is not empty.
-     * @return true if a task was found, false if the queue is empty.
+     * @param task The task to add.
      */
-    bool pop_task(std::function<void()> &task)
+    void enqueue(task_function &&task)
     {
-        const std::scoped_lock lock(queue_mutex);
-        if (tasks.empty())
-            return false;
-        else
+        const bool from_worker = current_pool == this;
+        // Block on max tasks (never inside a worker: it could be waiting on itself)
+        if (!from_worker && tasks_total > max_tasks)
+        {
+            std::unique_lock lock(park_mutex);
+            waiters++;
+            done_cv.wait(lock, [this] { return tasks_total <= max_tasks; });
+            waiters--;
+        }
+
+        tasks_total++;
+        tasks_queued++;
+        worker_queue &queue = queues[from_worker ? current_index : (ui32)(next_queue++ % thread_count)];
+        {
+            const std::scoped_lock lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        if (parked > 0)
+        {
+            {
+                const std::scoped_lock lock(park_mutex);
+            }
+            park_cv.notify_one();
+        }
+    }
+
+    /**
+     * @brief Try to take a task: first from the front of deque index, then from the back of every other deque.
+     *
+     * @param index The deque to look at first.
+     * @param task A reference to the task. Will be populated with a function if one was found.
+     * @return true if a task was found, false if every deque is empty.
+     */
+    bool pop_task(const ui32 index, task_function &task)
+    {
+        {
+            worker_queue &own = queues[index];
+            const std::scoped_lock lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.front());
+                own.tasks.pop_front();
+                tasks_queued--;
+                return true;
+            }
+        }
+        for (ui32 i = 1; i < thread_count; i++)
+        {
+            worker_queue &victim = queues[(index + i) % thread_count];
+            const std::scoped_lock lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                tasks_queued--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Run a task and record its completion, waking anyone in wait_for_tasks() or blocked on max_tasks.
+     *
+     * @param task The task to run.
+     */
+    void run_task(task_function &task)
+    {
+        task();
+        task = task_function();
+        tasks_total--;
+        if (waiters > 0)
         {
-            task = std::move(tasks.front());
-            tasks.pop();
-            return true;
+            {
+                const std::scoped_lock lock(park_mutex);
+            }
+            done_cv.notify_all();
         }
     }
 
     /**
-     * @brief Sleep for sleep_duration microseconds. If that variable is set to zero, yield instead.
+     * @brief Run one queued task on the calling thread, if there is one and the pool is not paused.
+     *
+     * @return true if a task was run.
+     */
+    bool run_pending_task()
+    {
+        task_function task;
+        if (paused || !pop_task(current_pool == this ? current_index : 0, task))
+            return false;
+        run_task(task);
+        return true;
+    }
+
+    /**
+     * @brief Keep yielding for up to sleep_duration microseconds until a task is queued.
      *
+     * @return true if a task was queued in the meantime.
      */
-    void sleep_or_yield()
+    bool spin_for_task() const
     {
-        if (sleep_duration)
-            std::this_thread::sleep_for(std::chrono::microseconds(sleep_duration));
-        else
+        if (!sleep_duration)
+            return false;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(sleep_duration);
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            if (!paused && tasks_queued > 0)
+                return true;
             std::this_thread::yield();
+        }
+        return false;
     }
 
     /**
-     * @brief A worker function to be assigned to each thread in the pool. Continuously pops tasks out of the queue and executes them, as long as the atomic variable running is set to true.
+     * @brief A worker function to be assigned to each thread in the pool. Runs tasks from its own deque, steals when it is empty, and parks when there is nothing to do, as long as the atomic variable running is set to true.
+     *
+     * @param index The index of this worker's deque.
      */
-    void worker()
+    void worker(const ui32 index)
     {
+        current_pool = this;
+        current_index = index;
+        task_function task;
         while (running)
         {
-            std::function<void()> task;
-            if (!paused && pop_task(task))
+            if (!paused && pop_task(index, task))
             {
-                task();
-                tasks_total--;
+                run_task(task);
+                continue;
             }
+            if (spin_for_task())
+                continue;
+            std::unique_lock lock(park_mutex);
+            parked++;
+            const auto ready = [this] { return !running || (!paused && tasks_queued > 0); };
+            if (paused)
+                park_cv.wait_for(lock, std::chrono::milliseconds(1), ready); // notice a resume
             else
-            {
-                sleep_or_yield();
-            }
+                park_cv.wait(lock, ready);
+            parked--;
         }
+        current_pool = nullptr;
     }
 
     // ============
@@ -424,19 +679,26 @@ private:
     // ============
 
     /**
-     * @brief A mutex to synchronize access to the task queue by different threads.
+     * @brief The pool that the current thread is a worker of (nullptr outside any pool), and the index of its deque.
      */
-    mutable std::mutex queue_mutex = {};
+    static inline thread_local const thread_pool *current_pool = nullptr;
+    static inline thread_local ui32 current_index = 0;
 
     /**
-     * @brief An atomic variable indicating to the workers to keep running. When set to false, the workers permanently stop working.
+     * @brief A mutex for parking idle workers and for waiting on task completion.
      */
-    std::atomic<bool> running = true;
+    mutable std::mutex park_mutex = {};
 
     /**
-     * @brief A queue of tasks to be executed by the threads.
+     * @brief Parked workers wait on park_cv; wait_for_tasks() and blocked submitters wait on done_cv.
      */
-    std::queue<std::function<void()>> tasks = {};
+    std::condition_variable park_cv = {};
+    std::condition_variable done_cv = {};
+
+    /**
+     * @brief An atomic variable indicating to the workers to keep running. When set to false, the workers permanently stop working.
+     */
+    std::atomic<bool> running = true;
 
     /**
      * @brief The number of threads in the pool.
@@ -448,11 +710,32 @@ private:
      */
     std::unique_ptr<std::thread[]> threads;
 
+    /**
+     * @brief One task deque per thread.
+     */
+    std::unique_ptr<worker_queue[]> queues;
+
+    /**
+     * @brief The deque that the next task submitted from outside the pool goes to.
+     */
+    std::atomic<ui64> next_queue = 0;
+
     /**
      * @brief An atomic variable to keep track of the total number of unfinished tasks - either still in the queue, or running in a thread.
      */
     std::atomic<ui32> tasks_total = 0;
 
+    /**
+     * @brief The number of tasks waiting in the deques.
+     */
+    std::atomic<ui64> tasks_queued = 0;
+
+    /**
+     * @brief The number of parked workers, and of threads waiting in wait_for_tasks() or on max_tasks. Submitting and finishing a task only touch park_mutex when these are nonzero.
+     */
+    std::atomic<ui32> parked = 0;
+    std::atomic<ui32> waiters = 0;
+
     const ui32 max_tasks = 100;
 };
 
@@ -12,6 +12,7 @@
 #include <cstddef>
 #include <initializer_list>
 #include <ranges>
+#include <span>
 #include <string_view>
 #include <type_traits>
 #include <utility>
@@ -19,7 +20,10 @@
 
 namespace automerge_cpp {
 
-namespace detail { struct DocState; }
+namespace detail {
+struct DocState;
+class FreshObjectBuilder;
+}  // namespace detail
 
 /// A mutation interface for modifying a Document.
 ///
@@ -36,6 +40,7 @@ namespace detail { struct DocState; }
 /// @endcode
 class Transaction {
     friend class Document;
+    friend class detail::FreshObjectBuilder;
     explicit Transaction(detail::DocState& state);
 
 public:
@@ -381,26 +386,72 @@ public:
 
     // -- Batch operations -----------------------------------------------------
 
+    /// Insert scalars into a list as a consecutive run starting at index.
+    ///
+    /// Equivalent to inserting each value at index, index + 1, ... in turn,
+    /// but the position is resolved once, each element is chained after the
+    /// previous one, and storage for the ops is reserved up front. Runs of
+    /// doubles, int64s or single-byte strings are stored packed.
+    /// @param obj The list object to modify.
+    /// @param index The visible index of the first inserted element.
+    /// @param values The scalar values to insert.
+    void insert_range(const ObjId& obj, std::size_t index, std::span<const ScalarValue> values);
+
+    /// Insert elements from a vector (or any sized range of ScalarValue-convertible values).
+    template <std::ranges::input_range R>
+        requires std::convertible_to<std::ranges::range_value_t<R>, ScalarValue>
+    void insert_range(const ObjId& obj, std::size_t start, R&& range) {
+        if constexpr (std::ranges::contiguous_range<R> &&
+                      std::same_as<std::ranges::range_value_t<R>, ScalarValue>) {
+            insert_range(obj, start, std::span<const ScalarValue>{range});
+        } else {
+            auto values = std::vector<ScalarValue>{};
+            if constexpr (std::ranges::sized_range<R>) values.reserve(std::ranges::size(range));
+            for (auto&& val : range) {
+                values.emplace_back(std::forward<decltype(val)>(val));
+            }
+            insert_range(obj, start, std::span<const ScalarValue>{values});
+        }
+    }
+
+    /// Append scalars to the end of a list (insert_range at its length).
+    void append(const ObjId& obj, std::span<const ScalarValue> values) {
+        insert_range(obj, length(obj), values);
+    }
+
+    /// Append elements from any range of ScalarValue-convertible values.
+    template <std::ranges::input_range R>
+        requires std::convertible_to<std::ranges::range_value_t<R>, ScalarValue>
+    void append(const ObjId& obj, R&& range) {
+        insert_range(obj, length(obj), std::forward<R>(range));
+    }
+
     /// Batch insert scalars into a list from an initializer list.
     /// @param obj The list object to modify.
     /// @param start The starting index for insertions.
     /// @param values The scalar values to insert sequentially.
     void insert_all(const ObjId& obj, std::size_t start,
                     std::initializer_list<ScalarValue> values) {
-        auto idx = start;
-        for (const auto& val : values) {
-            insert(obj, idx++, val);
-        }
+        insert_range(obj, start, std::span<const ScalarValue>{values.begin(), values.size()});
     }
 
+    /// Put key-value pairs into a map, in order.
+    ///
+    /// Equivalent to a put() per entry (a repeated key's later value wins),
+    /// but the map is looked up and grown once, and keys are not copied
+    /// until their ops are recorded.
+    /// @param obj The map object to modify.
+    /// @param entries Key-value pairs to set.
+    void put_many(const ObjId& obj,
+                  std::span<const std::pair<std::string_view, ScalarValue>> entries);
+
     /// Batch put key-value pairs into a map from an initializer list.
     /// @param obj The map object to modify.
     /// @param entries Key-value pairs to set.
     void put_all(const ObjId& obj,
                  std::initializer_list<std::pair<std::string_view, ScalarValue>> entries) {
-        for (const auto& [key, val] : entries) {
-            put(obj, key, val);
-        }
+        put_many(obj, std::span<const std::pair<std::string_view, ScalarValue>>{
+                          entries.begin(), entries.size()});
     }
 
     /// Populate a map from any associative container (std::map, std::unordered_map, etc.).
@@ -410,19 +461,12 @@ public:
             { m.begin()->second } -> std::convertible_to<ScalarValue>;
         }
     void put_map(const ObjId& obj, const Map& map) {
+        auto entries = std::vector<std::pair<std::string_view, ScalarValue>>{};
+        entries.reserve(std::ranges::size(map));
         for (const auto& [key, val] : map) {
-            put(obj, std::string_view{key}, ScalarValue{val});
-        }
-    }
-
-    /// Insert elements from a vector (or any sized range of ScalarValue-convertible values).
-    template <std::ranges::input_range R>
-        requires std::convertible_to<std::ranges::range_value_t<R>, ScalarValue>
-    void insert_range(const ObjId& obj, std::size_t start, R&& range) {
-        auto idx = start;
-        for (auto&& val : range) {
-            insert(obj, idx++, ScalarValue{std::forward<decltype(val)>(val)});
+            entries.emplace_back(std::string_view{key}, ScalarValue{val});
         }
+        put_many(obj, entries);
     }
 
     // --- Read methods (no locking, safe because transact holds exclusive lock) ---
@@ -0,0 +1,43 @@
+/// @file tree_visitor.hpp
+/// @brief SAX-style visitor for a depth-first walk of a document subtree.
+
+#pragma once
+
+#include <automerge-cpp/value.hpp>
+
+#include <cstddef>
+#include <string_view>
+
+namespace automerge_cpp {
+
+/// Receives the events of Document::walk().
+///
+/// A map (or table) arrives as begin_map(), then key() followed by its
+/// value for every key in sorted order, then end_map(). A list arrives as
+/// begin_list(), its visible elements in order, then end_list(). A text
+/// object arrives as one text() call. Only the winning value of a
+/// conflicted key is reported. Nested objects are reported inline, where
+/// they occur.
+///
+/// The walk holds the document's read guard, or with snapshot reads the
+/// snapshot it started from: callbacks must not modify the document being
+/// walked. They may read it, or any other document, re-entrantly (with
+/// snapshot reads, or with read locking off, for the walked document
+/// itself); the walk still sees the state it started with.
+class TreeVisitor {
+public:
+    virtual ~TreeVisitor() = default;
+
+    virtual void begin_map() = 0;
+    virtual void key(std::string_view key) = 0;
+    virtual void end_map() = 0;
+
+    /// @param size The number of elements that will follow.
+    virtual void begin_list(std::size_t size) = 0;
+    virtual void end_list() = 0;
+
+    virtual void text(std::string_view text) = 0;
+    virtual void scalar(const ScalarValue& value) = 0;
+};
+
+}  // namespace automerge_cpp
@@ -0,0 +1,117 @@
+/// @file value_ref.hpp
+/// @brief Borrowed views of document values: ScalarRef and ValueRef.
+
+#pragma once
+
+#include <automerge-cpp/value.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+namespace automerge_cpp {
+
+/// A ScalarValue borrowed from a document: strings and bytes are views of
+/// the stored data rather than copies.
+///
+/// Alternatives: Null, bool, int64_t, uint64_t, double,
+/// Counter, Timestamp, string_view, span<const byte>.
+using ScalarRef = std::variant<
+    Null,
+    bool,
+    std::int64_t,
+    std::uint64_t,
+    double,
+    Counter,
+    Timestamp,
+    std::string_view,
+    std::span<const std::byte>
+>;
+
+/// A Value borrowed from a document: a nested object type or a ScalarRef.
+///
+/// A ValueRef is only valid while the data it views is: see ReadView.
+using ValueRef = std::variant<ObjType, ScalarRef>;
+
+namespace detail {
+
+// Build a ScalarRef, or a ValueRef holding one, from sv in place.
+// (Converting a ScalarRef into a ValueRef after the fact costs several
+// times more than the whole lookup that produced it.)
+template <typename Ref, typename... Outer>
+auto borrow_scalar(const ScalarValue& sv, Outer... outer) -> Ref {
+    auto make = [&]<std::size_t I>(std::in_place_index_t<I> at) {
+        return Ref{outer..., at, std::get<I>(sv)};
+    };
+    switch (sv.index()) {
+        case 0: return make(std::in_place_index<0>);
+        case 1: return make(std::in_place_index<1>);
+        case 2: return make(std::in_place_index<2>);
+        case 3: return make(std::in_place_index<3>);
+        case 4: return make(std::in_place_index<4>);
+        case 5: return make(std::in_place_index<5>);
+        case 6: return make(std::in_place_index<6>);
+        case 7: return make(std::in_place_index<7>);
+        default: return make(std::in_place_index<8>);
+    }
+}
+
+}  // namespace detail
+
+/// Borrow a ScalarValue. The result views sv's string or bytes.
+inline auto scalar_ref(const ScalarValue& sv) -> ScalarRef {
+    return detail::borrow_scalar<ScalarRef>(sv);
+}
+
+/// Borrow a Value. The result views v's string or bytes.
+inline auto value_ref(const Value& v) -> ValueRef {
+    if (const auto* sv = std::get_if<ScalarValue>(&v)) {
+        return detail::borrow_scalar<ValueRef>(*sv, std::in_place_index<1>);
+    }
+    return ValueRef{std::in_place_index<0>, std::get<ObjType>(v)};
+}
+
+/// Copy a borrowed scalar into an owning ScalarValue.
+inline auto to_scalar(const ScalarRef& ref) -> ScalarValue {
+    return std::visit(overload{
+        [](std::string_view s) -> ScalarValue { return std::string{s}; },
+        [](std::span<const std::byte> b) -> ScalarValue { return Bytes(b.begin(), b.end()); },
+        [](const auto& v) -> ScalarValue { return v; },
+    }, ref);
+}
+
+/// Copy a borrowed value into an owning Value.
+inline auto to_value(const ValueRef& ref) -> Value {
+    return std::visit(overload{
+        [](ObjType type) -> Value { return type; },
+        [](const ScalarRef& sv) -> Value { return to_scalar(sv); },
+    }, ref);
+}
+
+/// Extract a typed scalar from a ValueRef, or nullopt on type mismatch.
+/// @code
+/// auto name = get_scalar<std::string_view>(ref);
+/// @endcode
+template <typename T>
+auto get_scalar(const ValueRef& v) -> std::optional<T> {
+    if (const auto* sv = std::get_if<ScalarRef>(&v)) {
+        if (const auto* t = std::get_if<T>(sv)) {
+            return *t;
+        }
+    }
+    return std::nullopt;
+}
+
+/// Extract a typed scalar from an optional<ValueRef>.
+template <typename T>
+auto get_scalar(const std::optional<ValueRef>& v) -> std::optional<T> {
+    if (!v) return std::nullopt;
+    return get_scalar<T>(*v);
+}
+
+}  // namespace automerge_cpp
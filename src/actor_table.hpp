@@ -0,0 +1,110 @@
+#pragma once
+
+// Compact op ids: (counter, index into an actor table).
+// Internal header — not installed.
+//
+// A public OpId embeds its 16-byte ActorId, so it is 24 bytes, and an
+// optional one 32. Structures that hold an id per element store a
+// CompactOpId instead: 16 bytes, with no separate flag needed for "no id",
+// and equality is two integer compares. The ActorIds live once in an
+// ActorTable; ids are translated back to OpIds only where they leave the
+// structure.
+//
+// An index says nothing about actor order, so CompactOpIds are only
+// compared for equality; order comparisons go through the public OpId.
+
+#include <automerge-cpp/types.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace automerge_cpp::detail {
+
+struct CompactOpId {
+    static constexpr auto no_actor = ~std::uint32_t{0};
+
+    std::uint64_t counter = 0;
+    std::uint32_t actor = no_actor;  // index into the ActorTable; no_actor for "none"
+
+    auto has_value() const -> bool { return actor != no_actor; }
+
+    auto operator==(const CompactOpId&) const -> bool = default;
+};
+
+// The distinct actors of one structure, in first-seen order. Tables are
+// per structure rather than per document so that they are copied and
+// mutated together with it, needing no synchronisation of their own.
+class ActorTable {
+public:
+    auto size() const -> std::size_t { return actors_.size(); }
+
+    auto operator[](std::uint32_t index) const -> const ActorId& { return actors_[index]; }
+
+    // Index of actor, adding it if new.
+    auto intern(const ActorId& actor) -> std::uint32_t {
+        if (auto index = find(actor)) return *index;
+        const auto index = static_cast<std::uint32_t>(actors_.size());
+        actors_.push_back(actor);
+        if (!by_actor_.empty() || actors_.size() > linear_limit) {
+            if (by_actor_.empty()) {
+                for (std::uint32_t i = 0; i < actors_.size(); ++i) by_actor_.emplace(actors_[i], i);
+            } else {
+                by_actor_.emplace(actor, index);
+            }
+        }
+        return index;
+    }
+
+    auto find(const ActorId& actor) const -> std::optional<std::uint32_t> {
+        if (!by_actor_.empty()) {
+            auto it = by_actor_.find(actor);
+            if (it == by_actor_.end()) return std::nullopt;
+            return it->second;
+        }
+        for (std::uint32_t i = 0; i < actors_.size(); ++i) {
+            if (actors_[i] == actor) return i;
+        }
+        return std::nullopt;
+    }
+
+    auto to_compact(const OpId& id) -> CompactOpId {
+        return CompactOpId{.counter = id.counter, .actor = intern(id.actor)};
+    }
+
+    auto to_compact(const std::optional<OpId>& id) -> CompactOpId {
+        return id ? to_compact(*id) : CompactOpId{};
+    }
+
+    // The compact form of id if its actor is in the table.
+    auto find_compact(const OpId& id) const -> std::optional<CompactOpId> {
+        auto index = find(id.actor);
+        if (!index) return std::nullopt;
+        return CompactOpId{.counter = id.counter, .actor = *index};
+    }
+
+    auto to_op_id(const CompactOpId& id) const -> OpId {
+        return OpId{id.counter, actors_[id.actor]};
+    }
+
+    auto to_optional_op_id(const CompactOpId& id) const -> std::optional<OpId> {
+        if (!id.has_value()) return std::nullopt;
+        return to_op_id(id);
+    }
+
+    auto memory_usage() const -> std::size_t {
+        constexpr auto map_node = sizeof(ActorId) + sizeof(std::uint32_t) + 3 * sizeof(void*);
+        return actors_.capacity() * sizeof(ActorId) + by_actor_.size() * map_node;
+    }
+
+private:
+    // Most structures see a handful of actors: scan them rather than hash.
+    static constexpr std::size_t linear_limit = 8;
+
+    std::vector<ActorId> actors_;
+    std::unordered_map<ActorId, std::uint32_t> by_actor_;  // built past linear_limit
+};
+
+}  // namespace automerge_cpp::detail
@@ -0,0 +1,154 @@
+#pragma once
+
+// Append-only change log shared between documents (11A.7).
+// Internal header — not installed.
+//
+// Each Change is allocated once and held by shared_ptr<const Change>, so
+// fork, copy, merge and sync hand the same immutable Change to every
+// document that has it instead of deep-copying ops, keys and values.
+//
+// Entries are grouped into fixed-size segments. Full segments are never
+// modified again and are shared outright between copies of a log; only
+// the partially filled tail segment is cloned (copy-on-write) when a
+// shared log is appended to (see EditToken). Copying a log is
+// O(segments), not O(changes).
+//
+// Each entry carries its change hash, computed once by whoever appends it,
+// so sharing an entry with another log shares the hash too.
+
+#include <automerge-cpp/change.hpp>
+#include "edit_token.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace automerge_cpp::detail {
+
+class ChangeLog {
+public:
+    using Entry = std::shared_ptr<const Change>;
+
+    static constexpr std::size_t segment_capacity = 256;
+
+private:
+    struct Segment {
+        std::vector<Entry> entries;       // up to segment_capacity
+        std::vector<ChangeHash> hashes;   // parallel to entries
+        std::uint64_t edit = 0;           // see EditToken
+    };
+
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Change;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Change*;
+        using reference = const Change&;
+
+        const_iterator() = default;
+
+        auto operator*() const -> reference { return *log_->entry(index_); }
+        auto operator->() const -> pointer { return log_->entry(index_).get(); }
+
+        auto operator++() -> const_iterator& {
+            ++index_;
+            return *this;
+        }
+
+        auto operator++(int) -> const_iterator {
+            auto copy = *this;
+            ++index_;
+            return copy;
+        }
+
+        auto operator==(const const_iterator& other) const -> bool {
+            return index_ == other.index_;
+        }
+
+    private:
+        friend class ChangeLog;
+        const_iterator(const ChangeLog* log, std::size_t index) : log_{log}, index_{index} {}
+
+        const ChangeLog* log_ = nullptr;
+        std::size_t index_ = 0;
+    };
+
+    ChangeLog() = default;
+
+    // Build a log that owns the given changes; hashes[i] is the hash of changes[i].
+    ChangeLog(std::vector<Change> changes, std::span<const ChangeHash> hashes) {
+        assert(changes.size() == hashes.size());
+        for (std::size_t i = 0; i < changes.size(); ++i) {
+            push_back(std::move(changes[i]), hashes[i]);
+        }
+    }
+
+    auto size() const -> std::size_t { return size_; }
+    auto empty() const -> bool { return size_ == 0; }
+
+    // Ops in all the changes, counted as they are appended.
+    auto op_count() const -> std::size_t { return op_count_; }
+
+    auto operator[](std::size_t i) const -> const Change& { return *entry(i); }
+    auto back() const -> const Change& { return *entry(size_ - 1); }
+
+    // The shared handle for change i (to share it with another log).
+    auto entry(std::size_t i) const -> const Entry& {
+        assert(i < size_);
+        return segments_[i / segment_capacity]->entries[i % segment_capacity];
+    }
+
+    // The hash of change i.
+    auto hash(std::size_t i) const -> const ChangeHash& {
+        assert(i < size_);
+        return segments_[i / segment_capacity]->hashes[i % segment_capacity];
+    }
+
+    auto begin() const -> const_iterator { return const_iterator{this, 0}; }
+    auto end() const -> const_iterator { return const_iterator{this, size_}; }
+
+    void push_back(Change change, const ChangeHash& hash) {
+        push_back(std::make_shared<const Change>(std::move(change)), hash);
+    }
+
+    void push_back(Entry change, const ChangeHash& hash) {
+        assert(change);
+        if (segments_.empty() || segments_.back()->entries.size() == segment_capacity) {
+            auto segment = std::make_shared<Segment>();
+            segment->edit = edit_.value();
+            segment->entries.reserve(segment_capacity);
+            segment->hashes.reserve(segment_capacity);
+            segments_.push_back(std::move(segment));
+        } else if (segments_.back()->edit != edit_.value()) {
+            // Tail shared with another log — detach before appending
+            segments_.back() = std::make_shared<Segment>(*segments_.back());
+            segments_.back()->edit = edit_.value();
+        }
+        op_count_ += change->operations.size();
+        segments_.back()->entries.push_back(std::move(change));
+        segments_.back()->hashes.push_back(hash);
+        ++size_;
+    }
+
+    // Copy out as plain values (for the public get_changes API).
+    auto to_vector() const -> std::vector<Change> {
+        auto result = std::vector<Change>{};
+        result.reserve(size_);
+        for (const auto& change : *this) result.push_back(change);
+        return result;
+    }
+
+private:
+    std::vector<std::shared_ptr<Segment>> segments_;
+    std::size_t size_ = 0;
+    std::size_t op_count_ = 0;
+    EditToken edit_;
+};
+
+}  // namespace automerge_cpp::detail
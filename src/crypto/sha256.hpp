@@ -2,6 +2,11 @@
 
 // Header-only SHA-256 implementation.
 // Produces a 32-byte digest conforming to FIPS 180-4.
+//
+// The block function is chosen once at runtime: the x86 SHA extensions
+// (SHA-NI) or the ARMv8 SHA-2 instructions when the CPU has them, otherwise
+// the portable implementation. All produce identical digests.
+//
 // Internal header — not installed.
 
 #include <algorithm>
@@ -10,8 +15,24 @@
 #include <cstdint>
 #include <cstring>
 #include <span>
+#include <string_view>
 #include <vector>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define AUTOMERGE_CPP_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__linux__) || defined(__APPLE__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define AUTOMERGE_CPP_SHA256_ARM 1
+#include <arm_neon.h>
+#ifdef __linux__
+#include <sys/auxv.h>
+#endif
+#endif
+
 namespace automerge_cpp::crypto {
 
 namespace detail {
@@ -88,54 +109,27 @@ inline void write_be64(std::byte* p, std::uint64_t v) {
     p[7] = static_cast<std::byte>(v);
 }
 
-}  // namespace detail
+inline constexpr std::array<std::uint32_t, 8> initial_state = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
 
-// Compute SHA-256 digest of the input bytes.
-inline auto sha256(std::span<const std::byte> input) -> std::array<std::byte, 32> {
-    // Initial hash values
-    auto h = std::array<std::uint32_t, 8>{
-        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
-        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
-    };
-
-    // Padding: message + 0x80 + zeros + 64-bit big-endian length
-    const auto msg_len = input.size();
-    const auto bit_len = static_cast<std::uint64_t>(msg_len) * 8;
-
-    // Pad to 64-byte blocks: need 1 byte (0x80) + enough zeros + 8 bytes length
-    auto padded_len = ((msg_len + 1 + 8 + 63) / 64) * 64;
-
-    // Stack buffer for small inputs (covers typical change hashing ~80-120 bytes).
-    // Falls back to heap for inputs requiring >256 bytes padded.
-    static constexpr std::size_t stack_buf_size = 256;
-    auto stack_buf = std::array<std::byte, stack_buf_size>{};
-    auto heap_buf = std::vector<std::byte>{};
-
-    std::byte* padded = nullptr;
-    if (padded_len <= stack_buf_size) {
-        stack_buf.fill(std::byte{0});
-        padded = stack_buf.data();
-    } else {
-        heap_buf.resize(padded_len, std::byte{0});
-        padded = heap_buf.data();
-    }
-    std::memcpy(padded, input.data(), msg_len);
-    padded[msg_len] = std::byte{0x80};
-    detail::write_be64(padded + padded_len - 8, bit_len);
+// Process num_blocks consecutive 64-byte blocks into state.
+using BlockFn = void (*)(std::uint32_t* state, const std::byte* blocks, std::size_t num_blocks);
 
-    // Process each 64-byte block
+inline void process_blocks_portable(std::uint32_t* h, const std::byte* blocks,
+                                    std::size_t num_blocks) {
     auto w = std::array<std::uint32_t, 64>{};
 
-    for (std::size_t block = 0; block < padded_len; block += 64) {
-        const auto* bp = padded + block;
+    for (std::size_t block = 0; block < num_blocks; ++block) {
+        const auto* bp = blocks + block * 64;
 
         // Prepare message schedule
         for (int i = 0; i < 16; ++i) {
-            w[i] = detail::read_be32(bp + static_cast<std::ptrdiff_t>(i) * 4);
+            w[i] = read_be32(bp + static_cast<std::ptrdiff_t>(i) * 4);
         }
         for (int i = 16; i < 64; ++i) {
-            w[i] = detail::gamma1(w[i - 2]) + w[i - 7] +
-                   detail::gamma0(w[i - 15]) + w[i - 16];
+            w[i] = gamma1(w[i - 2]) + w[i - 7] + gamma0(w[i - 15]) + w[i - 16];
         }
 
         // Working variables
@@ -144,8 +138,8 @@ inline auto sha256(std::span<const std::byte> input) -> std::array<std::byte, 32
 
         // 64 rounds
         for (int i = 0; i < 64; ++i) {
-            auto t1 = hh + detail::sigma1(e) + detail::ch(e, f, g) + detail::k[i] + w[i];
-            auto t2 = detail::sigma0(a) + detail::maj(a, b, c);
+            auto t1 = hh + sigma1(e) + ch(e, f, g) + k[i] + w[i];
+            auto t2 = sigma0(a) + maj(a, b, c);
             hh = g;
             g = f;
             f = e;
@@ -159,15 +153,187 @@ inline auto sha256(std::span<const std::byte> input) -> std::array<std::byte, 32
         h[0] += a; h[1] += b; h[2] += c; h[3] += d;
         h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
     }
+}
+
+#ifdef AUTOMERGE_CPP_SHA256_X86
+
+// SHA-NI: each sha256rnds2 does two rounds; the state lives in two
+// registers as ABEF / CDGH. Message words are kept in a ring of four
+// 4-word vectors, extended with sha256msg1/msg2.
+__attribute__((target("sha,sse4.1")))
+inline void process_blocks_sha_ni(std::uint32_t* h, const std::byte* blocks,
+                                  std::size_t num_blocks) {
+    const auto byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+
+    auto tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h)), 0xB1);
+    auto state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h + 4)), 0x1B);
+    auto state0 = _mm_alignr_epi8(tmp, state1, 8);     // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);       // CDGH
+
+    for (std::size_t block = 0; block < num_blocks; ++block) {
+        const auto* bp = blocks + block * 64;
+        const auto abef = state0;
+        const auto cdgh = state1;
+        __m128i w[4];
+
+        for (int g = 0; g < 16; ++g) {  // four rounds per group
+            auto& x = w[g % 4];
+            if (g < 4) {
+                x = _mm_shuffle_epi8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(bp + g * 16)), byte_swap);
+            } else {
+                // x holds W[4g-16..]; ring holds the three groups after it
+                auto t = _mm_sha256msg1_epu32(x, w[(g + 1) % 4]);
+                t = _mm_add_epi32(t, _mm_alignr_epi8(w[(g + 3) % 4], w[(g + 2) % 4], 4));
+                x = _mm_sha256msg2_epu32(t, w[(g + 3) % 4]);
+            }
+            auto msg = _mm_add_epi32(x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&k[g * 4])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);             // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);          // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);       // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);          // HGFE
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(h), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(h + 4), state1);
+}
+
+inline auto cpu_has_sha_ni() -> bool {
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1)) return false;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    return (ebx & (1u << 29)) != 0;  // CPUID.(EAX=7,ECX=0):EBX.SHA[bit 29]
+}
+
+#endif  // AUTOMERGE_CPP_SHA256_X86
+
+#ifdef AUTOMERGE_CPP_SHA256_ARM
+
+// ARMv8 SHA-2: sha256h/sha256h2 do four rounds on ABCD / EFGH; the
+// message ring is extended with sha256su0/su1.
+__attribute__((target("arch=armv8-a+crypto")))
+inline void process_blocks_armv8(std::uint32_t* h, const std::byte* blocks,
+                                 std::size_t num_blocks) {
+    auto state0 = vld1q_u32(h);      // ABCD
+    auto state1 = vld1q_u32(h + 4);  // EFGH
+
+    for (std::size_t block = 0; block < num_blocks; ++block) {
+        const auto* bp = reinterpret_cast<const std::uint8_t*>(blocks + block * 64);
+        const auto abcd = state0;
+        const auto efgh = state1;
+        uint32x4_t w[4];
+
+        for (int g = 0; g < 16; ++g) {  // four rounds per group
+            auto& x = w[g % 4];
+            if (g < 4) {
+                x = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(bp + g * 16)));
+            } else {
+                x = vsha256su1q_u32(vsha256su0q_u32(x, w[(g + 1) % 4]),
+                                    w[(g + 2) % 4], w[(g + 3) % 4]);
+            }
+            auto msg = vaddq_u32(x, vld1q_u32(&k[g * 4]));
+            auto prev0 = state0;
+            state0 = vsha256hq_u32(state0, state1, msg);
+            state1 = vsha256h2q_u32(state1, prev0, msg);
+        }
+
+        state0 = vaddq_u32(state0, abcd);
+        state1 = vaddq_u32(state1, efgh);
+    }
+
+    vst1q_u32(h, state0);
+    vst1q_u32(h + 4, state1);
+}
+
+inline auto cpu_has_armv8_sha2() -> bool {
+#ifdef __APPLE__
+    return true;  // every Apple arm64 core implements FEAT_SHA256
+#else
+#ifndef HWCAP_SHA2
+#define HWCAP_SHA2 (1 << 6)
+#endif
+    return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+#endif
+}
+
+#endif  // AUTOMERGE_CPP_SHA256_ARM
+
+// The fastest block function this CPU supports (selected once).
+inline auto active_block_fn() -> BlockFn {
+    static const auto fn = []() -> BlockFn {
+#ifdef AUTOMERGE_CPP_SHA256_X86
+        if (cpu_has_sha_ni()) return &process_blocks_sha_ni;
+#endif
+#ifdef AUTOMERGE_CPP_SHA256_ARM
+        if (cpu_has_armv8_sha2()) return &process_blocks_armv8;
+#endif
+        return &process_blocks_portable;
+    }();
+    return fn;
+}
+
+// SHA-256 of input using the given block function.
+inline auto sha256_with(BlockFn process_blocks, std::span<const std::byte> input)
+    -> std::array<std::byte, 32> {
+    auto h = initial_state;
+
+    // Whole blocks straight from the input
+    const auto full_blocks = input.size() / 64;
+    if (full_blocks > 0) process_blocks(h.data(), input.data(), full_blocks);
+
+    // Padding: tail + 0x80 + zeros + 64-bit big-endian length (one or two blocks)
+    const auto tail = input.size() - full_blocks * 64;
+    auto last = std::array<std::byte, 128>{};
+    if (tail > 0) std::memcpy(last.data(), input.data() + full_blocks * 64, tail);
+    last[tail] = std::byte{0x80};
+    const auto last_len = tail + 1 + 8 <= 64 ? std::size_t{64} : std::size_t{128};
+    write_be64(last.data() + last_len - 8, static_cast<std::uint64_t>(input.size()) * 8);
+    process_blocks(h.data(), last.data(), last_len / 64);
 
     // Produce output
     auto result = std::array<std::byte, 32>{};
     for (int i = 0; i < 8; ++i) {
-        detail::write_be32(result.data() + static_cast<std::ptrdiff_t>(i) * 4, h[i]);
+        write_be32(result.data() + static_cast<std::ptrdiff_t>(i) * 4, h[i]);
     }
     return result;
 }
 
+}  // namespace detail
+
+// Compute SHA-256 digest of the input bytes.
+inline auto sha256(std::span<const std::byte> input) -> std::array<std::byte, 32> {
+    return detail::sha256_with(detail::active_block_fn(), input);
+}
+
+// Compute the digests of many inputs at once: out[i] = sha256(inputs[i]).
+// Resolves the backend once for the whole batch. out.size() must be at
+// least inputs.size().
+inline void sha256_many(std::span<const std::span<const std::byte>> inputs,
+                        std::span<std::array<std::byte, 32>> out) {
+    const auto process_blocks = detail::active_block_fn();
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        out[i] = detail::sha256_with(process_blocks, inputs[i]);
+    }
+}
+
+// Name of the block function in use ("sha-ni", "armv8-sha2" or "portable").
+inline auto sha256_backend() -> std::string_view {
+    const auto fn = detail::active_block_fn();
+#ifdef AUTOMERGE_CPP_SHA256_X86
+    if (fn == &detail::process_blocks_sha_ni) return "sha-ni";
+#endif
+#ifdef AUTOMERGE_CPP_SHA256_ARM
+    if (fn == &detail::process_blocks_armv8) return "armv8-sha2";
+#endif
+    return "portable";
+}
+
 // Convenience: hash a vector of bytes.
 inline auto sha256(const std::vector<std::byte>& input) -> std::array<std::byte, 32> {
     return sha256(std::span<const std::byte>{input});
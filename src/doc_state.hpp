@@ -3,110 +3,485 @@
 // Internal header — not installed. Implementation detail of Document.
 
 #include <automerge-cpp/change.hpp>
+#include <automerge-cpp/metrics.hpp>
 #include <automerge-cpp/op.hpp>
+#include <automerge-cpp/patch.hpp>
+#include <automerge-cpp/thread_pool.hpp>
+#include <automerge-cpp/tree_visitor.hpp>
 #include <automerge-cpp/types.hpp>
 #include <automerge-cpp/value.hpp>
 
+#include "change_log.hpp"
 #include "crypto/sha256.hpp"
+#include "edit_token.hpp"
+#include "map_table.hpp"
+#include "persistent_map.hpp"
+#include "sequence_tree.hpp"
+#include "string_pool.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <cstring>
+#include <iterator>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
 #include <optional>
+#include <queue>
 #include <ranges>
-#include <set>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 namespace automerge_cpp::detail {
 
-// An entry at a map key. Multiple entries at the same key = conflict.
-struct MapEntry {
-    OpId op_id;
-    Value value;
-};
-
-// An element in a list or text sequence.
-struct ListElement {
-    OpId insert_id;
-    std::optional<OpId> insert_after;  // which element this was inserted after (nullopt = HEAD)
-    Value value;
-    bool visible = true;
-};
-
 // A rich-text mark anchored by element OpIds (survives edits and merges).
 struct MarkEntry {
     OpId mark_id;       // the OpId of the mark operation itself
     OpId start_elem;    // the OpId of the first element in the range
     OpId end_elem;      // the OpId of the last element in the range (inclusive)
-    std::string name;
+    Symbol name;        // interned in the object's StringPool
     ScalarValue value;
+    OpId reach{};       // the furthest end_elem of this and all earlier marks
+};
+
+// An object's marks. Copies of an object share one array until one of
+// them adds a mark (see EditToken), so cloning an object for a write does
+// not copy its marks.
+class MarkList {
+public:
+    using const_iterator = std::vector<MarkEntry>::const_iterator;
+
+    auto size() const -> std::size_t { return data_ ? data_->entries.size() : 0; }
+    auto empty() const -> bool { return size() == 0; }
+    auto capacity() const -> std::size_t { return data_ ? data_->entries.capacity() : 0; }
+    auto operator[](std::size_t i) const -> const MarkEntry& { return data_->entries[i]; }
+    auto begin() const -> const_iterator { return entries().begin(); }
+    auto end() const -> const_iterator { return entries().end(); }
+
+    // The entries, for writing: copied first if a copy of the list may see them.
+    auto mut() -> std::vector<MarkEntry>& {
+        if (!data_) {
+            data_ = std::make_shared<Data>();
+        } else if (data_->edit != edit_.value()) {
+            data_ = std::make_shared<Data>(*data_);
+        }
+        data_->edit = edit_.value();
+        return data_->entries;
+    }
+
+private:
+    struct Data {
+        std::uint64_t edit = 0;
+        std::vector<MarkEntry> entries;
+    };
+
+    auto entries() const -> const std::vector<MarkEntry>& {
+        static const auto none = std::vector<MarkEntry>{};
+        return data_ ? data_->entries : none;
+    }
+
+    std::shared_ptr<Data> data_;  // null while empty
+    EditToken edit_;
 };
 
 // The state of a single CRDT object in the document tree.
 struct ObjectState {
     ObjType type;
-    std::map<std::string, std::vector<MapEntry>> map_entries;  // map/table
-    std::vector<ListElement> list_elements;                     // list/text
-    std::vector<MarkEntry> marks;                               // rich-text marks
+    MapTable map_entries;              // map/table
+    SequenceTree list_elements;        // list/text (11A.4)
+    MarkList marks;                    // rich-text marks, by start
+    // Where the op that made this object put it: the containing object and,
+    // in a map, the key. In a list the element's id is the object's own id.
+    // Root has no parent.
+    std::optional<ObjId> parent;
+    std::string parent_key;
+    // Interns map keys and mark names; shared by every object of a document.
+    std::shared_ptr<StringPool> strings;
+    // The token of the ObjectTable that made this object (see EditToken).
+    std::uint64_t edit = 0;
+};
+
+// The objects of a DocState, by id. A copy keeps the source's memory
+// resource; assignment keeps the target's.
+//
+// The table is a PersistentMap, so copying it (a fork, or publishing a read
+// snapshot on every commit) is O(1) however many objects there are, and
+// adding or replacing an object copies O(log n) shared nodes. Copies also
+// share the objects themselves; edit is the token (see EditToken) an object
+// must carry for this table to change it in place. Copying the table renews
+// both tokens, so after a copy each clones an object before its first change
+// to it.
+class ObjectTable {
+public:
+    explicit ObjectTable(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : map_{resource} {}
+
+    auto size() const -> std::size_t { return map_.size(); }
+    auto contains(const ObjId& id) const -> bool { return map_.find(id) != nullptr; }
+
+    // The object with this id; null if there is none.
+    auto find(const ObjId& id) const -> const std::shared_ptr<ObjectState>* {
+        return map_.find(id);
+    }
+
+    void assign(const ObjId& id, std::shared_ptr<ObjectState> state) {
+        map_.assign(id, std::move(state));
+    }
+
+    // Visit every object in id order as f(id, state).
+    template <typename F>
+    void for_each(F&& f) const {
+        map_.for_each(f);
+    }
+
+    // Heap bytes held by the table, excluding the objects.
+    auto memory_usage() const -> std::size_t { return map_.memory_usage(); }
+
+    EditToken edit;
+
+private:
+    detail::PersistentMap<ObjId, std::shared_ptr<ObjectState>> map_;
+};
+
+struct DocState;
+
+// Historical state cache (11A.8, 11A.9).
+//
+// snapshots: recently materialised states, keyed by the sorted change_history
+// indices each one contains. A request for heads whose visible set is a
+// superset of a cached one replays only the difference. Copies start with no
+// snapshots: indices only mean something for the history they were built from.
+//
+// checkpoints: the objects after replaying the first history_size changes,
+// recorded every checkpoint_interval changes while a replay covers a prefix
+// of the history. Replay for any heads then starts from the nearest
+// checkpoint the visible set contains. Prefix-based, so copies that share
+// the history prefix keep them.
+struct HistoryCache {
+    struct Snapshot {
+        std::vector<std::size_t> indices;
+        std::shared_ptr<const DocState> state;
+    };
+
+    struct Checkpoint {
+        std::size_t history_size;
+        std::shared_ptr<const DocState> state;
+    };
+
+    static constexpr std::size_t capacity = 4;
+    static constexpr std::size_t max_checkpoints = 16;
+
+    std::mutex mutex;                    // readers share the Document lock
+    std::vector<Snapshot> snapshots;     // most recently used first
+    std::vector<Checkpoint> checkpoints;  // ascending history_size
+    std::size_t checkpoint_interval = 1024;
+
+    HistoryCache() = default;
+    HistoryCache(const HistoryCache& other)
+        : checkpoints{other.checkpoints}, checkpoint_interval{other.checkpoint_interval} {}
+    auto operator=(const HistoryCache& other) -> HistoryCache& {
+        snapshots.clear();
+        checkpoints = other.checkpoints;
+        checkpoint_interval = other.checkpoint_interval;
+        return *this;
+    }
+
+    // Record a checkpoint for a state covering the first history_size
+    // changes, if one is due. Keeps at most max_checkpoints by dropping
+    // every second one and doubling the spacing. Caller holds mutex.
+    void record_checkpoint(std::size_t history_size, std::shared_ptr<const DocState> state) {
+        if (history_size % checkpoint_interval != 0) return;
+        auto pos = std::ranges::lower_bound(checkpoints, history_size, {},
+                                            &Checkpoint::history_size);
+        if (pos != checkpoints.end() && pos->history_size == history_size) return;
+        checkpoints.insert(pos, Checkpoint{
+            .history_size = history_size,
+            .state = std::move(state),
+        });
+        if (checkpoints.size() > max_checkpoints) {
+            checkpoint_interval *= 2;
+            std::erase_if(checkpoints, [&](const Checkpoint& c) {
+                return c.history_size % checkpoint_interval != 0;
+            });
+        }
+    }
+};
+
+// Encoded change chunks for the sync protocol: chunks[i] is the change chunk
+// of change_history[i], built the first time it is sent. Copies share the
+// chunks built so far (the history prefix is shared too).
+struct EncodedChangeCache {
+    std::mutex mutex;  // readers share the Document lock
+    std::vector<std::shared_ptr<const std::vector<std::byte>>> chunks;
+
+    EncodedChangeCache() = default;
+    EncodedChangeCache(const EncodedChangeCache& other) : chunks{other.chunks} {}
+    auto operator=(const EncodedChangeCache& other) -> EncodedChangeCache& {
+        chunks = other.chunks;
+        return *this;
+    }
+};
+
+// Changes given to apply_changes or received in a sync message before all
+// their deps, held until the last one arrives. Each pending change counts its missing deps; waiting maps a
+// missing hash to the pending changes that need it. Every path that adds to
+// the history releases from it (see release_pending), so a pending change is
+// never also in the history.
+struct PendingChanges {
+    struct Entry {
+        Change change;
+        std::size_t missing = 0;
+    };
+
+    std::unordered_map<ChangeHash, Entry> changes;
+    std::unordered_map<ChangeHash, std::vector<ChangeHash>> waiting;
+};
+
+// Dense view of the change DAG, maintained incrementally from the hash
+// index. The deps of change i are the change_history indices
+// deps[dep_start[i], dep_start[i + 1]); generation[i] is one more than the
+// largest generation among them (1 with no known deps), so a change's
+// ancestors all have lower generations. Deps not yet in the history are
+// left out and remembered in unresolved: while none of them arrives later,
+// every dep precedes its change (ordered), which the pruned walks rely on.
+struct ChangeDag {
+    std::vector<std::size_t> dep_start{0};
+    std::vector<std::size_t> deps;
+    std::vector<std::size_t> generation;
+    std::unordered_set<ChangeHash> unresolved;
+    bool ordered = true;
+
+    auto size() const -> std::size_t { return generation.size(); }
+
+    auto deps_of(std::size_t i) const -> std::span<const std::size_t> {
+        return std::span{deps}.subspan(dep_start[i], dep_start[i + 1] - dep_start[i]);
+    }
+};
+
+// Indexes of a DocState's change history, built lazily and extended as
+// changes are appended: the hash index (11A.3), the change DAG, and the
+// actor table (11A.3b) with each actor's position in it.
+//
+// Readers extend them while sharing the Document lock, or with no lock at
+// all on a published snapshot, so extending takes mutex. Each count is the
+// number of changes an index covers, stored after the index is extended: a
+// reader that finds it equal to the history size reads the index without
+// locking, as nothing extends it again until a writer appends a change.
+// Copies copy every index, under the source's mutex.
+struct ChangeIndexes {
+    mutable std::mutex mutex;  // locked to copy from a const source
+    std::unordered_map<ChangeHash, std::size_t> hash_index;  // hash → index
+    ChangeDag dag;
+    std::vector<ActorId> actor_table;
+    std::unordered_map<ActorId, std::uint64_t> actor_index;  // actor → table index
+    std::atomic<std::size_t> hashed{0};          // changes in hash_index
+    std::atomic<std::size_t> in_dag{0};          // changes in dag
+    std::atomic<std::size_t> actors_scanned{0};  // changes scanned into actor_table
+    std::atomic<bool> has_local_actor{false};
+
+    ChangeIndexes() = default;
+    ChangeIndexes(const ChangeIndexes& other) { *this = other; }
+    auto operator=(const ChangeIndexes& other) -> ChangeIndexes& {
+        if (this == &other) return *this;
+        auto lock = std::scoped_lock{other.mutex};
+        hash_index = other.hash_index;
+        dag = other.dag;
+        actor_table = other.actor_table;
+        actor_index = other.actor_index;
+        hashed.store(other.hashed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        in_dag.store(other.in_dag.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        actors_scanned.store(other.actors_scanned.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+        has_local_actor.store(other.has_local_actor.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+        return *this;
+    }
+};
+
+// Deferred decode for Document::load_lazy (11A.11).
+//
+// The chunk has been validated and its heads, clock and local metadata read;
+// bytes keeps the saved document until the first access that needs objects
+// or history decodes it. Copies share the bytes and decode independently.
+struct PendingLoad {
+    std::mutex mutex;                  // readers share the Document lock
+    std::atomic<bool> pending{false};
+    std::shared_ptr<const std::vector<std::byte>> bytes;
+    std::size_t op_count = 0;          // ops stored in bytes (for size estimates)
+
+    PendingLoad() = default;
+    PendingLoad(const PendingLoad& other)
+        : pending{other.pending.load(std::memory_order_acquire)}, bytes{other.bytes},
+          op_count{other.op_count} {}
+    auto operator=(const PendingLoad& other) -> PendingLoad& {
+        pending.store(other.pending.load(std::memory_order_acquire), std::memory_order_release);
+        bytes = other.bytes;
+        op_count = other.op_count;
+        return *this;
+    }
 };
 
 // The complete internal state of a Document.
 struct DocState {
     ActorId actor;
     std::uint64_t next_counter = 1;
-    std::unordered_map<ObjId, ObjectState> objects;
 
-    // Change tracking (Phase 3)
-    std::vector<Change> change_history;
+    // Where the object table, objects and their map tables and sequence
+    // trees allocate (Document's memory resource). Copies share it.
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+
+    // Objects are shared copy-on-write between copies of a DocState (fork,
+    // Document copy, snapshots): copying shares every ObjectState, and the
+    // first mutable access through get_object() clones only that object.
+    // A clone shares its map table, sequence tree and marks with the
+    // original in turn, so it costs O(1), and each change then copies
+    // O(log n) of them.
+    ObjectTable objects{resource};
+
+    // The pool new objects intern their keys in. Each object also holds the
+    // pool, so its symbols outlive any DocState it is shared with.
+    std::shared_ptr<StringPool> strings = std::make_shared<StringPool>();
+
+    // Change tracking (Phase 3). Changes are immutable and shared between
+    // every document that has them (fork, merge, sync) — see ChangeLog.
+    ChangeLog change_history;
     std::vector<ChangeHash> heads;
     std::map<ActorId, std::uint64_t> clock;  // actor -> max seq seen
     std::uint64_t local_seq = 0;
 
-    // Cached change hash index (11A.3) — incrementally maintained.
-    // Only recomputes hashes for newly appended changes (append-only data).
-    mutable std::vector<ChangeHash> cached_hashes_;                        // parallel to change_history
-    mutable std::unordered_map<ChangeHash, std::size_t> cached_hash_index_; // hash → index
+    // change_history[0, saved_change_count) was covered by the last load
+    // or save_incremental (Document::save_incremental emits the rest).
+    std::size_t saved_change_count = 0;
+
+    // Hash index, change DAG and actor table, extended as changes are
+    // appended; never rehashes a change.
+    mutable ChangeIndexes indexes_;
+
+    // Historical snapshots and checkpoints for *_at reads and view_at.
+    mutable HistoryCache history_cache_;
+
+    // Change chunks already encoded for sync messages.
+    mutable EncodedChangeCache encoded_changes_;
 
-    // Cached actor table (11A.3b) — incrementally maintained.
-    // Invalidated by tracking how many changes have been scanned.
-    mutable std::vector<ActorId> cached_actor_table_;
-    mutable std::unordered_set<ActorId> cached_actor_set_;
-    mutable std::size_t cached_actor_table_size_ = 0;  // changes scanned so far
-    mutable bool cached_actor_table_has_local_ = false;
+    // Saved bytes not yet decoded (lazily loaded documents only).
+    mutable PendingLoad pending_load_;
 
-    DocState() {
-        objects[root] = ObjectState{.type = ObjType::map, .map_entries = {}, .list_elements = {}};
+    // Changes waiting for missing deps (apply_changes).
+    PendingChanges pending_changes_;
+
+    DocState() : DocState{std::pmr::get_default_resource()} {}
+
+    explicit DocState(std::pmr::memory_resource* resource) : resource{resource} {
+        objects.assign(root, new_object(ObjType::map, std::nullopt, {}));
+    }
+
+    // A state with no objects and no pool of its own, for read_snapshot to
+    // fill in.
+    struct Unfilled {};
+    explicit DocState(Unfilled) : strings{} {}
+
+    // An immutable copy of the current state for snapshot reads. Objects and
+    // change history are shared copy-on-write; no caches are copied.
+    auto read_snapshot() const -> std::shared_ptr<const DocState> {
+        auto snapshot = std::make_shared<DocState>(Unfilled{});
+        snapshot->actor = actor;
+        snapshot->next_counter = next_counter;
+        snapshot->resource = resource;
+        snapshot->objects = objects;
+        snapshot->strings = strings;
+        snapshot->change_history = change_history;
+        snapshot->heads = heads;
+        snapshot->clock = clock;
+        snapshot->local_seq = local_seq;
+        snapshot->saved_change_count = saved_change_count;
+        return snapshot;
     }
 
     auto next_op_id() -> OpId {
         return OpId{next_counter++, actor};
     }
 
+    // Reserve a contiguous range of n op ids; returns the first.
+    auto next_op_ids(std::uint64_t n) -> OpId {
+        auto id = OpId{next_counter, actor};
+        next_counter += n;
+        return id;
+    }
+
+    // Mutable access detaches a shared object first (copy-on-write).
     auto get_object(const ObjId& id) -> ObjectState* {
-        auto it = objects.find(id);
-        return it != objects.end() ? &it->second : nullptr;
+        const auto* found = objects.find(id);
+        if (!found) return nullptr;
+        if ((*found)->edit == objects.edit.value()) return found->get();
+        auto clone = clone_object(**found);
+        auto* state = clone.get();
+        objects.assign(id, std::move(clone));
+        return state;
+    }
+
+    // An empty object on this state's resource.
+    auto new_object(ObjType type, std::optional<ObjId> parent, std::string parent_key) const
+        -> std::shared_ptr<ObjectState> {
+        return allocate_object(ObjectState{
+            .type = type, .map_entries = MapTable{resource},
+            .list_elements = SequenceTree{resource}, .marks = {}, .parent = std::move(parent),
+            .parent_key = std::move(parent_key), .strings = strings,
+            .edit = objects.edit.value()});
+    }
+
+    // A copy of state on this state's resource, optionally with other elements.
+    auto clone_object(const ObjectState& state,
+                      std::optional<SequenceTree> elements = std::nullopt) const
+        -> std::shared_ptr<ObjectState> {
+        return allocate_object(ObjectState{
+            .type = state.type, .map_entries = MapTable{state.map_entries, resource},
+            .list_elements = elements ? std::move(*elements)
+                                      : SequenceTree{state.list_elements, resource},
+            .marks = state.marks, .parent = state.parent, .parent_key = state.parent_key,
+            .strings = state.strings, .edit = objects.edit.value()});
+    }
+
+    auto allocate_object(ObjectState state) const -> std::shared_ptr<ObjectState> {
+        return std::allocate_shared<ObjectState>(
+            std::pmr::polymorphic_allocator<ObjectState>{resource}, std::move(state));
+    }
+
+    // Move every object onto resource r, leaving none shared with another
+    // state (a fork onto its own resource).
+    void rehome(std::pmr::memory_resource* r) {
+        resource = r;
+        auto table = ObjectTable{r};
+        objects.for_each([&](const ObjId& id, const std::shared_ptr<ObjectState>& state) {
+            auto clone = clone_object(*state);
+            clone->edit = table.edit.value();
+            table.assign(id, std::move(clone));
+        });
+        objects = std::move(table);
     }
 
     auto get_object(const ObjId& id) const -> const ObjectState* {
-        auto it = objects.find(id);
-        return it != objects.end() ? &it->second : nullptr;
+        const auto* found = objects.find(id);
+        return found ? found->get() : nullptr;
     }
 
     // -- Predecessor queries (for Transaction) --------------------------------
 
-    auto map_pred(const ObjId& obj, const std::string& key) const -> std::vector<OpId> {
+    auto map_pred(const ObjId& obj, std::string_view key) const -> std::vector<OpId> {
         const auto* state = get_object(obj);
         if (!state) return {};
-        auto it = state->map_entries.find(key);
-        if (it == state->map_entries.end() || it->second.empty()) return {};
+        const auto* values = state->map_entries.find(key);
+        if (!values) return {};
         auto result = std::vector<OpId>{};
-        result.reserve(it->second.size());
-        std::ranges::transform(it->second, std::back_inserter(result),
-            [](const MapEntry& e) { return e.op_id; });
+        result.reserve(values->size());
+        values->for_each([&](const MapEntry& e) { result.push_back(e.op_id); });
         return result;
     }
 
@@ -129,48 +504,66 @@ struct DocState {
 
     // -- Map operations -------------------------------------------------------
 
-    void map_put(const ObjId& obj, const std::string& key, OpId op_id, Value value) {
+    void map_put(const ObjId& obj, std::string_view key, OpId op_id, Value value) {
         auto* state = get_object(obj);
         assert(state && (state->type == ObjType::map || state->type == ObjType::table));
 
-        auto& entries = state->map_entries[key];
         // For local operations: replace existing entries (no conflicts from same actor)
-        entries.clear();
-        entries.push_back(MapEntry{.op_id = op_id, .value = std::move(value)});
+        state->map_entries.assign(key, MapEntry{.op_id = op_id, .value = std::move(value)},
+                                  *state->strings);
+    }
+
+    // Put entries[i] with op id first_id + i, in order, calling
+    // on_put(i, pred, value) with the entries each one overwrote. The
+    // object is looked up and its table grown once for the batch.
+    template <typename F>
+    void map_put_many(const ObjId& obj, OpId first_id,
+                      std::span<const std::pair<std::string_view, ScalarValue>> entries, F&& on_put) {
+        auto* state = get_object(obj);
+        assert(state && (state->type == ObjType::map || state->type == ObjType::table));
+
+        auto& table = state->map_entries;
+        table.reserve(table.size() + entries.size());
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            const auto& [key, scalar] = entries[i];
+            auto pred = std::vector<OpId>{};
+            if (const auto* values = table.find(key)) {
+                pred.reserve(values->size());
+                values->for_each([&](const MapEntry& e) { pred.push_back(e.op_id); });
+            }
+            auto value = Value{scalar};
+            auto op_id = OpId{first_id.counter + i, first_id.actor};
+            table.assign(key, MapEntry{.op_id = op_id, .value = value}, *state->strings);
+            on_put(i, std::move(pred), std::move(value));
+        }
     }
 
-    void map_delete(const ObjId& obj, const std::string& key) {
+    void map_delete(const ObjId& obj, std::string_view key) {
         auto* state = get_object(obj);
         assert(state && (state->type == ObjType::map || state->type == ObjType::table));
 
         state->map_entries.erase(key);
     }
 
-    auto map_get(const ObjId& obj, const std::string& key) const -> std::optional<Value> {
+    auto map_get(const ObjId& obj, std::string_view key) const -> std::optional<Value> {
         const auto* state = get_object(obj);
         if (!state) return std::nullopt;
 
-        auto it = state->map_entries.find(key);
-        if (it == state->map_entries.end() || it->second.empty()) return std::nullopt;
-
-        // Return the winning value (highest OpId)
-        const auto& entries = it->second;
-        auto winner = std::ranges::max_element(entries,
-            [](const MapEntry& a, const MapEntry& b) { return a.op_id < b.op_id; });
-        return winner->value;
+        const auto* values = state->map_entries.find(key);
+        if (!values) return std::nullopt;
+        return values->winner().value;
     }
 
-    auto map_get_all(const ObjId& obj, const std::string& key) const -> std::vector<Value> {
+    auto map_get_all(const ObjId& obj, std::string_view key) const -> std::vector<Value> {
         const auto* state = get_object(obj);
         if (!state) return {};
 
-        auto it = state->map_entries.find(key);
-        if (it == state->map_entries.end()) return {};
+        const auto* values = state->map_entries.find(key);
+        if (!values) return {};
 
         auto result = std::vector<Value>{};
-        result.reserve(it->second.size());
-        std::ranges::transform(it->second, std::back_inserter(result),
-            [](const MapEntry& e) { return e.value; });
+        result.reserve(values->size());
+        values->for_each([&](const MapEntry& e) { result.push_back(e.value); });
         return result;
     }
 
@@ -180,8 +573,8 @@ struct DocState {
 
         auto result = std::vector<std::string>{};
         result.reserve(state->map_entries.size());
-        std::ranges::transform(state->map_entries, std::back_inserter(result),
-            [](const auto& pair) { return pair.first; });
+        state->map_entries.for_each_sorted(
+            [&](std::string_view key, const MapValues&) { result.emplace_back(key); });
         return result;
     }
 
@@ -191,27 +584,18 @@ struct DocState {
 
         auto result = std::vector<Value>{};
         result.reserve(state->map_entries.size());
-        for (const auto& [key, entries] : state->map_entries) {
-            if (entries.empty()) continue;
-            auto winner = std::ranges::max_element(entries,
-                [](const MapEntry& a, const MapEntry& b) { return a.op_id < b.op_id; });
-            result.push_back(winner->value);
-        }
+        state->map_entries.for_each_sorted([&](std::string_view, const MapValues& values) {
+            result.push_back(values.winner().value);
+        });
         return result;
     }
 
     // -- List operations ------------------------------------------------------
 
+    // O(log n) via the sequence tree's visible counts (11A.4).
+    // index == visible count means "past the end" (for insert at end).
     auto visible_index_to_real(const ObjectState& state, std::size_t index) const -> std::size_t {
-        auto visible_count = std::size_t{0};
-        for (std::size_t i = 0; i < state.list_elements.size(); ++i) {
-            if (state.list_elements[i].visible) {
-                if (visible_count == index) return i;
-                ++visible_count;
-            }
-        }
-        // index == visible_count means "past the end" (for insert at end)
-        return state.list_elements.size();
+        return state.list_elements.find_visible(index);
     }
 
     void list_insert(const ObjId& obj, std::size_t index, OpId op_id, Value value,
@@ -220,19 +604,41 @@ struct DocState {
         assert(state && (state->type == ObjType::list || state->type == ObjType::text));
 
         auto real_idx = visible_index_to_real(*state, index);
-        state->list_elements.insert(
-            state->list_elements.begin() + static_cast<std::ptrdiff_t>(real_idx),
+        state->list_elements.insert(real_idx,
             ListElement{.insert_id = op_id, .insert_after = insert_after,
                         .value = std::move(value), .visible = true});
     }
 
+    // Insert values at a visible index as a chain of elements with ids
+    // first_id, first_id + 1, ..., each after the previous.
+    void list_insert_many(const ObjId& obj, std::size_t index, OpId first_id,
+                          std::span<const Value> values,
+                          std::optional<OpId> insert_after = std::nullopt) {
+        auto* state = get_object(obj);
+        assert(state && (state->type == ObjType::list || state->type == ObjType::text));
+
+        auto real_idx = visible_index_to_real(*state, index);
+        state->list_elements.insert_values(real_idx, first_id, insert_after, values);
+    }
+
+    // Insert text at a visible index as one element per byte with ids
+    // first_id, first_id + 1, ... (a batched splice_text op).
+    void text_insert(const ObjId& obj, std::size_t index, OpId first_id, std::string_view text,
+                     std::optional<OpId> insert_after = std::nullopt) {
+        auto* state = get_object(obj);
+        assert(state && (state->type == ObjType::list || state->type == ObjType::text));
+
+        auto real_idx = visible_index_to_real(*state, index);
+        state->list_elements.insert_text(real_idx, first_id, insert_after, text);
+    }
+
     void list_set(const ObjId& obj, std::size_t index, OpId op_id, Value value) {
         auto* state = get_object(obj);
         assert(state && (state->type == ObjType::list || state->type == ObjType::text));
 
         auto real_idx = visible_index_to_real(*state, index);
         assert(real_idx < state->list_elements.size());
-        state->list_elements[real_idx].value = std::move(value);
+        state->list_elements.set_value(real_idx, std::move(value));
     }
 
     void list_delete(const ObjId& obj, std::size_t index) {
@@ -241,7 +647,7 @@ struct DocState {
 
         auto real_idx = visible_index_to_real(*state, index);
         assert(real_idx < state->list_elements.size());
-        state->list_elements[real_idx].visible = false;
+        state->list_elements.set_visible(real_idx, false);
     }
 
     auto list_get(const ObjId& obj, std::size_t index) const -> std::optional<Value> {
@@ -258,8 +664,7 @@ struct DocState {
         const auto* state = get_object(obj);
         if (!state) return 0;
 
-        return static_cast<std::size_t>(std::ranges::count_if(
-            state->list_elements, &ListElement::visible));
+        return state->list_elements.visible_size();
     }
 
     auto list_values(const ObjId& obj) const -> std::vector<Value> {
@@ -267,6 +672,7 @@ struct DocState {
         if (!state) return {};
 
         auto result = std::vector<Value>{};
+        result.reserve(state->list_elements.visible_size());
         for (const auto& elem : state->list_elements) {
             if (elem.visible) result.push_back(elem.value);
         }
@@ -277,21 +683,17 @@ struct DocState {
 
     /// Resolve the ObjId of a nested object at a map key.
     /// Returns nullopt if the key doesn't exist or holds a scalar.
-    auto get_obj_id_for_key(const ObjId& obj, const std::string& key) const -> std::optional<ObjId> {
+    auto get_obj_id_for_key(const ObjId& obj, std::string_view key) const -> std::optional<ObjId> {
         const auto* state = get_object(obj);
         if (!state) return std::nullopt;
 
-        auto it = state->map_entries.find(key);
-        if (it == state->map_entries.end() || it->second.empty()) return std::nullopt;
-
-        // Find the winning entry (highest OpId)
-        const auto& entries = it->second;
-        auto winner = std::ranges::max_element(entries,
-            [](const MapEntry& a, const MapEntry& b) { return a.op_id < b.op_id; });
+        const auto* values = state->map_entries.find(key);
+        if (!values) return std::nullopt;
 
-        // Must be an object type, not a scalar
-        if (!std::holds_alternative<ObjType>(winner->value)) return std::nullopt;
-        return ObjId{winner->op_id};
+        // The winning entry must be an object type, not a scalar
+        const auto& winner = values->winner();
+        if (!std::holds_alternative<ObjType>(winner.value)) return std::nullopt;
+        return ObjId{winner.op_id};
     }
 
     /// Resolve the ObjId of a nested object at a list index.
@@ -317,39 +719,77 @@ struct DocState {
         }, prop);
     }
 
+    // -- Tree walk ------------------------------------------------------------
+
+    /// Depth-first walk of obj and everything below it, visiting each live
+    /// value exactly once. A missing object produces no events.
+    void walk(const ObjId& obj, TreeVisitor& visitor) const {
+        const auto* state = get_object(obj);
+        if (!state) return;
+
+        auto visit_value = [&](const Value& value, const OpId& id) {
+            std::visit(overload{
+                [&](ObjType) { walk(ObjId{id}, visitor); },
+                [&](const ScalarValue& sv) { visitor.scalar(sv); },
+            }, value);
+        };
+
+        switch (state->type) {
+            case ObjType::text: {
+                auto text = std::string{};
+                text.reserve(state->list_elements.visible_size());
+                state->list_elements.append_visible_text(text);
+                visitor.text(text);
+                return;
+            }
+            case ObjType::map:
+            case ObjType::table:
+                visitor.begin_map();
+                state->map_entries.for_each_sorted(
+                    [&](std::string_view key, const MapValues& values) {
+                        visitor.key(key);
+                        visit_value(values.winner().value, values.winner().op_id);
+                    });
+                visitor.end_map();
+                return;
+            case ObjType::list:
+                visitor.begin_list(state->list_elements.visible_size());
+                for (const auto& elem : state->list_elements) {
+                    if (elem.visible) visit_value(elem.value, elem.insert_id);
+                }
+                visitor.end_list();
+                return;
+        }
+    }
+
     // -- Text operations ------------------------------------------------------
 
     auto text_content(const ObjId& obj) const -> std::string {
         const auto* state = get_object(obj);
         if (!state) return {};
 
+        // Text runs (11A.6) append whole buffers rather than one byte at a time.
         auto result = std::string{};
-        for (const auto& elem : state->list_elements) {
-            if (!elem.visible) continue;
-            if (auto* sv = std::get_if<ScalarValue>(&elem.value)) {
-                if (auto* s = std::get_if<std::string>(sv)) {
-                    result += *s;
-                }
-            }
-        }
+        result.reserve(state->list_elements.visible_size());
+        state->list_elements.append_visible_text(result);
         return result;
     }
 
     // -- Counter operations ---------------------------------------------------
 
-    void counter_increment(const ObjId& obj, const std::string& key, std::int64_t delta) {
+    void counter_increment(const ObjId& obj, std::string_view key, std::int64_t delta) {
         auto* state = get_object(obj);
         assert(state && (state->type == ObjType::map || state->type == ObjType::table));
 
-        auto it = state->map_entries.find(key);
-        assert(it != state->map_entries.end() && !it->second.empty());
+        auto* values = state->map_entries.find(key);
+        assert(values);
 
-        auto& entry = it->second.back();
-        auto* sv = std::get_if<ScalarValue>(&entry.value);
-        assert(sv);
-        auto* counter = std::get_if<Counter>(sv);
-        assert(counter);
-        counter->value += delta;
+        // Like a remote increment, add to every conflicting counter.
+        values->for_each([&](MapEntry& entry) {
+            auto* sv = std::get_if<ScalarValue>(&entry.value);
+            auto* counter = sv ? std::get_if<Counter>(sv) : nullptr;
+            if (counter) counter->value += delta;
+        });
     }
 
     // -- Mark operations ------------------------------------------------------
@@ -359,37 +799,111 @@ struct DocState {
         auto* state = get_object(obj);
         assert(state && (state->type == ObjType::list || state->type == ObjType::text));
 
-        // Remove any existing mark with the same name and mark_id actor
-        // (same actor overriding their own mark with the same name)
-        state->marks.push_back(MarkEntry{
+        add_mark(*state, MarkEntry{
             .mark_id = mark_id,
             .start_elem = start_elem,
             .end_elem = end_elem,
-            .name = name,
+            .name = state->strings->intern(name),
             .value = std::move(value),
         });
     }
 
+    // ObjectState::marks is an interval index. Entries are sorted by the
+    // position of start_elem (then mark_id), and each entry's reach is the
+    // furthest end_elem among it and all entries before it. List edits never
+    // reorder existing elements, and compaction keeps mark endpoints, so
+    // both orders hold without maintenance; only adding a mark touches them.
+    //
+    // A mark with the same name and endpoints as an existing one supersedes
+    // it if its mark_id is higher and is dropped otherwise, so repeated
+    // marking of a range does not accumulate entries (and replicas agree).
+    static void add_mark(ObjectState& state, MarkEntry entry) {
+        auto& marks = state.marks.mut();
+        const auto& elements = state.list_elements;
+        auto pos = [&](const OpId& id) { return elements.find(id).value_or(elements.size()); };
+
+        // Marks sharing entry's start element sit together at its position.
+        const auto start = pos(entry.start_elem);
+        auto erased = std::optional<std::size_t>{};
+        auto lo = std::ranges::partition_point(marks, [&](const MarkEntry& m) {
+            return pos(m.start_elem) < start;
+        });
+        for (auto it = lo; it != marks.end() && it->start_elem == entry.start_elem; ++it) {
+            if (it->name != entry.name || it->end_elem != entry.end_elem) continue;
+            if (it->mark_id > entry.mark_id) return;
+            erased = static_cast<std::size_t>(it - marks.begin());
+            marks.erase(it);
+            break;
+        }
+
+        auto at = std::ranges::partition_point(marks, [&](const MarkEntry& m) {
+            auto p = pos(m.start_elem);
+            return p < start || (p == start && m.mark_id < entry.mark_id);
+        });
+        auto index = static_cast<std::size_t>(at - marks.begin());
+        marks.insert(at, std::move(entry));
+
+        // Refresh reach from the first changed entry. Past the new entry and
+        // the hole left by a superseded one, a recomputed reach equal to the
+        // stored one means every later stored reach is right too.
+        auto from = index;
+        auto settled = index + 1;
+        if (erased) {
+            auto hole = *erased >= index ? *erased + 1 : *erased;
+            from = std::min(from, hole);
+            settled = std::max(settled, hole);
+        }
+        for (auto i = from; i < marks.size(); ++i) {
+            auto reach = marks[i].end_elem;
+            if (i > 0 && pos(marks[i - 1].reach) > pos(reach)) reach = marks[i - 1].reach;
+            if (i >= settled && marks[i].reach == reach) break;
+            marks[i].reach = reach;
+        }
+    }
+
     // Resolve a MarkEntry to visible indices. Returns nullopt if either
-    // endpoint is no longer visible.
+    // endpoint is no longer visible. O(log n).
     auto resolve_mark_indices(const ObjectState& state, const MarkEntry& entry) const
         -> std::optional<std::pair<std::size_t, std::size_t>> {
-        auto start_idx = std::optional<std::size_t>{};
-        auto end_idx = std::optional<std::size_t>{};
-        auto visible_count = std::size_t{0};
+        const auto& elements = state.list_elements;
+        auto start = elements.find(entry.start_elem);
+        auto end = elements.find(entry.end_elem);
+        if (!start || !end) return std::nullopt;
+        if (!elements.iterator_at(*start).visible() || !elements.iterator_at(*end).visible()) {
+            return std::nullopt;
+        }
+        return std::pair{elements.visible_rank(*start), elements.visible_rank(*end) + 1};
+    }
 
-        for (const auto& elem : state.list_elements) {
-            if (elem.insert_id == entry.start_elem && elem.visible) {
-                start_idx = visible_count;
-            }
-            if (elem.insert_id == entry.end_elem && elem.visible) {
-                end_idx = visible_count;
+    // Indices into state.marks of the visible marks overlapping the visible
+    // range [start, end), in start order. Binary search bounds the marks that
+    // start before end; scanning those backwards stops at the first entry
+    // whose reach ends before start, so marks wholly before the range are
+    // mostly never looked at.
+    auto marks_overlapping(const ObjectState& state, std::size_t start, std::size_t end) const
+        -> std::vector<std::size_t> {
+        const auto& elements = state.list_elements;
+        const auto& marks = state.marks;
+        auto result = std::vector<std::size_t>{};
+        if (start >= end || start >= elements.visible_size()) return result;
+
+        auto pos = [&](const OpId& id) { return elements.find(id).value_or(elements.size()); };
+        const auto first = elements.find_visible(start);
+        const auto last = end >= elements.visible_size() ? elements.size()
+                                                         : elements.find_visible(end);
+
+        auto hi = std::ranges::partition_point(marks, [&](const MarkEntry& m) {
+            return pos(m.start_elem) < last;
+        }) - marks.begin();
+        for (auto i = hi; i-- > 0;) {
+            const auto& mark = marks[static_cast<std::size_t>(i)];
+            if (pos(mark.reach) < first) break;
+            if (pos(mark.end_elem) >= first && resolve_mark_indices(state, mark)) {
+                result.push_back(static_cast<std::size_t>(i));
             }
-            if (elem.visible) ++visible_count;
         }
-
-        if (!start_idx || !end_idx) return std::nullopt;
-        return std::pair{*start_idx, *end_idx + 1};  // end is exclusive
+        std::ranges::reverse(result);
+        return result;
     }
 
     // -- Generic queries ------------------------------------------------------
@@ -415,12 +929,45 @@ struct DocState {
         return 0;
     }
 
-    auto create_object(OpId id, ObjType type) -> ObjId {
+    auto create_object(OpId id, ObjType type, std::optional<ObjId> parent = std::nullopt,
+                       std::string parent_key = {}) -> ObjId {
         auto obj_id = ObjId{id};
-        objects[obj_id] = ObjectState{.type = type, .map_entries = {}, .list_elements = {}};
+        objects.assign(obj_id, new_object(type, std::move(parent), std::move(parent_key)));
         return obj_id;
     }
 
+    // The path from the root to obj, or nullopt if obj does not exist or is
+    // not reachable from the root (overwritten, deleted, or inside such an
+    // object). One hop per ancestor via the parent links: a map hop is a
+    // key lookup, a list hop ranks the element in the sequence tree.
+    auto path_of(const ObjId& obj) const -> std::optional<Path> {
+        auto path = Path{};
+        auto current = obj;
+        while (!current.is_root()) {
+            const auto* state = get_object(current);
+            if (!state || !state->parent) return std::nullopt;
+            const auto* parent = get_object(*state->parent);
+            if (!parent) return std::nullopt;
+            const auto& id = std::get<OpId>(current.inner);
+            if (parent->type == ObjType::list || parent->type == ObjType::text) {
+                auto pos = parent->list_elements.find(id);
+                if (!pos) return std::nullopt;
+                auto elem = parent->list_elements.iterator_at(*pos);
+                if (!elem.visible() || !std::holds_alternative<ObjType>((*elem).value)) {
+                    return std::nullopt;
+                }
+                path.emplace_back(parent->list_elements.visible_rank(*pos));
+            } else {
+                const auto* values = parent->map_entries.find(state->parent_key);
+                if (!values || values->winner().op_id != id) return std::nullopt;
+                path.emplace_back(state->parent_key);
+            }
+            current = *state->parent;
+        }
+        std::ranges::reverse(path);
+        return path;
+    }
+
     // -- RGA merge support (Phase 3) ------------------------------------------
 
     // Find the real index to insert a new element using the RGA algorithm.
@@ -428,67 +975,91 @@ struct DocState {
     // new_id: the OpId of the element being inserted
     auto find_rga_position(const ObjectState& state, std::optional<OpId> insert_after,
                            OpId new_id) const -> std::size_t {
-        // Step 1: Find the position after the origin element
-        std::size_t pos = 0;
+        const auto& elements = state.list_elements;
 
+        // Step 1: Find the position after the origin element (element index, 11A.5)
+        auto scan_start = std::size_t{0};
+        auto it = elements.begin();
         if (insert_after) {
-            bool found = false;
-            for (std::size_t i = 0; i < state.list_elements.size(); ++i) {
-                if (state.list_elements[i].insert_id == *insert_after) {
-                    pos = i + 1;
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                return state.list_elements.size();
+            it = elements.find_iterator(*insert_after);
+            if (it == elements.end()) {
+                return elements.size();
             }
+            scan_start = elements.position_of(it);
+            ++it;
         }
+        auto pos = insert_after ? scan_start + 1 : std::size_t{0};
 
         // Step 2: Scan right — skip elements that have higher priority or belong
-        // to subtrees of higher-priority concurrent inserts.
-        auto scanned = std::unordered_set<OpId>{};
-        if (insert_after) scanned.insert(*insert_after);
-
-        while (pos < state.list_elements.size()) {
-            const auto& elem = state.list_elements[pos];
-
-            const bool same_origin = (elem.insert_after == insert_after);
-            bool origin_in_scan = same_origin;
-
-            if (!same_origin && elem.insert_after) {
-                origin_in_scan = scanned.contains(*elem.insert_after);
+        // to subtrees of higher-priority concurrent inserts. Everything scanned
+        // so far occupies [scan_start, pos), so "origin already scanned" is a
+        // range check on the origin's position instead of a per-op visited set.
+        auto prev_id = insert_after;
+        for (; it != elements.end(); ++it, ++pos) {
+            const auto elem_id = it.insert_id();
+            const auto elem_origin = it.insert_after();
+
+            const bool same_origin = (elem_origin == insert_after);
+            if (!same_origin) {
+                if (!elem_origin) break;
+                // Fast path: a child of the element just scanned
+                if (elem_origin != prev_id) {
+                    auto origin_pos = elements.find(*elem_origin);
+                    if (!origin_pos || *origin_pos < scan_start || *origin_pos >= pos) break;
+                }
             }
 
-            if (!origin_in_scan) break;
-
-            if (same_origin && elem.insert_id <= new_id) {
+            if (same_origin && elem_id <= new_id) {
                 // Lower priority — insert before it
                 break;
-            } else {
-                // Higher priority concurrent insert or subtree element — skip
-                scanned.insert(elem.insert_id);
-                ++pos;
             }
+            // Higher priority concurrent insert or subtree element — skip
+            prev_id = elem_id;
         }
 
         return pos;
     }
 
+    // Real position of the first list element named by a pred, or nullopt.
+    // List put/del ops carry the target element's insert_id in pred.
+    auto find_pred_element(const ObjectState& state, const std::vector<OpId>& pred) const
+        -> std::optional<std::size_t> {
+        for (const auto& p : pred) {
+            if (auto pos = state.list_elements.find(p)) return pos;
+        }
+        return std::nullopt;
+    }
+
     // -- Remote operation application (Phase 3) -------------------------------
 
-    void apply_op(const Op& op) {
+    void apply_op(const Op& op, std::vector<Patch>* patches = nullptr) {
+        AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::apply_op);
+        register_op(op);
+        if (auto* obj_state = get_object(op.obj)) apply_op_to(*obj_state, op, patches);
+    }
+
+    // The document-wide part of applying op: keep our counter ahead of it
+    // and create the object it makes, if any.
+    void register_op(const Op& op) {
         // Ensure our counter stays ahead of any ops we see
-        next_counter = std::max(next_counter, op.id.counter + 1);
+        next_counter = std::max(next_counter, op.id.counter + op.width());
 
         // If the value represents a nested object, ensure it exists
         if (std::holds_alternative<ObjType>(op.value)) {
             auto obj_id = ObjId{op.id};
-            if (objects.find(obj_id) == objects.end()) {
-                create_object(op.id, std::get<ObjType>(op.value));
+            if (!objects.contains(obj_id)) {
+                const auto* key = std::get_if<std::string>(&op.key);
+                create_object(op.id, std::get<ObjType>(op.value), op.obj, key ? *key : std::string{});
             }
         }
+    }
 
+    // The per-object part of applying op to its (already detached) target.
+    // Touches nothing but target, so ops on different objects can be
+    // applied concurrently. With patches, the visible effect of the op
+    // (if any) is appended, with list positions resolved to visible indices.
+    void apply_op_to(ObjectState& target, const Op& op,
+                     std::vector<Patch>* patches = nullptr) const {
         auto* key_str = std::get_if<std::string>(&op.key);
         const bool is_map = key_str != nullptr;
 
@@ -497,22 +1068,19 @@ struct DocState {
             case OpType::make_object: {
                 if (is_map) {
                     // Map put with conflict handling
-                    auto* obj_state = get_object(op.obj);
-                    if (!obj_state) break;
-                    auto& entries = obj_state->map_entries[*key_str];
-                    // Remove predecessors (values being overridden)
-                    std::erase_if(entries, [&](const MapEntry& e) {
-                        return std::ranges::find(op.pred, e.op_id) != op.pred.end();
-                    });
-                    entries.push_back(MapEntry{.op_id = op.id, .value = op.value});
+                    // Replaces the predecessors; concurrent values remain as conflicts
+                    const auto& values = target.map_entries.put(
+                        *key_str, op.pred, MapEntry{.op_id = op.id, .value = op.value},
+                        *target.strings);
+                    if (patches) push_map_winner(*patches, op, values);
                 } else {
                     // List set — find target element by pred, update value
-                    auto* obj_state = get_object(op.obj);
-                    if (!obj_state) break;
-                    for (auto& elem : obj_state->list_elements) {
-                        if (std::ranges::find(op.pred, elem.insert_id) != op.pred.end()) {
-                            elem.value = op.value;
-                            break;
+                    if (auto pos = find_pred_element(target, op.pred)) {
+                        target.list_elements.set_value(*pos, op.value);
+                        if (patches && target.list_elements.iterator_at(*pos).visible()) {
+                            auto index = target.list_elements.visible_rank(*pos);
+                            push_patch(*patches, Patch{.obj = op.obj, .key = list_index(index),
+                                                       .action = PatchPut{op.value, false}});
                         }
                     }
                 }
@@ -520,36 +1088,49 @@ struct DocState {
             }
             case OpType::insert:
             case OpType::splice_text: {
-                auto* obj_state = get_object(op.obj);
-                if (!obj_state) break;
-                auto rga_pos = find_rga_position(*obj_state, op.insert_after, op.id);
-                obj_state->list_elements.insert(
-                    obj_state->list_elements.begin() + static_cast<std::ptrdiff_t>(rga_pos),
-                    ListElement{.insert_id = op.id, .insert_after = op.insert_after,
-                                .value = op.value, .visible = true});
+                auto rga_pos = find_rga_position(target, op.insert_after, op.id);
+                // A batched splice is a chain: every element after the first
+                // is inserted after its predecessor, so the whole range lands
+                // contiguously at the first element's RGA position.
+                if (op.width() > 1) {
+                    const auto& bytes = std::get<std::string>(std::get<ScalarValue>(op.value));
+                    target.list_elements.insert_text(rga_pos, op.id, op.insert_after, bytes);
+                } else {
+                    target.list_elements.insert(rga_pos,
+                        ListElement{.insert_id = op.id, .insert_after = op.insert_after,
+                                    .value = op.value, .visible = true});
+                }
+                if (patches) {
+                    auto index = target.list_elements.visible_rank(rga_pos);
+                    auto action = PatchAction{PatchInsert{index, op.value}};
+                    if (op.action == OpType::splice_text) {
+                        action = PatchSpliceText{index, 0,
+                            std::get<std::string>(std::get<ScalarValue>(op.value))};
+                    }
+                    push_patch(*patches, Patch{.obj = op.obj, .key = list_index(index),
+                                               .action = std::move(action)});
+                }
                 break;
             }
             case OpType::del: {
                 if (is_map) {
-                    auto* obj_state = get_object(op.obj);
-                    if (!obj_state) break;
-                    auto it = obj_state->map_entries.find(*key_str);
-                    if (it != obj_state->map_entries.end()) {
-                        std::erase_if(it->second, [&](const MapEntry& e) {
-                            return std::ranges::find(op.pred, e.op_id) != op.pred.end();
-                        });
-                        if (it->second.empty()) {
-                            obj_state->map_entries.erase(it);
+                    if (target.map_entries.remove(*key_str, op.pred) && patches) {
+                        if (const auto* values = target.map_entries.find(*key_str)) {
+                            push_map_winner(*patches, op, *values);
+                        } else {
+                            push_patch(*patches, Patch{.obj = op.obj, .key = op.key,
+                                                       .action = PatchDelete{0, 1}});
                         }
                     }
                 } else {
                     // List delete — find element by pred, mark invisible
-                    auto* obj_state = get_object(op.obj);
-                    if (!obj_state) break;
-                    for (auto& elem : obj_state->list_elements) {
-                        if (std::ranges::find(op.pred, elem.insert_id) != op.pred.end()) {
-                            elem.visible = false;
-                            break;
+                    if (auto pos = find_pred_element(target, op.pred)) {
+                        const bool was_visible = target.list_elements.iterator_at(*pos).visible();
+                        target.list_elements.set_visible(*pos, false);
+                        if (patches && was_visible) {
+                            auto index = target.list_elements.visible_rank(*pos);
+                            push_patch(*patches, Patch{.obj = op.obj, .key = list_index(index),
+                                                       .action = PatchDelete{index, 1}});
                         }
                     }
                 }
@@ -557,21 +1138,24 @@ struct DocState {
             }
             case OpType::increment: {
                 if (!is_map) break;
-                auto* obj_state = get_object(op.obj);
-                if (!obj_state) break;
-                auto it = obj_state->map_entries.find(*key_str);
-                if (it == obj_state->map_entries.end()) break;
+                auto* values = target.map_entries.find(*key_str);
+                if (!values) break;
                 auto* delta_sv = std::get_if<ScalarValue>(&op.value);
                 if (!delta_sv) break;
                 auto* delta_counter = std::get_if<Counter>(delta_sv);
                 if (!delta_counter) break;
                 // Increment all conflict entries' counters
-                for (auto& entry : it->second) {
+                auto incremented = false;
+                values->for_each([&](MapEntry& entry) {
                     auto* sv = std::get_if<ScalarValue>(&entry.value);
-                    if (!sv) continue;
-                    auto* counter = std::get_if<Counter>(sv);
-                    if (!counter) continue;
+                    auto* counter = sv ? std::get_if<Counter>(sv) : nullptr;
+                    if (!counter) return;
                     counter->value += delta_counter->value;
+                    incremented = true;
+                });
+                if (patches && incremented) {
+                    push_patch(*patches, Patch{.obj = op.obj, .key = op.key,
+                                               .action = PatchIncrement{delta_counter->value}});
                 }
                 break;
             }
@@ -580,13 +1164,11 @@ struct DocState {
                 // pred[0]=start element, pred[1]=end element
                 if (!is_map) break;  // name is stored as string key
                 if (op.pred.size() < 2) break;
-                auto* obj_state = get_object(op.obj);
-                if (!obj_state) break;
-                obj_state->marks.push_back(MarkEntry{
+                add_mark(target, MarkEntry{
                     .mark_id = op.id,
                     .start_elem = op.pred[0],
                     .end_elem = op.pred[1],
-                    .name = *key_str,
+                    .name = target.strings->intern(*key_str),
                     .value = std::get_if<ScalarValue>(&op.value)
                         ? *std::get_if<ScalarValue>(&op.value)
                         : ScalarValue{Null{}},
@@ -596,138 +1178,418 @@ struct DocState {
         }
     }
 
+    // The value now visible at op's map key, after op changed its entries.
+    static void push_map_winner(std::vector<Patch>& patches, const Op& op,
+                                const MapValues& values) {
+        push_patch(patches, Patch{.obj = op.obj, .key = op.key,
+                                  .action = PatchPut{values.winner().value, values.conflicted()}});
+    }
+
+    // Append a patch, folding it into the previous one where a run of
+    // remote ops forms one edit: deletes at the same index, or text typed
+    // right after the previous splice.
+    static void push_patch(std::vector<Patch>& patches, Patch patch) {
+        if (!patches.empty() && patches.back().obj == patch.obj) {
+            auto& last = patches.back().action;
+            if (auto* del = std::get_if<PatchDelete>(&last)) {
+                const auto* next = std::get_if<PatchDelete>(&patch.action);
+                if (next && std::holds_alternative<std::size_t>(patches.back().key) &&
+                    std::holds_alternative<std::size_t>(patch.key) && next->index == del->index) {
+                    del->count += next->count;
+                    return;
+                }
+            } else if (auto* splice = std::get_if<PatchSpliceText>(&last)) {
+                const auto* next = std::get_if<PatchSpliceText>(&patch.action);
+                if (next && next->index == splice->index + splice->text.size()) {
+                    splice->text += next->text;
+                    return;
+                }
+            }
+        }
+        patches.push_back(std::move(patch));
+    }
+
     // -- Cached actor table (11A.3b) --------------------------------------------
 
     void ensure_actor_table() const {
-        // Ensure local actor is first
-        if (!cached_actor_table_has_local_) {
-            if (cached_actor_set_.insert(actor).second) {
-                cached_actor_table_.push_back(actor);
+        auto& ix = indexes_;
+        if (ix.has_local_actor.load(std::memory_order_acquire)
+            && ix.actors_scanned.load(std::memory_order_acquire) == change_history.size()) {
+            return;
+        }
+        auto lock = std::scoped_lock{ix.mutex};
+        auto add = [&](const ActorId& a) {
+            if (ix.actor_index.try_emplace(a, ix.actor_table.size()).second) {
+                ix.actor_table.push_back(a);
             }
-            cached_actor_table_has_local_ = true;
+        };
+        // Ensure local actor is first
+        if (!ix.has_local_actor.load(std::memory_order_relaxed)) {
+            add(actor);
+            ix.has_local_actor.store(true, std::memory_order_release);
         }
         // Scan only newly appended changes
-        for (auto i = cached_actor_table_size_; i < change_history.size(); ++i) {
+        for (auto i = ix.actors_scanned.load(std::memory_order_relaxed); i < change_history.size(); ++i) {
             const auto& change = change_history[i];
-            if (cached_actor_set_.insert(change.actor).second) {
-                cached_actor_table_.push_back(change.actor);
-            }
+            add(change.actor);
             for (const auto& op : change.operations) {
-                if (cached_actor_set_.insert(op.id.actor).second) {
-                    cached_actor_table_.push_back(op.id.actor);
-                }
-                if (!op.obj.is_root()) {
-                    const auto& obj_op = std::get<OpId>(op.obj.inner);
-                    if (cached_actor_set_.insert(obj_op.actor).second) {
-                        cached_actor_table_.push_back(obj_op.actor);
-                    }
-                }
-                if (op.insert_after) {
-                    if (cached_actor_set_.insert(op.insert_after->actor).second) {
-                        cached_actor_table_.push_back(op.insert_after->actor);
-                    }
-                }
-                for (const auto& p : op.pred) {
-                    if (cached_actor_set_.insert(p.actor).second) {
-                        cached_actor_table_.push_back(p.actor);
-                    }
-                }
+                add(op.id.actor);
+                if (!op.obj.is_root()) add(std::get<OpId>(op.obj.inner).actor);
+                if (op.insert_after) add(op.insert_after->actor);
+                for (const auto& p : op.pred) add(p.actor);
             }
         }
-        cached_actor_table_size_ = change_history.size();
+        ix.actors_scanned.store(change_history.size(), std::memory_order_release);
     }
 
     auto actor_table() const -> const std::vector<ActorId>& {
         ensure_actor_table();
-        return cached_actor_table_;
+        return indexes_.actor_table;
+    }
+
+    // Actor → its index in actor_table(), kept alongside it, so encoding a
+    // save looks actors up in O(1) whatever the table size.
+    auto actor_index() const -> const std::unordered_map<ActorId, std::uint64_t>& {
+        ensure_actor_table();
+        return indexes_.actor_index;
     }
 
     // -- Sync helpers (Phase 5) -------------------------------------------------
 
-    // Ensure the cached hash index is up to date. Only computes hashes for
-    // newly appended changes (changes are append-only).
+    // Ensure the cached hash index is up to date. Only indexes newly
+    // appended changes (changes are append-only).
     void ensure_hash_index() const {
-        if (cached_hashes_.size() == change_history.size()) return;
-        for (auto i = cached_hashes_.size(); i < change_history.size(); ++i) {
-            auto hash = compute_change_hash(change_history[i]);
-            cached_hash_index_[hash] = i;
-            cached_hashes_.push_back(hash);
+        if (indexes_.hashed.load(std::memory_order_acquire) == change_history.size()) return;
+        auto lock = std::scoped_lock{indexes_.mutex};
+        extend_hash_index();
+    }
+
+    // Index the changes appended since the last call. Caller holds
+    // indexes_.mutex.
+    void extend_hash_index() const {
+        auto& ix = indexes_;
+        for (auto i = ix.hashed.load(std::memory_order_relaxed); i < change_history.size(); ++i) {
+            ix.hash_index[change_history.hash(i)] = i;
         }
+        ix.hashed.store(change_history.size(), std::memory_order_release);
     }
 
     // Get the cached hash index (read-only reference).
     auto hash_index() const -> const std::unordered_map<ChangeHash, std::size_t>& {
         ensure_hash_index();
-        return cached_hash_index_;
+        return indexes_.hash_index;
     }
 
     // Check if we have a change with the given hash. O(1) via cached index.
     auto has_change_hash(const ChangeHash& hash) const -> bool {
         ensure_hash_index();
-        return cached_hash_index_.contains(hash);
+        return indexes_.hash_index.contains(hash);
     }
 
-    // Get all change hashes in change_history order (cached, no recomputation).
+    // Get all change hashes in change_history order (stored, no recomputation).
     auto all_change_hashes() const -> std::vector<ChangeHash> {
-        ensure_hash_index();
-        return cached_hashes_;
+        auto result = std::vector<ChangeHash>{};
+        result.reserve(change_history.size());
+        for (std::size_t i = 0; i < change_history.size(); ++i) {
+            result.push_back(change_history.hash(i));
+        }
+        return result;
     }
 
-    // Get change hashes that are NOT ancestors of the given set of hashes.
-    // This returns all hashes that are "new" relative to the given set.
-    auto get_changes_since(const std::vector<ChangeHash>& since_heads) const
-        -> std::vector<ChangeHash> {
-        if (since_heads.empty()) return all_change_hashes();
+    // Ensure the cached DAG covers every change. Only indexes newly
+    // appended changes.
+    void ensure_dag_index() const {
+        if (indexes_.in_dag.load(std::memory_order_acquire) == change_history.size()) return;
+        auto lock = std::scoped_lock{indexes_.mutex};
+        extend_hash_index();
+        auto& dag = indexes_.dag;
+        const auto& hash_index = indexes_.hash_index;
+        for (auto i = dag.size(); i < change_history.size(); ++i) {
+            if (!dag.unresolved.empty() && dag.unresolved.erase(change_history.hash(i)) > 0) {
+                dag.ordered = false;  // something before it depends on it
+            }
+            auto generation = std::size_t{1};
+            for (const auto& dep : change_history[i].deps) {
+                auto it = hash_index.find(dep);
+                if (it == hash_index.end() || it->second >= i) {
+                    dag.unresolved.insert(dep);
+                    continue;
+                }
+                dag.deps.push_back(it->second);
+                generation = std::max(generation, dag.generation[it->second] + 1);
+            }
+            dag.dep_start.push_back(dag.deps.size());
+            dag.generation.push_back(generation);
+        }
+        indexes_.in_dag.store(change_history.size(), std::memory_order_release);
+    }
 
-        ensure_hash_index();
-        const auto& idx = cached_hash_index_;
+    // Get the cached change DAG (read-only reference).
+    auto change_dag() const -> const ChangeDag& {
+        ensure_dag_index();
+        return indexes_.dag;
+    }
 
-        // BFS: find all ancestors of since_heads
-        auto ancestors = std::unordered_set<ChangeHash>{};
-        auto queue = std::vector<ChangeHash>{};
-        for (const auto& h : since_heads) {
-            if (idx.contains(h)) {
-                ancestors.insert(h);
-                queue.push_back(h);
+    // Mark, by change_history index, every change that is one of heads or an
+    // ancestor of one. Hashes we do not have are ignored.
+    auto ancestor_mask(const std::vector<ChangeHash>& heads) const -> std::vector<bool> {
+        ensure_dag_index();
+        if (!indexes_.dag.ordered) return ancestor_mask_by_hash(heads);
+        auto mask = std::vector<bool>(change_history.size());
+        auto queue = std::vector<std::size_t>{};
+        auto visit = [&](std::size_t i) {
+            if (!mask[i]) {
+                mask[i] = true;
+                queue.push_back(i);
             }
+        };
+        for (const auto& h : heads) {
+            auto it = indexes_.hash_index.find(h);
+            if (it != indexes_.hash_index.end()) visit(it->second);
+        }
+        while (!queue.empty()) {
+            auto i = queue.back();
+            queue.pop_back();
+            for (auto dep : indexes_.dag.deps_of(i)) visit(dep);
         }
+        return mask;
+    }
 
+    // As ancestor_mask, following deps through the hash index: also right
+    // when a dep was recorded after its dependent.
+    auto ancestor_mask_by_hash(const std::vector<ChangeHash>& heads) const -> std::vector<bool> {
+        ensure_hash_index();
+        auto mask = std::vector<bool>(change_history.size());
+        auto queue = std::vector<std::size_t>{};
+        auto visit = [&](const ChangeHash& h) {
+            auto it = indexes_.hash_index.find(h);
+            if (it != indexes_.hash_index.end() && !mask[it->second]) {
+                mask[it->second] = true;
+                queue.push_back(it->second);
+            }
+        };
+        for (const auto& h : heads) visit(h);
         while (!queue.empty()) {
-            auto h = queue.back();
+            auto i = queue.back();
             queue.pop_back();
-            auto it = idx.find(h);
-            if (it == idx.end()) continue;
-            for (const auto& dep : change_history[it->second].deps) {
-                if (ancestors.insert(dep).second) {
-                    queue.push_back(dep);
-                }
+            for (const auto& dep : change_history[i].deps) visit(dep);
+        }
+        return mask;
+    }
+
+    // For each of candidates (change_history indices), whether it is one of
+    // heads or an ancestor of one. The walk back from heads stops below the
+    // lowest generation among the candidates, so its cost is the changes
+    // newer than the oldest candidate rather than the whole history.
+    auto ancestors_among(const std::vector<ChangeHash>& heads,
+                         std::span<const std::size_t> candidates) const -> std::vector<bool> {
+        ensure_dag_index();
+        auto result = std::vector<bool>(candidates.size());
+        if (candidates.empty()) return result;
+        const auto& dag = indexes_.dag;
+        if (!dag.ordered) {
+            auto mask = ancestor_mask_by_hash(heads);
+            for (std::size_t k = 0; k < candidates.size(); ++k) result[k] = mask[candidates[k]];
+            return result;
+        }
+        auto floor = dag.generation[candidates[0]];
+        for (auto i : candidates) floor = std::min(floor, dag.generation[i]);
+        auto reached = std::unordered_set<std::size_t>{};
+        auto stack = std::vector<std::size_t>{};
+        auto visit = [&](std::size_t i) {
+            if (dag.generation[i] >= floor && reached.insert(i).second) stack.push_back(i);
+        };
+        for (const auto& h : heads) {
+            auto it = indexes_.hash_index.find(h);
+            if (it != indexes_.hash_index.end()) visit(it->second);
+        }
+        while (!stack.empty()) {
+            auto i = stack.back();
+            stack.pop_back();
+            for (auto dep : dag.deps_of(i)) visit(dep);
+        }
+        for (std::size_t k = 0; k < candidates.size(); ++k) {
+            result[k] = reached.contains(candidates[k]);
+        }
+        return result;
+    }
+
+    // Indices of the changes that are NOT ancestors of since_heads, in
+    // change_history order.
+    //
+    // A change's deps come before it in change_history, so this walks back
+    // from both since_heads and our heads in descending index order: by the
+    // time a change is reached its status is final (known if any change
+    // reached from since_heads depends on it), and the walk stops once
+    // nothing new is queued. The cost is the new changes plus the known ones
+    // down to the oldest new one, not the whole history. A history that is
+    // not in dependency order (or with no heads to start from) falls back to
+    // the full ancestor walk.
+    auto change_indices_since(const std::vector<ChangeHash>& since_heads) const
+        -> std::vector<std::size_t> {
+        auto result = std::vector<std::size_t>{};
+        if (since_heads.empty()) {
+            result.resize(change_history.size());
+            std::iota(result.begin(), result.end(), std::size_t{0});
+            return result;
+        }
+        ensure_dag_index();
+        if (heads.empty() || !indexes_.dag.ordered) {
+            return change_indices_outside(ancestor_mask(since_heads));
+        }
+        auto known = std::unordered_map<std::size_t, bool>{};  // reached change → known
+        auto queue = std::priority_queue<std::size_t>{};
+        auto queued_new = std::size_t{0};
+        auto reach = [&](std::size_t i, bool is_known) {
+            auto [slot, inserted] = known.try_emplace(i, is_known);
+            if (inserted) {
+                queue.push(i);
+                if (!is_known) ++queued_new;
+            } else if (is_known && !slot->second) {
+                slot->second = true;
+                --queued_new;
             }
+        };
+        auto reach_hash = [&](const ChangeHash& h, bool is_known) {
+            auto it = indexes_.hash_index.find(h);
+            if (it != indexes_.hash_index.end()) reach(it->second, is_known);
+        };
+        for (const auto& h : since_heads) reach_hash(h, true);
+        for (const auto& h : heads) reach_hash(h, false);
+        while (queued_new > 0) {
+            auto i = queue.top();
+            queue.pop();
+            const auto is_known = known[i];
+            if (!is_known) {
+                --queued_new;
+                result.push_back(i);
+            }
+            for (auto dep : indexes_.dag.deps_of(i)) reach(dep, is_known);
+        }
+        std::ranges::reverse(result);
+        return result;
+    }
+
+    // Indices of the changes not marked in mask, in change_history order.
+    static auto change_indices_outside(const std::vector<bool>& mask) -> std::vector<std::size_t> {
+        auto result = std::vector<std::size_t>{};
+        for (std::size_t i = 0; i < mask.size(); ++i) {
+            if (!mask[i]) result.push_back(i);
         }
+        return result;
+    }
 
-        // Return hashes not in ancestors, in change_history order
+    // Get change hashes that are NOT ancestors of the given set of hashes.
+    // This returns all hashes that are "new" relative to the given set.
+    auto get_changes_since(const std::vector<ChangeHash>& since_heads) const
+        -> std::vector<ChangeHash> {
+        if (since_heads.empty()) return all_change_hashes();
         auto result = std::vector<ChangeHash>{};
-        for (const auto& hash : cached_hashes_) {
-            if (!ancestors.contains(hash)) {
-                result.push_back(hash);
-            }
+        for (auto i : change_indices_since(since_heads)) {
+            result.push_back(change_history.hash(i));
         }
         return result;
     }
 
-    // Get changes we're missing that would be needed to know the given heads.
+    // Sort incoming changes causally against the history and the pending
+    // queue: returns the changes that can be applied now with their hashes,
+    // each after its deps, and queues the rest until their last missing dep
+    // arrives (in this call or a later one). Changes we already have, applied
+    // or queued, are dropped. O(1) per change and dep.
+    auto take_ready_changes(std::span<const Change> changes, std::span<const ChangeHash> hashes)
+        -> std::vector<std::pair<Change, ChangeHash>> {
+        ensure_hash_index();
+        auto ready = std::vector<std::pair<Change, ChangeHash>>{};
+        auto accepted = std::unordered_set<ChangeHash>{};  // ready in this call
+        auto present = [&](const ChangeHash& h) {
+            return indexes_.hash_index.contains(h) || accepted.contains(h);
+        };
+        auto& pending = pending_changes_;
+        for (std::size_t i = 0; i < changes.size(); ++i) {
+            const auto& hash = hashes[i];
+            if (present(hash) || pending.changes.contains(hash)) continue;
+            auto missing = std::size_t{0};
+            for (const auto& dep : changes[i].deps) {
+                if (present(dep)) continue;
+                pending.waiting[dep].push_back(hash);
+                ++missing;
+            }
+            if (missing > 0) {
+                pending.changes.emplace(hash, PendingChanges::Entry{changes[i], missing});
+                continue;
+            }
+            ready.emplace_back(changes[i], hash);
+            accepted.insert(hash);
+            release_waiters(hash, ready, accepted);
+        }
+        return ready;
+    }
+
+    // For changes just added to the history other than through
+    // take_ready_changes (merge, load_incremental): drops their queued
+    // copies, and returns the queued changes whose last missing dep was
+    // among them, ready to apply in order.
+    auto release_pending(std::span<const ChangeHash> arrived)
+        -> std::vector<std::pair<Change, ChangeHash>> {
+        auto ready = std::vector<std::pair<Change, ChangeHash>>{};
+        auto& pending = pending_changes_;
+        if (pending.changes.empty()) return ready;
+        ensure_hash_index();
+        for (const auto& hash : arrived) pending.changes.erase(hash);
+        auto accepted = std::unordered_set<ChangeHash>{};
+        for (const auto& hash : arrived) release_waiters(hash, ready, accepted);
+        return ready;
+    }
+
+    // Get changes we're missing that would be needed to know the given
+    // heads, and those the pending queue is waiting on. Sorted.
     auto get_missing_deps(const std::vector<ChangeHash>& their_heads) const
         -> std::vector<ChangeHash> {
         ensure_hash_index();
-        auto result = std::vector<ChangeHash>{};
+        auto missing = std::unordered_set<ChangeHash>{};
         for (const auto& h : their_heads) {
-            if (!cached_hash_index_.contains(h) &&
-                std::ranges::find(result, h) == result.end()) {
-                result.push_back(h);
-            }
+            if (!indexes_.hash_index.contains(h)) missing.insert(h);
+        }
+        // A waited-on hash is absent from the history; skip those whose
+        // waiters all arrived another way
+        const auto& pending = pending_changes_;
+        auto queued = [&](const ChangeHash& h) { return pending.changes.contains(h); };
+        for (const auto& [dep, waiters] : pending.waiting) {
+            if (std::ranges::any_of(waiters, queued)) missing.insert(dep);
         }
+        std::erase_if(missing, queued);
+        auto result = std::vector<ChangeHash>(missing.begin(), missing.end());
+        std::ranges::sort(result);
         return result;
     }
 
+    // Release the queued changes waiting on arrived, now present, into
+    // ready, and then those waiting on them. A queued change already in
+    // the history is dropped rather than applied twice.
+    void release_waiters(const ChangeHash& arrived,
+                         std::vector<std::pair<Change, ChangeHash>>& ready,
+                         std::unordered_set<ChangeHash>& accepted) {
+        auto& pending = pending_changes_;
+        auto stack = std::vector<ChangeHash>{arrived};
+        while (!stack.empty()) {
+            auto it = pending.waiting.find(stack.back());
+            stack.pop_back();
+            if (it == pending.waiting.end()) continue;
+            auto waiters = std::move(it->second);
+            pending.waiting.erase(it);
+            for (const auto& hash : waiters) {
+                auto entry = pending.changes.find(hash);
+                if (entry == pending.changes.end()) continue;  // arrived another way
+                if (--entry->second.missing > 0) continue;
+                if (!indexes_.hash_index.contains(hash) && accepted.insert(hash).second) {
+                    ready.emplace_back(std::move(entry->second.change), hash);
+                }
+                pending.changes.erase(entry);
+                stack.push_back(hash);
+            }
+        }
+    }
+
     // Get changes by their hashes, in the order given.
     auto get_changes_by_hash(const std::vector<ChangeHash>& hashes) const
         -> std::vector<Change> {
@@ -735,8 +1597,8 @@ struct DocState {
         auto result = std::vector<Change>{};
         result.reserve(hashes.size());
         for (const auto& h : hashes) {
-            auto it = cached_hash_index_.find(h);
-            if (it != cached_hash_index_.end()) {
+            auto it = indexes_.hash_index.find(h);
+            if (it != indexes_.hash_index.end()) {
                 result.push_back(change_history[it->second]);
             }
         }
@@ -748,52 +1610,189 @@ struct DocState {
     // Find indices (into change_history) of all changes visible at given heads.
     auto changes_visible_at(const std::vector<ChangeHash>& target_heads) const
         -> std::vector<std::size_t> {
-        ensure_hash_index();
-        const auto& idx = cached_hash_index_;
-        auto visited = std::set<ChangeHash>{};
-        auto queue = std::vector<ChangeHash>{};
-
-        for (const auto& h : target_heads) {
-            if (idx.contains(h) && visited.insert(h).second) {
-                queue.push_back(h);
-            }
+        auto visible = ancestor_mask(target_heads);
+        auto indices = std::vector<std::size_t>{};
+        for (std::size_t i = 0; i < visible.size(); ++i) {
+            if (visible[i]) indices.push_back(i);
         }
+        return indices;
+    }
 
-        while (!queue.empty()) {
-            auto h = queue.back();
-            queue.pop_back();
-            auto it = idx.find(h);
-            if (it == idx.end()) continue;
-            for (const auto& dep : change_history[it->second].deps) {
-                if (visited.insert(dep).second) {
-                    queue.push_back(dep);
+    // Materialise the object state visible at given heads. Snapshots are
+    // cached; an exact hit is returned as is, otherwise replay starts from
+    // the largest checkpoint or cached snapshot (or the live state) that the
+    // visible set contains and applies only the missing changes, in history
+    // order.
+    auto state_at(const std::vector<ChangeHash>& target_heads) const
+        -> std::shared_ptr<const DocState> {
+        return state_at(changes_visible_at(target_heads));
+    }
+
+    auto state_at(const std::vector<std::size_t>& indices) const
+        -> std::shared_ptr<const DocState> {
+        auto& cache = history_cache_;
+        auto base = std::shared_ptr<const DocState>{};
+        auto prefix = std::size_t{0};                     // indices[0, prefix) == 0..prefix-1
+        auto base_indices = std::vector<std::size_t>{};  // copied: may be evicted
+        auto interval = std::size_t{0};
+        {
+            auto lock = std::scoped_lock{cache.mutex};
+            interval = cache.checkpoint_interval;
+            auto& snapshots = cache.snapshots;
+            for (auto it = snapshots.begin(); it != snapshots.end(); ++it) {
+                if (it->indices == indices) {
+                    std::rotate(snapshots.begin(), it, std::next(it));
+                    return snapshots.front().state;
+                }
+            }
+            // A checkpoint at k is usable when the visible set starts 0..k-1
+            for (auto it = cache.checkpoints.rbegin(); it != cache.checkpoints.rend(); ++it) {
+                auto k = it->history_size;
+                if (k <= indices.size() && indices[k - 1] == k - 1) {
+                    base = it->state;
+                    prefix = k;
+                    break;
+                }
+            }
+            for (const auto& snap : snapshots) {
+                if (snap.indices.size() > std::max(prefix, base_indices.size()) &&
+                    snap.indices.size() < indices.size() &&
+                    std::ranges::includes(indices, snap.indices)) {
+                    base = snap.state;
+                    base_indices = snap.indices;
+                    prefix = 0;
                 }
             }
         }
 
-        auto indices = std::vector<std::size_t>{};
-        for (const auto& h : visited) {
-            auto it = idx.find(h);
-            if (it != idx.end()) {
-                indices.push_back(it->second);
+        auto snapshot = std::make_shared<DocState>();
+        snapshot->actor = actor;
+        snapshot->strings = strings;
+        if (indices.size() == change_history.size()) {
+            // Everything is visible: share the live objects (copy-on-write)
+            snapshot->objects = objects;
+            snapshot->next_counter = next_counter;
+        } else {
+            if (base) {
+                snapshot->objects = base->objects;
+                snapshot->next_counter = base->next_counter;
+            }
+            auto rest = std::span<const std::size_t>{indices}.subspan(prefix);
+            auto delta = std::vector<std::size_t>{};
+            std::ranges::set_difference(rest, base_indices, std::back_inserter(delta));
+
+            // While the replay covers a history prefix, leave checkpoints behind
+            auto covered = base_indices.empty() ? prefix : std::size_t{0};
+            for (auto idx : delta) {
+                for (const auto& op : change_history[idx].operations) {
+                    snapshot->apply_op(op);
+                }
+                if (idx != covered) continue;
+                ++covered;
+                if (covered % interval == 0) {
+                    auto checkpoint = std::make_shared<DocState>();
+                    checkpoint->actor = actor;
+                    checkpoint->strings = strings;
+                    checkpoint->objects = snapshot->objects;  // shared copy-on-write
+                    checkpoint->next_counter = snapshot->next_counter;
+                    auto lock = std::scoped_lock{cache.mutex};
+                    cache.record_checkpoint(covered, std::move(checkpoint));
+                }
             }
         }
-        std::ranges::sort(indices);
-        return indices;
-    }
 
-    // Rebuild a fresh DocState by replaying only the changes visible at given heads.
-    auto rebuild_state_at(const std::vector<ChangeHash>& target_heads) const -> DocState {
-        auto indices = changes_visible_at(target_heads);
-        auto snapshot = DocState{};
-        snapshot.actor = actor;
+        auto lock = std::scoped_lock{cache.mutex};
+        auto& snapshots = cache.snapshots;
+        snapshots.insert(snapshots.begin(), HistoryCache::Snapshot{
+            .indices = indices,
+            .state = snapshot,
+        });
+        if (snapshots.size() > HistoryCache::capacity) snapshots.pop_back();
+        return snapshot;
+    }
 
-        for (auto idx : indices) {
+    // -- Tombstone compaction (11A.10) ------------------------------------------
+
+    // Drop deleted list/text elements that no future op can reference, and
+    // return the approximate number of bytes reclaimed.
+    //
+    // stable_heads must be known to every peer, with no change concurrent to
+    // them still in flight. An element is dropped when its deletion is in the
+    // stable set, no unstable element was inserted after it and no mark is
+    // anchored on it. Elements whose origin was dropped take the dropped
+    // element's origin instead, which leaves the RGA position of any later
+    // insert unchanged. The change history is untouched.
+    auto compact_tombstones(const std::vector<ChangeHash>& stable_heads) -> std::size_t {
+        auto stable_deletes = std::unordered_set<OpId>{};
+        auto stable_counter = std::unordered_map<ActorId, std::uint64_t>{};  // last stable op per actor
+        for (auto idx : changes_visible_at(stable_heads)) {
             for (const auto& op : change_history[idx].operations) {
-                snapshot.apply_op(op);
+                auto& last = stable_counter[op.id.actor];
+                last = std::max(last, op.id.counter + op.width() - 1);
+                if (op.action == OpType::del) {
+                    stable_deletes.insert(op.pred.begin(), op.pred.end());
+                }
             }
         }
-        return snapshot;
+        if (stable_deletes.empty()) return 0;
+
+        // The visible set is causally closed, so per actor it is a counter prefix
+        auto is_stable = [&](const OpId& id) {
+            auto it = stable_counter.find(id.actor);
+            return it != stable_counter.end() && id.counter <= it->second;
+        };
+
+        auto reclaimed = std::size_t{0};
+        auto replaced = std::vector<std::pair<ObjId, std::shared_ptr<ObjectState>>>{};
+        objects.for_each([&](const ObjId& obj_id, const std::shared_ptr<ObjectState>& shared) {
+            const auto& tree = shared->list_elements;
+            if (tree.visible_size() == tree.size()) return;
+
+            auto pinned = std::unordered_set<OpId>{};
+            for (const auto& mark : shared->marks) {
+                pinned.insert(mark.start_elem);
+                pinned.insert(mark.end_elem);
+            }
+            for (auto it = tree.begin(); it != tree.end(); ++it) {
+                if (auto origin = it.insert_after(); origin && !is_stable(it.insert_id())) {
+                    pinned.insert(*origin);
+                }
+            }
+
+            auto origin_of = std::unordered_map<OpId, std::optional<OpId>>{};  // dropped → origin
+            auto kept = std::vector<ListElement>{};
+            kept.reserve(tree.visible_size());
+            for (auto it = tree.begin(); it != tree.end(); ++it) {
+                auto origin = it.insert_after();
+                if (origin) {
+                    if (auto found = origin_of.find(*origin); found != origin_of.end()) {
+                        origin = found->second;  // already resolved: origins precede elements
+                    }
+                }
+                auto id = it.insert_id();
+                if (!it.visible() && stable_deletes.contains(id) && !pinned.contains(id)) {
+                    origin_of.emplace(id, origin);
+                    continue;
+                }
+                auto elem = *it;
+                elem.insert_after = origin;
+                kept.push_back(std::move(elem));
+            }
+            if (origin_of.empty()) return;
+
+            auto before = tree.memory_usage();
+            auto compacted = SequenceTree::from_elements(std::move(kept), resource);
+            auto after = compacted.memory_usage();
+            if (shared->edit != objects.edit.value()) {
+                // Shared with a copy or snapshot: replace rather than clone
+                replaced.emplace_back(obj_id, clone_object(*shared, std::move(compacted)));
+            } else {
+                shared->list_elements = std::move(compacted);
+            }
+            if (before > after) reclaimed += before - after;
+        });
+        for (auto& [obj_id, clone] : replaced) objects.assign(obj_id, std::move(clone));
+        return reclaimed;
     }
 
     // -- Cursor helpers (Phase 6) -----------------------------------------------
@@ -803,10 +1802,7 @@ struct DocState {
         -> std::optional<OpId> {
         const auto* state = get_object(obj);
         if (!state) return std::nullopt;
-        auto real_idx = visible_index_to_real(*state, index);
-        if (real_idx >= state->list_elements.size()) return std::nullopt;
-        if (!state->list_elements[real_idx].visible) return std::nullopt;
-        return state->list_elements[real_idx].insert_id;
+        return visible_element_id(*state, index);
     }
 
     // Find the visible index of an element by its insert_id.
@@ -814,58 +1810,174 @@ struct DocState {
         -> std::optional<std::size_t> {
         const auto* state = get_object(obj);
         if (!state) return std::nullopt;
-        auto visible_count = std::size_t{0};
-        for (const auto& elem : state->list_elements) {
-            if (elem.insert_id == id) {
-                return elem.visible ? std::optional{visible_count} : std::nullopt;
-            }
-            if (elem.visible) ++visible_count;
-        }
-        return std::nullopt;
+        return element_visible_index(*state, id);
+    }
+
+    // insert_id of the visible element at index, or nullopt if out of
+    // bounds. O(log n).
+    static auto visible_element_id(const ObjectState& state, std::size_t index)
+        -> std::optional<OpId> {
+        const auto& elements = state.list_elements;
+        auto pos = elements.find_visible(index);
+        if (pos >= elements.size()) return std::nullopt;
+        return elements.iterator_at(pos).insert_id();
+    }
+
+    // Visible index of the element with insert_id id, or nullopt if it is
+    // unknown or deleted. O(log n): the run index locates the element and
+    // the tree's visible counts give its rank.
+    static auto element_visible_index(const ObjectState& state, const OpId& id)
+        -> std::optional<std::size_t> {
+        const auto& elements = state.list_elements;
+        auto it = elements.find_iterator(id);
+        if (it == elements.end() || !it.visible()) return std::nullopt;
+        return elements.visible_rank(elements.position_of(it));
     }
 
     // -- Change hash computation (SHA-256 based) --------------------------------
 
+    // Append the deterministic byte representation of a change that its hash
+    // covers: 16 (actor) + 8 (seq) + 8 (start_op) + 8 (ts) + 8 (num_ops) + deps*32.
+    // num_ops counts ops as stored, a batched splice one per byte, so a
+    // change hashes the same batched or not.
+    static void append_change_hash_input(const Change& change, std::vector<std::byte>& out) {
+        auto put_le64 = [&](std::uint64_t v) {
+            for (int i = 0; i < 8; ++i) {
+                out.push_back(static_cast<std::byte>(v >> (i * 8)));
+            }
+        };
+        out.insert(out.end(), change.actor.bytes.begin(), change.actor.bytes.end());
+        put_le64(change.seq);
+        put_le64(change.start_op);
+        put_le64(static_cast<std::uint64_t>(change.timestamp));
+        auto num_ops = std::uint64_t{0};
+        for (const auto& op : change.operations) num_ops += op.width();
+        put_le64(num_ops);
+        for (const auto& dep : change.deps) {
+            out.insert(out.end(), dep.bytes.begin(), dep.bytes.end());
+        }
+    }
+
     static auto compute_change_hash(const Change& change) -> ChangeHash {
-        // Build a deterministic byte representation of the change
-        // Size: 16 (actor) + 8 (seq) + 8 (start_op) + 8 (ts) + 8 (num_ops) + deps*32
+        AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::hash_changes);
         auto input = std::vector<std::byte>{};
         input.reserve(48 + change.deps.size() * 32);
+        append_change_hash_input(change, input);
 
-        // Actor ID
-        input.insert(input.end(), change.actor.bytes.begin(), change.actor.bytes.end());
+        auto digest = crypto::sha256(input);
+        ChangeHash result{};
+        std::memcpy(result.bytes.data(), digest.data(), 32);
+        return result;
+    }
 
-        // Seq (little-endian 8 bytes)
-        for (int i = 0; i < 8; ++i) {
-            input.push_back(static_cast<std::byte>(change.seq >> (i * 8)));
+    // Hash a batch of changes whose deps are already known: one shared input
+    // buffer and one SHA-256 call for the whole batch. get(i) returns the
+    // i-th change.
+    template <typename Get>
+    static auto compute_change_hashes(std::size_t count, Get&& get) -> std::vector<ChangeHash> {
+        AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::hash_changes);
+        auto buffer = std::vector<std::byte>{};
+        auto offsets = std::vector<std::size_t>{};
+        offsets.reserve(count + 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            offsets.push_back(buffer.size());
+            append_change_hash_input(get(i), buffer);
         }
+        offsets.push_back(buffer.size());
 
-        // Start op
-        for (int i = 0; i < 8; ++i) {
-            input.push_back(static_cast<std::byte>(change.start_op >> (i * 8)));
+        auto inputs = std::vector<std::span<const std::byte>>{};
+        inputs.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            inputs.emplace_back(buffer.data() + offsets[i], offsets[i + 1] - offsets[i]);
         }
+        auto digests = std::vector<std::array<std::byte, 32>>(count);
+        crypto::sha256_many(inputs, digests);
 
-        // Timestamp
-        auto ts = static_cast<std::uint64_t>(change.timestamp);
-        for (int i = 0; i < 8; ++i) {
-            input.push_back(static_cast<std::byte>(ts >> (i * 8)));
+        auto result = std::vector<ChangeHash>(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            std::memcpy(result[i].bytes.data(), digests[i].data(), 32);
         }
+        return result;
+    }
 
-        // Number of operations
-        auto num_ops = static_cast<std::uint64_t>(change.operations.size());
-        for (int i = 0; i < 8; ++i) {
-            input.push_back(static_cast<std::byte>(num_ops >> (i * 8)));
-        }
+    static auto compute_change_hashes(std::span<const Change> changes) -> std::vector<ChangeHash> {
+        return compute_change_hashes(changes.size(),
+                                     [&](std::size_t i) -> const Change& { return changes[i]; });
+    }
 
-        // Dependency hashes
-        for (const auto& dep : change.deps) {
-            input.insert(input.end(), dep.bytes.begin(), dep.bytes.end());
+    // -- Batched op application ---------------------------------------------
+
+    // Below this many ops, partitioning costs more than it saves.
+    static constexpr std::size_t parallel_apply_min_ops = 4096;
+
+    // Whether workers may allocate from resource at once: the heap, or a
+    // synchronized pool. Any other resource (say a monotonic arena) may not
+    // be thread-safe.
+    auto resource_is_thread_safe() const -> bool {
+        return resource == std::pmr::new_delete_resource()
+            || dynamic_cast<std::pmr::synchronized_pool_resource*>(resource) != nullptr;
+    }
+
+    // Apply the ops of count changes in order; get(i) returns the i-th
+    // change. With a pool, enough ops and a thread-safe resource, a serial
+    // pass registers every op (counter, object creation) and partitions the
+    // ops by target object; the partitions, each in its original order, are
+    // then applied in parallel. Collecting patches forces the serial path,
+    // so they come out in op order, each with the path its object had at
+    // the time.
+    template <typename Get>
+    void apply_change_ops(std::size_t count, Get&& get, thread_pool* pool = nullptr,
+                          std::vector<Patch>* patches = nullptr) {
+        auto total = std::size_t{0};
+        for (std::size_t i = 0; i < count; ++i) total += get(i).operations.size();
+        if (patches) {
+            // An op only changes its own object, never the path to it, so a
+            // run of ops on one object shares one path lookup.
+            auto path_obj = std::optional<ObjId>{};
+            auto path = Path{};
+            for (std::size_t i = 0; i < count; ++i) {
+                for (const auto& op : get(i).operations) {
+                    auto before = patches->size();
+                    apply_op(op, patches);
+                    if (patches->size() == before) continue;
+                    if (path_obj != op.obj) {
+                        path = path_of(op.obj).value_or(Path{});
+                        path_obj = op.obj;
+                    }
+                    for (auto k = before; k < patches->size(); ++k) (*patches)[k].path = path;
+                }
+            }
+            return;
+        }
+        if (!pool || total < parallel_apply_min_ops || !resource_is_thread_safe()) {
+            for (std::size_t i = 0; i < count; ++i) {
+                for (const auto& op : get(i).operations) apply_op(op);
+            }
+            return;
         }
 
-        auto digest = crypto::sha256(input);
-        ChangeHash result{};
-        std::memcpy(result.bytes.data(), digest.data(), 32);
-        return result;
+        struct Partition {
+            ObjectState* target;
+            std::vector<const Op*> ops;
+        };
+        auto partitions = std::vector<Partition>{};
+        auto partition_of = std::unordered_map<ObjectState*, std::size_t>{};
+        for (std::size_t i = 0; i < count; ++i) {
+            for (const auto& op : get(i).operations) {
+                register_op(op);
+                auto* target = get_object(op.obj);  // detached here, not in the workers
+                if (!target) continue;
+                auto [it, inserted] = partition_of.try_emplace(target, partitions.size());
+                if (inserted) partitions.push_back(Partition{.target = target, .ops = {}});
+                partitions[it->second].ops.push_back(&op);
+            }
+        }
+        pool->parallelize_loop(std::size_t{0}, partitions.size(),
+            [&](std::size_t start, std::size_t end) {
+                for (auto p = start; p < end; ++p) {
+                    for (const auto* op : partitions[p].ops) apply_op_to(*partitions[p].target, *op);
+                }
+            });
     }
 };
 
@@ -10,24 +10,20 @@
 #include "storage/deserializer.hpp"
 #include "storage/chunk.hpp"
 #include "storage/change_chunk.hpp"
+#include "storage/document_chunk.hpp"
 #include "sync/bloom_filter.hpp"
 
 #include <algorithm>
 #include <atomic>
 #include <cstring>
+#include <iterator>
+#include <limits>
 #include <ranges>
-#include <set>
 #include <shared_mutex>
 #include <unordered_set>
 
 namespace automerge_cpp {
 
-static auto make_default_pool() -> std::shared_ptr<thread_pool> {
-    auto n = std::thread::hardware_concurrency();
-    if (n <= 1) return nullptr;
-    return std::make_shared<thread_pool>(n);
-}
-
 static auto make_pool(unsigned int num_threads) -> std::shared_ptr<thread_pool> {
     if (num_threads == 1) return nullptr;
     auto n = (num_threads == 0) ? std::thread::hardware_concurrency() : num_threads;
@@ -47,30 +43,51 @@ Document::Document(std::shared_ptr<thread_pool> pool)
     : state_{std::make_unique<detail::DocState>()},
       pool_{std::move(pool)} {}
 
+Document::Document(std::pmr::memory_resource& resource, std::shared_ptr<thread_pool> pool)
+    : state_{std::make_unique<detail::DocState>(&resource)},
+      pool_{std::move(pool)} {}
+
 Document::~Document() = default;
 
 Document::Document(Document&& other) noexcept
     : state_{std::move(other.state_)},
-      pool_{std::move(other.pool_)} {}
-
+      pool_{std::move(other.pool_)},
+      read_locking_{other.read_locking_},
+      snapshot_reads_{other.snapshot_reads_},
+      snapshot_{other.snapshot_.exchange(nullptr)},
+      snapshot_version_{other.snapshot_version_.exchange(0)} {}
+
+// Assignment takes the source's read settings; the guard then publishes the
+// new state if snapshot reads are on, so no reader sees the old one.
 auto Document::operator=(Document&& other) noexcept -> Document& {
     if (this != &other) {
-        auto lock = std::unique_lock{mutex_};
+        auto lock = WriteGuard{*this};
         state_ = std::move(other.state_);
         pool_ = std::move(other.pool_);
+        read_locking_ = other.read_locking_;
+        snapshot_reads_ = other.snapshot_reads_;
+        unpublish_snapshot();
+        other.unpublish_snapshot();  // its state is gone
     }
     return *this;
 }
 
 Document::Document(const Document& other)
     : state_{std::make_unique<detail::DocState>(*other.state_)},
-      pool_{other.pool_} {}
+      pool_{other.pool_},
+      read_locking_{other.read_locking_},
+      snapshot_reads_{other.snapshot_reads_} {
+    publish_snapshot();
+}
 
 auto Document::operator=(const Document& other) -> Document& {
     if (this != &other) {
-        auto lock = std::unique_lock{mutex_};
+        auto lock = WriteGuard{*this};
         state_ = std::make_unique<detail::DocState>(*other.state_);
         pool_ = other.pool_;
+        read_locking_ = other.read_locking_;
+        snapshot_reads_ = other.snapshot_reads_;
+        unpublish_snapshot();
     }
     return *this;
 }
@@ -79,6 +96,10 @@ auto Document::get_thread_pool() const -> std::shared_ptr<thread_pool> {
     return pool_;
 }
 
+auto Document::memory_resource() const -> std::pmr::memory_resource* {
+    return state_->resource;
+}
+
 void Document::set_read_locking(bool enabled) {
     read_locking_ = enabled;
 }
@@ -88,166 +109,548 @@ auto Document::read_locking() const -> bool {
 }
 
 auto Document::read_guard() const -> ReadGuard {
-    return ReadGuard{mutex_, read_locking_};
+    auto guard = ReadGuard{mutex_, read_locking_};
+    materialize();
+    return guard;
+}
+
+void Document::set_snapshot_reads(bool enabled) {
+    auto lock = WriteGuard{*this};  // publishes the current state on release
+    snapshot_reads_ = enabled;
+    if (!enabled) unpublish_snapshot();
+}
+
+auto Document::snapshot_reads() const -> bool {
+    return snapshot_reads_;
+}
+
+// Snapshot versions are unique across all documents, so a version alone
+// identifies a published snapshot.
+static std::atomic<std::uint64_t> next_snapshot_version{1};
+
+void Document::publish_snapshot() const {
+    if (!snapshot_reads_) return;
+    // A lazily loaded document is published by the first read that decodes it
+    const auto ready = state_ && !state_->pending_load_.pending.load(std::memory_order_acquire);
+    snapshot_.store(ready ? state_->read_snapshot() : nullptr, std::memory_order_release);
+    snapshot_version_.store(ready ? next_snapshot_version.fetch_add(1, std::memory_order_relaxed) : 0,
+                            std::memory_order_release);
+}
+
+void Document::unpublish_snapshot() const {
+    snapshot_version_.store(0, std::memory_order_release);
+    snapshot_.store(nullptr, std::memory_order_release);
+}
+
+// The heap snapshot this thread read last, and its version. Keeping it alive
+// here lets repeat reads of an unchanged document skip the shared reference
+// count.
+struct ReaderCache {
+    std::uint64_t version = 0;
+    std::shared_ptr<const detail::DocState> snapshot;
+};
+static thread_local ReaderCache reader_cache;
+
+auto Document::current_snapshot(std::shared_ptr<const detail::DocState>& pin) const
+    -> const detail::DocState* {
+    const auto version = snapshot_version_.load(std::memory_order_acquire);
+    if (version == 0) return nullptr;
+    auto& cache = reader_cache;
+    if (cache.version == version) return cache.snapshot.get();
+    // The snapshot is stored before its version: this one is at least as new
+    auto snapshot = snapshot_.load(std::memory_order_acquire);
+    if (!snapshot) return nullptr;
+    if (snapshot->resource != std::pmr::new_delete_resource()) {
+        // Its nodes go back to the document's resource when freed, so this
+        // thread must not still hold it after the document is gone
+        pin = std::move(snapshot);
+        return pin.get();
+    }
+    cache.snapshot = std::move(snapshot);
+    cache.version = version;
+    return cache.snapshot.get();
+}
+
+auto Document::snapshot_guard() const -> SnapshotGuard {
+    if (snapshot_reads_) {
+        auto pin = std::shared_ptr<const detail::DocState>{};
+        if (const auto* state = current_snapshot(pin)) {
+            return SnapshotGuard{ReadGuard{mutex_, false}, state, std::move(pin)};
+        }
+    }
+    auto guard = SnapshotGuard{read_guard(), state_.get(), nullptr};
+    publish_snapshot();  // nothing published yet; the read lock excludes writers
+    return guard;
 }
 
 auto Document::actor_id() const -> const ActorId& {
-    auto guard = read_guard();
+    auto guard = ReadGuard{mutex_, read_locking_};  // known without decoding
     return state_->actor;
 }
 
 void Document::set_actor_id(ActorId id) {
-    auto lock = std::unique_lock{mutex_};
+    auto lock = WriteGuard{*this};
+    materialize();
     state_->actor = id;
 }
 
 void Document::transact(const std::function<void(Transaction&)>& fn) {
-    auto lock = std::unique_lock{mutex_};
+    auto lock = WriteGuard{*this};
+    materialize();
     auto tx = Transaction{*state_};
     fn(tx);
     tx.commit();
 }
 
 auto Document::get(const ObjId& obj, std::string_view key) const -> std::optional<Value> {
-    auto guard = read_guard();
-    return state_->map_get(obj, std::string{key});
+    auto guard = snapshot_guard();
+    return guard.state->map_get(obj, key);
 }
 
 auto Document::get_all(const ObjId& obj, std::string_view key) const -> std::vector<Value> {
-    auto guard = read_guard();
-    return state_->map_get_all(obj, std::string{key});
+    auto guard = snapshot_guard();
+    return guard.state->map_get_all(obj, key);
 }
 
 auto Document::get(const ObjId& obj, std::size_t index) const -> std::optional<Value> {
-    auto guard = read_guard();
-    return state_->list_get(obj, index);
+    auto guard = snapshot_guard();
+    return guard.state->list_get(obj, index);
 }
 
 auto Document::keys(const ObjId& obj) const -> std::vector<std::string> {
-    auto guard = read_guard();
-    return state_->map_keys(obj);
+    auto guard = snapshot_guard();
+    return guard.state->map_keys(obj);
 }
 
 auto Document::values(const ObjId& obj) const -> std::vector<Value> {
-    auto guard = read_guard();
-    const auto type = state_->object_type(obj);
+    auto guard = snapshot_guard();
+    const auto type = guard.state->object_type(obj);
     if (!type) return {};
 
     switch (*type) {
         case ObjType::map:
         case ObjType::table:
-            return state_->map_values(obj);
+            return guard.state->map_values(obj);
         case ObjType::list:
         case ObjType::text:
-            return state_->list_values(obj);
+            return guard.state->list_values(obj);
     }
     return {};
 }
 
 auto Document::length(const ObjId& obj) const -> std::size_t {
-    auto guard = read_guard();
-    return state_->object_length(obj);
+    auto guard = snapshot_guard();
+    return guard.state->object_length(obj);
 }
 
 auto Document::text(const ObjId& obj) const -> std::string {
-    auto guard = read_guard();
-    return state_->text_content(obj);
+    auto guard = snapshot_guard();
+    return guard.state->text_content(obj);
+}
+
+void Document::walk(const ObjId& obj, TreeVisitor& visitor) const {
+    // Pin the snapshot like read_view(): a read from inside the visitor
+    // replaces this thread's cached one, which may be the last reference.
+    auto view = read_view();
+    view.state_->walk(obj, visitor);
 }
 
 auto Document::object_type(const ObjId& obj) const -> std::optional<ObjType> {
-    auto guard = read_guard();
-    return state_->object_type(obj);
+    auto guard = snapshot_guard();
+    return guard.state->object_type(obj);
 }
 
 // -- Child object lookup ------------------------------------------------------
 
 auto Document::get_obj_id(const ObjId& obj, std::string_view key) const -> std::optional<ObjId> {
-    auto guard = read_guard();
-    return state_->get_obj_id_for_key(obj, std::string{key});
+    auto guard = snapshot_guard();
+    return guard.state->get_obj_id_for_key(obj, key);
 }
 
 auto Document::get_obj_id(const ObjId& obj, std::size_t index) const -> std::optional<ObjId> {
+    auto guard = snapshot_guard();
+    return guard.state->get_obj_id_for_index(obj, index);
+}
+
+// -- Borrowed views -----------------------------------------------------------
+
+auto Document::read_view() const -> ReadView {
+    if (snapshot_reads_) {
+        auto pin = std::shared_ptr<const detail::DocState>{};
+        if (!current_snapshot(pin)) snapshot_guard();  // publishes the current state
+        if (const auto* state = current_snapshot(pin)) {
+            return ReadView{pin ? std::move(pin) : reader_cache.snapshot, {}, state};
+        }
+    }
     auto guard = read_guard();
+    return ReadView{nullptr, std::move(guard.lock_), state_.get()};
+}
+
+auto ReadView::get(const ObjId& obj, std::string_view key) const -> std::optional<ValueRef> {
+    const auto* state = state_->get_object(obj);
+    if (!state) return std::nullopt;
+    const auto* values = state->map_entries.find(key);
+    if (!values) return std::nullopt;
+    return value_ref(values->winner().value);
+}
+
+auto ReadView::get(const ObjId& obj, std::size_t index) const -> std::optional<ValueRef> {
+    const auto* state = state_->get_object(obj);
+    if (!state || index >= state->list_elements.visible_size()) return std::nullopt;
+    const auto& elements = state->list_elements;
+    return elements.iterator_at(elements.find_visible(index)).value_ref();
+}
+
+auto ReadView::entries(const ObjId& obj) const -> MapRange {
+    auto range = MapRange{};
+    const auto* state = state_->get_object(obj);
+    if (!state || (state->type != ObjType::map && state->type != ObjType::table)) return range;
+    range.entries_.reserve(state->map_entries.size());
+    state->map_entries.for_each_sorted([&](std::string_view key, const detail::MapValues& values) {
+        const auto& winner = values.winner();
+        range.entries_.push_back(
+            MapEntryRef{.key = key, .value = value_ref(winner.value), .id = winner.op_id});
+    });
+    return range;
+}
+
+using SequenceIterator = detail::SequenceTree::const_iterator;
+
+// The first visible element at or after it (runs share visibility, so
+// hidden runs are skipped whole).
+static auto skip_hidden(SequenceIterator it) -> SequenceIterator {
+    while (it != SequenceIterator{} && !it.visible()) it.next_run();
+    return it;
+}
+
+// The first non-empty visible text chunk at or after it.
+static auto skip_to_text(SequenceIterator it) -> SequenceIterator {
+    while (it != SequenceIterator{} && (!it.visible() || it.run_text().empty())) it.next_run();
+    return it;
+}
+
+auto ReadView::elements(const ObjId& obj) const -> ListRange {
+    return elements(obj, 0, std::numeric_limits<std::size_t>::max());
+}
+
+auto ReadView::elements(const ObjId& obj, std::size_t first, std::size_t last) const -> ListRange {
+    auto range = ListRange{};
+    const auto* state = state_->get_object(obj);
+    if (!state || (state->type != ObjType::list && state->type != ObjType::text)) return range;
+    const auto& elements = state->list_elements;
+    last = std::min(last, elements.visible_size());
+    if (first >= last) return range;
+    // find_visible lands on a visible element, or size() (end) past the last
+    range.begin_ = ListRange::iterator{
+        elements.iterator_at(elements.find_visible(first)).position(), first};
+    range.end_ = ListRange::iterator{
+        elements.iterator_at(elements.find_visible(last)).position(), last};
+    range.size_ = last - first;
+    return range;
+}
+
+auto ListRange::iterator::operator*() const -> ElementRef {
+    const auto it = SequenceIterator{at_};
+    return ElementRef{.index = index_, .value = it.value_ref(), .id = it.insert_id()};
+}
+
+auto ListRange::iterator::operator++() -> iterator& {
+    at_ = skip_hidden(++SequenceIterator{at_}).position();
+    ++index_;
+    return *this;
+}
+
+auto ReadView::text_chunks(const ObjId& obj) const -> TextChunks {
+    auto range = TextChunks{};
+    const auto* state = state_->get_object(obj);
+    if (!state || state->type != ObjType::text) return range;
+    range.begin_ = TextChunks::iterator{skip_to_text(state->list_elements.begin()).position()};
+    return range;
+}
+
+auto TextChunks::iterator::operator*() const -> std::string_view {
+    return SequenceIterator{at_}.run_text();
+}
+
+auto TextChunks::iterator::operator++() -> iterator& {
+    auto it = SequenceIterator{at_};
+    it.next_run();
+    at_ = skip_to_text(it).position();
+    return *this;
+}
+
+// The first visible element at or after it that starts a chunk of T.
+template <typename T>
+static auto skip_to_numbers(SequenceIterator it) -> SequenceIterator {
+    while (it != SequenceIterator{} && (!it.visible() || it.run_numbers<T>().empty())) it.next_run();
+    return it;
+}
+
+template <typename T>
+    requires std::same_as<T, double> || std::same_as<T, std::int64_t>
+auto ReadView::scalar_chunks(const ObjId& obj) const -> ScalarChunks<T> {
+    auto range = ScalarChunks<T>{};
+    const auto* state = state_->get_object(obj);
+    if (!state || state->type != ObjType::list) return range;
+    range.begin_ = typename ScalarChunks<T>::iterator{
+        skip_to_numbers<T>(state->list_elements.begin()).position()};
+    return range;
+}
+
+template <typename T>
+auto ScalarChunks<T>::iterator::operator*() const -> std::span<const T> {
+    return SequenceIterator{at_}.run_numbers<T>();
+}
+
+template <typename T>
+auto ScalarChunks<T>::iterator::operator++() -> iterator& {
+    auto it = SequenceIterator{at_};
+    it.next_run();
+    at_ = skip_to_numbers<T>(it).position();
+    return *this;
+}
+
+template class ScalarChunks<double>;
+template class ScalarChunks<std::int64_t>;
+template auto ReadView::scalar_chunks<double>(const ObjId&) const -> ScalarChunks<double>;
+template auto ReadView::scalar_chunks<std::int64_t>(const ObjId&) const
+    -> ScalarChunks<std::int64_t>;
+
+auto ReadView::length(const ObjId& obj) const -> std::size_t {
+    return state_->object_length(obj);
+}
+
+auto ReadView::object_type(const ObjId& obj) const -> std::optional<ObjType> {
+    return state_->object_type(obj);
+}
+
+auto ReadView::get_obj_id(const ObjId& obj, std::string_view key) const -> std::optional<ObjId> {
+    return state_->get_obj_id_for_key(obj, key);
+}
+
+auto ReadView::get_obj_id(const ObjId& obj, std::size_t index) const -> std::optional<ObjId> {
     return state_->get_obj_id_for_index(obj, index);
 }
 
 // -- Phase 3: Fork and Merge --------------------------------------------------
 
+// Create a unique actor by stamping a monotonic counter into the last 8 bytes
+static auto forked_actor(ActorId actor) -> ActorId {
+    static std::atomic<std::uint64_t> fork_counter{1};
+    auto counter = fork_counter.fetch_add(1, std::memory_order_relaxed);
+    std::memcpy(&actor.bytes[8], &counter, sizeof(counter));
+    return actor;
+}
+
 auto Document::fork() const -> Document {
     auto guard = read_guard();
-    static std::atomic<std::uint64_t> fork_counter{1};
-    auto forked = Document{pool_};
+    auto forked = Document{*state_->resource, pool_};
     *forked.state_ = *state_;
-    // Create a unique actor by stamping a monotonic counter into the last 8 bytes
-    auto new_actor = state_->actor;
-    auto counter = fork_counter.fetch_add(1, std::memory_order_relaxed);
-    std::memcpy(&new_actor.bytes[8], &counter, sizeof(counter));
-    forked.state_->actor = new_actor;
+    forked.state_->actor = forked_actor(state_->actor);
+    return forked;
+}
+
+auto Document::fork(std::pmr::memory_resource& resource) const -> Document {
+    auto guard = read_guard();
+    auto forked = Document{resource, pool_};
+    *forked.state_ = *state_;
+    forked.state_->rehome(&resource);
+    forked.state_->actor = forked_actor(state_->actor);
     return forked;
 }
 
+// Apply changes whose deps are all present, each after its deps, and record
+// them in the clock, heads and history.
+static void apply_ready_changes(detail::DocState& state,
+                                std::vector<std::pair<Change, ChangeHash>>& ready,
+                                thread_pool* pool, std::vector<Patch>* patches) {
+    state.apply_change_ops(ready.size(),
+        [&](std::size_t i) -> const Change& { return ready[i].first; }, pool, patches);
+    for (auto& [change, hash] : ready) {
+        // Update clock
+        auto& seq = state.clock[change.actor];
+        seq = std::max(seq, change.seq);
+
+        // Update heads: remove deps, add this change
+        for (const auto& dep : change.deps) {
+            std::erase(state.heads, dep);
+        }
+        state.heads.push_back(hash);
+
+        // Store change
+        state.change_history.push_back(std::move(change), hash);
+    }
+}
+
 void Document::merge(const Document& other) {
-    auto lock = std::unique_lock{mutex_};
-    // Find changes from other that we haven't seen
-    auto missing = std::vector<Change>{};
-    for (const auto& change : other.state_->change_history) {
-        auto it = state_->clock.find(change.actor);
-        if (it == state_->clock.end() || it->second < change.seq) {
-            missing.push_back(change);
+    const Document* others[] = {&other};
+    merge_all(others);
+}
+
+void Document::merge_all(std::span<const Document> others) {
+    auto pointers = std::vector<const Document*>{};
+    pointers.reserve(others.size());
+    for (const auto& other : others) pointers.push_back(&other);
+    merge_all(pointers);
+}
+
+void Document::merge_all(std::span<const Document* const> others) {
+    merge_all_impl(others, nullptr);
+}
+
+void Document::merge_all_impl(std::span<const Document* const> others,
+                              std::vector<Patch>* patches) {
+    auto lock = WriteGuard{*this};
+    materialize();
+    auto inputs = std::vector<const Document*>{};
+    auto seen = std::unordered_set<const Document*>{};
+    for (const auto* other : others) {
+        if (other && other != this && seen.insert(other).second) inputs.push_back(other);
+    }
+
+    // Decode lazily loaded inputs and bring their hash indices up to date
+    auto prepare = [&](std::size_t start, std::size_t end) {
+        for (auto i = start; i < end; ++i) {
+            inputs[i]->materialize();
+            inputs[i]->state_->ensure_hash_index();
         }
+    };
+    if (pool_ && inputs.size() > 1) {
+        pool_->parallelize_loop(std::size_t{0}, inputs.size(), prepare);
+    } else {
+        prepare(0, inputs.size());
     }
-    // Sort by start_op for causal ordering
-    std::ranges::sort(missing, [](const Change& a, const Change& b) {
-        return a.start_op < b.start_op;
-    });
-    // Apply changes inline (avoid recursive lock from apply_changes)
-    for (const auto& change : missing) {
-        for (const auto& op : change.operations) {
-            state_->apply_op(op);
+
+    // Walk back from each input's heads through its hash index, stopping at
+    // changes we already have or an earlier input supplies: only missing
+    // changes are visited, each once. Missing changes (and their hashes)
+    // are shared with the input's log, not copied or rehashed.
+    struct Source {
+        const detail::ChangeLog* history;
+        std::size_t index;
+    };
+    auto missing = std::vector<Source>{};
+    auto visited = std::unordered_set<ChangeHash>{};
+    for (const auto* other : inputs) {
+        const auto& other_history = other->state_->change_history;
+        const auto& other_index = other->state_->hash_index();
+        auto found = std::vector<std::size_t>{};  // indices into other_history
+        auto stack = other->state_->heads;
+        while (!stack.empty()) {
+            auto hash = stack.back();
+            stack.pop_back();
+            if (state_->has_change_hash(hash) || !visited.insert(hash).second) continue;
+            auto it = other_index.find(hash);
+            if (it == other_index.end()) continue;
+            found.push_back(it->second);
+            for (const auto& dep : other_history[it->second].deps) {
+                stack.push_back(dep);
+            }
         }
+        // Each history is causally ordered, and a change's missing ancestors
+        // come from this input or an earlier one: concatenating keeps every
+        // change after its deps.
+        std::ranges::sort(found);
+        for (auto i : found) missing.push_back(Source{.history = &other_history, .index = i});
+    }
+    if (missing.empty()) return;
+
+    // Apply changes inline (avoid recursive lock from apply_changes)
+    state_->apply_change_ops(missing.size(),
+        [&](std::size_t k) -> const Change& { return (*missing[k].history)[missing[k].index]; },
+        pool_.get(), patches);
+    auto depended_on = std::unordered_set<ChangeHash>{};
+    for (const auto& [history, i] : missing) {
+        const auto& change = (*history)[i];
         auto& seq = state_->clock[change.actor];
         seq = std::max(seq, change.seq);
-        auto hash = detail::DocState::compute_change_hash(change);
-        for (const auto& dep : change.deps) {
-            std::erase(state_->heads, dep);
-        }
-        state_->heads.push_back(hash);
-        state_->change_history.push_back(change);
+        depended_on.insert(change.deps.begin(), change.deps.end());
+        state_->change_history.push_back(history->entry(i), history->hash(i));
+    }
+
+    // Heads: old and new heads that no merged change depends on
+    std::erase_if(state_->heads, [&](const auto& h) { return depended_on.contains(h); });
+    for (const auto& [history, i] : missing) {
+        const auto& hash = history->hash(i);
+        if (!depended_on.contains(hash)) state_->heads.push_back(hash);
+    }
+
+    // Queued changes that arrived here, or were waiting on one that did
+    if (!state_->pending_changes_.changes.empty()) {
+        auto arrived = std::vector<ChangeHash>{};
+        arrived.reserve(missing.size());
+        for (const auto& [history, i] : missing) arrived.push_back(history->hash(i));
+        auto released = state_->release_pending(arrived);
+        apply_ready_changes(*state_, released, pool_.get(), patches);
     }
 }
 
 auto Document::get_changes() const -> std::vector<Change> {
+    auto guard = snapshot_guard();
+    return guard.state->change_history.to_vector();
+}
+
+// The readers below use the change indexes, so they read the live state
+// under the read lock even with snapshot reads on: a published snapshot
+// starts without indexes and would build them from the whole history.
+auto Document::get_changes_since(const std::vector<ChangeHash>& heads) const
+    -> std::vector<Change> {
     auto guard = read_guard();
-    return state_->change_history;
+    const auto& history = state_->change_history;
+    auto result = std::vector<Change>{};
+    auto indices = state_->change_indices_since(heads);
+    result.reserve(indices.size());
+    for (auto i : indices) result.push_back(history[i]);
+    return result;
 }
 
-void Document::apply_changes(const std::vector<Change>& changes) {
-    auto lock = std::unique_lock{mutex_};
-    for (const auto& change : changes) {
-        // Apply each operation
-        for (const auto& op : change.operations) {
-            state_->apply_op(op);
-        }
+void Document::for_each_change_since(const std::vector<ChangeHash>& heads,
+                                     const std::function<void(const Change&)>& fn) const {
+    // Changes are shared and immutable, so holding the entries keeps them
+    // alive after the lock is released.
+    auto entries = std::vector<detail::ChangeLog::Entry>{};
+    {
+        auto guard = read_guard();
+        const auto& history = state_->change_history;
+        auto indices = state_->change_indices_since(heads);
+        entries.reserve(indices.size());
+        for (auto i : indices) entries.push_back(history.entry(i));
+    }
+    for (const auto& entry : entries) fn(*entry);
+}
 
-        // Update clock
-        auto& seq = state_->clock[change.actor];
-        seq = std::max(seq, change.seq);
+auto Document::get_change_by_hash(const ChangeHash& hash) const -> std::optional<Change> {
+    auto guard = read_guard();
+    const auto& index = state_->hash_index();
+    auto it = index.find(hash);
+    if (it == index.end()) return std::nullopt;
+    return state_->change_history[it->second];
+}
 
-        // Update heads
-        auto hash = detail::DocState::compute_change_hash(change);
-        // Remove deps from heads
-        for (const auto& dep : change.deps) {
-            std::erase(state_->heads, dep);
-        }
-        state_->heads.push_back(hash);
+void Document::apply_changes(const std::vector<Change>& changes) {
+    apply_changes_impl(changes, nullptr);
+}
 
-        // Store change
-        state_->change_history.push_back(change);
-    }
+void Document::apply_changes_impl(const std::vector<Change>& changes,
+                                  std::vector<Patch>* patches) {
+    auto lock = WriteGuard{*this};
+    materialize();
+    auto hashes = detail::DocState::compute_change_hashes(changes);
+    auto ready = state_->take_ready_changes(changes, hashes);
+    apply_ready_changes(*state_, ready, pool_.get(), patches);
 }
 
-auto Document::get_heads() const -> std::vector<ChangeHash> {
+auto Document::pending_change_count() const -> std::size_t {
     auto guard = read_guard();
+    return state_->pending_changes_.changes.size();
+}
+
+auto Document::get_heads() const -> std::vector<ChangeHash> {
+    if (snapshot_reads_) {
+        auto pin = std::shared_ptr<const detail::DocState>{};
+        if (const auto* snapshot = current_snapshot(pin)) return snapshot->heads;
+    }
+    auto guard = ReadGuard{mutex_, read_locking_};  // known without decoding
     return state_->heads;
 }
 
@@ -258,14 +661,67 @@ auto Document::get_heads() const -> std::vector<ChangeHash> {
 static constexpr std::uint8_t MAGIC[] = {0x85, 0x6F, 0x4A, 0x83};
 static constexpr std::uint8_t FORMAT_VERSION = 0x01;
 
-auto Document::save() const -> std::vector<std::byte> {
-    auto guard = read_guard();
+auto Document::save(const SaveOptions& options) const -> std::vector<std::byte> {
+    AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::save);
+    auto output = std::vector<std::byte>{};
+    auto offset = std::size_t{0};
+    {
+        auto guard = ReadGuard{mutex_, read_locking_};
+        if (options.compression_level == SaveOptions{}.compression_level
+            && state_->pending_load_.pending.load(std::memory_order_acquire)) {
+            // Lazily loaded and never touched: the loaded bytes are still current
+            auto lock = std::lock_guard{state_->pending_load_.mutex};
+            if (state_->pending_load_.bytes) return *state_->pending_load_.bytes;
+        }
+        materialize();
+        offset = write_document_chunk(options, output);
+    }
+    // Drop the unused part of the header room (a few bytes, moved in place)
+    output.erase(output.begin(), output.begin() + static_cast<std::ptrdiff_t>(offset));
+    return output;
+}
+
+auto Document::save_to(const std::function<void(std::span<const std::byte>)>& sink,
+                       const SaveOptions& options) const -> std::size_t {
+    auto loaded = std::shared_ptr<const std::vector<std::byte>>{};  // untouched lazy load
+    auto output = std::vector<std::byte>{};
+    auto offset = std::size_t{0};
+    {
+        auto guard = ReadGuard{mutex_, read_locking_};
+        if (options.compression_level == SaveOptions{}.compression_level
+            && state_->pending_load_.pending.load(std::memory_order_acquire)) {
+            auto lock = std::lock_guard{state_->pending_load_.mutex};
+            loaded = state_->pending_load_.bytes;
+        }
+        if (!loaded) {
+            materialize();
+            offset = write_document_chunk(options, output);
+        }
+    }
+    if (loaded) {
+        sink(*loaded);
+        return loaded->size();
+    }
+    auto chunk = std::span<const std::byte>{output}.subspan(offset);
+    sink(chunk);
+    return chunk.size();
+}
+
+auto Document::write_document_chunk(const SaveOptions& options,
+                                    std::vector<std::byte>& output) const -> std::size_t {
+    AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::column_encode);
     const auto& actor_table = state_->actor_table();
 
-    // Build document body (pre-size: actor table + heads + ~256 bytes per change)
-    auto body = std::vector<std::byte>{};
-    body.reserve(128 + actor_table.size() * 20 + state_->heads.size() * 32
-                 + state_->change_history.size() * 256);
+    // The body is built in place after room for the chunk header, so it is
+    // never copied (pre-size: actor table + heads + ~64 bytes per change)
+    auto& body = output;
+    body.reserve(body.size() + storage::max_chunk_header_size + 128 + actor_table.size() * 20
+                 + state_->heads.size() * 32 + state_->change_history.size() * 64);
+    const auto start = storage::begin_chunk(body);
+
+    // Columnar layout marker: a zero actor count, then the layout version
+    encoding::encode_uleb128(0, body);
+    body.push_back(static_cast<std::byte>(storage::columnar_document_version));
 
     // Actor table: count + length-prefixed actors
     encoding::encode_uleb128(actor_table.size(), body);
@@ -283,40 +739,46 @@ auto Document::save() const -> std::vector<std::byte> {
     // Change count
     encoding::encode_uleb128(state_->change_history.size(), body);
 
-    // Change bodies (each as a sub-blob)
-    for (const auto& change : state_->change_history) {
-        auto change_body = storage::serialize_change_body(change, actor_table);
-        encoding::encode_uleb128(change_body.size(), body);
-        body.insert(body.end(), change_body.begin(), change_body.end());
-    }
+    // Changes: one set of metadata and op columns for the whole history,
+    // encoded and deflated on the pool if there is one
+    const auto& actor_index = state_->actor_index();
+    storage::write_document_changes(state_->change_history, state_->all_change_hashes(),
+                                    actor_index, body, options.compression_level, pool_.get());
 
     // Local metadata: actor index + next_counter + local_seq + clock
-    auto local_actor_idx = std::uint64_t{0};
-    for (std::size_t i = 0; i < actor_table.size(); ++i) {
-        if (actor_table[i] == state_->actor) {
-            local_actor_idx = static_cast<std::uint64_t>(i);
-            break;
-        }
-    }
-    encoding::encode_uleb128(local_actor_idx, body);
+    encoding::encode_uleb128(storage::find_actor_index(actor_index, state_->actor), body);
     encoding::encode_uleb128(state_->next_counter, body);
     encoding::encode_uleb128(state_->local_seq, body);
 
     // Clock
     encoding::encode_uleb128(state_->clock.size(), body);
     for (const auto& [actor, seq] : state_->clock) {
-        for (std::size_t i = 0; i < actor_table.size(); ++i) {
-            if (actor_table[i] == actor) {
-                encoding::encode_uleb128(i, body);
-                break;
-            }
-        }
+        encoding::encode_uleb128(storage::find_actor_index(actor_index, actor), body);
         encoding::encode_uleb128(seq, body);
     }
 
-    // Write as a document chunk
+    return storage::finish_chunk(storage::ChunkType::document, output, start);
+}
+
+auto Document::save_since(const std::vector<ChangeHash>& heads,
+                          const SaveOptions& options) const -> std::vector<std::byte> {
+    auto guard = read_guard();
     auto output = std::vector<std::byte>{};
-    storage::write_chunk(storage::ChunkType::document, body, output);
+    for (auto i : state_->change_indices_since(heads)) {
+        storage::write_change_chunk(state_->change_history[i], output, options.compression_level);
+    }
+    return output;
+}
+
+auto Document::save_incremental(const SaveOptions& options) -> std::vector<std::byte> {
+    auto lock = WriteGuard{*this};
+    materialize();
+    const auto& history = state_->change_history;
+    auto output = std::vector<std::byte>{};
+    for (auto i = std::min(state_->saved_change_count, history.size()); i < history.size(); ++i) {
+        storage::write_change_chunk(history[i], output, options.compression_level);
+    }
+    state_->saved_change_count = history.size();
     return output;
 }
 
@@ -326,10 +788,17 @@ struct ParsedDocData {
     std::uint64_t next_counter;
     std::uint64_t local_seq;
     std::vector<Change> changes;
+    std::vector<ChangeHash> change_hashes;  // change_hashes[i] is the hash of changes[i]
     std::vector<ChangeHash> heads;
     std::map<ActorId, std::uint64_t> clock;
 };
 
+// Decoded changes with the hash of each (computed once, at decode time).
+struct HashedChanges {
+    std::vector<Change> changes;
+    std::vector<ChangeHash> hashes;
+};
+
 static auto parse_v1(std::span<const std::byte> data) -> std::optional<ParsedDocData> {
     auto d = storage::Deserializer{data};
 
@@ -467,11 +936,7 @@ static auto parse_v1(std::span<const std::byte> data) -> std::optional<ParsedDoc
     // Recompute change hashes with SHA-256 (old format used FNV-1a).
     // Build a map from each change to its recomputed hash, then find the
     // true heads (changes that are not a dependency of any other change).
-    auto change_hashes = std::vector<ChangeHash>{};
-    change_hashes.reserve(changes.size());
-    for (const auto& change : changes) {
-        change_hashes.push_back(detail::DocState::compute_change_hash(change));
-    }
+    auto change_hashes = detail::DocState::compute_change_hashes(changes);
 
     // A head is a change whose hash is not listed as a dep of any other change.
     auto dep_set = std::unordered_set<ChangeHash>{};
@@ -507,6 +972,7 @@ static auto parse_v1(std::span<const std::byte> data) -> std::optional<ParsedDoc
         .next_counter = *next_counter,
         .local_seq = *local_seq,
         .changes = std::move(changes),
+        .change_hashes = std::move(change_hashes),
         .heads = std::move(result_heads),
         .clock = std::move(clock),
     };
@@ -514,29 +980,76 @@ static auto parse_v1(std::span<const std::byte> data) -> std::optional<ParsedDoc
 
 // -- v2 format parser (chunk-based) -------------------------------------------
 
-static auto parse_v2(std::span<const std::byte> data) -> std::optional<ParsedDocData> {
+// Per-change bodies are only decoded on the pool above this count.
+static constexpr auto parallel_decode_min_changes = std::size_t{64};
+
+// A validated v2 document chunk: header fields and local metadata read, the
+// changes section located but not decoded.
+struct V2Layout {
+    std::span<const std::byte> body;
+    std::vector<ActorId> actor_table;
+    bool columnar = false;
+    std::size_t changes_pos = 0;  // offset of the first change in body
+    std::size_t num_changes = 0;
+    ActorId local_actor;
+    std::uint64_t next_counter = 0;
+    std::uint64_t local_seq = 0;
+    std::vector<ChangeHash> heads;
+    std::map<ActorId, std::uint64_t> clock;
+};
+
+static auto read_body_uleb(std::span<const std::byte> body, std::size_t& pos)
+    -> std::optional<std::uint64_t> {
+    if (pos >= body.size()) return std::nullopt;
+    auto r = encoding::decode_uleb128(body.subspan(pos));
+    if (!r) return std::nullopt;
+    pos += r->bytes_read;
+    return r->value;
+}
+
+// Length-prefixed change bodies of the per-change layout, starting at pos.
+static auto split_change_bodies(std::span<const std::byte> body, std::size_t& pos,
+                                std::size_t num_changes)
+    -> std::optional<std::vector<std::span<const std::byte>>> {
+    auto change_bodies = std::vector<std::span<const std::byte>>{};
+    change_bodies.reserve(num_changes);
+    for (std::size_t ci = 0; ci < num_changes; ++ci) {
+        auto change_len = read_body_uleb(body, pos);
+        if (!change_len || *change_len > body.size() - pos) return std::nullopt;
+        change_bodies.push_back(body.subspan(pos, static_cast<std::size_t>(*change_len)));
+        pos += static_cast<std::size_t>(*change_len);
+    }
+    return change_bodies;
+}
+
+static auto parse_v2_layout(std::span<const std::byte> data, bool verify_checksum = true)
+    -> std::optional<V2Layout> {
     auto header = storage::parse_chunk_header(data);
     if (!header) return std::nullopt;
 
-    if (!storage::validate_chunk_checksum(*header, data)) return std::nullopt;
+    if (verify_checksum && !storage::validate_chunk_checksum(*header, data)) return std::nullopt;
     if (header->type != storage::ChunkType::document) return std::nullopt;
 
+    auto layout = V2Layout{};
     auto body = data.subspan(header->body_offset, header->body_length);
+    layout.body = body;
     auto pos = std::size_t{0};
+    auto read_uleb = [&]() { return read_body_uleb(body, pos); };
 
-    auto read_uleb = [&]() -> std::optional<std::uint64_t> {
-        if (pos >= body.size()) return std::nullopt;
-        auto r = encoding::decode_uleb128(body.subspan(pos));
-        if (!r) return std::nullopt;
-        pos += r->bytes_read;
-        return r->value;
-    };
-
-    // Actor table
+    // Actor table. A zero count marks the columnar layout (followed by its
+    // version and the real count); older saves store one blob per change.
     auto num_actors = read_uleb();
     if (!num_actors) return std::nullopt;
-    auto actor_table = std::vector<ActorId>{};
-    actor_table.reserve(static_cast<std::size_t>(*num_actors));
+    if (*num_actors == 0) {
+        if (pos >= body.size()) return std::nullopt;
+        if (std::to_integer<std::uint8_t>(body[pos++]) != storage::columnar_document_version) {
+            return std::nullopt;
+        }
+        layout.columnar = true;
+        num_actors = read_uleb();
+        if (!num_actors) return std::nullopt;
+    }
+    layout.actor_table.reserve(static_cast<std::size_t>(*num_actors));
     for (std::uint64_t i = 0; i < *num_actors; ++i) {
         auto actor_len = read_uleb();
         if (!actor_len || *actor_len != ActorId::size) return std::nullopt;
@@ -544,37 +1057,33 @@ static auto parse_v2(std::span<const std::byte> data) -> std::optional<ParsedDoc
         auto actor = ActorId{};
         std::memcpy(actor.bytes.data(), &body[pos], ActorId::size);
         pos += ActorId::size;
-        actor_table.push_back(actor);
+        layout.actor_table.push_back(actor);
     }
+    const auto& actor_table = layout.actor_table;
 
     // Heads
     auto num_heads = read_uleb();
     if (!num_heads) return std::nullopt;
-    auto heads = std::vector<ChangeHash>{};
-    heads.reserve(static_cast<std::size_t>(*num_heads));
+    layout.heads.reserve(static_cast<std::size_t>(*num_heads));
     for (std::uint64_t i = 0; i < *num_heads; ++i) {
         if (pos + 32 > body.size()) return std::nullopt;
         auto h = ChangeHash{};
         std::memcpy(h.bytes.data(), &body[pos], 32);
         pos += 32;
-        heads.push_back(h);
+        layout.heads.push_back(h);
     }
 
-    // Changes
+    // Changes — located here, decoded by decode_v2_changes
     auto num_changes = read_uleb();
     if (!num_changes) return std::nullopt;
-    auto changes = std::vector<Change>{};
-    changes.reserve(static_cast<std::size_t>(*num_changes));
-
-    for (std::uint64_t ci = 0; ci < *num_changes; ++ci) {
-        auto change_len = read_uleb();
-        if (!change_len || pos + *change_len > body.size()) return std::nullopt;
-        auto change_body = body.subspan(pos, static_cast<std::size_t>(*change_len));
-        pos += static_cast<std::size_t>(*change_len);
-
-        auto change = storage::parse_change_chunk(change_body, actor_table);
-        if (!change) return std::nullopt;
-        changes.push_back(std::move(*change));
+    layout.num_changes = static_cast<std::size_t>(*num_changes);
+    layout.changes_pos = pos;
+    if (layout.columnar) {
+        if (!storage::skip_raw_columns(body, pos) || !storage::skip_raw_columns(body, pos)) {
+            return std::nullopt;
+        }
+    } else if (!split_change_bodies(body, pos, layout.num_changes)) {
+        return std::nullopt;
     }
 
     // Local metadata
@@ -584,30 +1093,197 @@ static auto parse_v2(std::span<const std::byte> data) -> std::optional<ParsedDoc
     if (!next_counter) return std::nullopt;
     auto local_seq = read_uleb();
     if (!local_seq) return std::nullopt;
+    layout.local_actor = actor_table[static_cast<std::size_t>(*local_actor_idx)];
+    layout.next_counter = *next_counter;
+    layout.local_seq = *local_seq;
 
     // Clock
     auto num_clock = read_uleb();
     if (!num_clock) return std::nullopt;
-    auto clock = std::map<ActorId, std::uint64_t>{};
     for (std::uint64_t i = 0; i < *num_clock; ++i) {
         auto cidx = read_uleb();
         if (!cidx || *cidx >= actor_table.size()) return std::nullopt;
         auto cseq = read_uleb();
         if (!cseq) return std::nullopt;
-        clock[actor_table[static_cast<std::size_t>(*cidx)]] = *cseq;
+        layout.clock[actor_table[static_cast<std::size_t>(*cidx)]] = *cseq;
+    }
+
+    return layout;
+}
+
+// Stored op count of a layout's changes, read from change metadata only.
+static auto count_v2_ops(const V2Layout& layout) -> std::optional<std::size_t> {
+    if (layout.columnar) {
+        return storage::count_document_ops(layout.body, layout.changes_pos, layout.num_changes);
     }
+    auto pos = layout.changes_pos;
+    auto change_bodies = split_change_bodies(layout.body, pos, layout.num_changes);
+    if (!change_bodies) return std::nullopt;
+    auto total = std::size_t{0};
+    for (const auto& change_body : *change_bodies) {
+        auto count = storage::change_chunk_op_count(change_body);
+        if (!count) return std::nullopt;
+        total += *count;
+    }
+    return total;
+}
+
+static auto decode_v2_changes(const V2Layout& layout, thread_pool* pool)
+    -> std::optional<HashedChanges> {
+    auto pos = layout.changes_pos;
+    if (layout.columnar) {
+        auto hashes = std::vector<ChangeHash>{};
+        auto changes = storage::parse_document_changes(
+            layout.body, pos, layout.actor_table, layout.num_changes,
+            &detail::DocState::compute_change_hash, pool, &hashes);
+        if (!changes) return std::nullopt;
+        return HashedChanges{.changes = std::move(*changes), .hashes = std::move(hashes)};
+    }
+
+    // Per-change bodies decode independently
+    auto change_bodies = split_change_bodies(layout.body, pos, layout.num_changes);
+    if (!change_bodies) return std::nullopt;
+    auto decoded = std::vector<std::optional<Change>>(change_bodies->size());
+    auto decode = [&](std::size_t start, std::size_t end) {
+        for (auto i = start; i < end; ++i) {
+            decoded[i] = storage::parse_change_chunk((*change_bodies)[i], layout.actor_table);
+        }
+    };
+    if (pool && change_bodies->size() >= parallel_decode_min_changes) {
+        pool->parallelize_loop(std::size_t{0}, change_bodies->size(), decode);
+    } else {
+        decode(0, change_bodies->size());
+    }
+
+    auto changes = std::vector<Change>{};
+    changes.reserve(decoded.size());
+    for (auto& change : decoded) {
+        if (!change) return std::nullopt;
+        changes.push_back(std::move(*change));
+    }
+    auto hashes = detail::DocState::compute_change_hashes(changes);
+    return HashedChanges{.changes = std::move(changes), .hashes = std::move(hashes)};
+}
+
+static auto parse_v2(std::span<const std::byte> data, thread_pool* pool,
+                     bool verify_checksum = true)
+    -> std::optional<ParsedDocData> {
+    auto layout = parse_v2_layout(data, verify_checksum);
+    if (!layout) return std::nullopt;
+    auto changes = decode_v2_changes(*layout, pool);
+    if (!changes) return std::nullopt;
 
     return ParsedDocData{
-        .local_actor = actor_table[static_cast<std::size_t>(*local_actor_idx)],
-        .next_counter = *next_counter,
-        .local_seq = *local_seq,
-        .changes = std::move(changes),
-        .heads = std::move(heads),
-        .clock = std::move(clock),
+        .local_actor = layout->local_actor,
+        .next_counter = layout->next_counter,
+        .local_seq = layout->local_seq,
+        .changes = std::move(changes->changes),
+        .change_hashes = std::move(changes->hashes),
+        .heads = std::move(layout->heads),
+        .clock = std::move(layout->clock),
     };
 }
 
+// -- Incremental chunks -------------------------------------------------------
+
+// Decode a concatenation of document and change chunks, in order.
+// nullopt if any chunk is malformed or of another type.
+static auto parse_chunk_sequence(std::span<const std::byte> data, thread_pool* pool,
+                                 const LoadOptions& options)
+    -> std::optional<HashedChanges> {
+    auto result = HashedChanges{};
+    auto pos = std::size_t{0};
+    while (pos < data.size()) {
+        auto rest = data.subspan(pos);
+        auto header = storage::parse_chunk_header(rest);
+        if (!header) return std::nullopt;
+        if (options.verify_checksum && !storage::validate_chunk_checksum(*header, rest)) {
+            return std::nullopt;
+        }
+        auto chunk = rest.first(header->body_offset + header->body_length);
+        if (header->type == storage::ChunkType::document) {
+            auto parsed = parse_v2(chunk, pool, false);  // checksum checked above
+            if (!parsed) return std::nullopt;
+            std::ranges::move(parsed->changes, std::back_inserter(result.changes));
+            std::ranges::copy(parsed->change_hashes, std::back_inserter(result.hashes));
+        } else if (header->type == storage::ChunkType::change) {
+            auto change = storage::parse_standalone_change(
+                chunk.subspan(header->body_offset, header->body_length));
+            if (!change) return std::nullopt;
+            result.hashes.push_back(detail::DocState::compute_change_hash(*change));
+            result.changes.push_back(std::move(*change));
+        } else {
+            return std::nullopt;
+        }
+        pos += chunk.size();
+    }
+    return result;
+}
+
+// Apply the changes state has not seen yet (by actor clock), in order, then
+// any queued changes they complete. Returns the number applied.
+static auto apply_missing_changes(detail::DocState& state, HashedChanges changes,
+                                  thread_pool* pool) -> std::size_t {
+    auto selected = std::vector<std::size_t>{};
+    for (std::size_t i = 0; i < changes.changes.size(); ++i) {
+        const auto& change = changes.changes[i];
+        auto& seq = state.clock[change.actor];
+        if (change.seq <= seq) continue;
+        seq = change.seq;
+        if (change.actor == state.actor) {
+            state.local_seq = std::max(state.local_seq, change.seq);
+        }
+        selected.push_back(i);
+    }
+    state.apply_change_ops(selected.size(),  // also keeps next_counter ahead
+        [&](std::size_t k) -> const Change& { return changes.changes[selected[k]]; }, pool);
+    for (auto i : selected) {
+        auto& change = changes.changes[i];
+        const auto& hash = changes.hashes[i];
+        for (const auto& dep : change.deps) {
+            std::erase(state.heads, dep);
+        }
+        state.heads.push_back(hash);
+        state.change_history.push_back(std::move(change), hash);
+    }
+    if (state.pending_changes_.changes.empty()) return selected.size();
+
+    // Queued changes that arrived here, or were waiting on one that did
+    auto arrived = std::vector<ChangeHash>{};
+    arrived.reserve(selected.size());
+    for (auto i : selected) arrived.push_back(changes.hashes[i]);
+    auto released = state.release_pending(arrived);
+    apply_ready_changes(state, released, pool, nullptr);
+    return selected.size() + released.size();
+}
+
+auto Document::load_incremental(std::span<const std::byte> data, const LoadOptions& options)
+    -> std::optional<std::size_t> {
+    auto lock = WriteGuard{*this};
+    materialize();
+    auto changes = parse_chunk_sequence(data, pool_.get(), options);
+    if (!changes) return std::nullopt;
+    return apply_missing_changes(*state_, std::move(*changes), pool_.get());
+}
+
 auto Document::load(std::span<const std::byte> data) -> std::optional<Document> {
+    return load(data, nullptr);
+}
+
+auto Document::load(std::span<const std::byte> data,
+                    std::shared_ptr<thread_pool> pool) -> std::optional<Document> {
+    return load(data, *std::pmr::get_default_resource(), std::move(pool));
+}
+
+auto Document::load(std::span<const std::byte> data, const LoadOptions& options,
+                    std::shared_ptr<thread_pool> pool) -> std::optional<Document> {
+    return load(data, *std::pmr::get_default_resource(), std::move(pool), options);
+}
+
+auto Document::load(std::span<const std::byte> data, std::pmr::memory_resource& resource,
+                    std::shared_ptr<thread_pool> pool, const LoadOptions& options)
+    -> std::optional<Document> {
+    AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::load);
     if (data.size() < 5) return std::nullopt;
 
     // Check magic bytes
@@ -618,31 +1294,89 @@ auto Document::load(std::span<const std::byte> data) -> std::optional<Document>
 
     // Try v2 (chunk-based) first since it's the current format.
     // Fall back to v1 if v2 parsing fails (backward compat).
-    std::optional<ParsedDocData> parsed = parse_v2(data);
-    if (!parsed) {
+    std::optional<ParsedDocData> parsed = parse_v2(data, pool.get(), options.verify_checksum);
+
+    // Change chunks appended after the document chunk (save_incremental)
+    auto appended = HashedChanges{};
+    if (parsed) {
+        auto header = storage::parse_chunk_header(data);
+        auto end = header->body_offset + header->body_length;
+        auto trailing = parse_chunk_sequence(data.subspan(end), pool.get(), options);
+        if (!trailing) return std::nullopt;
+        appended = std::move(*trailing);
+    } else {
         parsed = parse_v1(data);
     }
     if (!parsed) return std::nullopt;
 
-    auto doc = Document{1u};  // no pool — caller can assign one later
+    auto doc = Document{resource, std::move(pool)};
     doc.set_actor_id(parsed->local_actor);
     doc.state_->next_counter = parsed->next_counter;
     doc.state_->local_seq = parsed->local_seq;
 
     // Replay all changes to rebuild the document state
-    for (const auto& change : parsed->changes) {
-        for (const auto& op : change.operations) {
-            doc.state_->apply_op(op);
-        }
-    }
+    doc.state_->apply_change_ops(parsed->changes.size(),
+        [&](std::size_t i) -> const Change& { return parsed->changes[i]; }, doc.pool_.get());
 
-    doc.state_->change_history = std::move(parsed->changes);
+    doc.state_->change_history =
+        detail::ChangeLog{std::move(parsed->changes), parsed->change_hashes};
     doc.state_->heads = std::move(parsed->heads);
     doc.state_->clock = std::move(parsed->clock);
+    apply_missing_changes(*doc.state_, std::move(appended), doc.pool_.get());
+    doc.state_->saved_change_count = doc.state_->change_history.size();
+
+    return doc;
+}
 
+auto Document::load_lazy(std::span<const std::byte> data, std::shared_ptr<thread_pool> pool,
+                         const LoadOptions& options) -> std::optional<Document> {
+    auto bytes = std::make_shared<const std::vector<std::byte>>(data.begin(), data.end());
+    auto layout = parse_v2_layout(*bytes, options.verify_checksum);
+    if (!layout || layout->body.data() + layout->body.size() != bytes->data() + bytes->size()) {
+        return load(data, options, std::move(pool));  // v1 or appended chunks: no deferred path
+    }
+    auto op_count = count_v2_ops(*layout);
+    if (!op_count) return std::nullopt;
+    AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::load);
+
+    auto doc = Document{std::move(pool)};
+    doc.state_->actor = layout->local_actor;
+    doc.state_->next_counter = layout->next_counter;
+    doc.state_->local_seq = layout->local_seq;
+    doc.state_->heads = std::move(layout->heads);
+    doc.state_->clock = std::move(layout->clock);
+    doc.state_->saved_change_count = layout->num_changes;
+    doc.state_->pending_load_.bytes = std::move(bytes);
+    doc.state_->pending_load_.op_count = *op_count;
+    doc.state_->pending_load_.pending.store(true, std::memory_order_release);
     return doc;
 }
 
+auto Document::is_materialized() const -> bool {
+    return !state_->pending_load_.pending.load(std::memory_order_acquire);
+}
+
+void Document::materialize() const {
+    auto& pending = state_->pending_load_;
+    if (!pending.pending.load(std::memory_order_acquire)) return;
+    auto lock = std::lock_guard{pending.mutex};
+    if (!pending.pending.load(std::memory_order_relaxed)) return;
+
+    // Checksum (if asked for) and layout were validated by load_lazy
+    auto layout = parse_v2_layout(*pending.bytes, false);
+    auto changes = layout ? decode_v2_changes(*layout, pool_.get()) : std::nullopt;
+    if (changes) {
+        state_->apply_change_ops(changes->changes.size(),
+            [&](std::size_t i) -> const Change& { return changes->changes[i]; }, pool_.get());
+        state_->change_history = detail::ChangeLog{std::move(changes->changes), changes->hashes};
+    } else {
+        state_->heads.clear();
+        state_->clock.clear();
+    }
+    pending.bytes.reset();
+    pending.pending.store(false, std::memory_order_release);
+}
+
 // -- Phase 5: Sync Protocol ---------------------------------------------------
 
 // SyncState encode/decode
@@ -675,7 +1409,108 @@ auto SyncState::decode(std::span<const std::byte> data) -> std::optional<SyncSta
     return state;
 }
 
+// SyncMessage encode/decode (upstream sync wire format)
+
+static constexpr std::uint8_t sync_message_type = 0x42;
+
+static void write_hashes(storage::Serializer& s, const std::vector<ChangeHash>& hashes) {
+    s.write_uleb128(hashes.size());
+    for (const auto& h : hashes) s.write_change_hash(h);
+}
+
+static auto read_hashes(storage::Deserializer& d) -> std::optional<std::vector<ChangeHash>> {
+    auto count = d.read_uleb128();
+    if (!count || *count > d.remaining() / 32) return std::nullopt;
+    auto hashes = std::vector<ChangeHash>{};
+    hashes.reserve(static_cast<std::size_t>(*count));
+    for (std::uint64_t i = 0; i < *count; ++i) {
+        auto h = d.read_change_hash();
+        if (!h) return std::nullopt;
+        hashes.push_back(*h);
+    }
+    return hashes;
+}
+
+// Everything before the changes: type, heads, need, have.
+static void write_sync_message_fields(storage::Serializer& s, const SyncMessage& message) {
+    s.write_u8(sync_message_type);
+    write_hashes(s, message.heads);
+    write_hashes(s, message.need);
+    s.write_uleb128(message.have.size());
+    for (const auto& have : message.have) {
+        write_hashes(s, have.last_sync);
+        s.write_uleb128(have.bloom_bytes.size());
+        s.write_bytes(have.bloom_bytes);
+    }
+}
+
+auto SyncMessage::encode() const -> std::vector<std::byte> {
+    auto s = storage::Serializer{};
+    write_sync_message_fields(s, *this);
+    s.write_uleb128(changes.size());
+    auto chunk = std::vector<std::byte>{};
+    for (const auto& change : changes) {
+        chunk.clear();
+        storage::write_change_chunk(change, chunk);
+        s.write_uleb128(chunk.size());
+        s.write_bytes(chunk);
+    }
+    return s.take();
+}
+
+auto SyncMessage::decode(std::span<const std::byte> data) -> std::optional<SyncMessage> {
+    auto d = storage::Deserializer{data};
+    auto type = d.read_u8();
+    if (!type || *type != sync_message_type) return std::nullopt;
+
+    auto message = SyncMessage{};
+    auto heads = read_hashes(d);
+    if (!heads) return std::nullopt;
+    message.heads = std::move(*heads);
+    auto need = read_hashes(d);
+    if (!need) return std::nullopt;
+    message.need = std::move(*need);
+
+    auto num_have = d.read_uleb128();
+    if (!num_have || *num_have > d.remaining()) return std::nullopt;
+    for (std::uint64_t i = 0; i < *num_have; ++i) {
+        auto last_sync = read_hashes(d);
+        if (!last_sync) return std::nullopt;
+        auto bloom_len = d.read_uleb128();
+        if (!bloom_len || *bloom_len > d.remaining()) return std::nullopt;
+        auto bloom = d.read_bytes(static_cast<std::size_t>(*bloom_len));
+        if (!bloom) return std::nullopt;
+        message.have.push_back(Have{
+            .last_sync = std::move(*last_sync),
+            .bloom_bytes = {bloom->begin(), bloom->end()},
+        });
+    }
+
+    auto num_changes = d.read_uleb128();
+    if (!num_changes || *num_changes > d.remaining()) return std::nullopt;
+    message.changes.reserve(static_cast<std::size_t>(*num_changes));
+    for (std::uint64_t i = 0; i < *num_changes; ++i) {
+        auto len = d.read_uleb128();
+        if (!len || *len > d.remaining()) return std::nullopt;
+        auto chunk = d.read_bytes(static_cast<std::size_t>(*len));
+        if (!chunk) return std::nullopt;
+        auto header = storage::parse_chunk_header(*chunk);
+        if (!header || header->type != storage::ChunkType::change ||
+            header->body_offset + header->body_length != chunk->size() ||
+            !storage::validate_chunk_checksum(*header, *chunk)) {
+            return std::nullopt;
+        }
+        auto change = storage::parse_standalone_change(
+            chunk->subspan(header->body_offset, header->body_length));
+        if (!change) return std::nullopt;
+        message.changes.push_back(std::move(*change));
+    }
+    // Trailing data (later protocol versions) is ignored
+    return message;
+}
+
 // Determine which change hashes to send based on peer's bloom filter and needs.
+// Works over dense change_history indices: sets are bitsets over the history.
 static auto get_hashes_to_send(
     const detail::DocState& state,
     const std::vector<Have>& their_have,
@@ -695,77 +1530,218 @@ static auto get_hashes_to_send(
         bloom_filters.push_back(bf.value_or(sync::BloomFilter{}));
     }
 
-    // Get all changes since last_sync
-    auto hashes = state.get_changes_since(last_sync_heads);
-
-    // Build dependency graph (hash → dependents)
+    // All changes since last_sync, in history order
+    const auto& history = state.change_history;
     const auto& hash_idx = state.hash_index();
-    auto dependents = std::map<ChangeHash, std::vector<ChangeHash>>{};
-    auto change_hashes_set = std::set<ChangeHash>(hashes.begin(), hashes.end());
+    const auto& dag = state.change_dag();
+    auto since = state.change_indices_since(last_sync_heads);
+
+    // Which of them some bloom filter has, probed in batches
+    auto since_hashes = std::vector<ChangeHash>{};
+    since_hashes.reserve(since.size());
+    for (auto i : since) since_hashes.push_back(history.hash(i));
+    auto in_any = std::vector<bool>(since.size());
+    for (const auto& bf : bloom_filters) bf.contains_hashes(since_hashes, in_any);
+
+    // Send what no bloom filter has, plus everything that depends on it.
+    // History order puts deps first, so one forward pass is the transitive
+    // closure.
+    auto to_send = std::vector<bool>(history.size());
+    for (std::size_t k = 0; k < since.size(); ++k) {
+        auto i = since[k];
+        to_send[i] = !in_any[k] || std::ranges::any_of(dag.deps_of(i), [&](auto dep) {
+            return to_send[dep];
+        });
+    }
 
-    for (const auto& h : hashes) {
+    // Build result: explicitly needed first, then our additions in document order
+    auto result = std::vector<ChangeHash>{};
+    for (const auto& h : their_need) {
         auto it = hash_idx.find(h);
-        if (it == hash_idx.end()) continue;
-        for (const auto& dep : state.change_history[it->second].deps) {
-            dependents[dep].push_back(h);
+        if (it == hash_idx.end() || !to_send[it->second]) {
+            result.push_back(h);
         }
     }
+    for (auto i : since) {
+        if (to_send[i]) result.push_back(history.hash(i));
+    }
+    return result;
+}
 
-    // Find hashes NOT in any bloom filter
-    auto hashes_to_send = std::set<ChangeHash>{};
-    for (const auto& h : hashes) {
-        auto in_any = std::ranges::any_of(bloom_filters,
-            [&](const auto& bf) { return bf.contains_hash(h); });
-        if (!in_any) {
-            hashes_to_send.insert(h);
+void Document::update_have_cache(const detail::DocState& state, SyncState& sync_state) {
+    const auto& history = state.change_history;
+    const auto& our_heads = state.heads;
+    auto& cache = sync_state.have_cache_;
+    if (cache && cache->shared_heads == sync_state.shared_heads_) {
+        if (cache->our_heads == our_heads) return;
+
+        // Changes appended since the cache are new relative to the shared
+        // heads, provided the cached history is still our prefix.
+        const auto& idx = state.hash_index();
+        auto is_prefix = cache->shared_heads_known &&
+                         history.size() >= cache->history_size &&
+                         std::ranges::all_of(cache->our_heads, [&](const auto& h) {
+                             auto it = idx.find(h);
+                             return it != idx.end() && it->second < cache->history_size;
+                         });
+        if (is_prefix) {
+            auto next = std::make_shared<SyncState::HaveCache>(*cache);
+            for (auto i = next->history_size; i < history.size(); ++i) {
+                next->changes_since.push_back(history.hash(i));
+            }
+            next->bloom_bytes = sync::BloomFilter::from_hashes(next->changes_since).to_bytes();
+            next->our_heads = our_heads;
+            next->history_size = history.size();
+            cache = std::move(next);
+            return;
         }
     }
 
-    // Transitive closure: if we send X, send everything that depends on X
-    auto stack = std::vector<ChangeHash>(hashes_to_send.begin(), hashes_to_send.end());
-    while (!stack.empty()) {
-        auto h = stack.back();
-        stack.pop_back();
-        auto dep_it = dependents.find(h);
-        if (dep_it != dependents.end()) {
-            for (const auto& dependent : dep_it->second) {
-                if (hashes_to_send.insert(dependent).second) {
-                    stack.push_back(dependent);
-                }
+    auto changes_since = state.get_changes_since(sync_state.shared_heads_);
+    auto bloom_bytes = sync::BloomFilter::from_hashes(changes_since).to_bytes();
+    cache = std::make_shared<const SyncState::HaveCache>(SyncState::HaveCache{
+        .our_heads = our_heads,
+        .shared_heads = sync_state.shared_heads_,
+        .history_size = history.size(),
+        .shared_heads_known = std::ranges::all_of(sync_state.shared_heads_,
+            [&](const auto& h) { return state.has_change_hash(h); }),
+        .changes_since = std::move(changes_since),
+        .bloom_bytes = std::move(bloom_bytes),
+    });
+}
+
+auto Document::generate_sync_message(SyncState& sync_state) const
+    -> std::optional<SyncMessage> {
+    auto guard = read_guard();
+    auto change_indices = std::vector<std::size_t>{};
+    auto message = generate_sync_message_unlocked(sync_state, change_indices);
+    if (message) {
+        for (auto i : change_indices) message->changes.push_back(state_->change_history[i]);
+    }
+    return message;
+}
+
+// The change chunk for change_history[i], encoded on first use and then
+// shared by every message that carries it.
+static auto encoded_change_chunk(const detail::DocState& state, std::size_t i)
+    -> std::shared_ptr<const std::vector<std::byte>> {
+    auto& cache = state.encoded_changes_;
+    {
+        auto lock = std::scoped_lock{cache.mutex};
+        if (i < cache.chunks.size() && cache.chunks[i]) return cache.chunks[i];
+    }
+    auto chunk = std::make_shared<std::vector<std::byte>>();
+    storage::write_change_chunk(state.change_history[i], *chunk);
+    auto lock = std::scoped_lock{cache.mutex};
+    if (cache.chunks.size() <= i) cache.chunks.resize(state.change_history.size());
+    if (!cache.chunks[i]) cache.chunks[i] = std::move(chunk);
+    return cache.chunks[i];
+}
+
+// The wire bytes of message, whose changes are change_history[change_indices].
+static auto encode_sync_message(const detail::DocState& state, const SyncMessage& message,
+                                const std::vector<std::size_t>& change_indices)
+    -> std::vector<std::byte> {
+    auto s = storage::Serializer{};
+    write_sync_message_fields(s, message);
+    s.write_uleb128(change_indices.size());
+    for (auto i : change_indices) {
+        auto chunk = encoded_change_chunk(state, i);
+        s.write_uleb128(chunk->size());
+        s.write_bytes(*chunk);
+    }
+    return s.take();
+}
+
+auto Document::generate_sync_message_encoded(SyncState& sync_state) const
+    -> std::optional<std::vector<std::byte>> {
+    auto guard = read_guard();
+    auto change_indices = std::vector<std::size_t>{};
+    auto message = generate_sync_message_unlocked(sync_state, change_indices);
+    if (!message) return std::nullopt;
+    return encode_sync_message(*state_, *message, change_indices);
+}
+
+// Peers are only handled on the pool above this count.
+static constexpr auto parallel_sync_min_peers = std::size_t{8};
+
+auto Document::generate_sync_messages(std::span<SyncState* const> sync_states) const
+    -> std::vector<std::optional<SyncMessage>> {
+    auto guard = read_guard();
+    auto messages = std::vector<std::optional<SyncMessage>>(sync_states.size());
+    generate_for_peers(sync_states, [&](std::size_t start, std::size_t end) {
+        auto change_indices = std::vector<std::size_t>{};
+        for (auto i = start; i < end; ++i) {
+            messages[i] = generate_sync_message_unlocked(*sync_states[i], change_indices);
+            if (!messages[i]) continue;
+            for (auto c : change_indices) {
+                messages[i]->changes.push_back(state_->change_history[c]);
             }
         }
-    }
+    });
+    return messages;
+}
 
-    // Build result: explicitly needed first, then our additions in document order
-    auto result = std::vector<ChangeHash>{};
-    for (const auto& h : their_need) {
-        if (!hashes_to_send.contains(h)) {
-            result.push_back(h);
+auto Document::generate_sync_messages_encoded(std::span<SyncState* const> sync_states) const
+    -> std::vector<std::optional<std::vector<std::byte>>> {
+    auto guard = read_guard();
+    auto messages = std::vector<std::optional<std::vector<std::byte>>>(sync_states.size());
+    generate_for_peers(sync_states, [&](std::size_t start, std::size_t end) {
+        auto change_indices = std::vector<std::size_t>{};
+        for (auto i = start; i < end; ++i) {
+            auto message = generate_sync_message_unlocked(*sync_states[i], change_indices);
+            if (message) messages[i] = encode_sync_message(*state_, *message, change_indices);
         }
-    }
-    for (const auto& h : hashes) {
-        if (hashes_to_send.contains(h)) {
-            result.push_back(h);
+    });
+    return messages;
+}
+
+void Document::generate_for_peers(
+    std::span<SyncState* const> sync_states,
+    const std::function<void(std::size_t, std::size_t)>& generate) const {
+    state_->ensure_dag_index();  // per-peer work below only reads the DAG and hash index
+
+    // One "have" summary per distinct set of shared heads
+    auto summaries = std::map<std::vector<ChangeHash>, std::shared_ptr<const SyncState::HaveCache>>{};
+    for (auto* sync_state : sync_states) {
+        auto& summary = summaries[sync_state->shared_heads_];
+        if (summary) {
+            sync_state->have_cache_ = summary;
+        } else {
+            update_have_cache(*state_, *sync_state);
+            summary = sync_state->have_cache_;
         }
     }
-    return result;
+
+    if (pool_ && sync_states.size() >= parallel_sync_min_peers) {
+        pool_->parallelize_loop(std::size_t{0}, sync_states.size(), generate);
+    } else {
+        generate(0, sync_states.size());
+    }
 }
 
-auto Document::generate_sync_message(SyncState& sync_state) const
-    -> std::optional<SyncMessage> {
-    auto guard = read_guard();
+// Heads are a set; their order depends on the order changes arrived in.
+static auto same_heads(std::vector<ChangeHash> a, std::vector<ChangeHash> b) -> bool {
+    if (a.size() != b.size()) return false;
+    std::ranges::sort(a);
+    std::ranges::sort(b);
+    return a == b;
+}
 
+auto Document::generate_sync_message_unlocked(SyncState& sync_state,
+                                              std::vector<std::size_t>& change_indices) const
+    -> std::optional<SyncMessage> {
+    AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::sync_generate);
     auto our_heads = state_->heads;
 
-    // Determine what we need from them
-    auto our_need = std::vector<ChangeHash>{};
-    if (sync_state.their_heads_) {
-        our_need = state_->get_missing_deps(*sync_state.their_heads_);
-    }
+    // Determine what we need from them: their heads we lack, and the deps
+    // our queued changes wait on
+    auto our_need = state_->get_missing_deps(
+        sync_state.their_heads_ ? *sync_state.their_heads_ : std::vector<ChangeHash>{});
 
     // Build our "have" bloom filter
     auto our_have = std::vector<Have>{};
-    auto their_heads_set = std::set<ChangeHash>{};
+    auto their_heads_set = std::unordered_set<ChangeHash>{};
     if (sync_state.their_heads_) {
         their_heads_set.insert(sync_state.their_heads_->begin(),
                                sync_state.their_heads_->end());
@@ -776,51 +1752,53 @@ auto Document::generate_sync_message(SyncState& sync_state) const
         [&](const auto& h) { return their_heads_set.contains(h); });
 
     if (all_needs_in_their_heads) {
-        auto changes_since = state_->get_changes_since(sync_state.shared_heads_);
-        auto bloom_hashes = std::vector<ChangeHash>{};
-        for (const auto& h : changes_since) {
-            bloom_hashes.push_back(h);
-        }
-        auto bloom = sync::BloomFilter::from_hashes(bloom_hashes);
+        update_have_cache(*state_, sync_state);
         our_have.push_back(Have{
             .last_sync = sync_state.shared_heads_,
-            .bloom_bytes = bloom.to_bytes(),
+            .bloom_bytes = sync_state.have_cache_->bloom_bytes,
         });
     }
 
-    // Determine changes to send
-    auto changes_to_send = std::vector<Change>{};
+    // Determine changes to send (as change_history indices)
+    change_indices.clear();
     if (sync_state.their_have_ && sync_state.their_need_) {
         auto hashes = get_hashes_to_send(*state_,
             *sync_state.their_have_, *sync_state.their_need_);
 
-        // Deduplicate with sent_hashes
-        auto unsent = std::vector<ChangeHash>{};
+        // Unsent changes, in order, up to the message budget (at least one
+        // change, so an oversized change still goes). The rest stay unsent
+        // for the next message.
+        const auto& hash_idx = state_->hash_index();
+        const auto max_changes = sync_state.max_changes_per_message_;
+        const auto max_bytes = sync_state.max_bytes_per_message_;
+        auto bytes = std::size_t{0};
         for (const auto& h : hashes) {
-            if (!sync_state.sent_hashes_.contains(h)) {
-                unsent.push_back(h);
+            if (sync_state.sent_hashes_.contains(h)) continue;
+            auto it = hash_idx.find(h);
+            if (it != hash_idx.end()) {
+                if (max_changes != 0 && change_indices.size() >= max_changes) break;
+                if (max_bytes != 0) {
+                    auto size = encoded_change_chunk(*state_, it->second)->size();
+                    if (!change_indices.empty() && bytes + size > max_bytes) break;
+                    bytes += size;
+                }
+                change_indices.push_back(it->second);
             }
-        }
-
-        changes_to_send = state_->get_changes_by_hash(unsent);
-
-        // Track what we're sending
-        for (const auto& h : unsent) {
-            sync_state.sent_hashes_.insert(h);
+            sync_state.sent_hashes_.insert(h);  // track what we're sending
         }
     }
 
     // Should we send a message?
     auto heads_unchanged = (sync_state.last_sent_heads_ == our_heads);
     auto heads_equal = (sync_state.their_heads_.has_value() &&
-                        *sync_state.their_heads_ == our_heads);
+                        same_heads(*sync_state.their_heads_, our_heads));
 
     if (heads_unchanged && sync_state.have_responded_) {
-        if (heads_equal && changes_to_send.empty()) {
+        if (heads_equal && change_indices.empty()) {
             return std::nullopt;  // fully synced
         }
-        if (sync_state.in_flight_) {
-            return std::nullopt;  // waiting for ack
+        if (sync_state.in_flight_ && change_indices.empty()) {
+            return std::nullopt;  // waiting for ack; budgeted catch-ups keep streaming
         }
     }
 
@@ -833,64 +1811,68 @@ auto Document::generate_sync_message(SyncState& sync_state) const
         .heads = std::move(our_heads),
         .need = std::move(our_need),
         .have = std::move(our_have),
-        .changes = std::move(changes_to_send),
+        .changes = {},
     };
 }
 
 void Document::receive_sync_message(SyncState& sync_state,
                                      const SyncMessage& message) {
-    auto lock = std::unique_lock{mutex_};
+    receive_sync_message_impl(sync_state, message, nullptr);
+}
 
+void Document::receive_sync_messages(SyncState& sync_state,
+                                     std::span<const SyncMessage> messages) {
+    if (messages.empty()) return;
+    auto lock = WriteGuard{*this};
+    materialize();
+    for (const auto& message : messages) {
+        receive_sync_message_locked(sync_state, message, nullptr);
+    }
+}
+
+void Document::receive_sync_message_impl(SyncState& sync_state, const SyncMessage& message,
+                                         std::vector<Patch>* patches) {
+    auto lock = WriteGuard{*this};
+    materialize();
+    receive_sync_message_locked(sync_state, message, patches);
+}
+
+void Document::receive_sync_message_locked(SyncState& sync_state, const SyncMessage& message,
+                                           std::vector<Patch>* patches) {
+    AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::sync_receive);
     // Clear in-flight flag (ack)
     sync_state.in_flight_ = false;
 
-    // Apply changes from message inline (avoid recursive lock)
+    // Apply changes from message inline (avoid recursive lock). They go
+    // through the pending queue like apply_changes: changes we already have
+    // (another peer sent them first) are skipped, and one that arrives
+    // before its deps is held until they do.
     if (!message.changes.empty()) {
-        for (const auto& change : message.changes) {
-            for (const auto& op : change.operations) {
-                state_->apply_op(op);
-            }
-            auto& seq = state_->clock[change.actor];
-            seq = std::max(seq, change.seq);
-            auto hash = detail::DocState::compute_change_hash(change);
-            for (const auto& dep : change.deps) {
-                std::erase(state_->heads, dep);
-            }
-            state_->heads.push_back(hash);
-            state_->change_history.push_back(change);
+        auto hashes = detail::DocState::compute_change_hashes(message.changes);
+        auto ready = state_->take_ready_changes(message.changes, hashes);
+        if (!ready.empty()) {
+            apply_ready_changes(*state_, ready, pool_.get(), patches);
+            // Advance shared_heads: keep new heads that appeared
+            sync_state.shared_heads_ = state_->heads;
         }
-
-        // Advance shared_heads: keep new heads that appeared
-        auto after_heads = state_->heads;
-        sync_state.shared_heads_ = after_heads;
     }
 
-    // Trim sent_hashes: remove ancestors of their acknowledged heads
-    if (!message.heads.empty()) {
+    // Trim sent_hashes: remove ancestors of their acknowledged heads. Only
+    // changes down to the oldest sent one are walked.
+    if (!message.heads.empty() && !sync_state.sent_hashes_.empty()) {
         const auto& hash_idx = state_->hash_index();
-        auto ancestors = std::set<ChangeHash>{};
-        auto queue = std::vector<ChangeHash>{};
-
-        for (const auto& h : message.heads) {
-            if (hash_idx.contains(h)) {
-                ancestors.insert(h);
-                queue.push_back(h);
-            }
-        }
-        while (!queue.empty()) {
-            auto h = queue.back();
-            queue.pop_back();
+        auto sent = std::vector<ChangeHash>{};
+        auto sent_indices = std::vector<std::size_t>{};
+        for (const auto& h : sync_state.sent_hashes_) {
             auto it = hash_idx.find(h);
             if (it == hash_idx.end()) continue;
-            for (const auto& dep : state_->change_history[it->second].deps) {
-                if (ancestors.insert(dep).second) {
-                    queue.push_back(dep);
-                }
-            }
+            sent.push_back(h);
+            sent_indices.push_back(it->second);
+        }
+        auto acked = state_->ancestors_among(message.heads, sent_indices);
+        for (std::size_t k = 0; k < sent.size(); ++k) {
+            if (acked[k]) sync_state.sent_hashes_.erase(sent[k]);
         }
-
-        std::erase_if(sync_state.sent_hashes_,
-            [&](const auto& h) { return ancestors.contains(h); });
     }
 
     // Update shared_heads based on what we now know they have
@@ -925,6 +1907,186 @@ void Document::receive_sync_message(SyncState& sync_state,
     sync_state.their_need_ = message.need;
 }
 
+// -- Tombstone compaction -----------------------------------------------------
+
+auto Document::compact(const std::vector<ChangeHash>& stable_heads) -> std::size_t {
+    auto lock = WriteGuard{*this};
+    materialize();
+    return state_->compact_tombstones(stable_heads);
+}
+
+// -- Statistics ---------------------------------------------------------------
+
+auto ObjectStats::operator+=(const ObjectStats& other) -> ObjectStats& {
+    objects += other.objects;
+    map_entries += other.map_entries;
+    conflicts += other.conflicts;
+    list_elements += other.list_elements;
+    tombstones += other.tombstones;
+    marks += other.marks;
+    heap_bytes += other.heap_bytes;
+    return *this;
+}
+
+auto DocumentMemoryStats::total() const -> std::size_t {
+    return objects + strings + change_history + hash_index + change_dag + actor_table
+         + encoded_changes + history_cache + pending_changes + pending_load;
+}
+
+auto DocumentStats::objects() const -> ObjectStats {
+    auto total = maps;
+    total += tables;
+    total += lists;
+    total += texts;
+    return total;
+}
+
+// Heap bytes of a string beyond its inline buffer.
+static auto string_heap(const std::string& s) -> std::size_t {
+    return s.capacity() > std::string{}.capacity() ? s.capacity() + 1 : 0;
+}
+
+static auto value_heap(const Value& value) -> std::size_t {
+    const auto* scalar = std::get_if<ScalarValue>(&value);
+    if (!scalar) return 0;
+    if (const auto* str = std::get_if<std::string>(scalar)) return string_heap(*str);
+    if (const auto* bytes = std::get_if<Bytes>(scalar)) return bytes->capacity();
+    return 0;
+}
+
+// Rough heap bytes of a node-based hash container: buckets, plus a node of
+// the value and a next pointer (and cached hash) per element.
+template <typename Container>
+static auto hashed_heap(const Container& c) -> std::size_t {
+    return c.bucket_count() * sizeof(void*)
+         + c.size() * (sizeof(typename Container::value_type) + 2 * sizeof(void*));
+}
+
+// shared_ptr control block allocated with the object (make_shared).
+static constexpr auto control_block_bytes = 2 * sizeof(long);
+
+static auto stats_of(const detail::ObjectState& obj) -> ObjectStats {
+    auto result = ObjectStats{.objects = 1};
+    result.heap_bytes = sizeof(detail::ObjectState) + control_block_bytes
+                      + string_heap(obj.parent_key);
+    switch (obj.type) {
+        case ObjType::map:
+        case ObjType::table:
+            result.map_entries = obj.map_entries.size();
+            obj.map_entries.for_each([&](std::string_view, const auto& values) {
+                if (values.conflicted()) ++result.conflicts;
+            });
+            result.heap_bytes += obj.map_entries.memory_usage();
+            break;
+        case ObjType::list:
+        case ObjType::text:
+            result.list_elements = obj.list_elements.visible_size();
+            result.tombstones = obj.list_elements.size() - obj.list_elements.visible_size();
+            result.heap_bytes += obj.list_elements.memory_usage();
+            break;
+    }
+    result.marks = obj.marks.size();
+    result.heap_bytes += obj.marks.capacity() * sizeof(detail::MarkEntry);
+    for (const auto& mark : obj.marks) result.heap_bytes += value_heap(Value{mark.value});
+    return result;
+}
+
+auto Document::stats() const -> DocumentStats {
+    // Not read_guard(): a lazily loaded document is reported as it is.
+    auto guard = ReadGuard{mutex_, read_locking_};
+    const auto& state = *state_;
+    auto result = DocumentStats{};
+    auto& memory = result.memory;
+
+    if (state.pending_load_.pending.load(std::memory_order_acquire)) {
+        result.decoded = false;
+        result.heads = state.heads.size();
+        result.actors = state.clock.size();
+        memory.pending_load = state.pending_load_.bytes->size();
+        return result;
+    }
+
+    // Objects
+    memory.objects = state.objects.memory_usage();
+    state.objects.for_each([&](const ObjId&, const std::shared_ptr<detail::ObjectState>& obj) {
+        auto obj_stats = stats_of(*obj);
+        memory.objects += obj_stats.heap_bytes;
+        switch (obj->type) {
+            case ObjType::map: result.maps += obj_stats; break;
+            case ObjType::table: result.tables += obj_stats; break;
+            case ObjType::list: result.lists += obj_stats; break;
+            case ObjType::text: result.texts += obj_stats; break;
+        }
+    });
+    memory.strings = state.strings->memory_usage();
+
+    // Change history
+    const auto& history = state.change_history;
+    result.changes = history.size();
+    result.ops = history.op_count();
+    result.heads = state.heads.size();
+    result.actors = state.clock.size();
+    memory.change_history = (history.size() / detail::ChangeLog::segment_capacity + 1)
+        * detail::ChangeLog::segment_capacity * (sizeof(detail::ChangeLog::Entry) + sizeof(ChangeHash));
+    for (const auto& change : history) {
+        memory.change_history += sizeof(Change) + control_block_bytes
+            + change.deps.capacity() * sizeof(ChangeHash)
+            + change.operations.capacity() * sizeof(Op)
+            + (change.message ? string_heap(*change.message) : 0);
+        for (const auto& op : change.operations) {
+            memory.change_history += op.pred.capacity() * sizeof(OpId) + value_heap(op.value);
+            if (const auto* key = std::get_if<std::string>(&op.key)) {
+                memory.change_history += string_heap(*key);
+            }
+        }
+    }
+
+    // Caches
+    {
+        auto& indexes = state.indexes_;
+        auto lock = std::scoped_lock{indexes.mutex};
+        result.hash_index_entries = indexes.hash_index.size();
+        memory.hash_index = hashed_heap(indexes.hash_index);
+        const auto& dag = indexes.dag;
+        memory.change_dag = (dag.dep_start.capacity() + dag.deps.capacity()
+                             + dag.generation.capacity()) * sizeof(std::size_t)
+                          + hashed_heap(dag.unresolved);
+        memory.actor_table = indexes.actor_table.capacity() * sizeof(ActorId)
+                           + hashed_heap(indexes.actor_index);
+    }
+    {
+        auto& cache = state.encoded_changes_;
+        auto lock = std::scoped_lock{cache.mutex};
+        memory.encoded_changes = cache.chunks.capacity() * sizeof(cache.chunks[0]);
+        for (const auto& chunk : cache.chunks) {
+            if (chunk) memory.encoded_changes += sizeof(*chunk) + control_block_bytes + chunk->capacity();
+        }
+    }
+    {
+        auto& cache = state.history_cache_;
+        auto lock = std::scoped_lock{cache.mutex};
+        memory.history_cache = cache.snapshots.capacity() * sizeof(cache.snapshots[0])
+                             + cache.checkpoints.capacity() * sizeof(cache.checkpoints[0]);
+        for (const auto& snapshot : cache.snapshots) {
+            memory.history_cache += snapshot.indices.capacity() * sizeof(std::size_t);
+        }
+    }
+    const auto& pending = state.pending_changes_;
+    result.pending_changes = pending.changes.size();
+    memory.pending_changes = hashed_heap(pending.changes) + hashed_heap(pending.waiting);
+    for (const auto& [hash, entry] : pending.changes) {
+        memory.pending_changes += entry.change.operations.capacity() * sizeof(Op);
+    }
+    return result;
+}
+
+auto Document::object_stats(const ObjId& obj) const -> std::optional<ObjectStats> {
+    auto guard = read_guard();
+    const auto* found = state_->objects.find(obj);
+    if (!found) return std::nullopt;
+    return stats_of(**found);
+}
+
 // -- Phase 6: Patches ---------------------------------------------------------
 
 // Convert a sequence of ops (from a transaction) into patches.
@@ -1047,7 +2209,8 @@ static auto ops_to_patches(const std::vector<Op>& ops) -> std::vector<Patch> {
 
 auto Document::transact_with_patches(const std::function<void(Transaction&)>& fn)
     -> std::vector<Patch> {
-    auto lock = std::unique_lock{mutex_};
+    auto lock = WriteGuard{*this};
+    materialize();
     auto tx = Transaction{*state_};
     fn(tx);
 
@@ -1055,7 +2218,29 @@ auto Document::transact_with_patches(const std::function<void(Transaction&)>& fn
     auto ops = tx.pending_ops_;
     tx.commit();
 
-    return ops_to_patches(ops);
+    return ops_to_patches_internal(ops);
+}
+
+auto Document::apply_changes_with_patches(const std::vector<Change>& changes)
+    -> std::vector<Patch> {
+    auto patches = std::vector<Patch>{};
+    apply_changes_impl(changes, &patches);
+    return patches;
+}
+
+auto Document::merge_with_patches(const Document& other) -> std::vector<Patch> {
+    const Document* others[] = {&other};
+    auto patches = std::vector<Patch>{};
+    merge_all_impl(others, &patches);
+    return patches;
+}
+
+auto Document::receive_sync_message_with_patches(SyncState& sync_state,
+                                                 const SyncMessage& message)
+    -> std::vector<Patch> {
+    auto patches = std::vector<Patch>{};
+    receive_sync_message_impl(sync_state, message, &patches);
+    return patches;
 }
 
 // -- Phase 6: Historical reads ------------------------------------------------
@@ -1063,37 +2248,37 @@ auto Document::transact_with_patches(const std::function<void(Transaction&)>& fn
 auto Document::get_at(const ObjId& obj, std::string_view key,
                       const std::vector<ChangeHash>& heads) const -> std::optional<Value> {
     auto guard = read_guard();
-    auto snapshot = state_->rebuild_state_at(heads);
-    return snapshot.map_get(obj, std::string{key});
+    auto snapshot = state_->state_at(heads);
+    return snapshot->map_get(obj, key);
 }
 
 auto Document::get_at(const ObjId& obj, std::size_t index,
                       const std::vector<ChangeHash>& heads) const -> std::optional<Value> {
     auto guard = read_guard();
-    auto snapshot = state_->rebuild_state_at(heads);
-    return snapshot.list_get(obj, index);
+    auto snapshot = state_->state_at(heads);
+    return snapshot->list_get(obj, index);
 }
 
 auto Document::keys_at(const ObjId& obj,
                        const std::vector<ChangeHash>& heads) const -> std::vector<std::string> {
     auto guard = read_guard();
-    auto snapshot = state_->rebuild_state_at(heads);
-    return snapshot.map_keys(obj);
+    auto snapshot = state_->state_at(heads);
+    return snapshot->map_keys(obj);
 }
 
 auto Document::values_at(const ObjId& obj,
                          const std::vector<ChangeHash>& heads) const -> std::vector<Value> {
     auto guard = read_guard();
-    auto snapshot = state_->rebuild_state_at(heads);
-    auto type = snapshot.object_type(obj);
+    auto snapshot = state_->state_at(heads);
+    auto type = snapshot->object_type(obj);
     if (!type) return {};
     switch (*type) {
         case ObjType::map:
         case ObjType::table:
-            return snapshot.map_values(obj);
+            return snapshot->map_values(obj);
         case ObjType::list:
         case ObjType::text:
-            return snapshot.list_values(obj);
+            return snapshot->list_values(obj);
     }
     return {};
 }
@@ -1101,35 +2286,102 @@ auto Document::values_at(const ObjId& obj,
 auto Document::length_at(const ObjId& obj,
                          const std::vector<ChangeHash>& heads) const -> std::size_t {
     auto guard = read_guard();
-    auto snapshot = state_->rebuild_state_at(heads);
-    return snapshot.object_length(obj);
+    auto snapshot = state_->state_at(heads);
+    return snapshot->object_length(obj);
 }
 
 auto Document::text_at(const ObjId& obj,
                        const std::vector<ChangeHash>& heads) const -> std::string {
     auto guard = read_guard();
-    auto snapshot = state_->rebuild_state_at(heads);
-    return snapshot.text_content(obj);
+    auto snapshot = state_->state_at(heads);
+    return snapshot->text_content(obj);
+}
+
+auto Document::view_at(const std::vector<ChangeHash>& heads) const -> Document {
+    auto guard = read_guard();
+    auto indices = state_->changes_visible_at(heads);
+    auto snapshot = state_->state_at(indices);
+
+    auto view = Document{pool_};
+    auto& view_state = *view.state_;
+    view_state.objects = snapshot->objects;
+    view_state.next_counter = snapshot->next_counter;
+    view_state.actor = forked_actor(state_->actor);
+
+    // History: exactly the visible changes; heads are those no other
+    // visible change depends on.
+    auto depended_on = std::unordered_set<ChangeHash>{};
+    for (auto idx : indices) {
+        const auto& change = state_->change_history[idx];
+        view_state.change_history.push_back(state_->change_history.entry(idx),
+                                            state_->change_history.hash(idx));
+        auto& seq = view_state.clock[change.actor];
+        seq = std::max(seq, change.seq);
+        depended_on.insert(change.deps.begin(), change.deps.end());
+    }
+    for (auto idx : indices) {
+        const auto& hash = state_->change_history.hash(idx);
+        if (!depended_on.contains(hash)) view_state.heads.push_back(hash);
+    }
+    return view;
 }
 
 // -- Phase 6: Cursors ---------------------------------------------------------
 
 auto Document::cursor(const ObjId& obj, std::size_t index) const
     -> std::optional<Cursor> {
-    auto guard = read_guard();
-    auto id = state_->list_element_id_at(obj, index);
+    auto guard = snapshot_guard();
+    auto id = guard.state->list_element_id_at(obj, index);
     if (!id) return std::nullopt;
     return Cursor{*id};
 }
 
 auto Document::resolve_cursor(const ObjId& obj, const Cursor& cur) const
     -> std::optional<std::size_t> {
-    auto guard = read_guard();
-    return state_->find_element_visible_index(obj, cur.position);
+    auto guard = snapshot_guard();
+    return guard.state->find_element_visible_index(obj, cur.position);
+}
+
+auto Document::cursors(const ObjId& obj, std::span<const std::size_t> indices) const
+    -> std::vector<std::optional<Cursor>> {
+    auto guard = snapshot_guard();
+    auto result = std::vector<std::optional<Cursor>>(indices.size());
+    const auto* state = guard.state->get_object(obj);
+    if (!state) return result;
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        if (auto id = detail::DocState::visible_element_id(*state, indices[i])) {
+            result[i] = Cursor{*id};
+        }
+    }
+    return result;
+}
+
+auto Document::resolve_cursors(const ObjId& obj, std::span<const Cursor> cursors) const
+    -> std::vector<std::optional<std::size_t>> {
+    auto guard = snapshot_guard();
+    auto result = std::vector<std::optional<std::size_t>>(cursors.size());
+    const auto* state = guard.state->get_object(obj);
+    if (!state) return result;
+    for (std::size_t i = 0; i < cursors.size(); ++i) {
+        result[i] = detail::DocState::element_visible_index(*state, cursors[i].position);
+    }
+    return result;
 }
 
 // -- Rich text marks ----------------------------------------------------------
 
+static auto to_mark(const detail::DocState& state, const detail::ObjectState& obj_state,
+                    const detail::MarkEntry& entry) -> std::optional<Mark> {
+    auto indices = state.resolve_mark_indices(obj_state, entry);
+    if (!indices) return std::nullopt;
+    return Mark{
+        .start = indices->first,
+        .end = indices->second,
+        .name = std::string{entry.name.view()},
+        .value = entry.value,
+    };
+}
+
 static auto collect_marks(const detail::DocState& state, const ObjId& obj)
     -> std::vector<Mark> {
     const auto* obj_state = state.get_object(obj);
@@ -1137,67 +2389,78 @@ static auto collect_marks(const detail::DocState& state, const ObjId& obj)
 
     auto result = std::vector<Mark>{};
     for (const auto& entry : obj_state->marks) {
-        auto indices = state.resolve_mark_indices(*obj_state, entry);
-        if (!indices) continue;
-        auto [start, end] = *indices;
-        result.push_back(Mark{
-            .start = start,
-            .end = end,
-            .name = entry.name,
-            .value = entry.value,
-        });
+        if (auto mark = to_mark(state, *obj_state, entry)) result.push_back(std::move(*mark));
     }
     return result;
 }
 
 auto Document::marks(const ObjId& obj) const -> std::vector<Mark> {
-    auto guard = read_guard();
-    return collect_marks(*state_, obj);
+    auto guard = snapshot_guard();
+    return collect_marks(*guard.state, obj);
+}
+
+auto Document::marks(const ObjId& obj, std::size_t start, std::size_t end) const
+    -> std::vector<Mark> {
+    auto guard = snapshot_guard();
+    const auto* obj_state = guard.state->get_object(obj);
+    if (!obj_state) return {};
+
+    auto result = std::vector<Mark>{};
+    for (auto i : guard.state->marks_overlapping(*obj_state, start, end)) {
+        if (auto mark = to_mark(*guard.state, *obj_state, obj_state->marks[i])) {
+            result.push_back(std::move(*mark));
+        }
+    }
+    return result;
 }
 
 auto Document::marks_at(const ObjId& obj,
                         const std::vector<ChangeHash>& heads) const -> std::vector<Mark> {
     auto guard = read_guard();
-    auto snapshot = state_->rebuild_state_at(heads);
-    return collect_marks(snapshot, obj);
+    auto snapshot = state_->state_at(heads);
+    return collect_marks(*snapshot, obj);
 }
 
 // -- Phase 12A: Modern API helpers --------------------------------------------
 
-auto Document::ops_to_patches_internal(const std::vector<Op>& ops) -> std::vector<Patch> {
-    return ops_to_patches(ops);
+auto Document::ops_to_patches_internal(const std::vector<Op>& ops) const -> std::vector<Patch> {
+    auto patches = ops_to_patches(ops);
+    auto path_obj = std::optional<ObjId>{};
+    auto path = Path{};
+    for (auto& patch : patches) {
+        if (path_obj != patch.obj) {
+            path = state_->path_of(patch.obj).value_or(Path{});
+            path_obj = patch.obj;
+        }
+        patch.path = path;
+    }
+    return patches;
+}
+
+auto Document::path_of(const ObjId& obj) const -> std::optional<Path> {
+    auto guard = snapshot_guard();
+    return guard.state->path_of(obj);
 }
 
 auto Document::get_path_impl(std::span<const Prop> path) const -> std::optional<Value> {
-    auto guard = read_guard();
+    auto guard = snapshot_guard();
     if (path.empty()) return std::nullopt;
 
     auto current_obj = root;
 
     // Walk all but the last path element to resolve intermediate ObjIds.
+    // get_obj_id_at finds the winning value once and fails on missing keys,
+    // out-of-range indices and scalars, so each step is a single lookup.
     for (std::size_t i = 0; i + 1 < path.size(); ++i) {
-        auto val = std::visit(overload{
-            [&](const std::string& key) { return state_->map_get(current_obj, key); },
-            [&](std::size_t index) { return state_->list_get(current_obj, index); },
-        }, path[i]);
-
-        if (!val) return std::nullopt;
-
-        // The value must be an ObjType to continue navigating.
-        if (!is_object(*val)) return std::nullopt;
-
-        // We need the ObjId, not the ObjType. For intermediate objects,
-        // the ObjId is the OpId that created them. We look it up via
-        // the internal state's object-at-key resolution.
-        auto obj_id = state_->get_obj_id_at(current_obj, path[i]);
+        auto obj_id = guard.state->get_obj_id_at(current_obj, path[i]);
         if (!obj_id) return std::nullopt;
         current_obj = *obj_id;
     }
 
     // Final element: return the value.
     return std::visit(overload{
-        [&](const std::string& key) { return state_->map_get(current_obj, key); },
-        [&](std::size_t index) { return state_->list_get(current_obj, index); },
+        [&](const std::string& key) { return guard.state->map_get(current_obj, key); },
+        [&](std::size_t index) { return guard.state->list_get(current_obj, index); },
     }, path.back());
 }
 
@@ -0,0 +1,248 @@
+#include <automerge-cpp/document_store.hpp>
+
+#include "doc_state.hpp"
+
+#include <utility>
+
+namespace automerge_cpp {
+
+void DocumentBackend::append(const std::string& id, std::span<const std::byte> bytes) {
+    auto stored = fetch(id).value_or(std::vector<std::byte>{});
+    stored.insert(stored.end(), bytes.begin(), bytes.end());
+    store(id, std::move(stored));
+}
+
+namespace {
+
+// The default backend: saved bytes in a map.
+class MemoryBackend final : public DocumentBackend {
+public:
+    void store(const std::string& id, std::vector<std::byte> bytes) override {
+        bytes_[id] = std::move(bytes);
+    }
+
+    void append(const std::string& id, std::span<const std::byte> bytes) override {
+        auto& stored = bytes_[id];
+        stored.insert(stored.end(), bytes.begin(), bytes.end());
+    }
+
+    auto fetch(const std::string& id) -> std::optional<std::vector<std::byte>> override {
+        auto it = bytes_.find(id);
+        if (it == bytes_.end()) return std::nullopt;
+        return it->second;
+    }
+
+    void remove(const std::string& id) override { bytes_.erase(id); }
+
+private:
+    std::unordered_map<std::string, std::vector<std::byte>> bytes_;
+};
+
+// Rough heap cost of a document, and per change, op and object once
+// materialized, fitted to Document::stats() (within about 25% for typing,
+// map updates and nested objects; op values and text runs vary it most).
+constexpr auto bytes_per_document = std::size_t{12} << 10;
+constexpr auto bytes_per_change = std::size_t{128};
+constexpr auto bytes_per_op = std::size_t{320};
+constexpr auto bytes_per_object = std::size_t{1024};
+
+}  // namespace
+
+DocumentStore::DocumentStore(DocumentStoreOptions options) : options_{std::move(options)} {
+    if (!options_.backend) options_.backend = std::make_shared<MemoryBackend>();
+}
+
+DocumentStore::~DocumentStore() = default;
+
+auto DocumentStore::create(const std::string& id) -> std::shared_ptr<Document> {
+    return insert(id, Document{options_.pool});
+}
+
+auto DocumentStore::insert(const std::string& id, Document doc) -> std::shared_ptr<Document> {
+    auto lock = std::scoped_lock{mutex_};
+    auto [it, inserted] = entries_.try_emplace(id);
+    if (!inserted) {
+        drop(it->second);
+        if (it->second.in_backend) options_.backend->remove(id);
+        it->second = Entry{};
+    }
+    auto result = make_resident(id, it->second, std::make_shared<Document>(std::move(doc)));
+    enforce_limits();
+    return result;
+}
+
+auto DocumentStore::open(const std::string& id) -> std::shared_ptr<Document> {
+    auto lock = std::scoped_lock{mutex_};
+    auto it = entries_.find(id);
+    if (it != entries_.end() && it->second.doc) {
+        auto& entry = it->second;
+        ++metrics_.hits;
+        lru_.splice(lru_.begin(), lru_, entry.lru);
+        resident_bytes_ -= entry.estimated_bytes;
+        entry.estimated_bytes = estimate(*entry.doc);
+        resident_bytes_ += entry.estimated_bytes;
+        auto result = entry.doc;
+        enforce_limits();
+        return result;
+    }
+
+    ++metrics_.misses;
+    auto bytes = options_.backend->fetch(id);
+    if (!bytes) return nullptr;
+    auto doc = Document::load_lazy(*bytes, options_.pool, options_.load_options);
+    if (!doc) {
+        ++metrics_.load_failures;
+        return nullptr;
+    }
+    if (it == entries_.end()) {
+        it = entries_.try_emplace(id).first;
+        it->second.in_backend = true;
+        it->second.stored_heads = doc->get_heads();
+        it->second.stored_snapshot_bytes = bytes->size();
+    }
+    auto result = make_resident(id, it->second, std::make_shared<Document>(std::move(*doc)));
+    enforce_limits();
+    return result;
+}
+
+auto DocumentStore::contains(const std::string& id) const -> bool {
+    auto lock = std::scoped_lock{mutex_};
+    return entries_.contains(id);
+}
+
+auto DocumentStore::is_resident(const std::string& id) const -> bool {
+    auto lock = std::scoped_lock{mutex_};
+    auto it = entries_.find(id);
+    return it != entries_.end() && it->second.doc != nullptr;
+}
+
+auto DocumentStore::erase(const std::string& id) -> bool {
+    auto lock = std::scoped_lock{mutex_};
+    auto it = entries_.find(id);
+    if (it == entries_.end()) return false;
+    drop(it->second);
+    if (it->second.in_backend) options_.backend->remove(id);
+    entries_.erase(it);
+    return true;
+}
+
+auto DocumentStore::evict(const std::string& id) -> bool {
+    auto lock = std::scoped_lock{mutex_};
+    auto it = entries_.find(id);
+    if (it == entries_.end() || !it->second.doc || !evictable(it->second)) return false;
+    write_back(id, it->second);
+    drop(it->second);
+    ++metrics_.evictions;
+    return true;
+}
+
+void DocumentStore::flush() {
+    auto lock = std::scoped_lock{mutex_};
+    for (const auto& id : lru_) write_back(id, entries_.at(id));
+}
+
+auto DocumentStore::metrics() const -> DocumentStoreMetrics {
+    auto lock = std::scoped_lock{mutex_};
+    auto result = metrics_;
+    result.documents = entries_.size();
+    result.resident_documents = lru_.size();
+    result.resident_bytes = resident_bytes_;
+    return result;
+}
+
+auto DocumentStore::get_thread_pool() const -> std::shared_ptr<thread_pool> {
+    return options_.pool;
+}
+
+auto DocumentStore::make_resident(const std::string& id, Entry& entry,
+                                  std::shared_ptr<Document> doc) -> std::shared_ptr<Document> {
+    lru_.push_front(id);
+    entry.lru = lru_.begin();
+    entry.estimated_bytes = estimate(*doc);
+    resident_bytes_ += entry.estimated_bytes;
+    entry.doc = std::move(doc);
+    return entry.doc;
+}
+
+// O(1): open() re-estimates on every hit, under the store's lock.
+auto DocumentStore::estimate(const Document& doc) const -> std::size_t {
+    if (options_.estimate_memory) return options_.estimate_memory(doc);
+    auto guard = Document::ReadGuard{doc.mutex_, doc.read_locking_};
+    const auto& state = *doc.state_;
+    if (const auto& pending = state.pending_load_; pending.pending.load(std::memory_order_acquire)) {
+        // Still encoded (load_lazy): size it as decoded, since any use
+        // decodes it, from the change and op counts load_lazy read. The
+        // next open() re-estimates.
+        return bytes_per_document + pending.bytes->size()
+             + state.saved_change_count * bytes_per_change + pending.op_count * bytes_per_op;
+    }
+    return bytes_per_document + state.change_history.size() * bytes_per_change
+         + state.change_history.op_count() * bytes_per_op
+         + state.objects.size() * bytes_per_object;
+}
+
+// Bring the backend up to date with a resident document: nothing if it is
+// unchanged since it was stored, its new changes if they are still smaller
+// than the stored snapshot, otherwise a full save.
+void DocumentStore::write_back(const std::string& id, Entry& entry) {
+    auto heads = entry.doc->get_heads();
+    if (entry.in_backend && heads == entry.stored_heads) return;
+
+    if (entry.in_backend) {
+        auto delta = entry.doc->save_since(entry.stored_heads, options_.save_options);
+        if (entry.stored_appended_bytes + delta.size() < entry.stored_snapshot_bytes) {
+            options_.backend->append(id, delta);
+            entry.stored_appended_bytes += delta.size();
+            entry.stored_heads = std::move(heads);
+            metrics_.bytes_written += delta.size();
+            ++metrics_.incremental_saves;
+            return;
+        }
+    }
+
+    auto bytes = entry.doc->save(options_.save_options);
+    entry.in_backend = true;
+    entry.stored_heads = std::move(heads);
+    entry.stored_snapshot_bytes = bytes.size();
+    entry.stored_appended_bytes = 0;
+    metrics_.bytes_written += bytes.size();
+    ++metrics_.full_saves;
+    options_.backend->store(id, std::move(bytes));
+}
+
+// Stop tracking a resident document (the caller has written it back or is
+// discarding it).
+void DocumentStore::drop(Entry& entry) {
+    if (!entry.doc) return;
+    lru_.erase(entry.lru);
+    resident_bytes_ -= entry.estimated_bytes;
+    entry.estimated_bytes = 0;
+    entry.doc.reset();
+}
+
+// Only the store holds it: nobody can be using it.
+auto DocumentStore::evictable(const Entry& entry) const -> bool {
+    return entry.doc.use_count() == 1;
+}
+
+// Evict least recently used documents that are not held until the limits
+// are met (or nothing more can be evicted).
+void DocumentStore::enforce_limits() {
+    auto over = [&] {
+        return (options_.max_resident != 0 && lru_.size() > options_.max_resident)
+            || (options_.memory_budget != 0 && resident_bytes_ > options_.memory_budget);
+    };
+    auto it = lru_.end();
+    while (over() && it != lru_.begin()) {
+        --it;
+        auto& entry = entries_.at(*it);
+        if (!evictable(entry)) continue;
+        auto next = std::next(it);
+        write_back(*it, entry);
+        drop(entry);  // erases it
+        ++metrics_.evictions;
+        it = next;
+    }
+}
+
+}  // namespace automerge_cpp
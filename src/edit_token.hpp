@@ -0,0 +1,65 @@
+#pragma once
+
+// Ownership of nodes shared copy-on-write between copies of a structure.
+// Internal header — not installed.
+//
+// A structure whose copies share nodes (fork, snapshot reads) tags every
+// node it creates or copies with its edit token, and changes a node in place
+// only while the node carries its current token. Copying the structure gives
+// the copy a new token and renews the source's, so from then on both copy a
+// shared node before changing it, and a node can only carry a structure's
+// current token if that structure made it since it was last copied: no other
+// copy, and no reader of one, can see it.
+//
+// Unlike asking a shared_ptr whether it is unique, this needs no
+// synchronisation with readers that drop their copy on another thread:
+// ownership is decided by the writer's own token alone.
+
+#include <atomic>
+#include <cstdint>
+
+namespace automerge_cpp::detail {
+
+class EditToken {
+public:
+    EditToken() : value_{next()} {}
+
+    // Copying freezes what both sides made so far.
+    EditToken(const EditToken& other) : value_{next()} { other.renew(); }
+    auto operator=(const EditToken& other) -> EditToken& {
+        if (this != &other) {
+            renew();
+            other.renew();
+        }
+        return *this;
+    }
+
+    // Moving hands the nodes over, so the target keeps their token.
+    EditToken(EditToken&& other) noexcept : value_{other.value()} { other.renew(); }
+    auto operator=(EditToken&& other) noexcept -> EditToken& {
+        if (this != &other) {
+            value_.store(other.value(), std::memory_order_relaxed);
+            other.renew();
+        }
+        return *this;
+    }
+
+    ~EditToken() = default;
+
+    auto value() const -> std::uint64_t { return value_.load(std::memory_order_relaxed); }
+
+    // Give up in-place changes to every node tagged so far (a copy of the
+    // structure is about to share them). Const because sharing a structure
+    // is a read of it.
+    void renew() const { value_.store(next(), std::memory_order_relaxed); }
+
+private:
+    static auto next() -> std::uint64_t {
+        static auto counter = std::atomic<std::uint64_t>{1};
+        return counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    mutable std::atomic<std::uint64_t> value_;
+};
+
+}  // namespace automerge_cpp::detail
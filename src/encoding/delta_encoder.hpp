@@ -63,6 +63,18 @@ public:
         return std::optional<std::int64_t>{absolute_};
     }
 
+    // Decode up to out.size() values into out (see RleDecoder::next_n).
+    auto next_n(std::span<std::optional<std::int64_t>> out) -> std::optional<std::size_t> {
+        auto n = rle_.next_n(out);
+        if (!n) return std::nullopt;
+        for (auto& value : out.first(*n)) {
+            if (!value) continue;  // null — don't update accumulator
+            absolute_ += *value;
+            *value = absolute_;
+        }
+        return n;
+    }
+
     auto done() const -> bool { return rle_.done(); }
 
 private:
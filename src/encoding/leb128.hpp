@@ -6,6 +6,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <optional>
 #include <span>
 #include <vector>
@@ -42,6 +43,11 @@ struct DecodeResult {
 // Decode an unsigned LEB128 value from a byte span.
 // Returns nullopt if the input is truncated (no terminating byte found).
 inline auto decode_uleb128(std::span<const std::byte> input) -> std::optional<DecodeResult> {
+    // Most column values (counts, actor indices, small deltas) fit in one byte
+    if (!input.empty() && (input[0] & std::byte{0x80}) == std::byte{0}) {
+        return DecodeResult{.value = std::to_integer<std::uint64_t>(input[0]), .bytes_read = 1};
+    }
+
     auto value = std::uint64_t{0};
     auto shift = 0u;
 
@@ -60,6 +66,36 @@ inline auto decode_uleb128(std::span<const std::byte> input) -> std::optional<De
     return std::nullopt;  // truncated input
 }
 
+// Decode out.size() consecutive unsigned LEB128 values into out.
+// Returns the number of bytes consumed, or nullopt if the input is truncated
+// or a value overflows. Runs of single-byte values (the common case in
+// column data) are recognised eight bytes at a time.
+inline auto decode_uleb128_batch(std::span<const std::byte> input,
+                                 std::span<std::uint64_t> out) -> std::optional<std::size_t> {
+    constexpr auto continuation_bits = std::uint64_t{0x8080808080808080};
+    auto pos = std::size_t{0};
+    auto n = std::size_t{0};
+    while (n < out.size()) {
+        if (out.size() - n >= 8 && input.size() - pos >= 8) {
+            auto word = std::uint64_t{0};
+            std::memcpy(&word, &input[pos], 8);
+            if ((word & continuation_bits) == 0) {
+                for (std::size_t i = 0; i < 8; ++i) {
+                    out[n + i] = std::to_integer<std::uint64_t>(input[pos + i]);
+                }
+                n += 8;
+                pos += 8;
+                continue;
+            }
+        }
+        auto r = decode_uleb128(input.subspan(pos));
+        if (!r) return std::nullopt;
+        out[n++] = r->value;
+        pos += r->bytes_read;
+    }
+    return pos;
+}
+
 // -- Signed LEB128 ------------------------------------------------------------
 
 // Encode an int64 as signed LEB128, appending bytes to output.
@@ -96,6 +132,12 @@ struct SignedDecodeResult {
 // Decode a signed LEB128 value from a byte span.
 // Returns nullopt if the input is truncated.
 inline auto decode_sleb128(std::span<const std::byte> input) -> std::optional<SignedDecodeResult> {
+    if (!input.empty() && (input[0] & std::byte{0x80}) == std::byte{0}) {
+        // One byte: 7-bit two's complement
+        auto byte = std::to_integer<std::int64_t>(input[0]);
+        return SignedDecodeResult{.value = (byte & 0x40) ? byte - 0x80 : byte, .bytes_read = 1};
+    }
+
     auto value = std::int64_t{0};
     auto shift = 0u;
 
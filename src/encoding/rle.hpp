@@ -12,11 +12,14 @@
 
 #include "leb128.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace automerge_cpp::encoding {
@@ -96,7 +99,8 @@ private:
             encode_uleb128(value, data_);
         } else if constexpr (std::is_same_v<T, std::int64_t>) {
             encode_sleb128(value, data_);
-        } else if constexpr (std::is_same_v<T, std::string>) {
+        } else if constexpr (std::is_same_v<T, std::string> ||
+                             std::is_same_v<T, std::string_view>) {
             encode_uleb128(value.size(), data_);
             for (auto c : value) {
                 data_.push_back(static_cast<std::byte>(c));
@@ -173,6 +177,53 @@ public:
         }
     }
 
+    // Decode up to out.size() values into out, filling runs and null runs
+    // in bulk. Returns the number written (fewer at end of stream), or
+    // nullopt on malformed data.
+    auto next_n(std::span<std::optional<T>> out) -> std::optional<std::size_t> {
+        auto n = std::size_t{0};
+        while (n < out.size()) {
+            auto wanted = static_cast<std::uint64_t>(out.size() - n);
+            if (null_remaining_ > 0) {
+                auto k = static_cast<std::size_t>(std::min(null_remaining_, wanted));
+                std::ranges::fill(out.subspan(n, k), std::nullopt);
+                null_remaining_ -= k;
+                n += k;
+            } else if (run_remaining_ > 0) {
+                auto k = static_cast<std::size_t>(std::min(run_remaining_, wanted));
+                std::ranges::fill(out.subspan(n, k), std::optional<T>{run_value_});
+                run_remaining_ -= k;
+                n += k;
+            } else if (literal_remaining_ > 0) {
+                if constexpr (std::is_same_v<T, std::uint64_t>) {
+                    auto values = std::array<std::uint64_t, 64>{};
+                    auto k = static_cast<std::size_t>(
+                        std::min({literal_remaining_, wanted, std::uint64_t{values.size()}}));
+                    auto used = decode_uleb128_batch(data_.subspan(pos_),
+                                                     std::span{values}.first(k));
+                    if (!used) return std::nullopt;
+                    pos_ += *used;
+                    std::ranges::copy(std::span{values}.first(k), out.begin() + n);
+                    literal_remaining_ -= k;
+                    n += k;
+                } else {
+                    --literal_remaining_;
+                    auto val = decode_value();
+                    if (!val) return std::nullopt;
+                    out[n++] = std::move(*val);
+                }
+            } else if (pos_ >= data_.size()) {
+                break;  // end of stream
+            } else {
+                // Read the next control word (and its first value)
+                auto val = next();
+                if (!val) return std::nullopt;
+                out[n++] = std::move(*val);
+            }
+        }
+        return n;
+    }
+
     auto done() const -> bool { return pos_ >= data_.size() && run_remaining_ == 0 &&
                                        literal_remaining_ == 0 && null_remaining_ == 0; }
 
@@ -188,7 +239,8 @@ private:
             if (!r) return std::nullopt;
             pos_ += r->bytes_read;
             return r->value;
-        } else if constexpr (std::is_same_v<T, std::string>) {
+        } else if constexpr (std::is_same_v<T, std::string> ||
+                             std::is_same_v<T, std::string_view>) {
             auto len_r = decode_uleb128(data_.subspan(pos_));
             if (!len_r) return std::nullopt;
             pos_ += len_r->bytes_read;
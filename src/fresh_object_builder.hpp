@@ -0,0 +1,124 @@
+#pragma once
+
+// Bulk construction of objects created earlier in the same transaction.
+// Internal header — not installed.
+//
+// A freshly created object has no history yet: none of its map keys has a
+// predecessor, and its list is only ever appended to. The builder relies on
+// that to skip the per-op lookups that Transaction::put / insert must do for
+// arbitrary objects (object lookup, map_pred, insert_after_for and visible
+// index resolution). It holds the ObjectState directly, chains each list
+// element after the previous one, and appends ops straight to the
+// transaction's pending op list.
+
+#include <automerge-cpp/op.hpp>
+#include <automerge-cpp/transaction.hpp>
+#include <automerge-cpp/types.hpp>
+#include <automerge-cpp/value.hpp>
+#include "doc_state.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace automerge_cpp::detail {
+
+class FreshObjectBuilder {
+public:
+    // An object being filled. For a list, last is the element the next
+    // append is inserted after.
+    struct Target {
+        ObjId id;
+        ObjectState* state;
+        std::optional<OpId> last;
+    };
+
+    explicit FreshObjectBuilder(Transaction& tx)
+        : state_{tx.state_}, ops_{tx.pending_ops_} {}
+
+    // Make room for n more ops in the transaction.
+    void reserve(std::size_t n) { ops_.reserve(ops_.size() + n); }
+
+    // Start filling obj, which must be an empty object created in this
+    // transaction.
+    auto open(const ObjId& obj) -> Target {
+        auto* state = state_.get_object(obj);
+        assert(state && state->map_entries.empty() && state->list_elements.empty());
+        return Target{.id = obj, .state = state, .last = std::nullopt};
+    }
+
+    // Make room for n keys in a fresh map.
+    void reserve_keys(Target& map, std::size_t n) { map.state->map_entries.reserve(n); }
+
+    // Set a key of a fresh map. Each key may be set only once.
+    void put(Target& map, std::string key, ScalarValue value) {
+        auto op_id = state_.next_op_id();
+        put_entry(map, std::move(key), op_id, Value{std::move(value)}, OpType::put);
+    }
+
+    auto put_object(Target& map, std::string key, ObjType type) -> Target {
+        auto op_id = state_.next_op_id();
+        auto child = make_child(op_id, type, map.id, key);
+        put_entry(map, std::move(key), op_id, Value{type}, OpType::make_object);
+        return child;
+    }
+
+    // Append to the end of a fresh list.
+    void append(Target& list, ScalarValue value) {
+        append_element(list, state_.next_op_id(), Value{std::move(value)});
+    }
+
+    auto append_object(Target& list, ObjType type) -> Target {
+        auto op_id = state_.next_op_id();
+        auto child = make_child(op_id, type, list.id, {});
+        append_element(list, op_id, Value{type});
+        return child;
+    }
+
+private:
+    auto make_child(OpId op_id, ObjType type, const ObjId& parent, std::string key) -> Target {
+        auto id = state_.create_object(op_id, type, parent, std::move(key));
+        return Target{.id = id, .state = state_.objects.find(id)->get(), .last = std::nullopt};
+    }
+
+    void put_entry(Target& map, std::string key, OpId op_id, Value value, OpType action) {
+        assert(map.state->type == ObjType::map || map.state->type == ObjType::table);
+        assert(!map.state->map_entries.find(key));
+        map.state->map_entries.assign(key, MapEntry{.op_id = op_id, .value = value},
+                                      *map.state->strings);
+        ops_.push_back(Op{
+            .id = op_id,
+            .obj = map.id,
+            .key = map_key(std::move(key)),
+            .action = action,
+            .value = std::move(value),
+            .pred = {},
+        });
+    }
+
+    void append_element(Target& list, OpId op_id, Value value) {
+        assert(list.state->type == ObjType::list);
+        auto index = list.state->list_elements.size();
+        list.state->list_elements.push_back(
+            ListElement{.insert_id = op_id, .insert_after = list.last,
+                        .value = value, .visible = true});
+        ops_.push_back(Op{
+            .id = op_id,
+            .obj = list.id,
+            .key = list_index(index),
+            .action = OpType::insert,
+            .value = std::move(value),
+            .pred = {},
+            .insert_after = list.last,
+        });
+        list.last = op_id;
+    }
+
+    DocState& state_;
+    std::vector<Op>& ops_;
+};
+
+}  // namespace automerge_cpp::detail
@@ -1,10 +1,16 @@
 #include <automerge-cpp/json.hpp>
 
+#include "fresh_object_builder.hpp"
+
 #include <algorithm>
 #include <array>
 #include <charconv>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -50,7 +56,7 @@ void hex_to_bytes(std::string_view hex, std::byte* out, std::size_t expected_len
 }
 
 // Base64 encode for Bytes
-auto base64_encode(const std::vector<std::byte>& data) -> std::string {
+auto base64_encode(std::span<const std::byte> data) -> std::string {
     static constexpr char table[] =
         "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
     auto result = std::string{};
@@ -434,10 +440,202 @@ auto export_object_at(const Document& doc, const ObjId& obj,
     return result;
 }
 
+// Single-pass export: Document::walk drives these visitors, so a list of
+// n elements is exported in O(n) instead of n indexed lookups.
+
+auto scalar_to_json(const ScalarValue& sv) -> nlohmann::json {
+    return std::visit(overload{
+        [](Null) -> nlohmann::json { return nullptr; },
+        [](bool b) -> nlohmann::json { return b; },
+        [](std::int64_t i) -> nlohmann::json { return i; },
+        [](std::uint64_t u) -> nlohmann::json { return u; },
+        [](double d) -> nlohmann::json { return d; },
+        [](const Counter& c) -> nlohmann::json { return c.value; },
+        [](const Timestamp& t) -> nlohmann::json { return t.millis_since_epoch; },
+        [](const std::string& s) -> nlohmann::json { return s; },
+        [](const Bytes& b) -> nlohmann::json { return base64_encode(b); },
+    }, sv);
+}
+
+// Builds a nlohmann::json tree. Open containers are kept on a stack; a
+// container's address is stable while it is open because nothing is
+// appended to its parent until it closes.
+class JsonBuilder final : public TreeVisitor {
+public:
+    void begin_map() override { stack_.push_back(place(nlohmann::json::object())); }
+    void key(std::string_view key) override { key_.assign(key); }
+    void end_map() override { stack_.pop_back(); }
+
+    void begin_list(std::size_t size) override {
+        auto* list = place(nlohmann::json::array());
+        list->get_ref<nlohmann::json::array_t&>().reserve(size);
+        stack_.push_back(list);
+    }
+    void end_list() override { stack_.pop_back(); }
+
+    void text(std::string_view text) override { place(nlohmann::json(std::string{text})); }
+    void scalar(const ScalarValue& value) override { place(scalar_to_json(value)); }
+
+    auto take() -> nlohmann::json { return std::move(result_); }
+
+private:
+    auto place(nlohmann::json value) -> nlohmann::json* {
+        if (stack_.empty()) {
+            result_ = std::move(value);
+            return &result_;
+        }
+        auto& parent = *stack_.back();
+        if (parent.is_object()) {
+            auto& slot = parent[key_];
+            slot = std::move(value);
+            return &slot;
+        }
+        parent.push_back(std::move(value));
+        return &parent.back();
+    }
+
+    nlohmann::json result_;
+    std::vector<nlohmann::json*> stack_;
+    std::string key_;
+};
+
+// Writes compact JSON text matching nlohmann::json::dump(). Output is
+// buffered and handed to the stream (if any) in blocks of flush_threshold.
+class JsonWriter final : public TreeVisitor {
+public:
+    static constexpr std::size_t flush_threshold = 64 * 1024;
+
+    explicit JsonWriter(std::ostream* out = nullptr) : out_{out} {}
+
+    void begin_map() override { separate(); buf_.push_back('{'); comma_ = false; }
+    void key(std::string_view key) override {
+        separate();
+        write_string(key);
+        buf_.push_back(':');
+        comma_ = false;
+    }
+    void end_map() override { buf_.push_back('}'); end_value(); }
+
+    void begin_list(std::size_t) override { separate(); buf_.push_back('['); comma_ = false; }
+    void end_list() override { buf_.push_back(']'); end_value(); }
+
+    void text(std::string_view text) override {
+        separate();
+        write_string(text);
+        end_value();
+    }
+
+    void scalar(const ScalarValue& value) override {
+        separate();
+        std::visit(overload{
+            [&](Null) { buf_.append("null"); },
+            [&](bool b) { buf_.append(b ? "true" : "false"); },
+            [&](std::int64_t i) { write_number(i); },
+            [&](std::uint64_t u) { write_number(u); },
+            [&](double d) { write_double(d); },
+            [&](const Counter& c) { write_number(c.value); },
+            [&](const Timestamp& t) { write_number(t.millis_since_epoch); },
+            [&](const std::string& str) { write_string(str); },
+            [&](const Bytes& b) { write_string(base64_encode(b)); },
+        }, value);
+        end_value();
+    }
+
+    /// Write whatever is buffered to the stream.
+    void flush() {
+        if (!out_ || buf_.empty()) return;
+        out_->write(buf_.data(), static_cast<std::streamsize>(buf_.size()));
+        buf_.clear();
+    }
+
+    /// Nothing was emitted (the object does not exist) -> "null".
+    auto empty() const -> bool { return !written_; }
+
+    auto take() -> std::string { return std::move(buf_); }
+
+private:
+    void separate() {
+        if (comma_) buf_.push_back(',');
+        written_ = true;
+    }
+
+    void end_value() {
+        comma_ = true;
+        if (buf_.size() >= flush_threshold) flush();
+    }
+
+    template <typename Int>
+    void write_number(Int value) {
+        auto chars = std::array<char, 24>{};
+        auto [end, ec] = std::to_chars(chars.data(), chars.data() + chars.size(), value);
+        buf_.append(chars.data(), end);
+    }
+
+    void write_double(double value) {
+        if (!std::isfinite(value)) {
+            buf_.append("null");  // as nlohmann::json::dump() does
+            return;
+        }
+        auto chars = std::array<char, 32>{};
+        auto [end, ec] = std::to_chars(chars.data(), chars.data() + chars.size(), value);
+        auto written = std::string_view{chars.data(), static_cast<std::size_t>(end - chars.data())};
+        buf_.append(written);
+        if (written.find_first_of(".eE") == std::string_view::npos) buf_.append(".0");
+    }
+
+    void write_string(std::string_view str) {
+        static constexpr char hex_chars[] = "0123456789abcdef";
+        buf_.push_back('"');
+        auto run_start = std::size_t{0};
+        for (std::size_t i = 0; i < str.size(); ++i) {
+            auto c = static_cast<unsigned char>(str[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+            buf_.append(str.substr(run_start, i - run_start));
+            run_start = i + 1;
+            switch (c) {
+                case '"':  buf_.append("\\\""); break;
+                case '\\': buf_.append("\\\\"); break;
+                case '\b': buf_.append("\\b"); break;
+                case '\f': buf_.append("\\f"); break;
+                case '\n': buf_.append("\\n"); break;
+                case '\r': buf_.append("\\r"); break;
+                case '\t': buf_.append("\\t"); break;
+                default:
+                    buf_.append("\\u00");
+                    buf_.push_back(hex_chars[c >> 4]);
+                    buf_.push_back(hex_chars[c & 0x0F]);
+            }
+        }
+        buf_.append(str.substr(run_start));
+        buf_.push_back('"');
+    }
+
+    std::ostream* out_;
+    std::string buf_;
+    bool comma_ = false;
+    bool written_ = false;
+};
+
 }  // anonymous namespace
 
 auto export_json(const Document& doc, const ObjId& obj) -> nlohmann::json {
-    return export_object_impl(doc, obj);
+    auto builder = JsonBuilder{};
+    doc.walk(obj, builder);
+    return builder.take();
+}
+
+void write_json(const Document& doc, std::ostream& out, const ObjId& obj) {
+    auto writer = JsonWriter{&out};
+    doc.walk(obj, writer);
+    if (writer.empty()) writer.scalar(Null{});
+    writer.flush();
+}
+
+auto dump_json(const Document& doc, const ObjId& obj) -> std::string {
+    auto writer = JsonWriter{};
+    doc.walk(obj, writer);
+    if (writer.empty()) return "null";
+    return writer.take();
 }
 
 auto export_json_at(const Document& doc,
@@ -452,72 +650,82 @@ auto export_json_at(const Document& doc,
 
 namespace {
 
-void import_json_value_at_key(Transaction& tx, const ObjId& obj,
-                              std::string_view key, const nlohmann::json& val);
-void import_json_value_at_index(Transaction& tx, const ObjId& obj,
-                                std::size_t index, const nlohmann::json& val);
-
-void import_json_value_at_key(Transaction& tx, const ObjId& obj,
-                              std::string_view key, const nlohmann::json& val) {
-    if (val.is_object()) {
-        auto child = tx.put_object(obj, key, ObjType::map);
-        for (auto& [k, v] : val.items()) {
-            import_json_value_at_key(tx, child, k, v);
-        }
-    } else if (val.is_array()) {
-        auto child = tx.put_object(obj, key, ObjType::list);
-        for (std::size_t i = 0; i < val.size(); ++i) {
-            import_json_value_at_index(tx, child, i, val[i]);
-        }
-    } else if (val.is_string()) {
-        tx.put(obj, key, val.get<std::string>());
-    } else if (val.is_number_unsigned()) {
+// The scalar a JSON value imports as; nullopt for objects and arrays.
+auto json_scalar(const nlohmann::json& val) -> std::optional<ScalarValue> {
+    if (val.is_string()) return ScalarValue{val.get<std::string>()};
+    if (val.is_number_unsigned()) {
         auto u = val.get<std::uint64_t>();
         if (u <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())) {
-            tx.put(obj, key, static_cast<std::int64_t>(u));
-        } else {
-            tx.put(obj, key, u);
+            return ScalarValue{static_cast<std::int64_t>(u)};
         }
-    } else if (val.is_number_integer()) {
-        tx.put(obj, key, val.get<std::int64_t>());
-    } else if (val.is_number_float()) {
-        tx.put(obj, key, val.get<double>());
-    } else if (val.is_boolean()) {
-        tx.put(obj, key, val.get<bool>());
-    } else if (val.is_null()) {
-        tx.put(obj, key, Null{});
+        return ScalarValue{u};
     }
+    if (val.is_number_integer()) return ScalarValue{val.get<std::int64_t>()};
+    if (val.is_number_float()) return ScalarValue{val.get<double>()};
+    if (val.is_boolean()) return ScalarValue{val.get<bool>()};
+    if (val.is_null()) return ScalarValue{Null{}};
+    return std::nullopt;
 }
 
-void import_json_value_at_index(Transaction& tx, const ObjId& obj,
-                                std::size_t index, const nlohmann::json& val) {
+// Number of ops needed to import the contents of val.
+auto count_import_ops(const nlohmann::json& val) -> std::size_t {
+    if (!val.is_structured()) return 0;
+    auto count = val.size();
+    for (const auto& v : val) count += count_import_ops(v);
+    return count;
+}
+
+void fill_fresh(detail::FreshObjectBuilder& builder,
+                detail::FreshObjectBuilder::Target& target, const nlohmann::json& val) {
     if (val.is_object()) {
-        auto child = tx.insert_object(obj, index, ObjType::map);
-        for (auto& [k, v] : val.items()) {
-            import_json_value_at_key(tx, child, k, v);
-        }
-    } else if (val.is_array()) {
-        auto child = tx.insert_object(obj, index, ObjType::list);
-        for (std::size_t i = 0; i < val.size(); ++i) {
-            import_json_value_at_index(tx, child, i, val[i]);
+        builder.reserve_keys(target, val.size());
+        for (const auto& [k, v] : val.items()) {
+            if (v.is_structured()) {
+                auto child = builder.put_object(target, k, v.is_object() ? ObjType::map : ObjType::list);
+                fill_fresh(builder, child, v);
+            } else if (auto sv = json_scalar(v)) {
+                builder.put(target, k, std::move(*sv));
+            }
         }
-    } else if (val.is_string()) {
-        tx.insert(obj, index, val.get<std::string>());
-    } else if (val.is_number_unsigned()) {
-        auto u = val.get<std::uint64_t>();
-        if (u <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())) {
-            tx.insert(obj, index, static_cast<std::int64_t>(u));
-        } else {
-            tx.insert(obj, index, u);
+    } else {
+        for (const auto& v : val) {
+            if (v.is_structured()) {
+                auto child = builder.append_object(target, v.is_object() ? ObjType::map : ObjType::list);
+                fill_fresh(builder, child, v);
+            } else if (auto sv = json_scalar(v)) {
+                builder.append(target, std::move(*sv));
+            }
         }
-    } else if (val.is_number_integer()) {
-        tx.insert(obj, index, val.get<std::int64_t>());
-    } else if (val.is_number_float()) {
-        tx.insert(obj, index, val.get<double>());
-    } else if (val.is_boolean()) {
-        tx.insert(obj, index, val.get<bool>());
-    } else if (val.is_null()) {
-        tx.insert(obj, index, ScalarValue{Null{}});
+    }
+}
+
+// Import the contents of val (an object or array) into child, which was just
+// created by tx. Nothing can precede anything in a new object, so this takes
+// the bulk path: no predecessor lookups and list appends chained in order.
+void import_into_new_object(Transaction& tx, const ObjId& child, const nlohmann::json& val) {
+    auto builder = detail::FreshObjectBuilder{tx};
+    builder.reserve(count_import_ops(val));
+    auto target = builder.open(child);
+    fill_fresh(builder, target, val);
+}
+
+void import_json_value_at_key(Transaction& tx, const ObjId& obj,
+                              std::string_view key, const nlohmann::json& val) {
+    if (val.is_structured()) {
+        auto child = tx.put_object(obj, key, val.is_object() ? ObjType::map : ObjType::list);
+        import_into_new_object(tx, child, val);
+    } else if (auto sv = json_scalar(val)) {
+        tx.put(obj, key, std::move(*sv));
+    }
+}
+
+void import_json_value_at_index(Transaction& tx, const ObjId& obj,
+                                std::size_t index, const nlohmann::json& val) {
+    if (val.is_structured()) {
+        auto child = tx.insert_object(obj, index, val.is_object() ? ObjType::map : ObjType::list);
+        import_into_new_object(tx, child, val);
+    } else if (auto sv = json_scalar(val)) {
+        tx.insert(obj, index, std::move(*sv));
     }
 }
 
@@ -782,16 +990,8 @@ void add_value_at_pointer(Transaction& tx,
             idx = *parsed;
         }
         // For lists, "add" means insert
-        if (value.is_object()) {
-            auto child = tx.insert_object(current, idx, ObjType::map);
-            for (auto& [k, v] : value.items()) {
-                import_json_value_at_key(tx, child, k, v);
-            }
-        } else if (value.is_array()) {
-            auto child = tx.insert_object(current, idx, ObjType::list);
-            for (std::size_t i = 0; i < value.size(); ++i) {
-                import_json_value_at_index(tx, child, i, value[i]);
-            }
+        if (value.is_structured()) {
+            import_json_value_at_index(tx, current, idx, value);
         } else {
             auto sv = ScalarValue{};
             automerge_cpp::from_json(value, sv);
@@ -955,10 +1155,7 @@ void apply_merge_patch_recursive(Transaction& tx,
                 }
             }
             // Create new map and import
-            auto child = tx.put_object(target, key, ObjType::map);
-            for (auto& [k, v] : value.items()) {
-                import_json_value_at_key(tx, child, k, v);
-            }
+            import_json_value_at_key(tx, target, key, value);
         } else {
             // Scalar or array — just import
             import_json_value_at_key(tx, target, key, value);
@@ -1015,7 +1212,7 @@ auto generate_merge_patch(const Document& before, const Document& after) -> nloh
 namespace {
 
 /// Escape a segment for RFC 6901: ~ -> ~0, / -> ~1
-auto escape_pointer_segment(const std::string& segment) -> std::string {
+auto escape_pointer_segment(std::string_view segment) -> std::string {
     auto result = std::string{};
     result.reserve(segment.size());
     for (char c : segment) {
@@ -1026,68 +1223,50 @@ auto escape_pointer_segment(const std::string& segment) -> std::string {
     return result;
 }
 
-void flatten_recursive(const Document& doc, const ObjId& obj,
+auto scalar_to_json(const ScalarRef& sv) -> nlohmann::json {
+    return std::visit(overload{
+        [](Null) -> nlohmann::json { return nullptr; },
+        [](bool b) -> nlohmann::json { return b; },
+        [](std::int64_t i) -> nlohmann::json { return i; },
+        [](std::uint64_t u) -> nlohmann::json { return u; },
+        [](double d) -> nlohmann::json { return d; },
+        [](const Counter& c) -> nlohmann::json { return c.value; },
+        [](const Timestamp& t) -> nlohmann::json { return t.millis_since_epoch; },
+        [](std::string_view s) -> nlohmann::json { return s; },
+        [](std::span<const std::byte> b) -> nlohmann::json { return base64_encode(b); },
+    }, sv);
+}
+
+// One read view for the whole walk: each object's entries or elements are
+// visited in one pass instead of a guarded lookup per key or index.
+void flatten_recursive(const ReadView& view, const ObjId& obj,
                        const std::string& prefix,
                        std::map<std::string, nlohmann::json>& result) {
-    auto type = doc.object_type(obj);
+    auto type = view.object_type(obj);
     if (!type) return;
 
     if (*type == ObjType::text) {
-        result[prefix.empty() ? "/" : prefix] = doc.text(obj);
+        auto text = std::string{};
+        for (auto chunk : view.text_chunks(obj)) text.append(chunk);
+        result[prefix.empty() ? "/" : prefix] = std::move(text);
         return;
     }
 
+    auto visit = [&](const ValueRef& value, const OpId& id, const std::string& path) {
+        std::visit(overload{
+            [&](ObjType) { flatten_recursive(view, ObjId{id}, path, result); },
+            [&](const ScalarRef& sv) { result[path] = scalar_to_json(sv); },
+        }, value);
+    };
+
     if (*type == ObjType::map || *type == ObjType::table) {
-        for (const auto& key : doc.keys(obj)) {
-            auto path = prefix + "/" + escape_pointer_segment(key);
-            if (auto val = doc.get(obj, key)) {
-                std::visit(overload{
-                    [&](ObjType) {
-                        auto child = doc.get_obj_id(obj, key);
-                        if (child) flatten_recursive(doc, *child, path, result);
-                    },
-                    [&](const ScalarValue& sv) {
-                        result[path] = std::visit(overload{
-                            [](Null) -> nlohmann::json { return nullptr; },
-                            [](bool b) -> nlohmann::json { return b; },
-                            [](std::int64_t i) -> nlohmann::json { return i; },
-                            [](std::uint64_t u) -> nlohmann::json { return u; },
-                            [](double d) -> nlohmann::json { return d; },
-                            [](const Counter& c) -> nlohmann::json { return c.value; },
-                            [](const Timestamp& t) -> nlohmann::json { return t.millis_since_epoch; },
-                            [](const std::string& s) -> nlohmann::json { return s; },
-                            [](const Bytes& b) -> nlohmann::json { return base64_encode(b); },
-                        }, sv);
-                    },
-                }, *val);
-            }
+        for (const auto& entry : view.entries(obj)) {
+            visit(entry.value, entry.id, prefix + "/" + escape_pointer_segment(entry.key));
         }
     } else {
         // list
-        auto len = doc.length(obj);
-        for (std::size_t i = 0; i < len; ++i) {
-            auto path = prefix + "/" + std::to_string(i);
-            if (auto val = doc.get(obj, i)) {
-                std::visit(overload{
-                    [&](ObjType) {
-                        auto child = doc.get_obj_id(obj, i);
-                        if (child) flatten_recursive(doc, *child, path, result);
-                    },
-                    [&](const ScalarValue& sv) {
-                        result[path] = std::visit(overload{
-                            [](Null) -> nlohmann::json { return nullptr; },
-                            [](bool b) -> nlohmann::json { return b; },
-                            [](std::int64_t i) -> nlohmann::json { return i; },
-                            [](std::uint64_t u) -> nlohmann::json { return u; },
-                            [](double d) -> nlohmann::json { return d; },
-                            [](const Counter& c) -> nlohmann::json { return c.value; },
-                            [](const Timestamp& t) -> nlohmann::json { return t.millis_since_epoch; },
-                            [](const std::string& s) -> nlohmann::json { return s; },
-                            [](const Bytes& b) -> nlohmann::json { return base64_encode(b); },
-                        }, sv);
-                    },
-                }, *val);
-            }
+        for (const auto& element : view.elements(obj)) {
+            visit(element.value, element.id, prefix + "/" + std::to_string(element.index));
         }
     }
 }
@@ -1097,7 +1276,7 @@ void flatten_recursive(const Document& doc, const ObjId& obj,
 auto flatten(const Document& doc, const ObjId& obj)
     -> std::map<std::string, nlohmann::json> {
     auto result = std::map<std::string, nlohmann::json>{};
-    flatten_recursive(doc, obj, "", result);
+    flatten_recursive(doc.read_view(), obj, "", result);
     return result;
 }
 
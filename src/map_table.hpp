@@ -0,0 +1,351 @@
+#pragma once
+
+// Open-addressing hash table for map/table objects.
+// Internal header — not installed.
+//
+// Almost every key holds a single value, so a key's values are stored as
+// one inline winner (the entry with the highest OpId) plus an out-of-line
+// list of concurrent losers that is only allocated for a conflicted key.
+// Keys (interned in the object's StringPool) and their values live in
+// one dense array; the probe array holds
+// only an index and a hash fragment per slot, so a lookup touches one
+// slot run and one entry, and get() needs no scan for the winner.
+//
+// Lookups, inserts and erases are O(1) expected. Iteration in key order,
+// which Document exposes through keys()/values()/walk, sorts on demand.
+//
+// Both arrays are PersistentVectors, shared between copies of the table:
+// copying a table is O(1), and a change copies only the array leaves it
+// touches that another copy may see, so an object shared with a snapshot
+// or fork still updates in O(log n).
+//
+// Both arrays allocate from the table's memory resource (the document's).
+// As with std::pmr containers, a copy or move keeps the source's resource
+// unless one is given, and assignment keeps the target's.
+
+#include <automerge-cpp/types.hpp>
+#include <automerge-cpp/value.hpp>
+#include "persistent_vector.hpp"
+#include "string_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace automerge_cpp::detail {
+
+// An entry at a map key. Multiple entries at the same key = conflict.
+struct MapEntry {
+    OpId op_id;
+    Value value;
+};
+
+// The live entries of one key: never empty.
+class MapValues {
+public:
+    explicit MapValues(MapEntry entry) : winner_{std::move(entry)} {}
+
+    MapValues(const MapValues& other)
+        : winner_{other.winner_}
+        , losers_{other.losers_ ? std::make_unique<std::vector<MapEntry>>(*other.losers_)
+                                : nullptr} {}
+
+    auto operator=(const MapValues& other) -> MapValues& {
+        if (this != &other) *this = MapValues{other};
+        return *this;
+    }
+
+    MapValues(MapValues&&) noexcept = default;
+    auto operator=(MapValues&&) noexcept -> MapValues& = default;
+    ~MapValues() = default;
+
+    // The entry with the highest OpId: the value get() reports.
+    auto winner() const -> const MapEntry& { return winner_; }
+
+    auto size() const -> std::size_t { return 1 + (losers_ ? losers_->size() : 0); }
+    auto conflicted() const -> bool { return losers_ && !losers_->empty(); }
+
+    // Visit every entry in ascending OpId order (the winner last).
+    template <typename F>
+    void for_each(F&& f) const {
+        if (losers_) {
+            for (const auto& entry : *losers_) f(entry);
+        }
+        f(winner_);
+    }
+
+    template <typename F>
+    void for_each(F&& f) {
+        if (losers_) {
+            for (auto& entry : *losers_) f(entry);
+        }
+        f(winner_);
+    }
+
+private:
+    friend class MapTable;
+
+    void assign(MapEntry entry) {
+        winner_ = std::move(entry);
+        losers_.reset();
+    }
+
+    void add(MapEntry entry) {
+        if (!losers_) losers_ = std::make_unique<std::vector<MapEntry>>();
+        if (winner_.op_id < entry.op_id) std::swap(winner_, entry);
+        auto at = std::ranges::upper_bound(*losers_, entry.op_id, {}, &MapEntry::op_id);
+        losers_->insert(at, std::move(entry));
+    }
+
+    // Remove the entries whose OpId is in ids. Returns false, leaving the
+    // values unchanged, if that would remove every entry.
+    auto remove(std::span<const OpId> ids) -> bool {
+        auto listed = [&](const MapEntry& e) { return std::ranges::find(ids, e.op_id) != ids.end(); };
+        const bool winner_listed = listed(winner_);
+        if (!losers_) return !winner_listed;
+        if (winner_listed && std::ranges::all_of(*losers_, listed)) return false;
+        std::erase_if(*losers_, listed);
+        if (winner_listed) {
+            winner_ = std::move(losers_->back());
+            losers_->pop_back();
+        }
+        if (losers_->empty()) losers_.reset();
+        return true;
+    }
+
+    MapEntry winner_;
+    std::unique_ptr<std::vector<MapEntry>> losers_;  // ascending OpId; null if none
+};
+
+class MapTable {
+public:
+    MapTable() = default;
+    explicit MapTable(std::pmr::memory_resource* resource) : entries_{resource}, slots_{resource} {}
+
+    MapTable(const MapTable& other) : MapTable{other, other.resource()} {}
+    MapTable(const MapTable& other, std::pmr::memory_resource* resource)
+        : entries_{other.entries_, resource}, slots_{other.slots_, resource} {}
+    auto operator=(const MapTable&) -> MapTable& = default;
+    MapTable(MapTable&&) noexcept = default;
+    auto operator=(MapTable&&) -> MapTable& = default;
+    ~MapTable() = default;
+
+    auto resource() const -> std::pmr::memory_resource* { return entries_.resource(); }
+
+    auto size() const -> std::size_t { return entries_.size(); }
+    auto empty() const -> bool { return entries_.empty(); }
+
+    // Approximate heap bytes held by the table: both arrays, loser lists and
+    // long string values (interned keys live in the StringPool).
+    auto memory_usage() const -> std::size_t {
+        auto bytes = entries_.memory_usage() + slots_.memory_usage();
+        auto value_bytes = [](const MapEntry& e) -> std::size_t {
+            const auto* scalar = std::get_if<ScalarValue>(&e.value);
+            if (!scalar) return 0;
+            if (const auto* str = std::get_if<std::string>(scalar)) {
+                return str->capacity() > std::string{}.capacity() ? str->capacity() + 1 : 0;
+            }
+            if (const auto* b = std::get_if<Bytes>(scalar)) return b->capacity();
+            return 0;
+        };
+        entries_.for_each([&](const Entry& e) {
+            if (e.values.losers_) {
+                bytes += sizeof(std::vector<MapEntry>)
+                       + e.values.losers_->capacity() * sizeof(MapEntry);
+            }
+            e.values.for_each([&](const MapEntry& entry) { bytes += value_bytes(entry); });
+        });
+        return bytes;
+    }
+
+    auto find(std::string_view key) const -> const MapValues* {
+        auto slot = find_slot(key, hash_of(key));
+        return slot == npos ? nullptr : &entries_[slots_[slot].index].values;
+    }
+
+    auto find(std::string_view key) -> MapValues* {
+        auto slot = find_slot(key, hash_of(key));
+        return slot == npos ? nullptr : &entries_.mut(slots_[slot].index).values;
+    }
+
+    // Set key to a single value, dropping any others (a local put). A new
+    // key is interned in pool.
+    void assign(std::string_view key, MapEntry entry, StringPool& pool) {
+        auto hash = hash_of(key);
+        if (auto slot = find_slot(key, hash); slot != npos) {
+            entries_.mut(slots_[slot].index).values.assign(std::move(entry));
+            return;
+        }
+        emplace(pool.intern(key, hash), hash, std::move(entry));
+    }
+
+    // Apply a put that overwrites the entries in pred: they are removed and
+    // entry joins whatever concurrent values remain.
+    auto put(std::string_view key, std::span<const OpId> pred, MapEntry entry,
+             StringPool& pool) -> const MapValues& {
+        auto hash = hash_of(key);
+        auto slot = find_slot(key, hash);
+        if (slot == npos) return emplace(pool.intern(key, hash), hash, std::move(entry));
+        auto& values = entries_.mut(slots_[slot].index).values;
+        if (values.remove(pred)) {
+            values.add(std::move(entry));
+        } else {
+            values.assign(std::move(entry));
+        }
+        return values;
+    }
+
+    // Remove the entries in pred from key, erasing the key if none remain.
+    // Returns false if the key was not present.
+    auto remove(std::string_view key, std::span<const OpId> pred) -> bool {
+        auto slot = find_slot(key, hash_of(key));
+        if (slot == npos) return false;
+        if (!entries_.mut(slots_[slot].index).values.remove(pred)) erase_slot(slot);
+        return true;
+    }
+
+    void erase(std::string_view key) {
+        if (auto slot = find_slot(key, hash_of(key)); slot != npos) erase_slot(slot);
+    }
+
+    void reserve(std::size_t n) {
+        if (n > max_load(slots_.size())) rehash(capacity_for(n));
+    }
+
+    // Visit (key, values) in unspecified order. key is a std::string_view.
+    template <typename F>
+    void for_each(F&& f) const {
+        entries_.for_each([&](const Entry& e) { f(e.key.view(), e.values); });
+    }
+
+    // Visit (key, values) in ascending key order. O(n log n).
+    template <typename F>
+    void for_each_sorted(F&& f) const {
+        auto order = std::vector<std::pair<std::uint64_t, const Entry*>>{};
+        order.reserve(entries_.size());
+        entries_.for_each([&](const Entry& e) { order.emplace_back(sort_prefix(e.key), &e); });
+        // Most keys differ in their first 8 bytes, so most comparisons are
+        // one integer compare rather than a string compare.
+        std::ranges::sort(order, [](const auto& a, const auto& b) {
+            if (a.first != b.first) return a.first < b.first;
+            return a.second->key.view() < b.second->key.view();
+        });
+        for (const auto& [prefix, e] : order) f(e->key.view(), e->values);
+    }
+
+private:
+    struct Entry {
+        Symbol key;
+        std::uint64_t hash;
+        MapValues values;
+    };
+
+    // index into entries_, or empty_index; tag is the hash's high bits, so
+    // most mismatched probes are rejected without touching the entry.
+    struct Slot {
+        std::uint32_t index = empty_index;
+        std::uint32_t tag = 0;
+    };
+
+    static constexpr auto empty_index = ~std::uint32_t{0};
+    static constexpr auto npos = ~std::size_t{0};
+
+    static auto hash_of(std::string_view key) -> std::uint64_t {
+        return std::hash<std::string_view>{}(key);
+    }
+    static auto tag_of(std::uint64_t hash) -> std::uint32_t {
+        return static_cast<std::uint32_t>(hash >> 32);
+    }
+    // The first 8 bytes of key, zero-padded, as a big-endian integer: if
+    // the prefixes of two keys differ, they order the keys.
+    static auto sort_prefix(std::string_view key) -> std::uint64_t {
+        auto prefix = std::uint64_t{0};
+        const auto n = std::min<std::size_t>(key.size(), 8);
+        for (std::size_t i = 0; i < n; ++i) {
+            prefix |= std::uint64_t{static_cast<unsigned char>(key[i])} << (56 - 8 * i);
+        }
+        return prefix;
+    }
+    // Keep the table at most 7/8 full.
+    static auto max_load(std::size_t slots) -> std::size_t { return slots - slots / 8; }
+    static auto capacity_for(std::size_t n) -> std::size_t {
+        return std::bit_ceil(std::max<std::size_t>(8, n + n / 7 + 1));
+    }
+
+    auto mask() const -> std::size_t { return slots_.size() - 1; }
+
+    auto find_slot(std::string_view key, std::uint64_t hash) const -> std::size_t {
+        if (slots_.empty()) return npos;
+        const auto tag = tag_of(hash);
+        for (auto i = hash & mask();; i = (i + 1) & mask()) {
+            const auto& slot = slots_[i];
+            if (slot.index == empty_index) return npos;
+            if (slot.tag == tag) {
+                const auto& e = entries_[slot.index];
+                if (e.hash == hash && e.key.view() == key) return i;
+            }
+        }
+    }
+
+    auto emplace(Symbol key, std::uint64_t hash, MapEntry entry) -> MapValues& {
+        if (entries_.size() + 1 > max_load(slots_.size())) rehash(capacity_for(entries_.size() + 1));
+        auto index = static_cast<std::uint32_t>(entries_.size());
+        entries_.push_back(Entry{.key = key, .hash = hash,
+                                 .values = MapValues{std::move(entry)}});
+        place(index, hash);
+        return entries_.mut(index).values;
+    }
+
+    void place(std::uint32_t index, std::uint64_t hash) {
+        auto i = hash & mask();
+        while (slots_[i].index != empty_index) i = (i + 1) & mask();
+        slots_.mut(i) = Slot{.index = index, .tag = tag_of(hash)};
+    }
+
+    void rehash(std::size_t capacity) {
+        slots_.assign(capacity, Slot{});
+        for (std::uint32_t i = 0; i < entries_.size(); ++i) place(i, entries_[i].hash);
+    }
+
+    // Erase the entry at slot: the last entry moves into its place in the
+    // dense array, and the probe run closes up by backward shifting, so no
+    // tombstones accumulate.
+    void erase_slot(std::size_t slot) {
+        const auto index = slots_[slot].index;
+        const auto last = static_cast<std::uint32_t>(entries_.size() - 1);
+        if (index != last) {
+            auto i = entries_[last].hash & mask();
+            while (slots_[i].index != last) i = (i + 1) & mask();
+            slots_.mut(i).index = index;
+            entries_.mut(index) = std::move(entries_.mut(last));
+        }
+        entries_.pop_back();
+
+        auto hole = slot;
+        for (auto i = (slot + 1) & mask(); slots_[i].index != empty_index; i = (i + 1) & mask()) {
+            auto home = entries_[slots_[i].index].hash & mask();
+            // Move slot i back into the hole unless its home lies in (hole, i].
+            if (((i - home) & mask()) >= ((i - hole) & mask())) {
+                const auto moved = slots_[i];  // mut() may copy the node holding it
+                slots_.mut(hole) = moved;
+                hole = i;
+            }
+        }
+        slots_.mut(hole) = Slot{};
+    }
+
+    PersistentVector<Entry> entries_;
+    PersistentVector<Slot> slots_;  // power-of-two size, or empty
+};
+
+}  // namespace automerge_cpp::detail
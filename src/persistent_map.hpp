@@ -0,0 +1,292 @@
+#pragma once
+
+// Ordered map shared copy-on-write between copies.
+// Internal header — not installed.
+//
+// A B+ tree of up to 32 keys a node. Copying the map is O(1): the copies
+// share every node (see EditToken). An update copies the nodes on its
+// root-to-leaf path that another copy may see, O(log n), and changes in
+// place the nodes this map made since it was last copied.
+//
+// Besides exact lookups, floor() finds the greatest key not above a given
+// one, which is how a run index maps an element id to the run holding it.
+//
+// Erase unlinks a node once it is empty but does not merge underfull
+// siblings: a map that shrinks keeps some slack. The maps here mostly grow.
+//
+// Nodes allocate from the map's memory resource. As with std::pmr
+// containers, a copy or move keeps the source's resource unless one is
+// given, and assignment keeps the target's; a copy onto another resource
+// copies every entry.
+
+#include "edit_token.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace automerge_cpp::detail {
+
+template <typename Key, typename Value>
+class PersistentMap {
+    static constexpr std::size_t capacity = 32;
+
+    // In a leaf, keys[i] maps to values[i]. In an internal node, keys[i]
+    // is at most the least key under children[i] and more than every key
+    // under children[i - 1].
+    struct Node {
+        explicit Node(std::pmr::memory_resource* resource)
+            : keys{resource}, values{resource}, children{resource} {}
+        Node(const Node& other, std::pmr::memory_resource* resource)
+            : is_leaf{other.is_leaf}
+            , keys{other.keys, resource}
+            , values{other.values, resource}
+            , children{other.children, resource} {}
+
+        std::uint64_t edit = 0;
+        bool is_leaf = true;
+        std::pmr::vector<Key> keys;
+        std::pmr::vector<Value> values;                    // leaves only
+        std::pmr::vector<std::shared_ptr<Node>> children;  // internal nodes only
+    };
+
+public:
+    PersistentMap() : PersistentMap{std::pmr::get_default_resource()} {}
+    explicit PersistentMap(std::pmr::memory_resource* resource) : resource_{resource} {}
+
+    PersistentMap(const PersistentMap& other) : PersistentMap{other, other.resource_} {}
+
+    PersistentMap(const PersistentMap& other, std::pmr::memory_resource* resource)
+        : resource_{resource}, size_{other.size_}, edit_{other.edit_} {
+        if (*resource == *other.resource_) {
+            root_ = other.root_;
+        } else if (other.root_) {
+            root_ = deep_copy(*other.root_);
+        }
+    }
+
+    auto operator=(const PersistentMap& other) -> PersistentMap& {
+        if (this != &other) *this = PersistentMap{other, resource_};
+        return *this;
+    }
+
+    PersistentMap(PersistentMap&& other) noexcept
+        : resource_{other.resource_}
+        , root_{std::move(other.root_)}
+        , size_{std::exchange(other.size_, 0)}
+        , edit_{std::move(other.edit_)} {}
+
+    // From a map on another resource this copies, keeping this map's.
+    auto operator=(PersistentMap&& other) -> PersistentMap& {
+        if (this == &other) return *this;
+        if (*resource_ != *other.resource_) return *this = std::as_const(other);
+        root_ = std::move(other.root_);
+        size_ = std::exchange(other.size_, 0);
+        edit_ = std::move(other.edit_);
+        return *this;
+    }
+
+    ~PersistentMap() = default;
+
+    auto size() const -> std::size_t { return size_; }
+    auto empty() const -> bool { return size_ == 0; }
+
+    auto find(const Key& key) const -> const Value* {
+        const auto* node = root_.get();
+        if (!node) return nullptr;
+        while (!node->is_leaf) {
+            const auto c = child_for(*node, key);
+            if (!c) return nullptr;
+            node = node->children[*c].get();
+        }
+        auto it = std::ranges::lower_bound(node->keys, key);
+        if (it == node->keys.end() || *it != key) return nullptr;
+        return &node->values[static_cast<std::size_t>(it - node->keys.begin())];
+    }
+
+    // The entry with the greatest key not above key, if any.
+    auto floor(const Key& key) const -> std::optional<std::pair<Key, Value>> {
+        return root_ ? floor_in(*root_, key) : std::nullopt;
+    }
+
+    // Map key to value, replacing any value it had.
+    void assign(const Key& key, Value value) {
+        if (!root_) root_ = make_node(true);
+        auto right = insert(own(root_), key, std::move(value));
+        if (!right) return;
+        auto root = make_node(false);
+        root->keys.push_back(root_->keys.front());
+        root->keys.push_back(right->keys.front());
+        root->children.push_back(std::move(root_));
+        root->children.push_back(std::move(right));
+        root_ = std::move(root);
+    }
+
+    void erase(const Key& key) {
+        if (!find(key)) return;
+        remove(own(root_), key);
+        --size_;
+        while (!root_->is_leaf && root_->children.size() == 1) {
+            auto child = std::move(root_->children.front());
+            root_ = std::move(child);
+        }
+        if (size_ == 0) root_.reset();
+    }
+
+    void clear() {
+        root_.reset();
+        size_ = 0;
+    }
+
+    // Visit every entry in key order as f(key, value).
+    template <typename F>
+    void for_each(F&& f) const {
+        if (root_) visit(*root_, f);
+    }
+
+    // Heap bytes held by the nodes. Nodes shared with a copy are counted
+    // by both.
+    auto memory_usage() const -> std::size_t { return root_ ? node_memory(*root_) : 0; }
+
+private:
+    auto make_node(bool is_leaf) const -> std::shared_ptr<Node> {
+        auto node = std::allocate_shared<Node>(std::pmr::polymorphic_allocator<Node>{resource_},
+                                               resource_);
+        node->edit = edit_.value();
+        node->is_leaf = is_leaf;
+        return node;
+    }
+
+    // The node in slot, copied first if another copy may see it.
+    auto own(std::shared_ptr<Node>& slot) -> Node& {
+        if (slot->edit != edit_.value()) {
+            slot = std::allocate_shared<Node>(std::pmr::polymorphic_allocator<Node>{resource_},
+                                              *slot, resource_);
+            slot->edit = edit_.value();
+        }
+        return *slot;
+    }
+
+    // The child of an internal node whose range holds key; nullopt if key
+    // is below every key under the node.
+    static auto child_for(const Node& node, const Key& key) -> std::optional<std::size_t> {
+        auto it = std::ranges::upper_bound(node.keys, key);
+        if (it == node.keys.begin()) return std::nullopt;
+        return static_cast<std::size_t>(it - node.keys.begin()) - 1;
+    }
+
+    static auto floor_in(const Node& node, const Key& key) -> std::optional<std::pair<Key, Value>> {
+        auto it = std::ranges::upper_bound(node.keys, key);
+        auto n = static_cast<std::size_t>(it - node.keys.begin());
+        if (node.is_leaf) {
+            if (n == 0) return std::nullopt;
+            return std::pair{node.keys[n - 1], node.values[n - 1]};
+        }
+        // keys[i] may sit below the least key of child i (after erases), so
+        // the floor can be in an earlier child: then it is that child's last.
+        while (n-- > 0) {
+            if (auto found = floor_in(*node.children[n], key)) return found;
+        }
+        return std::nullopt;
+    }
+
+    // Insert into the subtree at node (owned). Returns the new right
+    // sibling if node split.
+    auto insert(Node& node, const Key& key, Value value) -> std::shared_ptr<Node> {
+        if (node.is_leaf) {
+            auto it = std::ranges::lower_bound(node.keys, key);
+            auto i = it - node.keys.begin();
+            if (it != node.keys.end() && *it == key) {
+                node.values[static_cast<std::size_t>(i)] = std::move(value);
+                return nullptr;
+            }
+            node.keys.insert(it, key);
+            node.values.insert(node.values.begin() + i, std::move(value));
+            ++size_;
+        } else {
+            auto c = child_for(node, key).value_or(0);
+            if (key < node.keys[c]) node.keys[c] = key;
+            auto right = insert(own(node.children[c]), key, std::move(value));
+            if (right) {
+                const auto at = static_cast<std::ptrdiff_t>(c + 1);
+                node.keys.insert(node.keys.begin() + at, right->keys.front());
+                node.children.insert(node.children.begin() + at, std::move(right));
+            }
+        }
+        return node.keys.size() > capacity ? split(node) : nullptr;
+    }
+
+    // Move the upper half of node into a new right sibling.
+    auto split(Node& node) -> std::shared_ptr<Node> {
+        auto right = make_node(node.is_leaf);
+        const auto half = static_cast<std::ptrdiff_t>(node.keys.size() / 2);
+        right->keys.assign(node.keys.begin() + half, node.keys.end());
+        node.keys.erase(node.keys.begin() + half, node.keys.end());
+        if (node.is_leaf) {
+            right->values.assign(std::make_move_iterator(node.values.begin() + half),
+                                 std::make_move_iterator(node.values.end()));
+            node.values.erase(node.values.begin() + half, node.values.end());
+        } else {
+            right->children.assign(std::make_move_iterator(node.children.begin() + half),
+                                   std::make_move_iterator(node.children.end()));
+            node.children.erase(node.children.begin() + half, node.children.end());
+        }
+        return right;
+    }
+
+    // Remove key (present) from the subtree at node (owned).
+    void remove(Node& node, const Key& key) {
+        if (node.is_leaf) {
+            auto i = std::ranges::lower_bound(node.keys, key) - node.keys.begin();
+            node.keys.erase(node.keys.begin() + i);
+            node.values.erase(node.values.begin() + i);
+            return;
+        }
+        const auto c = *child_for(node, key);
+        auto& child = own(node.children[c]);
+        remove(child, key);
+        if (child.keys.empty()) {
+            const auto at = static_cast<std::ptrdiff_t>(c);
+            node.keys.erase(node.keys.begin() + at);
+            node.children.erase(node.children.begin() + at);
+        }
+    }
+
+    auto deep_copy(const Node& src) const -> std::shared_ptr<Node> {
+        auto node = make_node(src.is_leaf);
+        node->keys.assign(src.keys.begin(), src.keys.end());
+        node->values.assign(src.values.begin(), src.values.end());
+        for (const auto& child : src.children) node->children.push_back(deep_copy(*child));
+        return node;
+    }
+
+    template <typename F>
+    static void visit(const Node& node, F& f) {
+        if (node.is_leaf) {
+            for (std::size_t i = 0; i < node.keys.size(); ++i) f(node.keys[i], node.values[i]);
+            return;
+        }
+        for (const auto& child : node.children) visit(*child, f);
+    }
+
+    static auto node_memory(const Node& node) -> std::size_t {
+        auto bytes = sizeof(Node) + node.keys.capacity() * sizeof(Key)
+                   + node.values.capacity() * sizeof(Value)
+                   + node.children.capacity() * sizeof(std::shared_ptr<Node>);
+        for (const auto& child : node.children) bytes += node_memory(*child);
+        return bytes;
+    }
+
+    std::pmr::memory_resource* resource_;
+    std::shared_ptr<Node> root_;  // null while empty
+    std::size_t size_ = 0;
+    EditToken edit_;
+};
+
+}  // namespace automerge_cpp::detail
@@ -0,0 +1,221 @@
+#pragma once
+
+// Random-access array shared copy-on-write between copies.
+// Internal header — not installed.
+//
+// A radix tree of 32-way nodes: element i sits in leaf i / 32, found by
+// reading i five bits at a time from the top level down. Copying the
+// array is O(1): the copies share every node (see EditToken). Changing an
+// element copies the nodes on its root-to-leaf path that another copy may
+// see, O(log n) (one leaf of 32 elements and a few pointer arrays), and
+// changes in place the nodes this array made since it was last copied.
+// Reads are O(log32 n): one to four pointer hops for any realistic size.
+//
+// Nodes allocate from the array's memory resource. As with std::pmr
+// containers, a copy or move keeps the source's resource unless one is
+// given, and assignment keeps the target's; a copy onto another resource
+// copies every element.
+
+#include "edit_token.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace automerge_cpp::detail {
+
+template <typename T>
+class PersistentVector {
+    static constexpr std::size_t bits = 5;
+    static constexpr std::size_t width = std::size_t{1} << bits;
+    static constexpr std::size_t mask = width - 1;
+
+    struct Node {
+        explicit Node(std::pmr::memory_resource* resource) : items{resource}, children{resource} {}
+        Node(const Node& other, std::pmr::memory_resource* resource)
+            : items{other.items, resource}, children{other.children, resource} {}
+
+        std::uint64_t edit = 0;
+        std::pmr::vector<T> items;                          // leaves only
+        std::pmr::vector<std::shared_ptr<Node>> children;  // internal nodes only
+    };
+
+public:
+    PersistentVector() : PersistentVector{std::pmr::get_default_resource()} {}
+    explicit PersistentVector(std::pmr::memory_resource* resource) : resource_{resource} {}
+
+    PersistentVector(const PersistentVector& other) : PersistentVector{other, other.resource_} {}
+
+    PersistentVector(const PersistentVector& other, std::pmr::memory_resource* resource)
+        : resource_{resource}, size_{other.size_}, shift_{other.shift_}, edit_{other.edit_} {
+        if (*resource == *other.resource_) {
+            root_ = other.root_;
+        } else if (other.root_) {
+            root_ = deep_copy(*other.root_);
+        }
+    }
+
+    auto operator=(const PersistentVector& other) -> PersistentVector& {
+        if (this != &other) *this = PersistentVector{other, resource_};
+        return *this;
+    }
+
+    PersistentVector(PersistentVector&& other) noexcept
+        : resource_{other.resource_}
+        , root_{std::move(other.root_)}
+        , size_{std::exchange(other.size_, 0)}
+        , shift_{std::exchange(other.shift_, 0)}
+        , edit_{std::move(other.edit_)} {}
+
+    // From an array on another resource this copies, keeping this array's.
+    auto operator=(PersistentVector&& other) -> PersistentVector& {
+        if (this == &other) return *this;
+        if (*resource_ != *other.resource_) return *this = std::as_const(other);
+        root_ = std::move(other.root_);
+        size_ = std::exchange(other.size_, 0);
+        shift_ = std::exchange(other.shift_, 0);
+        edit_ = std::move(other.edit_);
+        return *this;
+    }
+
+    ~PersistentVector() = default;
+
+    auto resource() const -> std::pmr::memory_resource* { return resource_; }
+
+    auto size() const -> std::size_t { return size_; }
+    auto empty() const -> bool { return size_ == 0; }
+
+    auto operator[](std::size_t i) const -> const T& {
+        assert(i < size_);
+        const auto* node = root_.get();
+        for (auto shift = shift_; shift > 0; shift -= bits) {
+            node = node->children[(i >> shift) & mask].get();
+        }
+        return node->items[i & mask];
+    }
+
+    auto back() const -> const T& { return (*this)[size_ - 1]; }
+
+    // Element i, for writing: copies its path if shared.
+    auto mut(std::size_t i) -> T& {
+        assert(i < size_);
+        auto* node = &own(root_);
+        for (auto shift = shift_; shift > 0; shift -= bits) {
+            node = &own(node->children[(i >> shift) & mask]);
+        }
+        return node->items[i & mask];
+    }
+
+    void push_back(T value) {
+        if (!root_) {
+            root_ = make_node();
+        } else if (size_ == width << shift_) {
+            // Full: grow a level
+            auto root = make_node();
+            root->children.push_back(std::move(root_));
+            root_ = std::move(root);
+            shift_ += bits;
+        }
+        auto* node = &own(root_);
+        for (auto shift = shift_; shift > 0; shift -= bits) {
+            auto& children = node->children;
+            const auto slot = (size_ >> shift) & mask;
+            if (slot == children.size()) children.push_back(make_node());
+            node = &own(children[slot]);
+        }
+        node->items.push_back(std::move(value));
+        ++size_;
+    }
+
+    void pop_back() {
+        assert(size_ > 0);
+        if (--size_ == 0) {
+            clear();
+            return;
+        }
+        pop_from(own(root_), shift_, size_);
+    }
+
+    // Replace the contents with n copies of value.
+    void assign(std::size_t n, const T& value) {
+        clear();
+        for (std::size_t i = 0; i < n; ++i) push_back(value);
+    }
+
+    void clear() {
+        root_.reset();
+        size_ = 0;
+        shift_ = 0;
+    }
+
+    // Visit every element in index order.
+    template <typename F>
+    void for_each(F&& f) const {
+        if (root_) visit(*root_, f);
+    }
+
+    // Heap bytes held by the nodes, excluding what the elements own. Nodes
+    // shared with a copy are counted by both.
+    auto memory_usage() const -> std::size_t { return root_ ? node_memory(*root_) : 0; }
+
+private:
+    auto make_node() const -> std::shared_ptr<Node> {
+        auto node = std::allocate_shared<Node>(std::pmr::polymorphic_allocator<Node>{resource_},
+                                               resource_);
+        node->edit = edit_.value();
+        return node;
+    }
+
+    // The node in slot, copied first if another copy may see it.
+    auto own(std::shared_ptr<Node>& slot) -> Node& {
+        if (slot->edit != edit_.value()) {
+            slot = std::allocate_shared<Node>(std::pmr::polymorphic_allocator<Node>{resource_},
+                                              *slot, resource_);
+            slot->edit = edit_.value();
+        }
+        return *slot;
+    }
+
+    // Remove the element at index (the last), dropping emptied nodes.
+    void pop_from(Node& node, std::size_t shift, std::size_t index) {
+        if (shift == 0) {
+            node.items.pop_back();
+            return;
+        }
+        auto& child = own(node.children.back());
+        pop_from(child, shift - bits, index);
+        if (child.items.empty() && child.children.empty()) node.children.pop_back();
+    }
+
+    auto deep_copy(const Node& src) const -> std::shared_ptr<Node> {
+        auto node = make_node();
+        node->items.assign(src.items.begin(), src.items.end());
+        for (const auto& child : src.children) node->children.push_back(deep_copy(*child));
+        return node;
+    }
+
+    template <typename F>
+    static void visit(const Node& node, F& f) {
+        for (const auto& item : node.items) f(item);
+        for (const auto& child : node.children) visit(*child, f);
+    }
+
+    static auto node_memory(const Node& node) -> std::size_t {
+        auto bytes = sizeof(Node) + node.items.capacity() * sizeof(T)
+                   + node.children.capacity() * sizeof(std::shared_ptr<Node>);
+        for (const auto& child : node.children) bytes += node_memory(*child);
+        return bytes;
+    }
+
+    std::pmr::memory_resource* resource_;
+    std::shared_ptr<Node> root_;  // null while empty
+    std::size_t size_ = 0;
+    std::size_t shift_ = 0;       // bits of index above the leaf level
+    EditToken edit_;
+};
+
+}  // namespace automerge_cpp::detail
@@ -0,0 +1,1166 @@
+#pragma once
+
+// Order-statistic B+ tree for list/text elements (11A.4).
+// Internal header — not installed.
+//
+// Elements live in leaves of up to leaf_capacity runs. Every node caches
+// the total and visible element counts of its subtree, so the operations
+// Document needs are O(log n) rather than a linear scan of the whole
+// sequence:
+// - find_visible(k): real position of the k-th visible element
+// - visible_rank(pos): number of visible elements before a real position
+// - insert(pos, elem), set_visible(pos, bool), at(pos)
+//
+// Elements are never removed (deletes are tombstones), so nodes only split.
+//
+// Text runs (11A.6): consecutive single-byte string elements from one actor,
+// with contiguous counters and each inserted after the previous one, are
+// stored as one run holding a single UTF-8 buffer. Typing extends the last
+// run in place; runs split only when an edit, delete or concurrent insert
+// lands inside them. Any other element is a run of length 1. A run holds at
+// most max_run_length elements and a leaf (past its first run) at most
+// leaf_element_capacity, so no node is large to copy.
+//
+// A run-start index (11A.5) maps (actor, counter) → leaf so that RGA merge
+// and pred resolution find an element's position in O(log n) without
+// scanning the sequence.
+//
+// Runs and the run index hold CompactOpIds against the tree's own
+// ActorTable; OpIds are rebuilt only when an element leaves the tree.
+//
+// A leaf stores its runs as parallel arrays (see Runs): descending the
+// tree and locating a position scans only the packed lengths and flags.
+//
+// Copies share nodes (see EditToken): copying a tree is O(1), and an edit
+// copies only the nodes on its root-to-leaf path that another copy may see,
+// so a document whose objects are shared with a snapshot or fork still
+// edits in O(log n). Nodes therefore have no parent or sibling pointers:
+// the run index names a leaf by a node id that survives copying, a
+// persistent map from node id to parent id leads from it back to the root,
+// and iterators find the next leaf by position.
+//
+// Leaf run arrays and the indexes allocate from the tree's memory resource
+// (the document's). As with std::pmr containers, a copy or move keeps the
+// source's resource unless one is given, and assignment keeps the target's;
+// a copy onto another resource copies every node.
+
+#include <automerge-cpp/read_view.hpp>
+#include <automerge-cpp/types.hpp>
+#include <automerge-cpp/value.hpp>
+#include <automerge-cpp/value_ref.hpp>
+#include "actor_table.hpp"
+#include "edit_token.hpp"
+#include "persistent_map.hpp"
+#include "persistent_vector.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace automerge_cpp::detail {
+
+// An element in a list or text sequence.
+struct ListElement {
+    OpId insert_id;
+    std::optional<OpId> insert_after;  // which element this was inserted after (nullopt = HEAD)
+    Value value;
+    bool visible = true;
+};
+
+class SequenceTree {
+public:
+    static constexpr std::size_t leaf_capacity = 64;  // runs per leaf
+    static constexpr std::size_t node_capacity = 32;
+    static constexpr std::size_t max_run_length = 4096;         // elements per run
+    static constexpr std::size_t leaf_element_capacity = 4096;  // elements per leaf of several runs
+
+private:
+    // What one element of a run holds. Text, real and integer runs store
+    // their elements' values packed: one string of bytes, or one array of
+    // doubles or int64s. A run of any other value has length 1.
+    enum class Kind : std::uint8_t {
+        element,  // any value
+        text,     // single-byte strings
+        real,     // doubles
+        integer,  // int64s
+    };
+
+    // The part of a run that position scans read: its length and flags,
+    // packed into one word.
+    struct Span {
+        std::uint64_t length : 61;
+        std::uint64_t visible : 1;
+        std::uint64_t kind : 2;
+
+        static auto make(std::size_t length, bool visible, Kind kind) -> Span {
+            auto span = Span{};
+            span.length = length;
+            span.visible = visible;
+            span.kind = static_cast<std::uint64_t>(kind);
+            return span;
+        }
+
+        auto run_kind() const -> Kind { return static_cast<Kind>(kind); }
+
+        // Visible elements in the run, without a branch.
+        auto visible_length() const -> std::size_t { return length & -std::uint64_t{visible}; }
+    };
+
+    // A run of elements e[0..length). e[i] has id (first_id.counter + i,
+    // first_id.actor) and, for i > 0, was inserted after e[i-1].
+    struct RunIds {
+        CompactOpId first_id;
+        CompactOpId insert_after;          // origin of e[0]; none for HEAD
+    };
+
+    // A run's values: the sole element's value, the text run bytes, or
+    // (for a real or integer run of more than one element) the numbers.
+    using Payload = std::variant<Value, std::vector<double>, std::vector<std::int64_t>>;
+
+    // A whole run, as it enters a leaf.
+    struct Run {
+        Span span;
+        RunIds ids;
+        Payload payload;
+    };
+
+    // A leaf's runs, stored as parallel arrays. The scans that map positions
+    // to runs (run_at, find_visible, visible_rank, position_of, recount)
+    // read only the spans, eight bytes a run, so a full leaf's worth is a
+    // few cache lines; ids are read by lookups and merge checks, and values
+    // only when an element itself is read.
+    class Runs {
+    public:
+        explicit Runs(std::pmr::memory_resource* resource)
+            : spans_{resource}, ids_{resource}, payloads_{resource} {}
+        Runs(const Runs& other, std::pmr::memory_resource* resource)
+            : spans_{other.spans_, resource}, ids_{other.ids_, resource}
+            , payloads_{other.payloads_, resource} {}
+
+        auto size() const -> std::size_t { return spans_.size(); }
+        auto empty() const -> bool { return spans_.empty(); }
+
+        auto spans() const -> std::span<const Span> { return spans_; }
+        auto span(std::size_t i) -> Span& { return spans_[i]; }
+        auto span(std::size_t i) const -> const Span& { return spans_[i]; }
+        auto ids(std::size_t i) const -> const RunIds& { return ids_[i]; }
+        auto payload(std::size_t i) -> Payload& { return payloads_[i]; }
+
+        auto length(std::size_t i) const -> std::size_t { return spans_[i].length; }
+        auto visible(std::size_t i) const -> bool { return spans_[i].visible; }
+        auto kind(std::size_t i) const -> Kind { return spans_[i].run_kind(); }
+        auto text(std::size_t i) const -> bool { return kind(i) == Kind::text; }
+
+        auto id_at(std::size_t i, std::size_t k) const -> CompactOpId {
+            const auto& first = ids_[i].first_id;
+            return CompactOpId{.counter = first.counter + k, .actor = first.actor};
+        }
+
+        auto origin_at(std::size_t i, std::size_t k) const -> CompactOpId {
+            return k == 0 ? ids_[i].insert_after : id_at(i, k - 1);
+        }
+
+        // The run's value, if it is not a packed number array.
+        auto value(std::size_t i) const -> const Value* { return std::get_if<Value>(&payloads_[i]); }
+
+        auto bytes(std::size_t i) -> std::string& { return string_of(payloads_[i]); }
+        auto bytes(std::size_t i) const -> const std::string& {
+            return std::get<std::string>(std::get<ScalarValue>(std::get<Value>(payloads_[i])));
+        }
+
+        // The numbers of a real (T = double) or integer (T = int64_t) run.
+        template <typename T>
+        auto numbers(std::size_t i) const -> std::span<const T> {
+            if (const auto* packed = std::get_if<std::vector<T>>(&payloads_[i])) return *packed;
+            return std::span<const T>{&std::get<T>(std::get<ScalarValue>(std::get<Value>(payloads_[i]))), 1};
+        }
+
+        auto value_at(std::size_t i, std::size_t k) const -> Value {
+            switch (kind(i)) {
+                case Kind::text: return Value{ScalarValue{std::string(1, bytes(i)[k])}};
+                case Kind::real: return Value{ScalarValue{numbers<double>(i)[k]}};
+                case Kind::integer: return Value{ScalarValue{numbers<std::int64_t>(i)[k]}};
+                case Kind::element: break;
+            }
+            return *value(i);
+        }
+
+        // Element k's value, borrowed: a text run element is a one-byte view
+        // of the run's buffer.
+        auto value_ref_at(std::size_t i, std::size_t k) const -> ValueRef {
+            switch (kind(i)) {
+                case Kind::text:
+                    return ValueRef{std::in_place_index<1>, std::in_place_type<std::string_view>,
+                                    std::string_view{bytes(i)}.substr(k, 1)};
+                case Kind::real:
+                    return ValueRef{std::in_place_index<1>, std::in_place_type<double>,
+                                    numbers<double>(i)[k]};
+                case Kind::integer:
+                    return ValueRef{std::in_place_index<1>, std::in_place_type<std::int64_t>,
+                                    numbers<std::int64_t>(i)[k]};
+                case Kind::element: break;
+            }
+            return automerge_cpp::value_ref(*value(i));
+        }
+
+        auto element(std::size_t i, std::size_t k, const ActorTable& actors) const -> ListElement {
+            return ListElement{.insert_id = actors.to_op_id(id_at(i, k)),
+                               .insert_after = actors.to_optional_op_id(origin_at(i, k)),
+                               .value = value_at(i, k), .visible = visible(i)};
+        }
+
+        // Overwrite element k of a text, real or integer run with a value of
+        // the run's kind.
+        void set_packed(std::size_t i, std::size_t k, const Value& value) {
+            const auto& sv = std::get<ScalarValue>(value);
+            switch (kind(i)) {
+                case Kind::text: bytes(i)[k] = std::get<std::string>(sv).front(); break;
+                case Kind::real: numbers_mut<double>(i)[k] = std::get<double>(sv); break;
+                case Kind::integer: numbers_mut<std::int64_t>(i)[k] = std::get<std::int64_t>(sv); break;
+                case Kind::element: assert(false && "not a packed run"); break;
+            }
+        }
+
+        // Append the elements of payload, of the same kind as run i, to it.
+        void extend(std::size_t i, std::size_t length, Payload&& payload) {
+            switch (kind(i)) {
+                case Kind::text: bytes(i) += string_of(payload); break;
+                case Kind::real: append_numbers<double>(i, payload); break;
+                case Kind::integer: append_numbers<std::int64_t>(i, payload); break;
+                case Kind::element: assert(false && "not a packed run"); break;
+            }
+            spans_[i].length += length;
+        }
+
+        // Truncate packed run i to its first `at` elements, returning the
+        // payload of the rest.
+        auto split_payload(std::size_t i, std::size_t at) -> Payload {
+            switch (kind(i)) {
+                case Kind::text: {
+                    auto tail = Value{ScalarValue{bytes(i).substr(at)}};
+                    bytes(i).resize(at);
+                    return tail;
+                }
+                case Kind::real: return split_numbers<double>(i, at);
+                case Kind::integer: return split_numbers<std::int64_t>(i, at);
+                case Kind::element: break;
+            }
+            assert(false && "not a packed run");
+            return Payload{};
+        }
+
+        void insert(std::size_t i, Run run) {
+            const auto at = static_cast<std::ptrdiff_t>(i);
+            spans_.insert(spans_.begin() + at, run.span);
+            ids_.insert(ids_.begin() + at, run.ids);
+            payloads_.insert(payloads_.begin() + at, std::move(run.payload));
+        }
+
+        void erase(std::size_t i) {
+            const auto at = static_cast<std::ptrdiff_t>(i);
+            spans_.erase(spans_.begin() + at);
+            ids_.erase(ids_.begin() + at);
+            payloads_.erase(payloads_.begin() + at);
+        }
+
+        // Move runs [from, size()) into the empty other.
+        void move_tail(std::size_t from, Runs& other) {
+            assert(other.empty());
+            const auto at = static_cast<std::ptrdiff_t>(from);
+            other.spans_.assign(spans_.begin() + at, spans_.end());
+            other.ids_.assign(ids_.begin() + at, ids_.end());
+            other.payloads_.assign(std::make_move_iterator(payloads_.begin() + at),
+                                   std::make_move_iterator(payloads_.end()));
+            spans_.resize(from);
+            ids_.resize(from);
+            payloads_.resize(from);
+        }
+
+        // Heap bytes held, including text and number buffers.
+        auto memory_usage() const -> std::size_t {
+            auto bytes = spans_.capacity() * sizeof(Span) + ids_.capacity() * sizeof(RunIds)
+                       + payloads_.capacity() * sizeof(Payload);
+            for (std::size_t i = 0; i < size(); ++i) {
+                bytes += std::visit(overload{
+                    [&](const Value&) { return text(i) ? this->bytes(i).capacity() : std::size_t{0}; },
+                    [](const auto& packed) { return packed.capacity() * sizeof(packed[0]); },
+                }, payloads_[i]);
+            }
+            return bytes;
+        }
+
+    private:
+        static auto string_of(Payload& payload) -> std::string& {
+            return std::get<std::string>(std::get<ScalarValue>(std::get<Value>(payload)));
+        }
+
+        // The numbers of run i as a mutable array, packing a lone value.
+        template <typename T>
+        auto numbers_mut(std::size_t i) -> std::vector<T>& {
+            auto& payload = payloads_[i];
+            if (auto* value = std::get_if<Value>(&payload)) {
+                const auto single = std::get<T>(std::get<ScalarValue>(*value));
+                payload = std::vector<T>{single};
+            }
+            return std::get<std::vector<T>>(payload);
+        }
+
+        template <typename T>
+        void append_numbers(std::size_t i, const Payload& payload) {
+            auto& packed = numbers_mut<T>(i);
+            if (const auto* value = std::get_if<Value>(&payload)) {
+                packed.push_back(std::get<T>(std::get<ScalarValue>(*value)));
+            } else {
+                const auto& more = std::get<std::vector<T>>(payload);
+                packed.insert(packed.end(), more.begin(), more.end());
+            }
+        }
+
+        template <typename T>
+        auto split_numbers(std::size_t i, std::size_t at) -> Payload {
+            auto& packed = std::get<std::vector<T>>(payloads_[i]);
+            auto tail = std::vector<T>(packed.begin() + static_cast<std::ptrdiff_t>(at), packed.end());
+            packed.resize(at);
+            return tail;
+        }
+
+        std::pmr::vector<Span> spans_;
+        std::pmr::vector<RunIds> ids_;
+        std::pmr::vector<Payload> payloads_;
+    };
+
+    // Nodes are shared between copies of a tree; a tree changes only the
+    // nodes carrying its edit token and copies any other on the way down.
+    struct Node {
+        explicit Node(std::pmr::memory_resource* resource) : runs{resource} {}
+        Node(const Node& other, std::pmr::memory_resource* resource)
+            : id{other.id}, size{other.size}, visible{other.visible}
+            , runs{other.runs, resource}, children{other.children}, is_leaf{other.is_leaf} {}
+
+        std::uint64_t edit = 0;                        // see EditToken
+        std::uint32_t id = 0;                          // kept by copies of the node
+        std::size_t size = 0;                          // elements in subtree
+        std::size_t visible = 0;                       // visible elements in subtree
+        Runs runs;                                     // leaves only
+        std::vector<std::shared_ptr<Node>> children;   // internal nodes only
+        bool is_leaf = true;
+    };
+
+    using RunKey = std::pair<std::uint32_t, std::uint64_t>;  // (actor index, first counter)
+
+    static constexpr auto no_parent = ~std::uint32_t{0};
+
+    // A root-to-leaf path of nodes this tree owns, with each node's index
+    // among its parent's children. Splits keep nodes at least half full, so
+    // a tree of depth max_depth would hold over 16^15 leaves.
+    static constexpr std::size_t max_depth = 16;
+    struct Path {
+        std::array<Node*, max_depth> nodes{};
+        std::array<std::size_t, max_depth> slots{};
+        std::size_t depth = 0;
+
+        void push(Node* node, std::size_t slot) {
+            assert(depth < max_depth);
+            nodes[depth] = node;
+            slots[depth] = slot;
+            ++depth;
+        }
+        auto leaf() const -> Node& { return *nodes[depth - 1]; }
+    };
+
+public:
+    // -- Iteration -------------------------------------------------------------
+
+    // Forward iterator over elements. Elements are materialized on
+    // dereference; id/origin/visibility are available without copying values.
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ListElement;
+        using difference_type = std::ptrdiff_t;
+        using reference = ListElement;
+
+        struct arrow_proxy {
+            ListElement elem;
+            auto operator->() const -> const ListElement* { return &elem; }
+        };
+        using pointer = arrow_proxy;
+
+        const_iterator() = default;
+
+        auto operator*() const -> reference {
+            return runs().element(run_, offset_, *tree_->actors_);
+        }
+        auto operator->() const -> pointer { return arrow_proxy{**this}; }
+
+        auto insert_id() const -> OpId { return tree_->actors_->to_op_id(runs().id_at(run_, offset_)); }
+        auto insert_after() const -> std::optional<OpId> {
+            return tree_->actors_->to_optional_op_id(runs().origin_at(run_, offset_));
+        }
+        auto visible() const -> bool { return runs().visible(run_); }
+
+        // The element's value, borrowed from the tree: a text run element is
+        // a one-byte view of the run's buffer.
+        auto value_ref() const -> ValueRef { return runs().value_ref_at(run_, offset_); }
+
+        // The string content from this element to the end of its run: the
+        // rest of a text run's buffer, or a string element's value (empty
+        // for any other value).
+        auto run_text() const -> std::string_view {
+            if (runs().text(run_)) return std::string_view{runs().bytes(run_)}.substr(offset_);
+            if (runs().kind(run_) != Kind::element) return {};
+            if (const auto* sv = std::get_if<ScalarValue>(runs().value(run_))) {
+                if (const auto* s = std::get_if<std::string>(sv)) return *s;
+            }
+            return {};
+        }
+
+        // The T values from this element to the end of its run, where T is
+        // double or int64_t: the rest of a real or integer run (empty for
+        // any other run).
+        template <typename T>
+        auto run_numbers() const -> std::span<const T> {
+            if (runs().kind(run_) != kind_of_number<T>()) return {};
+            return runs().template numbers<T>(run_).subspan(offset_);
+        }
+
+        // Advance to the first element of the next run.
+        void next_run() {
+            offset_ = runs().length(run_) - 1;
+            ++*this;
+        }
+
+        // Conversion to and from the opaque position ReadView ranges hold.
+        auto position() const -> SequencePosition {
+            return {leaf_, run_, offset_, tree_, leaf_start_};
+        }
+        explicit const_iterator(const SequencePosition& at)
+            : tree_{static_cast<const SequenceTree*>(at.tree)}
+            , leaf_{static_cast<const Node*>(at.leaf)}
+            , leaf_start_{at.leaf_start}, run_{at.run}, offset_{at.offset} {}
+
+        auto operator++() -> const_iterator& {
+            if (++offset_ >= runs().length(run_)) {
+                offset_ = 0;
+                if (++run_ >= leaf_->runs.size()) [[unlikely]] next_leaf();
+            }
+            return *this;
+        }
+
+        auto operator++(int) -> const_iterator {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        auto operator==(const const_iterator&) const -> bool = default;
+
+    private:
+        friend class SequenceTree;
+
+        const_iterator(const SequenceTree* tree, const Node* leaf, std::size_t leaf_start,
+                       std::size_t run, std::size_t offset)
+            : tree_{tree}, leaf_{leaf}, leaf_start_{leaf_start}, run_{run}, offset_{offset} {}
+
+        auto runs() const -> const Runs& { return leaf_->runs; }
+
+        // Leaves have no sibling links (they are shared between copies), so
+        // stepping past a leaf's last run locates the next leaf from the
+        // root: O(log n) once per leaf. Kept out of line so that ++ inlines.
+        [[gnu::noinline]] void next_leaf() { *this = tree_->iterator_at(leaf_start_ + leaf_->size); }
+
+        const SequenceTree* tree_ = nullptr;
+        const Node* leaf_ = nullptr;
+        std::size_t leaf_start_ = 0;  // real position of the leaf's first element
+        std::size_t run_ = 0;
+        std::size_t offset_ = 0;
+    };
+
+    // -- Construction ----------------------------------------------------------
+
+    // The actor table is allocated by the first insert: every map object
+    // holds an (empty) tree too.
+    SequenceTree() : SequenceTree{std::pmr::get_default_resource()} {}
+
+    explicit SequenceTree(std::pmr::memory_resource* resource)
+        : resource_{resource}, run_index_{resource}, parents_{resource} {
+        root_ = make_node(true);
+    }
+
+    SequenceTree(const SequenceTree& other) : SequenceTree{other, other.resource_} {}
+
+    // O(1) on the same resource: the copies share every node.
+    SequenceTree(const SequenceTree& other, std::pmr::memory_resource* resource)
+        : resource_{resource}
+        , actors_{other.actors_}
+        , run_index_{other.run_index_, resource}
+        , parents_{other.parents_, resource}
+        , edit_{other.edit_} {
+        root_ = *resource == *other.resource_ ? other.root_ : deep_copy(*other.root_);
+    }
+
+    auto operator=(const SequenceTree& other) -> SequenceTree& {
+        if (this != &other) *this = SequenceTree{other, resource_};
+        return *this;
+    }
+
+    // The moved-from tree is left empty.
+    SequenceTree(SequenceTree&& other) noexcept
+        : resource_{other.resource_}
+        , actors_{std::move(other.actors_)}
+        , actors_edit_{other.actors_edit_}
+        , root_{std::move(other.root_)}
+        , run_index_{std::move(other.run_index_)}
+        , parents_{std::move(other.parents_)}
+        , edit_{std::move(other.edit_)} {
+        other.reset();
+    }
+
+    // From a tree on another resource this copies, keeping this tree's.
+    auto operator=(SequenceTree&& other) -> SequenceTree& {
+        if (this == &other) return *this;
+        if (*resource_ != *other.resource_) return *this = std::as_const(other);
+        actors_ = std::move(other.actors_);
+        actors_edit_ = other.actors_edit_;
+        root_ = std::move(other.root_);
+        run_index_ = std::move(other.run_index_);
+        parents_ = std::move(other.parents_);
+        edit_ = std::move(other.edit_);
+        other.reset();
+        return *this;
+    }
+
+    ~SequenceTree() = default;
+
+    auto resource() const -> std::pmr::memory_resource* { return resource_; }
+
+    // Build a tree from elements in order. O(n).
+    template <typename Range>
+    static auto from_elements(Range&& range,
+                              std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        -> SequenceTree {
+        auto tree = SequenceTree{resource};
+        for (auto&& elem : range) {
+            tree.push_back(std::forward<decltype(elem)>(elem));
+        }
+        return tree;
+    }
+
+    // -- Size queries ----------------------------------------------------------
+
+    auto size() const -> std::size_t { return root_->size; }
+    auto visible_size() const -> std::size_t { return root_->visible; }
+    auto empty() const -> bool { return root_->size == 0; }
+
+    // Number of stored runs (== size() when no text runs have formed).
+    auto run_count() const -> std::size_t { return run_index_.size(); }
+
+    // Approximate heap bytes held by the tree: nodes, run storage, text run
+    // bytes and the indexes. Nodes shared with a copy are counted by both.
+    auto memory_usage() const -> std::size_t {
+        return node_memory(*root_) + run_index_.memory_usage() + parents_.memory_usage()
+             + (actors_ ? sizeof(ActorTable) + actors_->memory_usage() : 0);
+    }
+
+    auto begin() const -> const_iterator { return iterator_at(0); }
+    auto end() const -> const_iterator { return const_iterator{}; }
+
+    // -- Positional access -----------------------------------------------------
+
+    // Element at a real (tombstone-inclusive) position. O(log n).
+    auto at(std::size_t pos) const -> ListElement {
+        return *iterator_at(pos);
+    }
+
+    auto operator[](std::size_t pos) const -> ListElement { return at(pos); }
+
+    // Iterator to the element at real position pos (pos == size() → end()).
+    auto iterator_at(std::size_t pos) const -> const_iterator {
+        if (pos >= size()) return end();
+        auto [leaf, offset, leaf_start] = locate(pos);
+        auto [run, in_run] = run_at(*leaf, offset);
+        return const_iterator{this, leaf, leaf_start, run, in_run};
+    }
+
+    // Real position of the element an iterator refers to (end() → size()).
+    auto position_of(const_iterator it) const -> std::size_t {
+        if (!it.leaf_) return size();
+        auto pos = it.leaf_start_ + it.offset_;
+        const auto& spans = it.leaf_->runs.spans();
+        for (std::size_t i = 0; i < it.run_; ++i) pos += spans[i].length;
+        return pos;
+    }
+
+    // Real position of the element with the given insert_id, or nullopt if
+    // it is not in the sequence. O(log n).
+    auto find(const OpId& id) const -> std::optional<std::size_t> {
+        auto it = find_iterator(id);
+        if (it == end()) return std::nullopt;
+        return position_of(it);
+    }
+
+    // Iterator to the element with the given insert_id, or end(). O(log n).
+    auto find_iterator(const OpId& op_id) const -> const_iterator {
+        if (!actors_) return end();
+        const auto id = actors_->find_compact(op_id);
+        if (!id) return end();
+        const auto found = run_index_.floor(RunKey{id->actor, id->counter});
+        if (!found || found->first.first != id->actor) return end();
+        const auto start = found->first.second;
+        const auto [leaf, leaf_start] = leaf_by_id(found->second);
+        for (std::size_t i = 0; i < leaf->runs.size(); ++i) {
+            const auto& first = leaf->runs.ids(i).first_id;
+            if (first.counter != start || first.actor != id->actor) continue;
+            if (id->counter - start >= leaf->runs.length(i)) return end();
+            return const_iterator{this, leaf, leaf_start, i, id->counter - start};
+        }
+        assert(false && "run index out of sync");
+        return end();
+    }
+
+    auto contains(const OpId& id) const -> bool { return find_iterator(id) != end(); }
+
+    // Real position of the k-th visible element, or size() if k is past the
+    // last visible element. O(log n).
+    auto find_visible(std::size_t k) const -> std::size_t {
+        if (k >= root_->visible) return root_->size;
+
+        auto pos = std::size_t{0};
+        const auto* node = root_.get();
+        while (!node->is_leaf) {
+            for (const auto& child : node->children) {
+                if (k < child->visible) {
+                    node = child.get();
+                    break;
+                }
+                k -= child->visible;
+                pos += child->size;
+            }
+        }
+        for (const auto& span : node->runs.spans()) {
+            const auto visible = span.visible_length();
+            if (k < visible) return pos + k;
+            k -= visible;
+            pos += span.length;
+        }
+        assert(false && "visible counts out of sync");
+        return root_->size;
+    }
+
+    // Number of visible elements strictly before a real position. O(log n).
+    auto visible_rank(std::size_t pos) const -> std::size_t {
+        assert(pos <= size());
+        auto rank = std::size_t{0};
+        const auto* node = root_.get();
+        while (!node->is_leaf) {
+            auto descended = false;
+            for (const auto& child : node->children) {
+                if (pos < child->size) {
+                    node = child.get();
+                    descended = true;
+                    break;
+                }
+                pos -= child->size;
+                rank += child->visible;
+            }
+            if (!descended) return rank;  // pos == size()
+        }
+        for (const auto& span : node->runs.spans()) {
+            if (pos == 0) break;
+            const auto take = std::min<std::size_t>(pos, span.length);
+            rank += take & -std::uint64_t{span.visible};
+            pos -= take;
+        }
+        return rank;
+    }
+
+    // Append the visible text content (string values concatenated in order).
+    // Text runs are copied as whole buffers.
+    void append_visible_text(std::string& out) const {
+        for_each_leaf(*root_, [&](const Node& leaf) {
+            const auto& runs = leaf.runs;
+            for (std::size_t i = 0; i < runs.size(); ++i) {
+                if (!runs.visible(i)) continue;
+                if (runs.text(i)) {
+                    out += runs.bytes(i);
+                } else if (const auto* sv = std::get_if<ScalarValue>(runs.value(i))) {
+                    if (const auto* s = std::get_if<std::string>(sv)) out += *s;
+                }
+            }
+        });
+    }
+
+    // -- Mutation --------------------------------------------------------------
+
+    // Insert an element before real position pos (pos == size() appends).
+    void insert(std::size_t pos, ListElement elem) {
+        const auto kind = kind_of(elem.value);
+        insert_run(pos, Run{.span = Span::make(1, elem.visible, kind),
+                            .ids = {.first_id = to_compact(elem.insert_id),
+                                    .insert_after = to_compact(elem.insert_after)},
+                            .payload = std::move(elem.value)});
+    }
+
+    // Insert bytes.size() visible text elements before real position pos:
+    // element i has counter first_id.counter + i and is inserted after
+    // element i - 1 (the first after insert_after). Stored as one run per
+    // max_run_length bytes.
+    void insert_text(std::size_t pos, OpId first_id, std::optional<OpId> insert_after,
+                     std::string_view bytes) {
+        assert(!bytes.empty());
+        const auto first = to_compact(first_id);
+        auto origin = to_compact(insert_after);
+        for (std::size_t i = 0; i < bytes.size(); i += max_run_length) {
+            const auto chunk = bytes.substr(i, max_run_length);
+            insert_run(pos + i, Run{.span = Span::make(chunk.size(), true, Kind::text),
+                                    .ids = {.first_id = {first.counter + i, first.actor},
+                                            .insert_after = origin},
+                                    .payload = Value{ScalarValue{std::string{chunk}}}});
+            origin = CompactOpId{first.counter + i + chunk.size() - 1, first.actor};
+        }
+    }
+
+    // Insert values.size() visible elements before real position pos,
+    // chained as insert_text does. Consecutive values that pack (single
+    // bytes, doubles, int64s) go in as one run each, so the tree is
+    // descended once per run rather than once per element.
+    void insert_values(std::size_t pos, OpId first_id, std::optional<OpId> insert_after,
+                       std::span<const Value> values) {
+        const auto first = to_compact(first_id);
+        auto origin = to_compact(insert_after);
+        for (std::size_t i = 0; i < values.size();) {
+            const auto kind = kind_of(values[i]);
+            auto end = i + 1;
+            if (kind != Kind::element) {
+                while (end < values.size() && end - i < max_run_length &&
+                       kind_of(values[end]) == kind) {
+                    ++end;
+                }
+            }
+            const auto length = end - i;
+            auto payload = length == 1 ? Payload{values[i]} : pack(kind, values.subspan(i, length));
+            insert_run(pos + i, Run{.span = Span::make(length, true, kind),
+                                    .ids = {.first_id = {first.counter + i, first.actor},
+                                            .insert_after = origin},
+                                    .payload = std::move(payload)});
+            origin = CompactOpId{first.counter + end - 1, first.actor};
+            i = end;
+        }
+    }
+
+    void push_back(ListElement elem) { insert(size(), std::move(elem)); }
+
+    void set_visible(std::size_t pos, bool visible) {
+        if (iterator_at(pos).visible() == visible) return;  // copy nothing for a no-op
+
+        auto [path, offset] = descend(pos);
+        auto& leaf = path.leaf();
+        auto [ri, in_run] = run_at(leaf, offset);
+        ri = isolate(leaf, ri, in_run);
+        leaf.runs.span(ri).visible = visible;
+        if (visible) {
+            adjust_counts(path, 0, 1);
+        } else {
+            for (std::size_t i = 0; i < path.depth; ++i) --path.nodes[i]->visible;
+        }
+        coalesce(leaf, ri);
+        if (overfull(leaf)) split(path, path.depth - 1);
+    }
+
+    void set_value(std::size_t pos, Value value) {
+        auto [path, offset] = descend(pos);
+        auto& leaf = path.leaf();
+        auto [ri, in_run] = run_at(leaf, offset);
+        const auto kind = kind_of(value);
+        if (kind != Kind::element && leaf.runs.kind(ri) == kind) {
+            leaf.runs.set_packed(ri, in_run, value);
+            return;
+        }
+
+        ri = isolate(leaf, ri, in_run);
+        leaf.runs.span(ri).kind = static_cast<std::uint64_t>(kind);
+        leaf.runs.payload(ri) = std::move(value);
+        if (overfull(leaf)) split(path, path.depth - 1);
+    }
+
+private:
+    // -- Run helpers -----------------------------------------------------------
+
+    void insert_run(std::size_t pos, Run run) {
+        assert(pos <= size());
+        auto [path, offset] = descend(pos);
+        auto& leaf = path.leaf();
+        auto [ri, in_run] = run_at(leaf, offset);
+        const std::size_t length = run.span.length;
+        const auto visible = run.span.visible_length();
+
+        // Fast path: typing continues the run that ends at the insertion point
+        if (in_run == 0 && ri > 0 && mergeable(leaf.runs, ri - 1, run.span, run.ids)) {
+            leaf.runs.extend(ri - 1, length, std::move(run.payload));
+            adjust_counts(path, length, visible);
+            if (overfull(leaf)) split(path, path.depth - 1);
+            return;
+        }
+
+        if (in_run > 0) {
+            split_run(leaf, ri, in_run);
+            ++ri;
+        }
+        run_index_.assign(key_of(run.ids), leaf.id);
+        leaf.runs.insert(ri, std::move(run));
+        adjust_counts(path, length, visible);
+        coalesce(leaf, ri);
+        if (overfull(leaf)) split(path, path.depth - 1);
+    }
+
+    // The kind of run a lone element with this value forms.
+    static auto kind_of(const Value& value) -> Kind {
+        const auto* sv = std::get_if<ScalarValue>(&value);
+        if (!sv) return Kind::element;
+        if (const auto* s = std::get_if<std::string>(sv)) {
+            return s->size() == 1 ? Kind::text : Kind::element;
+        }
+        if (std::holds_alternative<double>(*sv)) return Kind::real;
+        if (std::holds_alternative<std::int64_t>(*sv)) return Kind::integer;
+        return Kind::element;
+    }
+
+    // The payload of a run of several values, all of packable kind.
+    static auto pack(Kind kind, std::span<const Value> values) -> Payload {
+        auto scalar = [](const Value& v) -> const ScalarValue& { return std::get<ScalarValue>(v); };
+        switch (kind) {
+            case Kind::text: {
+                auto bytes = std::string{};
+                bytes.reserve(values.size());
+                for (const auto& v : values) bytes += std::get<std::string>(scalar(v));
+                return Value{ScalarValue{std::move(bytes)}};
+            }
+            case Kind::real: {
+                auto numbers = std::vector<double>{};
+                numbers.reserve(values.size());
+                for (const auto& v : values) numbers.push_back(std::get<double>(scalar(v)));
+                return numbers;
+            }
+            case Kind::integer: {
+                auto numbers = std::vector<std::int64_t>{};
+                numbers.reserve(values.size());
+                for (const auto& v : values) numbers.push_back(std::get<std::int64_t>(scalar(v)));
+                return numbers;
+            }
+            case Kind::element: break;
+        }
+        assert(false && "element values do not pack");
+        return {};
+    }
+
+    template <typename T>
+    static constexpr auto kind_of_number() -> Kind {
+        static_assert(std::is_same_v<T, double> || std::is_same_v<T, std::int64_t>);
+        return std::is_same_v<T, double> ? Kind::real : Kind::integer;
+    }
+
+    static auto key_of(const RunIds& ids) -> RunKey {
+        return RunKey{ids.first_id.actor, ids.first_id.counter};
+    }
+
+    // Can the run (span, ids) be appended to run i as one run?
+    static auto mergeable(const Runs& runs, std::size_t i, const Span& span, const RunIds& ids)
+        -> bool {
+        const auto& a = runs.span(i);
+        const auto& first = runs.ids(i).first_id;
+        return a.kind == span.kind && a.run_kind() != Kind::element && a.visible == span.visible &&
+               a.length + span.length <= max_run_length &&
+               ids.first_id.actor == first.actor &&
+               ids.first_id.counter == first.counter + a.length &&
+               ids.insert_after == runs.id_at(i, a.length - 1);
+    }
+
+    // Split run ri of a leaf so that its element at `at` starts a new run.
+    void split_run(Node& leaf, std::size_t ri, std::size_t at) {
+        auto& runs = leaf.runs;
+        auto& head = runs.span(ri);
+        assert(head.run_kind() != Kind::element && at > 0 && at < head.length);
+        auto tail = Run{.span = Span::make(head.length - at, head.visible, head.run_kind()),
+                        .ids = {.first_id = runs.id_at(ri, at), .insert_after = runs.id_at(ri, at - 1)},
+                        .payload = runs.split_payload(ri, at)};
+        head.length = at;
+        run_index_.assign(key_of(tail.ids), leaf.id);
+        runs.insert(ri + 1, std::move(tail));
+    }
+
+    // Split as needed so the element at (ri, in_run) is a run of its own.
+    // Returns its run index.
+    auto isolate(Node& leaf, std::size_t ri, std::size_t in_run) -> std::size_t {
+        if (in_run > 0) {
+            split_run(leaf, ri, in_run);
+            ++ri;
+        }
+        if (leaf.runs.length(ri) > 1) split_run(leaf, ri, 1);
+        return ri;
+    }
+
+    // Merge run ri with its neighbours in the same leaf where possible.
+    void coalesce(Node& leaf, std::size_t ri) {
+        const auto& runs = leaf.runs;
+        if (ri + 1 < runs.size() && mergeable(runs, ri, runs.span(ri + 1), runs.ids(ri + 1))) {
+            absorb_next(leaf, ri);
+        }
+        if (ri > 0 && mergeable(runs, ri - 1, runs.span(ri), runs.ids(ri))) {
+            absorb_next(leaf, ri - 1);
+        }
+    }
+
+    void absorb_next(Node& leaf, std::size_t ri) {
+        auto& runs = leaf.runs;
+        runs.extend(ri, runs.length(ri + 1), std::move(runs.payload(ri + 1)));
+        run_index_.erase(key_of(runs.ids(ri + 1)));
+        runs.erase(ri + 1);
+    }
+
+    // -- Actor table -----------------------------------------------------------
+
+    // Index of actor in the table, adding it if new. The table is shared
+    // with copies of the tree like a node, and copied before it grows if
+    // this tree did not make it. Tables only grow, so an older copy's
+    // indices mean the same in a newer one.
+    auto intern(const ActorId& actor) -> std::uint32_t {
+        if (actors_) {
+            if (auto index = actors_->find(actor)) return *index;
+        }
+        if (!actors_) {
+            actors_ = std::make_shared<ActorTable>();
+        } else if (actors_edit_ != edit_.value()) {
+            actors_ = std::make_shared<ActorTable>(*actors_);
+        }
+        actors_edit_ = edit_.value();
+        return actors_->intern(actor);
+    }
+
+    auto to_compact(const OpId& id) -> CompactOpId {
+        return CompactOpId{.counter = id.counter, .actor = intern(id.actor)};
+    }
+
+    auto to_compact(const std::optional<OpId>& id) -> CompactOpId {
+        return id ? to_compact(*id) : CompactOpId{};
+    }
+
+    // -- Tree helpers ----------------------------------------------------------
+
+    // A new node with the next id, owned by this tree.
+    auto make_node(bool is_leaf) -> std::shared_ptr<Node> {
+        auto node = std::make_shared<Node>(resource_);
+        node->edit = edit_.value();
+        node->id = static_cast<std::uint32_t>(parents_.size());
+        node->is_leaf = is_leaf;
+        parents_.push_back(no_parent);
+        return node;
+    }
+
+    // The node in slot, copied first if another copy of the tree may see it.
+    auto own(std::shared_ptr<Node>& slot) -> Node& {
+        if (slot->edit != edit_.value()) {
+            slot = std::make_shared<Node>(*slot, resource_);
+            slot->edit = edit_.value();
+        }
+        return *slot;
+    }
+
+    // Empty, as a new tree (after a move).
+    void reset() {
+        actors_.reset();
+        run_index_.clear();
+        parents_.clear();
+        root_ = make_node(true);
+    }
+
+    // The child of an internal node holding the element at offset pos of
+    // the node; pos becomes the offset within the child. Past the end, the
+    // last child takes the remainder.
+    static auto child_at(const Node& node, std::size_t& pos) -> std::size_t {
+        const auto last = node.children.size() - 1;
+        auto c = std::size_t{0};
+        for (; c < last && pos >= node.children[c]->size; ++c) pos -= node.children[c]->size;
+        return c;
+    }
+
+    struct Location {
+        const Node* leaf;
+        std::size_t offset;      // of pos within the leaf
+        std::size_t leaf_start;  // position of the leaf's first element
+    };
+
+    // The leaf holding real position pos. For pos == size() this is one
+    // past the end of the last leaf.
+    auto locate(std::size_t pos) const -> Location {
+        const auto* node = root_.get();
+        auto start = pos;
+        while (!node->is_leaf) node = node->children[child_at(*node, pos)].get();
+        return {node, pos, start - pos};
+    }
+
+    // As locate, for writing: the path to the leaf, owned by this tree.
+    auto descend(std::size_t pos) -> std::pair<Path, std::size_t> {
+        auto path = Path{};
+        auto* node = &own(root_);
+        path.push(node, 0);
+        while (!node->is_leaf) {
+            const auto c = child_at(*node, pos);
+            node = &own(node->children[c]);
+            path.push(node, c);
+        }
+        return {path, pos};
+    }
+
+    // The leaf with the given id and the position of its first element:
+    // up through the parent map to the root, then down again summing the
+    // sizes of the children before each node on the way.
+    auto leaf_by_id(std::uint32_t id) const -> std::pair<const Node*, std::size_t> {
+        auto chain = std::array<std::uint32_t, max_depth>{};
+        auto depth = std::size_t{0};
+        for (auto at = id; at != no_parent; at = parents_[at]) {
+            assert(depth < max_depth);
+            chain[depth++] = at;
+        }
+        assert(chain[depth - 1] == root_->id);
+        const auto* node = root_.get();
+        auto start = std::size_t{0};
+        for (auto level = depth - 1; level-- > 0;) {
+            for (const auto& child : node->children) {
+                if (child->id == chain[level]) {
+                    node = child.get();
+                    break;
+                }
+                start += child->size;
+            }
+        }
+        return {node, start};
+    }
+
+    // Run index and offset within it for an in-leaf element offset. An
+    // offset equal to the leaf size maps to (runs.size(), 0).
+    static auto run_at(const Node& leaf, std::size_t offset) -> std::pair<std::size_t, std::size_t> {
+        const auto& spans = leaf.runs.spans();
+        for (std::size_t i = 0; i < spans.size(); ++i) {
+            if (offset < spans[i].length) return {i, offset};
+            offset -= spans[i].length;
+        }
+        return {leaf.runs.size(), 0};
+    }
+
+    static void adjust_counts(const Path& path, std::size_t size, std::size_t visible) {
+        for (std::size_t i = 0; i < path.depth; ++i) {
+            path.nodes[i]->size += size;
+            path.nodes[i]->visible += visible;
+        }
+    }
+
+    // Too many runs, or too many elements in more than one run.
+    static auto overfull(const Node& leaf) -> bool {
+        return leaf.runs.size() > leaf_capacity ||
+               (leaf.size > leaf_element_capacity && leaf.runs.size() > 1);
+    }
+
+    template <typename F>
+    static void for_each_leaf(const Node& node, F&& f) {
+        if (node.is_leaf) {
+            f(node);
+            return;
+        }
+        for (const auto& child : node.children) for_each_leaf(*child, f);
+    }
+
+    static auto node_memory(const Node& node) -> std::size_t {
+        auto bytes = sizeof(Node) + node.runs.memory_usage()
+                   + node.children.capacity() * sizeof(std::shared_ptr<Node>);
+        for (const auto& child : node.children) bytes += node_memory(*child);
+        return bytes;
+    }
+
+    static void recount(Node& node) {
+        node.size = 0;
+        node.visible = 0;
+        if (node.is_leaf) {
+            for (const auto& span : node.runs.spans()) {
+                node.size += span.length;
+                node.visible += span.visible_length();
+            }
+        } else {
+            for (const auto& child : node.children) {
+                node.size += child->size;
+                node.visible += child->visible;
+            }
+        }
+    }
+
+    // Split the overfull node at path level in half, pushing the new right
+    // sibling into the parent (growing a new root if needed) and recursing
+    // upward. The levels above are owned, so only ids are recorded for the
+    // children that move, which may still be shared.
+    void split(const Path& path, std::size_t level) {
+        auto& node = *path.nodes[level];
+        auto right = make_node(node.is_leaf);
+        if (node.is_leaf) {
+            const auto half = node.runs.size() / 2;
+            node.runs.move_tail(half, right->runs);
+            for (std::size_t i = 0; i < right->runs.size(); ++i) {
+                run_index_.assign(key_of(right->runs.ids(i)), right->id);
+            }
+        } else {
+            const auto half = static_cast<std::ptrdiff_t>(node.children.size() / 2);
+            right->children.assign(std::make_move_iterator(node.children.begin() + half),
+                                   std::make_move_iterator(node.children.end()));
+            node.children.erase(node.children.begin() + half, node.children.end());
+            for (const auto& child : right->children) parents_.mut(child->id) = right->id;
+        }
+        recount(node);
+        recount(*right);
+
+        if (level == 0) {
+            auto root = make_node(false);
+            parents_.mut(node.id) = root->id;
+            parents_.mut(right->id) = root->id;
+            root->children.push_back(std::move(root_));
+            root->children.push_back(std::move(right));
+            recount(*root);
+            root_ = std::move(root);
+            return;
+        }
+
+        auto& parent = *path.nodes[level - 1];
+        parents_.mut(right->id) = parent.id;
+        const auto at = static_cast<std::ptrdiff_t>(path.slots[level] + 1);
+        parent.children.insert(parent.children.begin() + at, std::move(right));
+        if (parent.children.size() > node_capacity) split(path, level - 1);
+    }
+
+    // A copy of src and its subtree on this tree's resource, keeping ids.
+    auto deep_copy(const Node& src) const -> std::shared_ptr<Node> {
+        auto node = std::make_shared<Node>(src, resource_);
+        node->edit = edit_.value();
+        for (auto& child : node->children) child = deep_copy(*child);
+        return node;
+    }
+
+    std::pmr::memory_resource* resource_;
+    std::shared_ptr<ActorTable> actors_;  // null while empty; see intern()
+    std::uint64_t actors_edit_ = 0;       // the token actors_ was made under
+    std::shared_ptr<Node> root_;
+    PersistentMap<RunKey, std::uint32_t> run_index_;  // run start → id of its leaf (11A.5)
+    PersistentVector<std::uint32_t> parents_;         // node id → parent's id, or no_parent
+    EditToken edit_;
+};
+
+}  // namespace automerge_cpp::detail
@@ -18,6 +18,7 @@
 #include "columns/raw_column.hpp"
 #include "../encoding/leb128.hpp"
 
+#include <algorithm>
 #include <cstddef>
 #include <cassert>
 #include <cstdint>
@@ -29,28 +30,70 @@
 
 namespace automerge_cpp::storage {
 
-// Serialize a change into its chunk body bytes (not including the chunk envelope).
-inline auto serialize_change_body(const Change& change,
-                                    const std::vector<ActorId>& actor_table)
-    -> std::vector<std::byte> {
+// Compress a column larger than deflate_threshold in place (when that saves
+// space). A compressed column stores its uncompressed length, then the
+// DEFLATE data, and has the deflate bit set in its spec. Level 0 leaves
+// every column uncompressed.
+inline void compress_column(RawColumn& col, int level = default_compression_level) {
+    if (level == 0 || col.data.size() <= deflate_threshold) return;
+    auto compressed = deflate_compress(col.data, level);
+    if (compressed && compressed->size() < col.data.size()) {
+        // Store uncompressed length first, then compressed data
+        auto compressed_col = std::vector<std::byte>{};
+        encoding::encode_uleb128(col.data.size(), compressed_col);
+        compressed_col.insert(compressed_col.end(),
+            compressed->begin(), compressed->end());
+        col.data = std::move(compressed_col);
+        col.spec.deflate = true;
+    }
+}
 
-    auto body = std::vector<std::byte>{};
-    body.reserve(64 + change.operations.size() * 32);
+// compress_column over each of columns.
+inline void compress_columns(std::vector<RawColumn>& columns,
+                             int level = default_compression_level) {
+    if (level == 0) return;
+    for (auto& col : columns) compress_column(col, level);
+}
+
+// Inflate a column view if it is deflated (its data is the uncompressed
+// length, then DEFLATE data), repointing it at buffer, which must outlive
+// the view. Returns false on corrupt data.
+inline auto inflate_column(ColumnView& col, std::vector<std::byte>& buffer) -> bool {
+    if (!col.spec.deflate || col.data.empty()) return true;
+    auto uncomp_len_r = encoding::decode_uleb128(col.data);
+    if (!uncomp_len_r) return false;
+    auto decompressed = deflate_decompress(col.data.subspan(uncomp_len_r->bytes_read),
+                                           std::size_t{64} * 1024 * 1024,
+                                           static_cast<std::size_t>(uncomp_len_r->value));
+    if (!decompressed) return false;
+    buffer = std::move(*decompressed);
+    col.data = buffer;
+    col.spec.deflate = false;
+    return true;
+}
 
-    // Find actor index
-    auto actor_idx = std::uint64_t{0};
-    bool actor_found = false;
-    for (std::size_t i = 0; i < actor_table.size(); ++i) {
-        if (actor_table[i] == change.actor) {
-            actor_idx = static_cast<std::uint64_t>(i);
-            actor_found = true;
-            break;
-        }
+// Inflate every deflated view; inflated holds the buffers (one per view).
+inline auto inflate_columns(std::vector<ColumnView>& columns,
+                            std::vector<std::vector<std::byte>>& inflated) -> bool {
+    inflated.resize(columns.size());
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+        if (!inflate_column(columns[i], inflated[i])) return false;
     }
-    assert(actor_found && "change actor not found in actor_table");
+    return true;
+}
+
+// Serialize a change into its chunk body bytes (not including the chunk
+// envelope). actors is an actor table or its ActorIndex.
+template <typename Actors>
+auto serialize_change_body_with(const Change& change, const Actors& actors,
+                                int compression_level) -> std::vector<std::byte> {
+    AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::column_encode);
+
+    auto body = std::vector<std::byte>{};
+    body.reserve(64 + change.operations.size() * 32);
 
     // Actor index
-    encoding::encode_uleb128(actor_idx, body);
+    encoding::encode_uleb128(find_actor_index(actors, change.actor), body);
 
     // Seq
     encoding::encode_uleb128(change.seq, body);
@@ -77,37 +120,36 @@ inline auto serialize_change_body(const Change& change,
         body.insert(body.end(), dep.bytes.begin(), dep.bytes.end());
     }
 
-    // Number of ops
-    encoding::encode_uleb128(change.operations.size(), body);
+    // Number of ops, as stored
+    encoding::encode_uleb128(stored_op_count(change.operations), body);
 
     // Op columns
-    auto columns = encode_change_ops(change.operations, actor_table);
-
-    // Optionally compress columns > threshold
-    for (auto& col : columns) {
-        if (col.data.size() > deflate_threshold) {
-            auto compressed = deflate_compress(col.data);
-            if (compressed && compressed->size() < col.data.size()) {
-                // Store uncompressed length first, then compressed data
-                auto compressed_col = std::vector<std::byte>{};
-                encoding::encode_uleb128(col.data.size(), compressed_col);
-                compressed_col.insert(compressed_col.end(),
-                    compressed->begin(), compressed->end());
-                col.data = std::move(compressed_col);
-                col.spec.deflate = true;
-            }
-        }
-    }
+    auto columns = encode_change_ops(change.operations, actors);
 
+    compress_columns(columns, compression_level);
     write_raw_columns(columns, body);
 
     return body;
 }
 
+inline auto serialize_change_body(const Change& change,
+                                    const std::vector<ActorId>& actor_table,
+                                    int compression_level = default_compression_level)
+    -> std::vector<std::byte> {
+    return serialize_change_body_with(change, actor_table, compression_level);
+}
+
+inline auto serialize_change_body(const Change& change, const ActorIndex& actor_index,
+                                    int compression_level = default_compression_level)
+    -> std::vector<std::byte> {
+    return serialize_change_body_with(change, actor_index, compression_level);
+}
+
 // Parse a change from its chunk body bytes.
 inline auto parse_change_chunk(std::span<const std::byte> body,
                                  const std::vector<ActorId>& actor_table)
     -> std::optional<Change> {
+    AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::column_decode);
 
     auto pos = std::size_t{0};
 
@@ -171,27 +213,10 @@ inline auto parse_change_chunk(std::span<const std::byte> body,
     auto num_ops = read_uleb();
     if (!num_ops) return std::nullopt;
 
-    // Parse columns
-    auto columns = parse_raw_columns(body, pos);
-
-    // Decompress any deflated columns
-    for (auto& col : columns) {
-        if (col.spec.deflate && !col.data.empty()) {
-            auto col_pos = std::size_t{0};
-            auto uncomp_len_r = encoding::decode_uleb128(
-                std::span<const std::byte>{col.data}.subspan(col_pos));
-            if (!uncomp_len_r) return std::nullopt;
-            col_pos += uncomp_len_r->bytes_read;
-
-            auto compressed = std::vector<std::byte>(
-                col.data.begin() + static_cast<std::ptrdiff_t>(col_pos),
-                col.data.end());
-            auto decompressed = deflate_decompress(compressed);
-            if (!decompressed) return std::nullopt;
-            col.data = std::move(*decompressed);
-            col.spec.deflate = false;
-        }
-    }
+    // Parse columns (in place; only deflated columns are copied out)
+    auto columns = parse_column_views(body, pos);
+    auto inflated = std::vector<std::vector<std::byte>>{};
+    if (!inflate_columns(columns, inflated)) return std::nullopt;
 
     // Decode ops
     auto operations = decode_change_ops(columns, actor_table,
@@ -210,4 +235,100 @@ inline auto parse_change_chunk(std::span<const std::byte> body,
     };
 }
 
+// The stored op count of a change chunk body, read from its header without
+// decoding the ops. nullopt on malformed data.
+inline auto change_chunk_op_count(std::span<const std::byte> body)
+    -> std::optional<std::size_t> {
+    auto pos = std::size_t{0};
+    auto read_uleb = [&]() -> std::optional<std::uint64_t> {
+        if (pos >= body.size()) return std::nullopt;
+        auto r = encoding::decode_uleb128(body.subspan(pos));
+        if (!r) return std::nullopt;
+        pos += r->bytes_read;
+        return r->value;
+    };
+
+    // Actor index, seq, start op, timestamp
+    if (!read_uleb() || !read_uleb() || !read_uleb()) return std::nullopt;
+    if (pos >= body.size()) return std::nullopt;
+    auto timestamp = encoding::decode_sleb128(body.subspan(pos));
+    if (!timestamp) return std::nullopt;
+    pos += timestamp->bytes_read;
+
+    // Message and deps
+    auto msg_len = read_uleb();
+    if (!msg_len || *msg_len > body.size() - pos) return std::nullopt;
+    pos += static_cast<std::size_t>(*msg_len);
+    auto num_deps = read_uleb();
+    if (!num_deps || *num_deps > (body.size() - pos) / 32) return std::nullopt;
+    pos += static_cast<std::size_t>(*num_deps) * 32;
+    auto num_ops = read_uleb();
+    if (!num_ops) return std::nullopt;
+    return static_cast<std::size_t>(*num_ops);
+}
+
+// -- Standalone change chunks -------------------------------------------------
+//
+// A change chunk (ChunkType::change) carries one change with its own actor
+// table, so it can be read without the document it came from:
+//   ULEB128 actor count, then (ULEB128 length, actor bytes) per actor,
+//   then the change body (serialize_change_body against that table).
+// The change's own actor comes first, then every other actor its ops name.
+
+inline auto change_actor_table(const Change& change) -> std::vector<ActorId> {
+    auto actors = std::vector<ActorId>{change.actor};
+    auto add = [&](const ActorId& actor) {
+        if (std::ranges::find(actors, actor) == actors.end()) actors.push_back(actor);
+    };
+    for (const auto& op : change.operations) {
+        if (!op.obj.is_root()) add(std::get<OpId>(op.obj.inner).actor);
+        if (op.insert_after) add(op.insert_after->actor);
+        for (const auto& pred : op.pred) add(pred.actor);
+    }
+    return actors;
+}
+
+// Append a complete change chunk (envelope included) for change to output.
+inline void write_change_chunk(const Change& change, std::vector<std::byte>& output,
+                               int compression_level = default_compression_level) {
+    auto actors = change_actor_table(change);
+    auto body = std::vector<std::byte>{};
+    encoding::encode_uleb128(actors.size(), body);
+    for (const auto& actor : actors) {
+        encoding::encode_uleb128(ActorId::size, body);
+        body.insert(body.end(), actor.bytes.begin(), actor.bytes.end());
+    }
+    auto change_body = serialize_change_body(change, actors, compression_level);
+    body.insert(body.end(), change_body.begin(), change_body.end());
+    write_chunk(ChunkType::change, body, output);
+}
+
+// Parse the body of a change chunk written by write_change_chunk.
+inline auto parse_standalone_change(std::span<const std::byte> body)
+    -> std::optional<Change> {
+    auto pos = std::size_t{0};
+    auto read_uleb = [&]() -> std::optional<std::uint64_t> {
+        if (pos >= body.size()) return std::nullopt;
+        auto r = encoding::decode_uleb128(body.subspan(pos));
+        if (!r) return std::nullopt;
+        pos += r->bytes_read;
+        return r->value;
+    };
+
+    auto num_actors = read_uleb();
+    if (!num_actors || *num_actors == 0 || *num_actors > body.size()) return std::nullopt;
+    auto actors = std::vector<ActorId>{};
+    actors.reserve(static_cast<std::size_t>(*num_actors));
+    for (std::uint64_t i = 0; i < *num_actors; ++i) {
+        auto actor_len = read_uleb();
+        if (!actor_len || *actor_len != ActorId::size) return std::nullopt;
+        if (pos + ActorId::size > body.size()) return std::nullopt;
+        auto actor = ActorId{};
+        std::memcpy(actor.bytes.data(), &body[pos], ActorId::size);
+        pos += ActorId::size;
+        actors.push_back(actor);
+    }
+    return parse_change_chunk(body.subspan(pos), actors);
+}
+
 }  // namespace automerge_cpp::storage
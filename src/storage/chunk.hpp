@@ -139,4 +139,37 @@ inline void write_chunk(ChunkType type, std::span<const std::byte> body,
     output.insert(output.end(), body.begin(), body.end());
 }
 
+// Longest chunk header: magic + checksum + type + a 10-byte ULEB128 length.
+inline constexpr std::size_t max_chunk_header_size = 4 + 4 + 1 + 10;
+
+// Writing a chunk in place, for bodies too large to copy: begin_chunk
+// leaves room for the header at the end of output, the caller appends the
+// body, and finish_chunk back-patches the header into that room.
+inline auto begin_chunk(std::vector<std::byte>& output) -> std::size_t {
+    auto start = output.size();
+    output.resize(start + max_chunk_header_size);
+    return start;
+}
+
+// Write the header of the chunk begun at start, ending where its body
+// begins. Returns the offset the chunk now starts at; the bytes between
+// start and it are unused.
+inline auto finish_chunk(ChunkType type, std::vector<std::byte>& output, std::size_t start)
+    -> std::size_t {
+    const auto body_offset = start + max_chunk_header_size;
+    auto body = std::span<const std::byte>{output}.subspan(body_offset);
+
+    auto header = std::vector<std::byte>{};
+    header.reserve(max_chunk_header_size);
+    header.insert(header.end(), chunk_magic.begin(), chunk_magic.end());
+    auto checksum = compute_chunk_checksum(body);
+    header.insert(header.end(), checksum.begin(), checksum.end());
+    header.push_back(static_cast<std::byte>(type));
+    encoding::encode_uleb128(body.size(), header);
+
+    const auto chunk_offset = body_offset - header.size();
+    std::memcpy(output.data() + chunk_offset, header.data(), header.size());
+    return chunk_offset;
+}
+
 }  // namespace automerge_cpp::storage
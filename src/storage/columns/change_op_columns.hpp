@@ -42,13 +42,16 @@
 #include <optional>
 #include <ranges>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace automerge_cpp::storage {
 
 // Map OpType + Value to upstream action code.
 // make_object(map/table) → 0, put → 1, make_object(list/text) → 2,
-// del → 3, increment → 4, mark → 5
+// del → 3, increment → 4, mark → 5. Only single-byte splices reach here
+// (see for_each_stored_op).
 inline auto op_to_action_code(const Op& op) -> std::uint64_t {
     switch (op.action) {
         case OpType::make_object: {
@@ -70,31 +73,118 @@ inline auto op_to_action_code(const Op& op) -> std::uint64_t {
             return 1;  // scalar insert uses put action code
         }
         case OpType::splice_text:
-            return 1;
+            return 1;  // an insert of a one-byte string
     }
     return 1;
 }
 
-// Encode a list of operations into columnar format.
-// actor_table maps actor -> index.
-inline auto encode_change_ops(const std::vector<Op>& ops,
-                                const std::vector<ActorId>& actor_table)
-    -> std::vector<RawColumn> {
+// Call f with each op as the columns store it. Upstream stores text one
+// insert op per character, so a batched splice (Op::width() > 1) is given
+// as one single-byte splice per element, each after the previous one.
+template <typename F>
+void for_each_stored_op(const Op& op, F&& f) {
+    if (op.width() == 1) {
+        f(op);
+        return;
+    }
+    const auto& text = std::get<std::string>(std::get<ScalarValue>(op.value));
+    auto element = Op{.id = op.id, .obj = op.obj, .key = op.key, .action = OpType::splice_text,
+                      .value = {}, .pred = op.pred, .insert_after = op.insert_after};
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (i > 0) {
+            element.insert_after = element.id;
+            ++element.id.counter;
+        }
+        element.value = Value{ScalarValue{std::string(1, text[i])}};
+        f(element);
+    }
+}
 
-    auto find_actor_idx = [&](const ActorId& actor) -> std::uint64_t {
-        for (std::size_t i = 0; i < actor_table.size(); ++i) {
-            if (actor_table[i] == actor) return static_cast<std::uint64_t>(i);
+// Number of ops the columns store for ops (see for_each_stored_op): the
+// sum of their widths.
+template <typename Ops>
+auto stored_op_count(const Ops& ops) -> std::size_t {
+    auto count = std::size_t{0};
+    for (const Op& op : ops) count += static_cast<std::size_t>(op.width());
+    return count;
+}
+
+// Append a decoded op to ops, folding a single-byte splice that continues
+// the previous one (the next counter, inserted after its last element)
+// back into it: the batched form Transaction::splice_text makes.
+inline void append_decoded_op(std::vector<Op>& ops, Op op) {
+    if (!ops.empty() && op.action == OpType::splice_text && op.pred.empty()) {
+        auto& last = ops.back();
+        const auto last_element = OpId{last.id.counter + last.width() - 1, last.id.actor};
+        if (last.action == OpType::splice_text && last.pred.empty() && last.obj == op.obj
+            && op.id.counter == last_element.counter + 1 && op.id.actor == last.id.actor
+            && op.insert_after == last_element) {
+            std::get<std::string>(std::get<ScalarValue>(last.value))
+                += std::get<std::string>(std::get<ScalarValue>(op.value));
+            return;
         }
-        assert(false && "actor not found in actor_table");
-        return 0;
-    };
+    }
+    ops.push_back(std::move(op));
+}
+
+// Groups of op columns that can be encoded in separate passes over the
+// ops, e.g. on different threads. Each group's columns are contiguous in
+// column order, so concatenating the groups' results in this order gives
+// the columns of a single all-group pass.
+struct OpColumnGroups {
+    bool keys = true;    // obj, key, insert, action
+    bool values = true;  // value_meta, value_raw
+    bool preds = true;   // pred, expand, mark_name
+};
+
+// Actor → index in an actor table. Built once per document save (see
+// DocState::actor_index) so every actor lookup while encoding is O(1).
+using ActorIndex = std::unordered_map<ActorId, std::uint64_t>;
+
+inline auto make_actor_index(const std::vector<ActorId>& actor_table) -> ActorIndex {
+    auto index = ActorIndex{};
+    index.reserve(actor_table.size());
+    for (std::size_t i = 0; i < actor_table.size(); ++i) {
+        index.emplace(actor_table[i], static_cast<std::uint64_t>(i));
+    }
+    return index;
+}
+
+// Tables up to this size are scanned rather than hashed: a single change
+// names a handful of actors.
+inline constexpr std::size_t actor_scan_limit = 16;
+
+inline auto find_actor_index(const std::vector<ActorId>& actor_table, const ActorId& actor)
+    -> std::uint64_t {
+    for (std::size_t i = 0; i < actor_table.size(); ++i) {
+        if (actor_table[i] == actor) return static_cast<std::uint64_t>(i);
+    }
+    assert(false && "actor not found in actor_table");
+    return 0;
+}
+
+inline auto find_actor_index(const ActorIndex& actor_index, const ActorId& actor)
+    -> std::uint64_t {
+    auto it = actor_index.find(actor);
+    assert(it != actor_index.end() && "actor not found in actor_table");
+    return it != actor_index.end() ? it->second : 0;
+}
+
+// Encode a list of operations (any input range of const Op&) into columnar
+// format. actors is an actor table or its ActorIndex. Only the columns of
+// the given groups are produced.
+template <typename Ops, typename Actors>
+auto encode_change_ops_with(const Ops& ops, const Actors& actors, OpColumnGroups groups)
+    -> std::vector<RawColumn> {
+    auto find_actor_idx = [&](const ActorId& actor) { return find_actor_index(actors, actor); };
 
     // Column encoders
     auto obj_actor_enc   = encoding::RleEncoder<std::uint64_t>{};
     auto obj_counter_enc = encoding::DeltaEncoder{};
     auto key_actor_enc   = encoding::RleEncoder<std::uint64_t>{};
     auto key_counter_enc = encoding::DeltaEncoder{};
-    auto key_string_enc  = encoding::RleEncoder<std::string>{};
+    // Key strings and mark names are viewed in place: ops outlive the encoders.
+    auto key_string_enc  = encoding::RleEncoder<std::string_view>{};
     auto insert_enc      = encoding::BooleanEncoder{};
     auto action_enc      = encoding::RleEncoder<std::uint64_t>{};
     auto val_meta         = std::vector<std::byte>{};
@@ -103,12 +193,40 @@ inline auto encode_change_ops(const std::vector<Op>& ops,
     auto pred_actor_enc  = encoding::RleEncoder<std::uint64_t>{};
     auto pred_counter_enc = encoding::DeltaEncoder{};
     auto expand_enc      = encoding::BooleanEncoder{};
-    auto mark_name_enc   = encoding::RleEncoder<std::string>{};
+    auto mark_name_enc   = encoding::RleEncoder<std::string_view>{};
 
     bool has_expand = false;
     bool has_mark_name = false;
 
-    for (const auto& op : ops) {
+    auto encode_op = [&](const Op& op) {
+        // VALUE
+        if (groups.values) encode_value(op.value, val_meta, val_raw);
+
+        // PRED
+        if (groups.preds) {
+            pred_group_enc.append(static_cast<std::uint64_t>(op.pred.size()));
+            for (const auto& p : op.pred) {
+                pred_actor_enc.append(find_actor_idx(p.actor));
+                pred_counter_enc.append(static_cast<std::int64_t>(p.counter));
+            }
+
+            // EXPAND (mark-related)
+            if (op.action == OpType::mark) {
+                expand_enc.append(true);
+                has_expand = true;
+                if (const auto* name = std::get_if<std::string>(&op.key)) {
+                    mark_name_enc.append(*name);
+                    has_mark_name = true;
+                } else {
+                    mark_name_enc.append_null();
+                }
+            } else {
+                expand_enc.append(false);
+                mark_name_enc.append_null();
+            }
+        }
+        if (!groups.keys) return;
+
         // OBJ: actor + counter
         if (op.obj.is_root()) {
             obj_actor_enc.append_null();
@@ -154,32 +272,8 @@ inline auto encode_change_ops(const std::vector<Op>& ops,
 
         // ACTION code
         action_enc.append(op_to_action_code(op));
-
-        // VALUE
-        encode_value(op.value, val_meta, val_raw);
-
-        // PRED
-        pred_group_enc.append(static_cast<std::uint64_t>(op.pred.size()));
-        for (const auto& p : op.pred) {
-            pred_actor_enc.append(find_actor_idx(p.actor));
-            pred_counter_enc.append(static_cast<std::int64_t>(p.counter));
-        }
-
-        // EXPAND (mark-related)
-        if (op.action == OpType::mark) {
-            expand_enc.append(true);
-            has_expand = true;
-            if (is_map_key) {
-                mark_name_enc.append(std::get<std::string>(op.key));
-                has_mark_name = true;
-            } else {
-                mark_name_enc.append_null();
-            }
-        } else {
-            expand_enc.append(false);
-            mark_name_enc.append_null();
-        }
-    }
+    };
+    for (const Op& op : ops) for_each_stored_op(op, encode_op);
 
     // Finish all encoders
     obj_actor_enc.finish();
@@ -227,114 +321,104 @@ inline auto encode_change_ops(const std::vector<Op>& ops,
     return columns;
 }
 
-// Decode operations from columnar format.
-// Returns the decoded ops. start_op is the counter for the first op.
-inline auto decode_change_ops(const std::vector<RawColumn>& columns,
-                                const std::vector<ActorId>& actor_table,
-                                ActorId change_actor,
-                                std::uint64_t start_op,
-                                std::size_t num_ops)
-    -> std::optional<std::vector<Op>> {
-
-    // Find columns by spec
-    auto find_col = [&](ColumnSpec spec) -> std::span<const std::byte> {
-        for (const auto& col : columns) {
-            if (col.spec.column_id == spec.column_id &&
-                col.spec.type == spec.type) {
-                return col.data;
-            }
-        }
-        return {};
-    };
-
-    auto obj_actor_data   = find_col(change_op_columns::obj_actor);
-    auto obj_counter_data = find_col(change_op_columns::obj_counter);
-    auto key_actor_data   = find_col(change_op_columns::key_actor);
-    auto key_counter_data = find_col(change_op_columns::key_counter);
-    auto key_string_data  = find_col(change_op_columns::key_string);
-    auto insert_data      = find_col(change_op_columns::insert);
-    auto action_data      = find_col(change_op_columns::action);
-    auto val_meta_data    = find_col(change_op_columns::value_meta);
-    auto val_raw_data     = find_col(change_op_columns::value_raw);
-    auto pred_group_data  = find_col(change_op_columns::pred_group);
-    auto pred_actor_data  = find_col(change_op_columns::pred_actor);
-    auto pred_counter_data = find_col(change_op_columns::pred_counter);
-
-    // Create decoders
-    auto obj_actor_dec   = encoding::RleDecoder<std::uint64_t>{obj_actor_data};
-    auto obj_counter_dec = encoding::DeltaDecoder{obj_counter_data};
-    auto key_actor_dec   = encoding::RleDecoder<std::uint64_t>{key_actor_data};
-    auto key_counter_dec = encoding::DeltaDecoder{key_counter_data};
-    auto key_string_dec  = encoding::RleDecoder<std::string>{key_string_data};
-    auto insert_dec      = encoding::BooleanDecoder{insert_data};
-    auto action_dec      = encoding::RleDecoder<std::uint64_t>{action_data};
-    auto pred_group_dec  = encoding::RleDecoder<std::uint64_t>{pred_group_data};
-    auto pred_actor_dec  = encoding::RleDecoder<std::uint64_t>{pred_actor_data};
-    auto pred_counter_dec = encoding::DeltaDecoder{pred_counter_data};
-
-    auto val_meta_pos = std::size_t{0};
-    auto val_raw_pos  = std::size_t{0};
+// Encode ops against a prebuilt ActorIndex (e.g. a whole document's).
+template <typename Ops>
+auto encode_change_ops(const Ops& ops, const ActorIndex& actor_index, OpColumnGroups groups = {})
+    -> std::vector<RawColumn> {
+    return encode_change_ops_with(ops, actor_index, groups);
+}
 
-    auto ops = std::vector<Op>{};
-    ops.reserve(num_ops);
+// As above, against an actor table (scanned if small, hashed otherwise).
+template <typename Ops>
+auto encode_change_ops(const Ops& ops, const std::vector<ActorId>& actor_table,
+                       OpColumnGroups groups = {})
+    -> std::vector<RawColumn> {
+    if (actor_table.size() > actor_scan_limit) {
+        return encode_change_ops_with(ops, make_actor_index(actor_table), groups);
+    }
+    return encode_change_ops_with(ops, actor_table, groups);
+}
 
-    for (std::size_t i = 0; i < num_ops; ++i) {
+// Stateful decoder over one set of op columns. Ops are read in column
+// order; the caller supplies each op's id, which is not stored (a change's
+// ops follow start_op, each advancing the counter by Op::width). Columns
+// is a vector of RawColumn or ColumnView; the column bytes must outlive the
+// decoder.
+class ChangeOpDecoder {
+public:
+    template <typename Columns>
+    ChangeOpDecoder(const Columns& columns,
+                    const std::vector<ActorId>& actor_table)
+        : actor_table_{actor_table},
+          obj_actor_dec_{find_col(columns, change_op_columns::obj_actor)},
+          obj_counter_dec_{find_col(columns, change_op_columns::obj_counter)},
+          key_actor_dec_{find_col(columns, change_op_columns::key_actor)},
+          key_counter_dec_{find_col(columns, change_op_columns::key_counter)},
+          key_string_dec_{find_col(columns, change_op_columns::key_string)},
+          insert_dec_{find_col(columns, change_op_columns::insert)},
+          action_dec_{find_col(columns, change_op_columns::action)},
+          pred_group_dec_{find_col(columns, change_op_columns::pred_group)},
+          pred_actor_dec_{find_col(columns, change_op_columns::pred_actor)},
+          pred_counter_dec_{find_col(columns, change_op_columns::pred_counter)},
+          val_meta_data_{find_col(columns, change_op_columns::value_meta)},
+          val_raw_data_{find_col(columns, change_op_columns::value_raw)} {}
+
+    // Decode the next op, giving it the id `id`. nullopt on malformed data.
+    auto next(OpId id) -> std::optional<Op> {
         auto op = Op{};
-
-        // OpId: sequential from start_op
-        op.id = OpId{start_op + i, change_actor};
+        op.id = id;
 
         // OBJ
-        auto obj_actor_val = obj_actor_dec.next();
-        auto obj_counter_val = obj_counter_dec.next();
+        auto obj_actor_val = obj_actor_dec_.next();
+        auto obj_counter_val = obj_counter_dec_.next();
         if (!obj_actor_val || !obj_counter_val) return std::nullopt;
 
         if (*obj_actor_val && *obj_counter_val) {
             auto actor_idx = **obj_actor_val;
-            if (actor_idx >= actor_table.size()) return std::nullopt;
+            if (actor_idx >= actor_table_.size()) return std::nullopt;
             op.obj = ObjId{OpId{static_cast<std::uint64_t>(**obj_counter_val),
-                                 actor_table[static_cast<std::size_t>(actor_idx)]}};
+                                 actor_table_[static_cast<std::size_t>(actor_idx)]}};
         } else {
             op.obj = ObjId{};  // root
         }
 
         // KEY
-        auto key_actor_val = key_actor_dec.next();
-        auto key_counter_val = key_counter_dec.next();
-        auto key_string_val = key_string_dec.next();
+        auto key_actor_val = key_actor_dec_.next();
+        auto key_counter_val = key_counter_dec_.next();
+        auto key_string_val = key_string_dec_.next();
 
         if (!key_actor_val || !key_counter_val || !key_string_val) return std::nullopt;
 
         if (*key_string_val) {
-            op.key = Prop{**key_string_val};
+            op.key = Prop{std::move(**key_string_val)};
         } else {
             op.key = Prop{std::size_t{0}};  // list element key; position resolved via insert_after
         }
 
         // INSERT
-        auto insert_val = insert_dec.next();
+        auto insert_val = insert_dec_.next();
         if (!insert_val) return std::nullopt;
         bool is_insert = *insert_val;
 
         // Resolve insert_after from key columns
         if (is_insert && *key_actor_val && *key_counter_val) {
             auto actor_idx = **key_actor_val;
-            if (actor_idx < actor_table.size()) {
+            if (actor_idx < actor_table_.size()) {
                 op.insert_after = OpId{static_cast<std::uint64_t>(**key_counter_val),
-                                       actor_table[static_cast<std::size_t>(actor_idx)]};
+                                       actor_table_[static_cast<std::size_t>(actor_idx)]};
             }
         } else if (is_insert && !*key_actor_val) {
             op.insert_after = std::nullopt;  // insert at head
         }
 
         // ACTION
-        auto action_val = action_dec.next();
+        auto action_val = action_dec_.next();
         if (!action_val || !*action_val) return std::nullopt;
         auto action_code = **action_val;
 
         // VALUE
-        auto value = decode_value_from_columns(val_meta_data, val_meta_pos,
-                                                val_raw_data, val_raw_pos);
+        auto value = decode_value_from_columns(val_meta_data_, val_meta_pos_,
+                                                val_raw_data_, val_raw_pos_);
         if (!value) return std::nullopt;
 
         // Map action code + insert flag to OpType + Value
@@ -352,11 +436,11 @@ inline auto decode_change_ops(const std::vector<RawColumn>& columns,
                     op.value = Value{action_code == 0 ? ObjType::map : ObjType::list};
                 }
             } else {
-                // Scalar insert or splice_text
+                // Scalar insert or single-byte splice_text
                 op.action = OpType::insert;
-                op.value = *value;
+                op.value = std::move(*value);
                 if (const auto* sv = std::get_if<ScalarValue>(&op.value)) {
-                    if (std::holds_alternative<std::string>(*sv)) {
+                    if (const auto* s = std::get_if<std::string>(sv); s && s->size() == 1) {
                         op.action = OpType::splice_text;
                     }
                 }
@@ -379,7 +463,7 @@ inline auto decode_change_ops(const std::vector<RawColumn>& columns,
                 }
                 case 1:  // put
                     op.action = OpType::put;
-                    op.value = *value;
+                    op.value = std::move(*value);
                     break;
                 case 2: {  // make list/text
                     op.action = OpType::make_object;
@@ -396,15 +480,15 @@ inline auto decode_change_ops(const std::vector<RawColumn>& columns,
                 }
                 case 3:  // del
                     op.action = OpType::del;
-                    op.value = *value;
+                    op.value = std::move(*value);
                     break;
                 case 4:  // increment
                     op.action = OpType::increment;
-                    op.value = *value;
+                    op.value = std::move(*value);
                     break;
                 case 5:  // mark
                     op.action = OpType::mark;
-                    op.value = *value;
+                    op.value = std::move(*value);
                     break;
                 default:
                     return std::nullopt;
@@ -412,24 +496,75 @@ inline auto decode_change_ops(const std::vector<RawColumn>& columns,
         }
 
         // PRED
-        auto pred_group_val = pred_group_dec.next();
+        auto pred_group_val = pred_group_dec_.next();
         if (!pred_group_val || !*pred_group_val) return std::nullopt;
         auto pred_count = **pred_group_val;
 
         op.pred.reserve(static_cast<std::size_t>(pred_count));
         for (std::uint64_t p = 0; p < pred_count; ++p) {
-            auto pa = pred_actor_dec.next();
-            auto pc = pred_counter_dec.next();
+            auto pa = pred_actor_dec_.next();
+            auto pc = pred_counter_dec_.next();
             if (!pa || !*pa || !pc || !*pc) return std::nullopt;
             auto actor_idx = **pa;
-            if (actor_idx >= actor_table.size()) return std::nullopt;
+            if (actor_idx >= actor_table_.size()) return std::nullopt;
             op.pred.push_back(OpId{static_cast<std::uint64_t>(**pc),
-                                    actor_table[static_cast<std::size_t>(actor_idx)]});
+                                    actor_table_[static_cast<std::size_t>(actor_idx)]});
         }
 
-        ops.push_back(std::move(op));
+        return op;
+    }
+
+private:
+    template <typename Columns>
+    static auto find_col(const Columns& columns, ColumnSpec spec)
+        -> std::span<const std::byte> {
+        for (const auto& col : columns) {
+            if (col.spec.column_id == spec.column_id &&
+                col.spec.type == spec.type) {
+                return col.data;
+            }
+        }
+        return {};
     }
 
+    const std::vector<ActorId>& actor_table_;
+    encoding::RleDecoder<std::uint64_t> obj_actor_dec_;
+    encoding::DeltaDecoder obj_counter_dec_;
+    encoding::RleDecoder<std::uint64_t> key_actor_dec_;
+    encoding::DeltaDecoder key_counter_dec_;
+    encoding::RleDecoder<std::string> key_string_dec_;
+    encoding::BooleanDecoder insert_dec_;
+    encoding::RleDecoder<std::uint64_t> action_dec_;
+    encoding::RleDecoder<std::uint64_t> pred_group_dec_;
+    encoding::RleDecoder<std::uint64_t> pred_actor_dec_;
+    encoding::DeltaDecoder pred_counter_dec_;
+    std::span<const std::byte> val_meta_data_;
+    std::span<const std::byte> val_raw_data_;
+    std::size_t val_meta_pos_ = 0;
+    std::size_t val_raw_pos_ = 0;
+};
+
+// Decode operations from columnar format.
+// Returns the decoded ops, runs of single-byte splices folded into batched
+// ones (see append_decoded_op). start_op is the counter for the first op;
+// num_ops counts stored ops.
+template <typename Columns>
+auto decode_change_ops(const Columns& columns,
+                       const std::vector<ActorId>& actor_table,
+                       ActorId change_actor,
+                       std::uint64_t start_op,
+                       std::size_t num_ops)
+    -> std::optional<std::vector<Op>> {
+    auto decoder = ChangeOpDecoder{columns, actor_table};
+    auto ops = std::vector<Op>{};
+    ops.reserve(num_ops);
+    auto next_counter = start_op;
+    for (std::size_t i = 0; i < num_ops; ++i) {
+        auto op = decoder.next(OpId{next_counter, change_actor});
+        if (!op) return std::nullopt;
+        next_counter += op->width();
+        append_decoded_op(ops, std::move(*op));
+    }
     return ops;
 }
 
@@ -94,4 +94,19 @@ namespace change_op_columns {
     inline constexpr auto mark_name    = ColumnSpec{column_id::mark_name,    ColumnType::string_rle,  false};
 }  // namespace change_op_columns
 
+// Change metadata columns of a columnar document body (one row per change).
+// Ops of all changes share one set of change_op_columns; a change's op count
+// says how many rows it owns, and op ids follow its start_op.
+namespace document_change_columns {
+    inline constexpr auto actor     = ColumnSpec{0, ColumnType::actor_id,    false};
+    inline constexpr auto seq       = ColumnSpec{0, ColumnType::delta_int,   false};
+    inline constexpr auto start_op  = ColumnSpec{1, ColumnType::delta_int,   false};
+    inline constexpr auto timestamp = ColumnSpec{2, ColumnType::delta_int,   false};
+    inline constexpr auto message   = ColumnSpec{3, ColumnType::string_rle,  false};
+    inline constexpr auto dep_group = ColumnSpec{4, ColumnType::group_card,  false};
+    inline constexpr auto dep_index = ColumnSpec{4, ColumnType::delta_int,   false};  // null = raw hash
+    inline constexpr auto dep_raw   = ColumnSpec{4, ColumnType::value_raw,   false};  // 32 bytes each
+    inline constexpr auto num_ops   = ColumnSpec{6, ColumnType::integer_rle, false};
+}  // namespace document_change_columns
+
 }  // namespace automerge_cpp::storage
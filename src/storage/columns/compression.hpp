@@ -8,8 +8,12 @@
 //
 // Internal header — not installed.
 
+#include <automerge-cpp/metrics.hpp>
+
+#include <algorithm>
 #include <cstddef>
 #include <optional>
+#include <span>
 #include <vector>
 
 #include <zlib.h>
@@ -19,77 +23,128 @@ namespace automerge_cpp::storage {
 // Columns smaller than this are not compressed.
 inline constexpr std::size_t deflate_threshold = 256;
 
-// Compress data using raw DEFLATE (no zlib/gzip header).
-inline auto deflate_compress(const std::vector<std::byte>& input)
-    -> std::optional<std::vector<std::byte>> {
-
-    if (input.empty()) return std::vector<std::byte>{};
-
-    auto stream = z_stream{};
-    // windowBits = -15 for raw deflate (negative = no header)
-    auto ret = ::deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
-                              -15, 8, Z_DEFAULT_STRATEGY);
-    if (ret != Z_OK) return std::nullopt;
-
-    auto bound = ::deflateBound(&stream, static_cast<uLong>(input.size()));
-    auto output = std::vector<std::byte>(bound);
-
-    stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.data()));
-    stream.avail_in = static_cast<uInt>(input.size());
-    stream.next_out = reinterpret_cast<Bytef*>(output.data());
-    stream.avail_out = static_cast<uInt>(bound);
-
-    ret = ::deflate(&stream, Z_FINISH);
-    ::deflateEnd(&stream);
-
-    if (ret != Z_STREAM_END) return std::nullopt;
-
-    output.resize(stream.total_out);
-    return output;
-}
-
-// Decompress raw DEFLATE data (no zlib/gzip header).
-// max_output_size limits decompressed output to prevent memory bombs.
-inline auto deflate_decompress(const std::vector<std::byte>& input,
-                                std::size_t max_output_size = std::size_t{64} * 1024 * 1024)
-    -> std::optional<std::vector<std::byte>> {
-
-    if (input.empty()) return std::vector<std::byte>{};
-
-    // Start with 4x the input size, grow if needed
-    auto output_size = std::min(input.size() * 4, max_output_size);
-    auto output = std::vector<std::byte>(output_size);
+// zlib's default level (6); level 0 means "store uncompressed".
+inline constexpr int default_compression_level = Z_DEFAULT_COMPRESSION;
 
-    auto stream = z_stream{};
-    stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.data()));
-    stream.avail_in = static_cast<uInt>(input.size());
-    stream.next_out = reinterpret_cast<Bytef*>(output.data());
-    stream.avail_out = static_cast<uInt>(output_size);
-
-    // windowBits = -15 for raw deflate (negative = no header)
-    auto ret = ::inflateInit2(&stream, -15);
-    if (ret != Z_OK) return std::nullopt;
+// Reusable raw DEFLATE streams (no zlib/gzip header).
+//
+// deflateInit2/inflateInit2 allocate ~300 KiB of window and hash state;
+// a context initialises each stream once and resets it between columns
+// (deflateReset/inflateReset), so a save with thousands of columns pays
+// the setup once. Not thread-safe: use one context per thread (see
+// thread_compression_context).
+class CompressionContext {
+public:
+    CompressionContext() = default;
+    CompressionContext(const CompressionContext&) = delete;
+    auto operator=(const CompressionContext&) -> CompressionContext& = delete;
+
+    ~CompressionContext() {
+        if (deflate_ready_) ::deflateEnd(&deflate_);
+        if (inflate_ready_) ::inflateEnd(&inflate_);
+    }
 
-    ret = ::inflate(&stream, Z_FINISH);
+    // Compress input at the given level (1-9, or default_compression_level).
+    auto compress(std::span<const std::byte> input, int level = default_compression_level)
+        -> std::optional<std::vector<std::byte>> {
+        if (input.empty()) return std::vector<std::byte>{};
+        if (!prepare_deflate(level)) return std::nullopt;
+
+        auto bound = ::deflateBound(&deflate_, static_cast<uLong>(input.size()));
+        auto output = std::vector<std::byte>(bound);
+        deflate_.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.data()));
+        deflate_.avail_in = static_cast<uInt>(input.size());
+        deflate_.next_out = reinterpret_cast<Bytef*>(output.data());
+        deflate_.avail_out = static_cast<uInt>(bound);
+
+        if (::deflate(&deflate_, Z_FINISH) != Z_STREAM_END) return std::nullopt;
+        output.resize(deflate_.total_out);
+        return output;
+    }
 
-    if (ret == Z_BUF_ERROR || ret == Z_OK) {
+    // Decompress input. max_output_size limits decompressed output to
+    // prevent memory bombs. expected_size (when known, e.g. a column's
+    // stored length) sizes the output buffer up front; otherwise it starts
+    // at 4x the input and grows.
+    auto decompress(std::span<const std::byte> input,
+                    std::size_t max_output_size = std::size_t{64} * 1024 * 1024,
+                    std::size_t expected_size = 0)
+        -> std::optional<std::vector<std::byte>> {
+        if (input.empty()) return std::vector<std::byte>{};
+        if (!prepare_inflate()) return std::nullopt;
+
+        auto output_size = std::min(expected_size > 0 ? expected_size : input.size() * 4,
+                                    max_output_size);
+        auto output = std::vector<std::byte>(output_size);
+        inflate_.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.data()));
+        inflate_.avail_in = static_cast<uInt>(input.size());
+        inflate_.next_out = reinterpret_cast<Bytef*>(output.data());
+        inflate_.avail_out = static_cast<uInt>(output_size);
+
+        auto ret = ::inflate(&inflate_, Z_FINISH);
         // Need more space
-        while (ret != Z_STREAM_END && output_size < max_output_size) {
-            auto written = stream.total_out;
+        while ((ret == Z_BUF_ERROR || ret == Z_OK) && output_size < max_output_size) {
+            auto written = inflate_.total_out;
             output_size = std::min(output_size * 2, max_output_size);
             output.resize(output_size);
-            stream.next_out = reinterpret_cast<Bytef*>(output.data() + written);
-            stream.avail_out = static_cast<uInt>(output_size - written);
-            ret = ::inflate(&stream, Z_FINISH);
+            inflate_.next_out = reinterpret_cast<Bytef*>(output.data() + written);
+            inflate_.avail_out = static_cast<uInt>(output_size - written);
+            ret = ::inflate(&inflate_, Z_FINISH);
         }
+
+        if (ret != Z_STREAM_END) return std::nullopt;
+        output.resize(inflate_.total_out);
+        return output;
     }
 
-    ::inflateEnd(&stream);
+private:
+    auto prepare_deflate(int level) -> bool {
+        if (deflate_ready_ && level == deflate_level_) return ::deflateReset(&deflate_) == Z_OK;
+        if (deflate_ready_) ::deflateEnd(&deflate_);
+        deflate_ = z_stream{};
+        // windowBits = -15 for raw deflate (negative = no header)
+        deflate_ready_ = ::deflateInit2(&deflate_, level, Z_DEFLATED,
+                                        -15, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+        deflate_level_ = level;
+        return deflate_ready_;
+    }
 
-    if (ret != Z_STREAM_END) return std::nullopt;
+    auto prepare_inflate() -> bool {
+        if (inflate_ready_) return ::inflateReset(&inflate_) == Z_OK;
+        inflate_ = z_stream{};
+        inflate_ready_ = ::inflateInit2(&inflate_, -15) == Z_OK;
+        return inflate_ready_;
+    }
 
-    output.resize(stream.total_out);
-    return output;
+    z_stream deflate_{};
+    z_stream inflate_{};
+    bool deflate_ready_ = false;
+    bool inflate_ready_ = false;
+    int deflate_level_ = default_compression_level;
+};
+
+// The calling thread's context (pool workers each get their own).
+inline auto thread_compression_context() -> CompressionContext& {
+    thread_local auto context = CompressionContext{};
+    return context;
+}
+
+// Compress data using raw DEFLATE (no zlib/gzip header).
+inline auto deflate_compress(std::span<const std::byte> input,
+                             int level = default_compression_level)
+    -> std::optional<std::vector<std::byte>> {
+    AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::deflate);
+    return thread_compression_context().compress(input, level);
+}
+
+// Decompress raw DEFLATE data (no zlib/gzip header).
+// See CompressionContext::decompress for the size limits.
+inline auto deflate_decompress(std::span<const std::byte> input,
+                                std::size_t max_output_size = std::size_t{64} * 1024 * 1024,
+                                std::size_t expected_size = 0)
+    -> std::optional<std::vector<std::byte>> {
+    AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::inflate);
+    return thread_compression_context().decompress(input, max_output_size, expected_size);
 }
 
 }  // namespace automerge_cpp::storage
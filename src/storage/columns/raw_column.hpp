@@ -2,7 +2,9 @@
 
 // Raw column data container and column header parser/writer.
 //
-// A RawColumn is a (spec, bytes) pair representing one column in a chunk.
+// A RawColumn is a (spec, bytes) pair representing one column in a chunk;
+// a ColumnView is the same over bytes it does not own (used when loading,
+// so column data is decoded in place instead of being copied out first).
 // RawColumns is a collection that can parse/write the column header table
 // preceding column data in a chunk.
 //
@@ -11,8 +13,10 @@
 #include "column_spec.hpp"
 #include "../../encoding/leb128.hpp"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <span>
 #include <vector>
 
@@ -24,13 +28,20 @@ struct RawColumn {
     std::vector<std::byte> data;
 };
 
-// Parse column headers from a byte stream.
+// A column whose bytes live elsewhere: in the buffer it was parsed from, or
+// in an inflate buffer owned by the caller.
+struct ColumnView {
+    ColumnSpec spec;
+    std::span<const std::byte> data;
+};
+
+// Parse column headers from a byte stream, viewing the column data in place.
 // Format: ULEB128 column_count + repeated (ULEB128 spec, ULEB128 length) pairs.
 // After the headers, the column data follows sequentially.
-inline auto parse_raw_columns(std::span<const std::byte> input, std::size_t& pos)
-    -> std::vector<RawColumn> {
+inline auto parse_column_views(std::span<const std::byte> input, std::size_t& pos)
+    -> std::vector<ColumnView> {
 
-    auto columns = std::vector<RawColumn>{};
+    auto columns = std::vector<ColumnView>{};
 
     // Read column count
     if (pos >= input.size()) return columns;
@@ -45,7 +56,7 @@ inline auto parse_raw_columns(std::span<const std::byte> input, std::size_t& pos
         std::uint64_t length;
     };
     auto headers = std::vector<ColHeader>{};
-    headers.reserve(num_columns);
+    headers.reserve(std::min(num_columns, input.size() - pos));
 
     for (std::size_t i = 0; i < num_columns; ++i) {
         if (pos >= input.size()) break;
@@ -64,24 +75,56 @@ inline auto parse_raw_columns(std::span<const std::byte> input, std::size_t& pos
         headers.push_back(ColHeader{.spec = spec, .length = len_result->value});
     }
 
-    // Second pass: extract column data
+    // Second pass: locate column data
     columns.reserve(headers.size());
     for (const auto& hdr : headers) {
+        if (hdr.length > input.size() - pos) break;
         auto len = static_cast<std::size_t>(hdr.length);
-        if (pos + len > input.size()) break;
-
-        auto col = RawColumn{
-            .spec = hdr.spec,
-            .data = std::vector<std::byte>(input.begin() + static_cast<std::ptrdiff_t>(pos),
-                                           input.begin() + static_cast<std::ptrdiff_t>(pos + len)),
-        };
+        columns.push_back(ColumnView{.spec = hdr.spec, .data = input.subspan(pos, len)});
         pos += len;
-        columns.push_back(std::move(col));
     }
 
     return columns;
 }
 
+// Parse column headers from a byte stream, copying the column data.
+inline auto parse_raw_columns(std::span<const std::byte> input, std::size_t& pos)
+    -> std::vector<RawColumn> {
+    auto columns = std::vector<RawColumn>{};
+    for (const auto& view : parse_column_views(input, pos)) {
+        columns.push_back(RawColumn{
+            .spec = view.spec,
+            .data = std::vector<std::byte>(view.data.begin(), view.data.end()),
+        });
+    }
+    return columns;
+}
+
+// Advance pos past a column block (headers and data) without copying it.
+// Returns false if the block is truncated.
+inline auto skip_raw_columns(std::span<const std::byte> input, std::size_t& pos) -> bool {
+    auto read_uleb = [&]() -> std::optional<std::uint64_t> {
+        if (pos >= input.size()) return std::nullopt;
+        auto r = encoding::decode_uleb128(input.subspan(pos));
+        if (!r) return std::nullopt;
+        pos += r->bytes_read;
+        return r->value;
+    };
+
+    auto num_columns = read_uleb();
+    if (!num_columns) return false;
+    auto data_length = std::uint64_t{0};
+    for (std::uint64_t i = 0; i < *num_columns; ++i) {
+        auto spec = read_uleb();
+        auto length = read_uleb();
+        if (!spec || !length || *length > input.size()) return false;
+        data_length += *length;
+    }
+    if (data_length > input.size() - pos) return false;
+    pos += static_cast<std::size_t>(data_length);
+    return true;
+}
+
 // Write column headers and data to output.
 inline void write_raw_columns(const std::vector<RawColumn>& columns,
                                std::vector<std::byte>& output) {
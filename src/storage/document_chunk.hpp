@@ -0,0 +1,380 @@
+#pragma once
+
+// Columnar change store for document chunks.
+//
+// Instead of one independently encoded (and compressed) body per change, a
+// columnar document body stores every change in two column blocks:
+//   1. Change metadata — one row per change (document_change_columns)
+//   2. Op columns      — all ops of all changes, in history order
+//                        (change_op_columns)
+// RLE, delta and DEFLATE therefore see the whole history at once, and the
+// per-change column headers and zlib streams disappear. Deps are stored as
+// indices of earlier rows; a dep that is not an earlier row falls back to
+// its raw 32-byte hash.
+//
+// Internal header — not installed.
+
+#include <automerge-cpp/change.hpp>
+#include <automerge-cpp/thread_pool.hpp>
+#include <automerge-cpp/types.hpp>
+
+#include "change_chunk.hpp"
+#include "columns/change_op_columns.hpp"
+#include "columns/column_spec.hpp"
+#include "columns/raw_column.hpp"
+#include "../encoding/delta_encoder.hpp"
+#include "../encoding/rle.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace automerge_cpp::storage {
+
+// Version byte of the columnar document body (follows a zero actor count,
+// which the per-change layout never writes).
+inline constexpr std::uint8_t columnar_document_version = 1;
+
+// Documents with fewer ops are encoded on the calling thread even with a
+// pool: below this the task overhead outweighs the split.
+inline constexpr std::size_t parallel_encode_min_ops = 1024;
+
+// The change metadata block for `changes` (a sized range of const Change&),
+// uncompressed. hashes[i] is the hash of the i-th change.
+template <typename Changes>
+auto encode_document_change_meta(const Changes& changes,
+                                 std::span<const ChangeHash> hashes,
+                                 const ActorIndex& actor_index)
+    -> std::vector<RawColumn> {
+    auto row_of = std::unordered_map<ChangeHash, std::int64_t>{};
+    row_of.reserve(hashes.size());
+    for (std::size_t i = 0; i < hashes.size(); ++i) {
+        row_of.emplace(hashes[i], static_cast<std::int64_t>(i));
+    }
+
+    auto actor_enc     = encoding::RleEncoder<std::uint64_t>{};
+    auto seq_enc       = encoding::DeltaEncoder{};
+    auto start_op_enc  = encoding::DeltaEncoder{};
+    auto timestamp_enc = encoding::DeltaEncoder{};
+    auto message_enc   = encoding::RleEncoder<std::string_view>{};
+    auto dep_group_enc = encoding::RleEncoder<std::uint64_t>{};
+    auto dep_index_enc = encoding::DeltaEncoder{};
+    auto num_ops_enc   = encoding::RleEncoder<std::uint64_t>{};
+    auto dep_raw       = std::vector<std::byte>{};
+
+    auto current_row = std::int64_t{0};
+    for (const Change& change : changes) {
+        actor_enc.append(find_actor_index(actor_index, change.actor));
+        seq_enc.append(static_cast<std::int64_t>(change.seq));
+        start_op_enc.append(static_cast<std::int64_t>(change.start_op));
+        timestamp_enc.append(change.timestamp);
+        if (change.message) {
+            message_enc.append(*change.message);
+        } else {
+            message_enc.append_null();
+        }
+        dep_group_enc.append(change.deps.size());
+        for (const auto& dep : change.deps) {
+            // Only earlier rows: the reader resolves indices as it goes
+            if (auto row = row_of.find(dep); row != row_of.end() && row->second < current_row) {
+                dep_index_enc.append(row->second);
+            } else {
+                dep_index_enc.append_null();
+                dep_raw.insert(dep_raw.end(), dep.bytes.begin(), dep.bytes.end());
+            }
+        }
+        num_ops_enc.append(stored_op_count(change.operations));
+        ++current_row;
+    }
+
+    actor_enc.finish();
+    seq_enc.finish();
+    start_op_enc.finish();
+    timestamp_enc.finish();
+    message_enc.finish();
+    dep_group_enc.finish();
+    dep_index_enc.finish();
+    num_ops_enc.finish();
+
+    auto meta = std::vector<RawColumn>{};
+    auto add_col = [&](ColumnSpec spec, std::vector<std::byte> data) {
+        if (!data.empty()) meta.push_back(RawColumn{.spec = spec, .data = std::move(data)});
+    };
+    add_col(document_change_columns::actor,     actor_enc.take());
+    add_col(document_change_columns::seq,       seq_enc.take());
+    add_col(document_change_columns::start_op,  start_op_enc.take());
+    add_col(document_change_columns::timestamp, timestamp_enc.take());
+    add_col(document_change_columns::message,   message_enc.take());
+    add_col(document_change_columns::dep_group, dep_group_enc.take());
+    add_col(document_change_columns::dep_index, dep_index_enc.take());
+    add_col(document_change_columns::dep_raw,   std::move(dep_raw));
+    add_col(document_change_columns::num_ops,   num_ops_enc.take());
+    return meta;
+}
+
+// Append the column blocks for `changes` (a sized range of const Change&)
+// to output. hashes[i] is the hash of the i-th change; actor_index maps
+// every actor they name to its place in the document's actor table.
+//
+// With a pool (and enough ops), the metadata block and the three op column
+// groups are encoded as four tasks, and every column is then deflated as a
+// task of its own. The output is identical either way.
+template <typename Changes>
+void write_document_changes(const Changes& changes,
+                            std::span<const ChangeHash> hashes,
+                            const ActorIndex& actor_index,
+                            std::vector<std::byte>& output,
+                            int compression_level = default_compression_level,
+                            thread_pool* pool = nullptr) {
+    auto all_ops = changes
+                 | std::views::transform([](const Change& c) -> const std::vector<Op>& {
+                       return c.operations;
+                   })
+                 | std::views::join;
+    auto op_count = std::size_t{0};
+    for (const Change& change : changes) op_count += change.operations.size();
+
+    auto meta = std::vector<RawColumn>{};
+    auto op_columns = std::vector<RawColumn>{};
+    if (!pool || op_count < parallel_encode_min_ops) {
+        meta = encode_document_change_meta(changes, hashes, actor_index);
+        op_columns = encode_change_ops(all_ops, actor_index);
+        compress_columns(meta, compression_level);
+        compress_columns(op_columns, compression_level);
+    } else {
+        constexpr auto groups = std::array{
+            OpColumnGroups{.keys = true, .values = false, .preds = false},
+            OpColumnGroups{.keys = false, .values = true, .preds = false},
+            OpColumnGroups{.keys = false, .values = false, .preds = true},
+        };
+        auto group_columns = std::array<std::vector<RawColumn>, groups.size()>{};
+        pool->parallelize_loop(std::size_t{0}, groups.size() + 1,
+            [&](std::size_t start, std::size_t end) {
+                for (auto i = start; i < end; ++i) {
+                    if (i == groups.size()) {
+                        meta = encode_document_change_meta(changes, hashes, actor_index);
+                    } else {
+                        group_columns[i] = encode_change_ops(all_ops, actor_index, groups[i]);
+                    }
+                }
+            },
+            static_cast<std::uint32_t>(groups.size() + 1));
+        for (auto& columns : group_columns) {
+            std::ranges::move(columns, std::back_inserter(op_columns));
+        }
+
+        if (compression_level != 0) {
+            auto columns = std::vector<RawColumn*>{};
+            for (auto& col : meta) columns.push_back(&col);
+            for (auto& col : op_columns) columns.push_back(&col);
+            pool->parallelize_loop(std::size_t{0}, columns.size(),
+                [&](std::size_t start, std::size_t end) {
+                    for (auto i = start; i < end; ++i) compress_column(*columns[i], compression_level);
+                },
+                static_cast<std::uint32_t>(columns.size()));
+        }
+    }
+    write_raw_columns(meta, output);
+    write_raw_columns(op_columns, output);
+}
+
+// As above, against an actor table.
+template <typename Changes>
+void write_document_changes(const Changes& changes,
+                            std::span<const ChangeHash> hashes,
+                            const std::vector<ActorId>& actor_table,
+                            std::vector<std::byte>& output,
+                            int compression_level = default_compression_level,
+                            thread_pool* pool = nullptr) {
+    write_document_changes(changes, hashes, make_actor_index(actor_table), output,
+                           compression_level, pool);
+}
+
+// Inflate the deflated columns of both blocks, one column per task; each
+// block's buffers vector gets one buffer per column.
+inline auto inflate_columns_parallel(std::vector<ColumnView>& meta,
+                                     std::vector<std::vector<std::byte>>& meta_buffers,
+                                     std::vector<ColumnView>& op_columns,
+                                     std::vector<std::vector<std::byte>>& op_buffers,
+                                     thread_pool& pool) -> bool {
+    meta_buffers.resize(meta.size());
+    op_buffers.resize(op_columns.size());
+    auto deflated = std::vector<std::pair<ColumnView*, std::vector<std::byte>*>>{};
+    for (std::size_t i = 0; i < meta.size(); ++i) {
+        if (meta[i].spec.deflate) deflated.emplace_back(&meta[i], &meta_buffers[i]);
+    }
+    for (std::size_t i = 0; i < op_columns.size(); ++i) {
+        if (op_columns[i].spec.deflate) deflated.emplace_back(&op_columns[i], &op_buffers[i]);
+    }
+    auto ok = std::vector<std::uint8_t>(deflated.size(), 0);
+    pool.parallelize_loop(std::size_t{0}, deflated.size(),
+        [&](std::size_t start, std::size_t end) {
+            for (auto i = start; i < end; ++i) {
+                ok[i] = inflate_column(*deflated[i].first, *deflated[i].second) ? 1 : 0;
+            }
+        });
+    return std::ranges::all_of(ok, [](std::uint8_t v) { return v != 0; });
+}
+
+// Total op count of the changes written by write_document_changes, read from
+// the per-change num_ops column only (no op column is decoded). nullopt on
+// malformed data.
+inline auto count_document_ops(std::span<const std::byte> body, std::size_t pos,
+                               std::size_t num_changes) -> std::optional<std::size_t> {
+    auto meta = parse_column_views(body, pos);
+    auto it = std::ranges::find_if(meta, [](const ColumnView& col) {
+        return col.spec.column_id == document_change_columns::num_ops.column_id
+            && col.spec.type == document_change_columns::num_ops.type;
+    });
+    if (it == meta.end()) return num_changes == 0 ? std::optional<std::size_t>{0} : std::nullopt;
+    auto buffer = std::vector<std::byte>{};
+    if (!inflate_column(*it, buffer)) return std::nullopt;
+
+    auto num_ops = std::vector<std::optional<std::uint64_t>>(num_changes);
+    auto n = encoding::RleDecoder<std::uint64_t>{it->data}.next_n(num_ops);
+    if (!n || *n != num_changes) return std::nullopt;
+    auto total = std::size_t{0};
+    for (const auto& count : num_ops) total += static_cast<std::size_t>(count.value_or(0));
+    return total;
+}
+
+// Parse the column blocks written by write_document_changes, starting at
+// body[pos]; pos is advanced past them. Columns are decoded in place in body;
+// only deflated ones are inflated into separate buffers (in parallel, with a
+// pool). hash_of(const Change&) computes a change hash, used to resolve deps
+// stored as row indices. If hashes_out is set it receives the hash of every
+// change, each computed once. nullopt on malformed data.
+template <typename HashFn>
+auto parse_document_changes(std::span<const std::byte> body, std::size_t& pos,
+                            const std::vector<ActorId>& actor_table,
+                            std::size_t num_changes, HashFn&& hash_of,
+                            thread_pool* pool = nullptr,
+                            std::vector<ChangeHash>* hashes_out = nullptr)
+    -> std::optional<std::vector<Change>> {
+    AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::column_decode);
+    auto meta = parse_column_views(body, pos);
+    auto op_columns = parse_column_views(body, pos);
+    auto meta_buffers = std::vector<std::vector<std::byte>>{};
+    auto op_buffers = std::vector<std::vector<std::byte>>{};
+    if (pool) {
+        if (!inflate_columns_parallel(meta, meta_buffers, op_columns, op_buffers, *pool)) {
+            return std::nullopt;
+        }
+    } else if (!inflate_columns(meta, meta_buffers) || !inflate_columns(op_columns, op_buffers)) {
+        return std::nullopt;
+    }
+
+    auto find_col = [&](ColumnSpec spec) -> std::span<const std::byte> {
+        for (const auto& col : meta) {
+            if (col.spec.column_id == spec.column_id && col.spec.type == spec.type) {
+                return col.data;
+            }
+        }
+        return {};
+    };
+
+    // Per-change columns hold exactly one value per change: decode them in bulk
+    auto decode_all = [&](auto decoder, auto& values) {
+        values.resize(num_changes);
+        auto n = decoder.next_n(values);
+        return n && *n == num_changes;
+    };
+    auto actors     = std::vector<std::optional<std::uint64_t>>{};
+    auto seqs       = std::vector<std::optional<std::int64_t>>{};
+    auto start_ops  = std::vector<std::optional<std::int64_t>>{};
+    auto timestamps = std::vector<std::optional<std::int64_t>>{};
+    auto messages   = std::vector<std::optional<std::string>>{};
+    auto dep_counts = std::vector<std::optional<std::uint64_t>>{};
+    auto num_ops    = std::vector<std::optional<std::uint64_t>>{};
+    using UintDecoder = encoding::RleDecoder<std::uint64_t>;
+    if (!decode_all(UintDecoder{find_col(document_change_columns::actor)}, actors)
+        || !decode_all(encoding::DeltaDecoder{find_col(document_change_columns::seq)}, seqs)
+        || !decode_all(encoding::DeltaDecoder{find_col(document_change_columns::start_op)}, start_ops)
+        || !decode_all(encoding::DeltaDecoder{find_col(document_change_columns::timestamp)}, timestamps)
+        || !decode_all(encoding::RleDecoder<std::string>{find_col(document_change_columns::message)},
+                       messages)
+        || !decode_all(UintDecoder{find_col(document_change_columns::dep_group)}, dep_counts)
+        || !decode_all(UintDecoder{find_col(document_change_columns::num_ops)}, num_ops)) {
+        return std::nullopt;
+    }
+    auto dep_index_dec = encoding::DeltaDecoder{find_col(document_change_columns::dep_index)};
+    auto dep_raw = find_col(document_change_columns::dep_raw);
+    auto dep_raw_pos = std::size_t{0};
+
+    auto ops = ChangeOpDecoder{op_columns, actor_table};
+    auto changes = std::vector<Change>{};
+    changes.reserve(num_changes);
+    auto hashes = std::vector<ChangeHash>{};  // computed lazily, only for dep indices
+
+    for (std::size_t ci = 0; ci < num_changes; ++ci) {
+        const auto& actor = actors[ci];
+        const auto& seq = seqs[ci];
+        const auto& start_op = start_ops[ci];
+        const auto& timestamp = timestamps[ci];
+        auto& message = messages[ci];
+        const auto& dep_count = dep_counts[ci];
+        if (!actor || *actor >= actor_table.size()) return std::nullopt;
+        if (!seq || !start_op || !timestamp || !dep_count || !num_ops[ci]) return std::nullopt;
+
+        auto change = Change{
+            .actor = actor_table[static_cast<std::size_t>(*actor)],
+            .seq = static_cast<std::uint64_t>(*seq),
+            .start_op = static_cast<std::uint64_t>(*start_op),
+            .timestamp = *timestamp,
+            .message = std::move(message),
+            .deps = {},
+            .operations = {},
+        };
+
+        change.deps.reserve(static_cast<std::size_t>(*dep_count));
+        for (std::uint64_t d = 0; d < *dep_count; ++d) {
+            auto index = dep_index_dec.next();
+            if (!index) return std::nullopt;
+            if (*index) {
+                auto row = static_cast<std::size_t>(**index);
+                if (**index < 0 || row >= changes.size()) return std::nullopt;
+                while (hashes.size() <= row) {
+                    hashes.push_back(hash_of(changes[hashes.size()]));
+                }
+                change.deps.push_back(hashes[row]);
+            } else {
+                if (dep_raw_pos + 32 > dep_raw.size()) return std::nullopt;
+                auto hash = ChangeHash{};
+                std::memcpy(hash.bytes.data(), &dep_raw[dep_raw_pos], 32);
+                dep_raw_pos += 32;
+                change.deps.push_back(hash);
+            }
+        }
+
+        change.operations.reserve(static_cast<std::size_t>(*num_ops[ci]));
+        auto next_counter = change.start_op;
+        for (std::uint64_t oi = 0; oi < *num_ops[ci]; ++oi) {
+            auto op = ops.next(OpId{next_counter, change.actor});
+            if (!op) return std::nullopt;
+            next_counter += op->width();
+            append_decoded_op(change.operations, std::move(*op));
+        }
+        changes.push_back(std::move(change));
+    }
+    if (hashes_out) {
+        while (hashes.size() < changes.size()) {
+            hashes.push_back(hash_of(changes[hashes.size()]));
+        }
+        *hashes_out = std::move(hashes);
+    }
+    return changes;
+}
+
+}  // namespace automerge_cpp::storage
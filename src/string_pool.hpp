@@ -0,0 +1,222 @@
+#pragma once
+
+// Interned strings for map keys and mark names.
+// Internal header — not installed.
+//
+// The same few key strings ("id", "name", "status", ...) recur in every
+// row of a table. Map entries and marks hold an 8-byte Symbol instead of
+// their own 32-byte std::string: a string of up to 7 bytes is stored in the
+// Symbol itself, and a longer one is interned once per document and the
+// Symbol points at it. Short keys, including unique ones such as row ids,
+// therefore never touch the pool.
+//
+// Interned strings are copied into append-only arena blocks as a 4-byte
+// length followed by the bytes, and a Symbol points at the length. A Symbol stays
+// valid for the pool's lifetime, and reading through it never touches the
+// pool, so readers need no lock. Interning may run concurrently (forks
+// share a pool, and remote ops are applied to different objects in
+// parallel), so the pool is split into shards, each with its own mutex
+// and open-addressing index, chosen by the string's hash.
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace automerge_cpp::detail {
+
+// A string from StringPool::intern. Symbols from the same pool are equal
+// exactly when their strings are.
+//
+// The bytes are either a pointer into the pool (always even: the pool
+// aligns its strings) or, for a short string, a tag byte with the low bit
+// set and the length above it, followed by the characters. With 4-byte
+// pointers the pointer sits in the half away from the tag byte, which is
+// then zero. A short
+// Symbol's view() points into the Symbol, so it is valid only as long as
+// the Symbol is.
+class Symbol {
+public:
+    static constexpr std::size_t max_inline = 7;
+
+    Symbol() { bytes_[tag_byte] = 1; }
+
+    auto view() const -> std::string_view {
+        if (is_inline()) {
+            return {bytes_.data() + first_char, static_cast<std::size_t>(bytes_[tag_byte] >> 1)};
+        }
+        const char* data;
+        std::memcpy(&data, bytes_.data() + pointer_offset, sizeof data);
+        auto size = std::uint32_t{0};
+        std::memcpy(&size, data, sizeof size);
+        return {data + sizeof size, size};
+    }
+    operator std::string_view() const { return view(); }
+
+    auto operator==(const Symbol& other) const -> bool { return bytes_ == other.bytes_; }
+
+private:
+    friend class StringPool;
+
+    static_assert(sizeof(const char*) == 8 || sizeof(const char*) == 4,
+                  "Symbol packs a pointer into 8 bytes");
+    // The byte holding the tag bit (a pointer's low byte when pointers are
+    // 8 bytes), where inline characters start, and where the pointer goes
+    static constexpr auto tag_byte = std::endian::native == std::endian::little ? 0 : 7;
+    static constexpr auto first_char = tag_byte == 0 ? 1 : 0;
+    static constexpr std::size_t pointer_offset =
+        sizeof(const char*) == 8 || tag_byte == 7 ? 0 : 8 - sizeof(const char*);
+
+    static auto from_pool(const char* data) -> Symbol {
+        auto symbol = Symbol{};
+        symbol.bytes_[tag_byte] = 0;
+        std::memcpy(symbol.bytes_.data() + pointer_offset, &data, sizeof data);
+        return symbol;
+    }
+
+    static auto from_inline(std::string_view str) -> Symbol {
+        auto symbol = Symbol{};
+        symbol.bytes_[tag_byte] = static_cast<char>(str.size() << 1 | 1);
+        std::memcpy(symbol.bytes_.data() + first_char, str.data(), str.size());
+        return symbol;
+    }
+
+    auto is_inline() const -> bool { return (bytes_[tag_byte] & 1) != 0; }
+
+    std::array<char, 8> bytes_{};
+};
+
+class StringPool {
+public:
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    auto operator=(const StringPool&) -> StringPool& = delete;
+
+    auto intern(std::string_view str) -> Symbol {
+        return intern(str, std::hash<std::string_view>{}(str));
+    }
+
+    // hash must be std::hash<std::string_view>{}(str).
+    auto intern(std::string_view str, std::uint64_t hash) -> Symbol {
+        if (str.size() <= Symbol::max_inline) return Symbol::from_inline(str);
+        auto& shard = shards_[(hash >> 56) % shard_count];
+        auto lock = std::scoped_lock{shard.mutex};
+        return shard.intern(str, hash);
+    }
+
+    // Number of distinct strings stored in the pool (longer than
+    // Symbol::max_inline).
+    auto size() const -> std::size_t {
+        auto total = std::size_t{0};
+        for (const auto& shard : shards_) {
+            auto lock = std::scoped_lock{shard.mutex};
+            total += shard.count;
+        }
+        return total;
+    }
+
+    // Approximate heap bytes held: string blocks and probe arrays.
+    auto memory_usage() const -> std::size_t {
+        auto total = std::size_t{0};
+        for (const auto& shard : shards_) {
+            auto lock = std::scoped_lock{shard.mutex};
+            total += shard.block_bytes + shard.blocks.capacity() * sizeof(shard.blocks[0])
+                   + shard.slots.capacity() * sizeof(Slot);
+        }
+        return total;
+    }
+
+private:
+    struct Slot {
+        const char* data = nullptr;
+        std::uint64_t hash = 0;
+    };
+
+    struct Shard {
+        // Blocks start small so that small documents stay small.
+        static constexpr std::size_t first_block = 256;
+        static constexpr std::size_t max_block = 16 * 1024;
+
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        std::size_t block_size = 0;  // capacity of blocks.back()
+        std::size_t block_used = 0;  // bytes used in blocks.back()
+        std::size_t block_bytes = 0; // capacity of all blocks
+        std::vector<Slot> slots;     // power-of-two size, or empty
+        std::size_t count = 0;
+
+        auto intern(std::string_view str, std::uint64_t hash) -> Symbol {
+            if (!slots.empty()) {
+                const auto mask = slots.size() - 1;
+                for (auto i = hash & mask; slots[i].data; i = (i + 1) & mask) {
+                    if (slots[i].hash == hash && stored(slots[i].data) == str) {
+                        return Symbol::from_pool(slots[i].data);
+                    }
+                }
+            }
+            if (count + 1 > slots.size() - slots.size() / 8) grow();
+            const auto* data = store(str);
+            place(Slot{.data = data, .hash = hash});
+            ++count;
+            return Symbol::from_pool(data);
+        }
+
+        static auto stored(const char* data) -> std::string_view {
+            auto size = std::uint32_t{0};
+            std::memcpy(&size, data, sizeof size);
+            return {data + sizeof size, size};
+        }
+
+        auto store(std::string_view str) -> const char* {
+            const auto size = static_cast<std::uint32_t>(str.size());
+            const auto bytes = sizeof size + str.size();
+            char* out;
+            if (bytes > max_block / 4) {
+                // Large strings get a block of their own, ahead of the open one
+                auto block = std::make_unique<char[]>(bytes);
+                block_bytes += bytes;
+                out = block.get();
+                blocks.insert(blocks.end() - (blocks.empty() ? 0 : 1), std::move(block));
+            } else {
+                if (block_used + bytes > block_size) {
+                    block_size = std::clamp(block_size * 2, first_block, max_block);
+                    blocks.push_back(std::make_unique<char[]>(block_size));
+                    block_bytes += block_size;
+                    block_used = 0;
+                }
+                out = blocks.back().get() + block_used;
+                block_used += bytes + (bytes & 1);  // keep strings even-aligned
+            }
+            std::memcpy(out, &size, sizeof size);
+            std::memcpy(out + sizeof size, str.data(), str.size());
+            return out;
+        }
+
+        void place(Slot slot) {
+            const auto mask = slots.size() - 1;
+            auto i = slot.hash & mask;
+            while (slots[i].data) i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+
+        void grow() {
+            auto old = std::move(slots);
+            slots.assign(std::max<std::size_t>(16, old.size() * 2), Slot{});
+            for (const auto& slot : old) {
+                if (slot.data) place(slot);
+            }
+        }
+    };
+
+    static constexpr std::size_t shard_count = 16;
+    std::array<Shard, shard_count> shards_;
+};
+
+}  // namespace automerge_cpp::detail
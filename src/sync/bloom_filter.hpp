@@ -8,11 +8,19 @@
 // - LFSR-based multi-hash from the first 12 bytes of a ChangeHash
 // - Serialized as: LEB128(num_entries) + LEB128(bits_per_entry)
 //                  + LEB128(num_probes) + raw_bits
+//
+// add_hashes / contains_hashes work on batch_lanes hashes at a time: the
+// probe sequences of a batch are generated lane by lane with branch-free
+// modular steps (which the compiler vectorizes), then the bits are set or
+// tested without an early exit per hash.
 
+#include <automerge-cpp/metrics.hpp>
 #include <automerge-cpp/types.hpp>
 #include "../encoding/leb128.hpp"
 
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -39,6 +47,7 @@ public:
     // Build from an iterator of hashes.
     template <typename It>
     static auto from_hashes(It first, It last) -> BloomFilter {
+        AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::bloom_build);
         auto count = static_cast<std::uint32_t>(std::distance(first, last));
         auto bf = BloomFilter{count};
         for (auto it = first; it != last; ++it) {
@@ -47,8 +56,15 @@ public:
         return bf;
     }
 
+    static auto from_hashes(std::span<const ChangeHash> hashes) -> BloomFilter {
+        AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::bloom_build);
+        auto bf = BloomFilter{static_cast<std::uint32_t>(hashes.size())};
+        bf.add_hashes(hashes);
+        return bf;
+    }
+
     static auto from_hashes(const std::vector<ChangeHash>& hashes) -> BloomFilter {
-        return from_hashes(hashes.begin(), hashes.end());
+        return from_hashes(std::span<const ChangeHash>{hashes});
     }
 
     void add_hash(const ChangeHash& hash) {
@@ -59,6 +75,17 @@ public:
         }
     }
 
+    void add_hashes(std::span<const ChangeHash> hashes) {
+        if (bits_.empty()) return;
+        for (std::size_t start = 0; start < hashes.size(); start += batch_lanes) {
+            auto count = std::min(batch_lanes, hashes.size() - start);
+            auto probes = get_probes_batch(hashes.subspan(start, count));
+            for (const auto& lanes : probes) {
+                for (std::size_t lane = 0; lane < count; ++lane) set_bit(lanes[lane]);
+            }
+        }
+    }
+
     auto contains_hash(const ChangeHash& hash) const -> bool {
         if (bits_.empty()) return false;
         auto probes = get_probes(hash);
@@ -68,6 +95,28 @@ public:
         return true;
     }
 
+    // Set out[k] for every hashes[k] the filter may contain; other entries
+    // are left as they are, so several filters can be checked into one
+    // mask. out must have at least hashes.size() entries.
+    void contains_hashes(std::span<const ChangeHash> hashes, std::vector<bool>& out) const {
+        assert(out.size() >= hashes.size());
+        if (bits_.empty()) return;
+        for (std::size_t start = 0; start < hashes.size(); start += batch_lanes) {
+            auto count = std::min(batch_lanes, hashes.size() - start);
+            auto probes = get_probes_batch(hashes.subspan(start, count));
+            auto hit = std::array<std::uint8_t, batch_lanes>{};
+            hit.fill(1);
+            for (const auto& lanes : probes) {
+                for (std::size_t lane = 0; lane < batch_lanes; ++lane) {
+                    hit[lane] &= static_cast<std::uint8_t>(get_bit(lanes[lane]));
+                }
+            }
+            for (std::size_t lane = 0; lane < count; ++lane) {
+                if (hit[lane]) out[start + lane] = true;
+            }
+        }
+    }
+
     auto empty() const -> bool { return num_entries_ == 0; }
 
     // Serialize to bytes.
@@ -155,6 +204,41 @@ private:
         return probes;
     }
 
+    // Hashes whose probes are generated together.
+    static constexpr std::size_t batch_lanes = 8;
+
+    using ProbeBatch = std::array<std::array<std::uint32_t, batch_lanes>, default_num_probes>;
+
+    // The probes of up to batch_lanes hashes: result[i][lane] is probe i of
+    // hashes[lane], as get_probes gives it. Lanes past hashes.size() probe
+    // bit 0. x, y and z stay below m, so each step's % m is one conditional
+    // subtraction.
+    auto get_probes_batch(std::span<const ChangeHash> hashes) const -> ProbeBatch {
+        auto probes = ProbeBatch{};
+        const auto m = static_cast<std::uint64_t>(modulo());
+        if (m == 0) return probes;
+
+        std::array<std::uint64_t, batch_lanes> x{}, y{}, z{};
+        for (std::size_t lane = 0; lane < hashes.size(); ++lane) {
+            std::uint32_t words[3];
+            std::memcpy(words, &hashes[lane].bytes[0], sizeof(words));
+            x[lane] = words[0] % m;
+            y[lane] = words[1] % m;
+            z[lane] = words[2] % m;
+        }
+
+        for (std::size_t i = 0; i < default_num_probes; ++i) {
+            for (std::size_t lane = 0; lane < batch_lanes; ++lane) {
+                probes[i][lane] = static_cast<std::uint32_t>(x[lane]);
+                auto next_x = x[lane] + y[lane];
+                auto next_y = y[lane] + z[lane];
+                x[lane] = next_x >= m ? next_x - m : next_x;
+                y[lane] = next_y >= m ? next_y - m : next_y;
+            }
+        }
+        return probes;
+    }
+
     auto get_bit(std::uint32_t pos) const -> bool {
         return (bits_[pos >> 3] & (1u << (pos & 7))) != 0;
     }
@@ -24,11 +24,30 @@ void Transaction::put(const ObjId& obj, std::string_view key, ScalarValue val) {
     pending_ops_.push_back(std::move(op));
 }
 
+void Transaction::put_many(const ObjId& obj,
+                           std::span<const std::pair<std::string_view, ScalarValue>> entries) {
+    if (entries.empty()) return;
+    auto first_id = state_.next_op_ids(entries.size());
+    pending_ops_.reserve(pending_ops_.size() + entries.size());
+    state_.map_put_many(obj, first_id, entries,
+        [&](std::size_t i, std::vector<OpId> pred, Value value) {
+            auto op = Op{
+                .id = OpId{first_id.counter + i, first_id.actor},
+                .obj = obj,
+                .key = map_key(std::string{entries[i].first}),
+                .action = OpType::put,
+                .value = std::move(value),
+                .pred = std::move(pred),
+            };
+            pending_ops_.push_back(std::move(op));
+        });
+}
+
 auto Transaction::put_object(const ObjId& obj, std::string_view key, ObjType type) -> ObjId {
     auto key_str = std::string{key};
     auto pred = state_.map_pred(obj, key_str);
     auto op_id = state_.next_op_id();
-    auto new_obj = state_.create_object(op_id, type);
+    auto new_obj = state_.create_object(op_id, type, obj, key_str);
     auto value = Value{type};
     state_.map_put(obj, key_str, op_id, value);
     auto op = Op{
@@ -76,10 +95,36 @@ void Transaction::insert(const ObjId& obj, std::size_t index, ScalarValue val) {
     pending_ops_.push_back(std::move(op));
 }
 
+void Transaction::insert_range(const ObjId& obj, std::size_t index,
+                               std::span<const ScalarValue> values) {
+    if (values.empty()) return;
+    auto insert_after = state_.insert_after_for(obj, index);
+    auto first_id = state_.next_op_ids(values.size());
+    auto elements = std::vector<Value>(values.begin(), values.end());
+    state_.list_insert_many(obj, index, first_id, elements, insert_after);
+
+    // One insert op per element, each after the one before it
+    pending_ops_.reserve(pending_ops_.size() + elements.size());
+    for (std::size_t i = 0; i < elements.size(); ++i) {
+        auto op_id = OpId{first_id.counter + i, first_id.actor};
+        auto op = Op{
+            .id = op_id,
+            .obj = obj,
+            .key = list_index(index + i),
+            .action = OpType::insert,
+            .value = std::move(elements[i]),
+            .pred = {},
+            .insert_after = insert_after,
+        };
+        pending_ops_.push_back(std::move(op));
+        insert_after = op_id;
+    }
+}
+
 auto Transaction::insert_object(const ObjId& obj, std::size_t index, ObjType type) -> ObjId {
     auto insert_after = state_.insert_after_for(obj, index);
     auto op_id = state_.next_op_id();
-    auto new_obj = state_.create_object(op_id, type);
+    auto new_obj = state_.create_object(op_id, type, obj);
     auto value = Value{type};
     state_.list_insert(obj, index, op_id, value, insert_after);
     auto op = Op{
@@ -144,31 +189,22 @@ void Transaction::splice_text(const ObjId& obj, std::size_t pos, std::size_t del
         pending_ops_.push_back(std::move(op));
     }
 
-    // Insert characters — one op per character, chaining insert_after
-    auto prev_op_id = std::optional<OpId>{};
-    for (std::size_t i = 0; i < text.size(); ++i) {
-        auto insert_after = std::optional<OpId>{};
-        if (i == 0) {
-            insert_after = state_.insert_after_for(obj, pos);
-        } else {
-            insert_after = prev_op_id;
-        }
-
-        auto op_id = state_.next_op_id();
-        prev_op_id = op_id;
-        auto char_val = Value{ScalarValue{std::string(1, text[i])}};
-        state_.list_insert(obj, pos + i, op_id, char_val, insert_after);
-        auto op = Op{
-            .id = op_id,
-            .obj = obj,
-            .key = list_index(pos + i),
-            .action = OpType::splice_text,
-            .value = std::move(char_val),
-            .pred = {},
-            .insert_after = insert_after,
-        };
-        pending_ops_.push_back(std::move(op));
-    }
+    // Insert characters — one op covering a contiguous counter range, one
+    // element per byte (see Op::width)
+    if (text.empty()) return;
+    auto insert_after = state_.insert_after_for(obj, pos);
+    auto op_id = state_.next_op_ids(text.size());
+    state_.text_insert(obj, pos, op_id, text, insert_after);
+    auto op = Op{
+        .id = op_id,
+        .obj = obj,
+        .key = list_index(pos),
+        .action = OpType::splice_text,
+        .value = Value{ScalarValue{std::string{text}}},
+        .pred = {},
+        .insert_after = insert_after,
+    };
+    pending_ops_.push_back(std::move(op));
 }
 
 void Transaction::increment(const ObjId& obj, std::string_view key, std::int64_t delta) {
@@ -212,6 +248,7 @@ void Transaction::mark(const ObjId& obj, std::size_t start, std::size_t end,
 
 void Transaction::commit() {
     if (pending_ops_.empty()) return;
+    AUTOMERGE_CPP_TIME_PHASE(metrics::Phase::transaction_commit);
 
     auto change = Change{
         .actor = state_.actor,
@@ -239,7 +276,7 @@ void Transaction::commit() {
     state_.clock[state_.actor] = change.seq;
 
     // Store change
-    state_.change_history.push_back(std::move(change));
+    state_.change_history.push_back(std::move(change), hash);
 }
 
 // =============================================================================
@@ -247,7 +284,7 @@ void Transaction::commit() {
 // =============================================================================
 
 auto Transaction::get(const ObjId& obj, std::string_view key) const -> std::optional<Value> {
-    return state_.map_get(obj, std::string{key});
+    return state_.map_get(obj, key);
 }
 
 auto Transaction::get(const ObjId& obj, std::size_t index) const -> std::optional<Value> {
@@ -259,7 +296,7 @@ auto Transaction::object_type(const ObjId& obj) const -> std::optional<ObjType>
 }
 
 auto Transaction::get_obj_id(const ObjId& obj, std::string_view key) const -> std::optional<ObjId> {
-    return state_.get_obj_id_for_key(obj, std::string{key});
+    return state_.get_obj_id_for_key(obj, key);
 }
 
 auto Transaction::get_obj_id(const ObjId& obj, std::size_t index) const -> std::optional<ObjId> {
@@ -0,0 +1,62 @@
+#include "../src/sync/bloom_filter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace automerge_cpp;
+using automerge_cpp::sync::BloomFilter;
+
+namespace {
+
+auto make_hashes(std::size_t count, std::uint8_t salt) -> std::vector<ChangeHash> {
+    auto hashes = std::vector<ChangeHash>(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        for (std::size_t b = 0; b < hashes[i].bytes.size(); ++b) {
+            hashes[i].bytes[b] = static_cast<std::byte>((i * 131 + b * 29 + salt) * 2654435761u >> 13);
+        }
+    }
+    return hashes;
+}
+
+}  // namespace
+
+TEST(BloomFilter, contains_every_added_hash) {
+    auto hashes = make_hashes(100, 1);
+    auto bf = BloomFilter::from_hashes(hashes);
+    for (const auto& h : hashes) EXPECT_TRUE(bf.contains_hash(h));
+}
+
+TEST(BloomFilter, add_hashes_matches_add_hash) {
+    auto hashes = make_hashes(37, 2);  // not a multiple of the batch size
+    auto one_by_one = BloomFilter{static_cast<std::uint32_t>(hashes.size())};
+    for (const auto& h : hashes) one_by_one.add_hash(h);
+    EXPECT_EQ(BloomFilter::from_hashes(hashes), one_by_one);
+    EXPECT_EQ(BloomFilter::from_hashes(hashes.begin(), hashes.end()), one_by_one);
+}
+
+TEST(BloomFilter, contains_hashes_matches_contains_hash) {
+    auto added = make_hashes(50, 3);
+    auto bf = BloomFilter::from_hashes(added);
+    auto probes = make_hashes(1000, 4);
+    probes.insert(probes.end(), added.begin(), added.begin() + 13);
+
+    auto out = std::vector<bool>(probes.size());
+    bf.contains_hashes(probes, out);
+    for (std::size_t k = 0; k < probes.size(); ++k) {
+        EXPECT_EQ(out[k], bf.contains_hash(probes[k])) << "hash " << k;
+    }
+}
+
+TEST(BloomFilter, contains_hashes_accumulates_across_filters) {
+    auto first = make_hashes(20, 5);
+    auto second = make_hashes(20, 6);
+    auto probes = std::vector<ChangeHash>{first[3], second[7]};
+
+    auto out = std::vector<bool>(probes.size());
+    BloomFilter::from_hashes(first).contains_hashes(probes, out);
+    BloomFilter::from_hashes(second).contains_hashes(probes, out);
+    BloomFilter{}.contains_hashes(probes, out);  // empty filter contains nothing
+    EXPECT_TRUE(out[0]);
+    EXPECT_TRUE(out[1]);
+}
@@ -455,15 +455,17 @@ TEST(ChangeOpColumns, mixed_insert_and_mark_ops) {
     auto columns = encode_change_ops(ops, actor_table);
     auto decoded = decode_change_ops(columns, actor_table, actor, 1, 4);
     ASSERT_TRUE(decoded.has_value()) << "decode returned nullopt";
-    ASSERT_EQ(decoded->size(), 4u);
+    // The two one-byte splices decode as one batched splice
+    ASSERT_EQ(decoded->size(), 3u);
 
     EXPECT_EQ((*decoded)[0].action, OpType::make_object);
     EXPECT_EQ((*decoded)[1].action, OpType::splice_text);
-    EXPECT_EQ((*decoded)[2].action, OpType::splice_text);
-    EXPECT_EQ((*decoded)[3].action, OpType::mark);
+    EXPECT_EQ(std::get<std::string>(std::get<ScalarValue>((*decoded)[1].value)), "Hi");
+    EXPECT_EQ((*decoded)[2].action, OpType::mark);
+    EXPECT_EQ((*decoded)[2].id, (OpId{4, actor}));
 
     // Check mark value
-    auto* sv = std::get_if<ScalarValue>(&(*decoded)[3].value);
+    auto* sv = std::get_if<ScalarValue>(&(*decoded)[2].value);
     ASSERT_NE(sv, nullptr) << "mark value not ScalarValue";
     EXPECT_TRUE(std::holds_alternative<bool>(*sv));
 }
@@ -491,6 +493,111 @@ TEST(ChangeOpColumns, increment_op_round_trip) {
     EXPECT_EQ((*decoded)[0].action, OpType::increment);
 }
 
+TEST(ChangeOpColumns, batched_splice_is_stored_one_op_per_byte) {
+    auto actor = make_actor(1);
+    auto actor_table = std::vector<ActorId>{actor};
+    auto text_obj = ObjId{OpId{1, actor}};
+
+    // A 5-byte splice at counter 2 occupies 2..6; the next op is counter 7
+    auto ops = std::vector<Op>{
+        Op{
+            .id = OpId{2, actor},
+            .obj = text_obj,
+            .key = list_index(0),
+            .action = OpType::splice_text,
+            .value = Value{ScalarValue{std::string{"Hello"}}},
+            .pred = {},
+        },
+        Op{
+            .id = OpId{7, actor},
+            .obj = text_obj,
+            .key = list_index(5),
+            .action = OpType::splice_text,
+            .value = Value{ScalarValue{std::string{"!"}}},
+            .pred = {},
+            .insert_after = OpId{6, actor},
+        },
+    };
+    EXPECT_EQ(ops[0].width(), 5u);
+    EXPECT_EQ(ops[1].width(), 1u);
+    EXPECT_EQ(stored_op_count(ops), 6u);
+
+    // As upstream stores text: an insert (action 1) of each byte after the last
+    auto columns = encode_change_ops(ops, actor_table);
+    auto decoder = ChangeOpDecoder{columns, actor_table};
+    for (std::uint64_t i = 0; i < 6; ++i) {
+        auto op = decoder.next(OpId{2 + i, actor});
+        ASSERT_TRUE(op.has_value());
+        EXPECT_EQ(op->action, OpType::splice_text);
+        EXPECT_EQ(op->width(), 1u);
+        EXPECT_EQ(std::get<std::string>(std::get<ScalarValue>(op->value)),
+                  std::string(1, "Hello!"[i]));
+        auto expected_after = i == 0 ? std::optional<OpId>{} : std::optional{OpId{1 + i, actor}};
+        EXPECT_EQ(op->insert_after, expected_after);
+    }
+    auto actions = std::vector<RawColumn>{};
+    for (const auto& col : columns) {
+        if (col.spec == change_op_columns::action) actions.push_back(col);
+    }
+    ASSERT_EQ(actions.size(), 1u);
+    auto codes = encoding::RleDecoder<std::uint64_t>{actions[0].data};
+    for (int i = 0; i < 6; ++i) EXPECT_EQ(codes.next(), std::optional{std::optional<std::uint64_t>{1}});
+
+    // Decoding folds the chain back into one batched splice
+    auto decoded = decode_change_ops(columns, actor_table, actor, 2, 6);
+    ASSERT_TRUE(decoded.has_value());
+    ASSERT_EQ(decoded->size(), 1u);
+    EXPECT_EQ((*decoded)[0].action, OpType::splice_text);
+    EXPECT_EQ((*decoded)[0].id, (OpId{2, actor}));
+    EXPECT_EQ((*decoded)[0].insert_after, std::nullopt);
+    EXPECT_EQ(std::get<std::string>(std::get<ScalarValue>((*decoded)[0].value)), "Hello!");
+}
+
+TEST(ChangeOpColumns, splices_elsewhere_are_not_folded) {
+    auto actor = make_actor(1);
+    auto actor_table = std::vector<ActorId>{actor};
+    auto text_obj = ObjId{OpId{1, actor}};
+
+    // The second splice goes back to the start, not after the first
+    auto ops = std::vector<Op>{
+        Op{.id = OpId{2, actor}, .obj = text_obj, .key = list_index(0),
+           .action = OpType::splice_text, .value = Value{ScalarValue{std::string{"ab"}}},
+           .pred = {}},
+        Op{.id = OpId{4, actor}, .obj = text_obj, .key = list_index(0),
+           .action = OpType::splice_text, .value = Value{ScalarValue{std::string{"cd"}}},
+           .pred = {}},
+    };
+    auto columns = encode_change_ops(ops, actor_table);
+    auto decoded = decode_change_ops(columns, actor_table, actor, 2, stored_op_count(ops));
+
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(*decoded, ops);
+}
+
+TEST(ChangeOpColumns, multi_byte_list_insert_is_not_a_splice) {
+    auto actor = make_actor(1);
+    auto actor_table = std::vector<ActorId>{actor};
+
+    auto ops = std::vector<Op>{
+        Op{
+            .id = OpId{2, actor},
+            .obj = ObjId{OpId{1, actor}},
+            .key = list_index(0),
+            .action = OpType::insert,
+            .value = Value{ScalarValue{std::string{"hello"}}},
+            .pred = {},
+        },
+    };
+
+    auto columns = encode_change_ops(ops, actor_table);
+    auto decoded = decode_change_ops(columns, actor_table, actor, 2, 1);
+
+    ASSERT_TRUE(decoded.has_value());
+    ASSERT_EQ(decoded->size(), 1u);
+    EXPECT_EQ((*decoded)[0].action, OpType::insert);
+    EXPECT_EQ((*decoded)[0].width(), 1u);
+}
+
 TEST(ChangeOpColumns, insert_object_map_round_trip) {
     auto actor = make_actor(1);
     auto actor_table = std::vector<ActorId>{actor};
@@ -575,3 +682,61 @@ TEST(ChangeOpColumns, multi_actor_op_fields_round_trip) {
     EXPECT_EQ((*decoded)[0].pred[0].counter, 3u);
     EXPECT_EQ((*decoded)[0].pred[0].actor, actor3);
 }
+
+TEST(ChangeOpColumns, column_groups_concatenate_to_all_columns) {
+    auto actor = make_actor(1);
+    auto actor_table = std::vector<ActorId>{actor, make_actor(2)};
+    auto ops = std::vector<Op>{
+        Op{.id = OpId{1, actor}, .obj = root, .key = map_key("text"),
+           .action = OpType::make_object, .value = Value{ObjType::text}, .pred = {}},
+        Op{.id = OpId{2, actor}, .obj = ObjId{OpId{1, actor}}, .key = list_index(0),
+           .action = OpType::splice_text, .value = Value{ScalarValue{std::string{"abc"}}},
+           .pred = {}},
+        Op{.id = OpId{5, actor}, .obj = ObjId{OpId{1, actor}}, .key = map_key("bold"),
+           .action = OpType::mark, .value = Value{ScalarValue{true}},
+           .pred = {OpId{2, actor}, OpId{4, actor}}},
+        Op{.id = OpId{6, actor}, .obj = root, .key = map_key("n"), .action = OpType::put,
+           .value = Value{ScalarValue{std::int64_t{7}}}, .pred = {OpId{3, make_actor(2)}}},
+    };
+
+    auto all = encode_change_ops(ops, actor_table);
+    auto joined = std::vector<RawColumn>{};
+    for (auto groups : {OpColumnGroups{.keys = true, .values = false, .preds = false},
+                        OpColumnGroups{.keys = false, .values = true, .preds = false},
+                        OpColumnGroups{.keys = false, .values = false, .preds = true}}) {
+        for (auto& col : encode_change_ops(ops, actor_table, groups)) joined.push_back(std::move(col));
+    }
+    ASSERT_EQ(joined.size(), all.size());
+    for (std::size_t i = 0; i < all.size(); ++i) {
+        EXPECT_EQ(joined[i].spec, all[i].spec) << "column " << i;
+        EXPECT_EQ(joined[i].data, all[i].data) << "column " << i;
+    }
+}
+
+TEST(ChangeOpColumns, actor_index_matches_actor_table) {
+    auto actor_table = std::vector<ActorId>{};
+    for (std::uint8_t i = 1; i <= 40; ++i) actor_table.push_back(make_actor(i));
+    auto ops = std::vector<Op>{};
+    for (std::uint8_t i = 0; i < 40; ++i) {
+        const auto& actor = actor_table[i];
+        const auto& prev = actor_table[(i + 39) % 40];
+        ops.push_back(Op{.id = OpId{i + 2u, actor}, .obj = ObjId{OpId{1, prev}},
+                         .key = map_key("k"), .action = OpType::put,
+                         .value = Value{ScalarValue{std::int64_t{i}}},
+                         .pred = {OpId{i + 1u, prev}}});
+    }
+
+    auto index = make_actor_index(actor_table);
+    EXPECT_EQ(find_actor_index(index, actor_table[17]), 17u);
+    EXPECT_EQ(find_actor_index(actor_table, actor_table[17]), 17u);
+
+    auto by_table = encode_change_ops(ops, actor_table);
+    auto by_index = encode_change_ops(ops, index);
+    ASSERT_EQ(by_index.size(), by_table.size());
+    for (std::size_t i = 0; i < by_table.size(); ++i) {
+        EXPECT_EQ(by_index[i].data, by_table[i].data) << "column " << i;
+    }
+    auto decoded = decode_change_ops(by_index, actor_table, actor_table[0], 2, ops.size());
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ((*decoded)[5].pred[0].actor, actor_table[4]);
+}
@@ -127,3 +127,19 @@ TEST(Chunk, body_extraction) {
         output.begin() + static_cast<std::ptrdiff_t>(header->body_offset + header->body_length));
     EXPECT_EQ(extracted, body);
 }
+
+TEST(Chunk, in_place_chunk_matches_write_chunk) {
+    for (auto size : {std::size_t{0}, std::size_t{3}, std::size_t{200}, std::size_t{20000}}) {
+        auto body = std::vector<std::byte>(size, std::byte{0x5A});
+        auto expected = std::vector<std::byte>{std::byte{0xFF}};
+        write_chunk(ChunkType::document, body, expected);
+
+        auto output = std::vector<std::byte>{std::byte{0xFF}};
+        auto start = begin_chunk(output);
+        output.insert(output.end(), body.begin(), body.end());
+        auto offset = finish_chunk(ChunkType::document, output, start);
+        output.erase(output.begin() + static_cast<std::ptrdiff_t>(start),
+                     output.begin() + static_cast<std::ptrdiff_t>(offset));
+        EXPECT_EQ(output, expected) << "body size " << size;
+    }
+}
@@ -1,9 +1,12 @@
 #include "../src/storage/columns/column_spec.hpp"
 #include "../src/storage/columns/raw_column.hpp"
 #include "../src/storage/columns/compression.hpp"
+#include "../src/storage/change_chunk.hpp"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 using namespace automerge_cpp::storage;
 
 // -- ColumnSpec tests ---------------------------------------------------------
@@ -102,6 +105,41 @@ TEST(RawColumn, column_with_empty_data) {
     EXPECT_TRUE(parsed[0].data.empty());
 }
 
+TEST(RawColumn, column_views_point_into_input) {
+    auto columns = std::vector<RawColumn>{
+        {.spec = ColumnSpec{.column_id = 0, .type = ColumnType::actor_id, .deflate = false},
+         .data = {std::byte{0x01}, std::byte{0x02}}},
+        {.spec = ColumnSpec{.column_id = 1, .type = ColumnType::delta_int, .deflate = false},
+         .data = {std::byte{0x0A}}},
+    };
+    auto output = std::vector<std::byte>{};
+    write_raw_columns(columns, output);
+
+    auto pos = std::size_t{0};
+    auto views = parse_column_views(output, pos);
+
+    ASSERT_EQ(views.size(), 2u);
+    EXPECT_EQ(pos, output.size());
+    EXPECT_EQ(views[1].data.data() + views[1].data.size(), output.data() + output.size());
+    EXPECT_TRUE(std::ranges::equal(views[0].data, columns[0].data));
+    EXPECT_TRUE(std::ranges::equal(views[1].data, columns[1].data));
+}
+
+TEST(RawColumn, column_views_stop_at_truncated_data) {
+    auto columns = std::vector<RawColumn>{
+        {.spec = ColumnSpec{.column_id = 0, .type = ColumnType::actor_id, .deflate = false},
+         .data = std::vector<std::byte>(8, std::byte{0x01})},
+    };
+    auto output = std::vector<std::byte>{};
+    write_raw_columns(columns, output);
+    output.pop_back();
+
+    auto pos = std::size_t{0};
+    EXPECT_TRUE(parse_column_views(output, pos).empty());
+    pos = 0;
+    EXPECT_FALSE(skip_raw_columns(output, pos));
+}
+
 // -- Compression tests --------------------------------------------------------
 
 TEST(Compression, round_trip_small_data) {
@@ -138,6 +176,54 @@ TEST(Compression, empty_data) {
     EXPECT_TRUE(decompressed->empty());
 }
 
+TEST(Compression, expected_size_hint) {
+    auto input = std::vector<std::byte>(10000, std::byte{0x07});
+    auto compressed = deflate_compress(input);
+    ASSERT_TRUE(compressed.has_value());
+
+    // Exact hint, and a hint too small (the buffer grows)
+    auto exact = deflate_decompress(*compressed, std::size_t{1} << 20, input.size());
+    auto small = deflate_decompress(*compressed, std::size_t{1} << 20, 16);
+    ASSERT_TRUE(exact.has_value());
+    ASSERT_TRUE(small.has_value());
+    EXPECT_EQ(*exact, input);
+    EXPECT_EQ(*small, input);
+}
+
+TEST(Compression, context_reuses_streams) {
+    auto context = CompressionContext{};
+    auto a = std::vector<std::byte>(2000, std::byte{0x11});
+    auto b = std::vector<std::byte>(3000, std::byte{0x22});
+
+    // Each call starts from a reset stream, whatever came before
+    auto ca = context.compress(a);
+    auto cb = context.compress(b, 1);
+    auto ca_again = context.compress(a);
+    ASSERT_TRUE(ca && cb && ca_again);
+    EXPECT_EQ(*ca_again, *ca);
+    EXPECT_EQ(context.decompress(*cb), b);
+    EXPECT_EQ(context.decompress(*ca), a);
+
+    // A corrupt stream fails without poisoning the next call
+    auto corrupt = std::vector<std::byte>(16, std::byte{0xFF});
+    EXPECT_FALSE(context.decompress(corrupt).has_value());
+    EXPECT_EQ(context.decompress(*ca), a);
+}
+
+TEST(Compression, compress_columns_level_zero_stores_raw) {
+    auto data = std::vector<std::byte>(1000, std::byte{0x33});
+    auto columns = std::vector<RawColumn>{
+        RawColumn{.spec = ColumnSpec{.column_id = 1, .type = ColumnType::value_raw, .deflate = false},
+                  .data = data},
+    };
+    compress_columns(columns, 0);
+    EXPECT_FALSE(columns[0].spec.deflate);
+    EXPECT_EQ(columns[0].data, data);
+
+    compress_columns(columns, 9);
+    EXPECT_TRUE(columns[0].spec.deflate);
+}
+
 TEST(Compression, threshold_check) {
     // Data below threshold should not be compressed (caller decides)
     auto small = std::vector<std::byte>(100, std::byte{0x00});
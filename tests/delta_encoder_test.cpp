@@ -139,6 +139,29 @@ TEST(DeltaEncoder, large_gaps_round_trip) {
     EXPECT_FALSE(dec.next().has_value());
 }
 
+TEST(DeltaEncoder, next_n_accumulates_across_nulls) {
+    auto enc = DeltaEncoder{};
+    auto values = std::vector<std::optional<std::int64_t>>{};
+    for (std::int64_t i = 0; i < 50; ++i) {
+        if (i % 7 == 3) {
+            enc.append_null();
+            values.push_back(std::nullopt);
+        } else {
+            enc.append(i * i);
+            values.push_back(i * i);
+        }
+    }
+    enc.finish();
+
+    auto dec = DeltaDecoder{enc.data()};
+    auto out = std::vector<std::optional<std::int64_t>>(60);
+    auto n = dec.next_n(out);
+    ASSERT_TRUE(n.has_value());
+    ASSERT_EQ(*n, values.size());
+    out.resize(*n);
+    EXPECT_EQ(out, values);
+}
+
 // -- Boolean encoder tests ----------------------------------------------------
 
 TEST(BooleanEncoder, empty_produces_no_bytes) {
@@ -0,0 +1,343 @@
+#include "../src/doc_state.hpp"
+
+#include <gtest/gtest.h>
+
+#include <memory_resource>
+#include <string>
+
+using namespace automerge_cpp;
+using automerge_cpp::detail::ChangeLog;
+using automerge_cpp::detail::DocState;
+using automerge_cpp::detail::HistoryCache;
+
+namespace {
+
+auto make_state() -> DocState {
+    constexpr std::uint8_t raw[16] = {1};
+    auto state = DocState{};
+    state.actor = ActorId{raw};
+    return state;
+}
+
+auto str(std::string s) -> Value { return Value{ScalarValue{std::move(s)}}; }
+
+auto make_change(std::uint64_t seq) -> Change {
+    auto change = Change{};
+    change.seq = seq;
+    change.start_op = seq;
+    return change;
+}
+
+void append(ChangeLog& log, std::uint64_t seq) {
+    auto change = make_change(seq);
+    auto hash = DocState::compute_change_hash(change);
+    log.push_back(std::move(change), hash);
+}
+
+}  // namespace
+
+// -- Copy-on-write objects ----------------------------------------------------
+
+TEST(DocState, copy_shares_objects_until_written) {
+    auto state = make_state();
+    auto list = state.create_object(state.next_op_id(), ObjType::list);
+    state.list_insert(list, 0, state.next_op_id(), str("a"));
+    state.map_put(root, "k", state.next_op_id(), str("v"));
+
+    auto copy = state;
+    const auto& const_state = state;
+    const auto& const_copy = copy;
+    EXPECT_EQ(const_state.get_object(list), const_copy.get_object(list));
+    EXPECT_EQ(const_state.get_object(root), const_copy.get_object(root));
+
+    // Writing to one object of the copy detaches only that object
+    copy.list_insert(list, 1, copy.next_op_id(), str("b"));
+    EXPECT_NE(const_state.get_object(list), const_copy.get_object(list));
+    EXPECT_EQ(const_state.get_object(root), const_copy.get_object(root));
+
+    EXPECT_EQ(state.list_length(list), 1u);
+    EXPECT_EQ(copy.list_length(list), 2u);
+}
+
+TEST(DocState, writes_to_original_do_not_leak_into_copy) {
+    auto state = make_state();
+    auto text = state.create_object(state.next_op_id(), ObjType::text);
+    state.text_insert(text, 0, state.next_op_ids(5), "hello");
+
+    auto copy = state;
+    state.list_delete(text, 0);
+    state.map_put(root, "k", state.next_op_id(), str("v"));
+
+    EXPECT_EQ(state.text_content(text), "ello");
+    EXPECT_EQ(copy.text_content(text), "hello");
+    EXPECT_FALSE(copy.map_get(root, "k").has_value());
+}
+
+TEST(DocState, unshared_object_is_written_in_place) {
+    auto state = make_state();
+    const auto& const_state = state;
+    const auto* before = const_state.get_object(root);
+    state.map_put(root, "k", state.next_op_id(), str("v"));
+    EXPECT_EQ(const_state.get_object(root), before);
+}
+
+// -- Interned keys ------------------------------------------------------------
+
+TEST(DocState, objects_intern_keys_in_one_pool) {
+    auto state = make_state();
+    for (int i = 0; i < 50; ++i) {
+        auto row = state.create_object(state.next_op_id(), ObjType::map);
+        state.map_put(row, "id", state.next_op_id(), str(std::to_string(i)));
+        state.map_put(row, "current_status", state.next_op_id(), str("open"));
+        state.map_put(row, "assigned_owner", state.next_op_id(), str("none"));
+    }
+    EXPECT_EQ(state.strings->size(), 2u);  // "id" is short enough to store inline
+}
+
+TEST(DocState, copied_object_keeps_its_pool) {
+    auto state = make_state();
+    auto row = state.create_object(state.next_op_id(), ObjType::map);
+    state.map_put(row, "document_title", state.next_op_id(), str("a"));
+
+    auto copy = state;
+    copy.strings = std::make_shared<detail::StringPool>();  // as a fresh DocState would have
+    copy.map_put(row, "document_owner", copy.next_op_id(), str("b"));
+    state = make_state();  // drop the original document's state
+
+    EXPECT_EQ(copy.map_keys(row),
+              (std::vector<std::string>{"document_owner", "document_title"}));
+    EXPECT_EQ(copy.strings->size(), 0u);
+}
+
+// -- Shared change log --------------------------------------------------------
+
+TEST(DocState, parallel_apply_needs_a_thread_safe_resource) {
+    EXPECT_TRUE(DocState{std::pmr::new_delete_resource()}.resource_is_thread_safe());
+    auto pool = std::pmr::synchronized_pool_resource{};
+    EXPECT_TRUE(DocState{&pool}.resource_is_thread_safe());
+    auto arena = std::pmr::monotonic_buffer_resource{};
+    EXPECT_FALSE(DocState{&arena}.resource_is_thread_safe());
+    auto unsynchronized = std::pmr::unsynchronized_pool_resource{};
+    EXPECT_FALSE(DocState{&unsynchronized}.resource_is_thread_safe());
+}
+
+TEST(ChangeLog, copy_shares_change_objects) {
+    auto log = ChangeLog{};
+    for (auto seq = std::uint64_t{1}; seq <= 300; ++seq) append(log, seq);
+
+    auto copy = log;
+    ASSERT_EQ(copy.size(), 300u);
+    for (auto i = std::size_t{0}; i < log.size(); ++i) {
+        EXPECT_EQ(&copy[i], &log[i]);
+    }
+}
+
+TEST(ChangeLog, append_to_copy_does_not_affect_original) {
+    auto log = ChangeLog{};
+    for (auto seq = std::uint64_t{1}; seq <= 10; ++seq) append(log, seq);
+
+    auto copy = log;
+    append(copy, 11);
+    append(log, 12);
+
+    ASSERT_EQ(copy.size(), 11u);
+    ASSERT_EQ(log.size(), 11u);
+    EXPECT_EQ(copy.back().seq, 11u);
+    EXPECT_EQ(log.back().seq, 12u);
+    EXPECT_EQ(&copy[9], &log[9]);
+}
+
+TEST(ChangeLog, entry_can_be_shared_into_another_log) {
+    auto changes = std::vector<Change>{make_change(1), make_change(2)};
+    auto hashes = DocState::compute_change_hashes(changes);
+    auto log = ChangeLog{std::move(changes), hashes};
+    auto other = ChangeLog{};
+    other.push_back(log.entry(1), log.hash(1));
+    EXPECT_EQ(&other[0], &log[1]);
+    EXPECT_EQ(other.hash(0), hashes[1]);
+
+    auto seqs = std::vector<std::uint64_t>{};
+    for (const auto& change : log) seqs.push_back(change.seq);
+    EXPECT_EQ(seqs, (std::vector<std::uint64_t>{1, 2}));
+}
+
+TEST(DocState, copy_shares_change_history) {
+    auto state = make_state();
+    append(state.change_history, 1);
+    auto copy = state;
+    EXPECT_EQ(&copy.change_history[0], &state.change_history[0]);
+}
+
+TEST(DocState, hash_index_uses_stored_hashes) {
+    auto state = make_state();
+    auto stored = ChangeHash{};
+    stored.bytes[0] = std::byte{0x42};  // not the change's computed hash
+    state.change_history.push_back(make_change(1), stored);
+    EXPECT_TRUE(state.has_change_hash(stored));
+    EXPECT_FALSE(state.has_change_hash(DocState::compute_change_hash(make_change(1))));
+    EXPECT_EQ(state.all_change_hashes(), std::vector<ChangeHash>{stored});
+}
+
+TEST(DocState, change_indices_since_excludes_ancestors) {
+    auto state = make_state();
+    auto first = make_change(1);
+    auto first_hash = DocState::compute_change_hash(first);
+    auto second = make_change(2);
+    second.deps = {first_hash};
+    auto second_hash = DocState::compute_change_hash(second);
+    state.change_history.push_back(std::move(first), first_hash);
+    state.change_history.push_back(std::move(second), second_hash);
+    append(state.change_history, 3);  // concurrent root
+
+    EXPECT_EQ(state.change_indices_since({second_hash}), (std::vector<std::size_t>{2}));
+    EXPECT_EQ(state.change_indices_since({first_hash}), (std::vector<std::size_t>{1, 2}));
+    EXPECT_EQ(state.change_indices_since({}), (std::vector<std::size_t>{0, 1, 2}));
+    EXPECT_EQ(state.changes_visible_at({second_hash}), (std::vector<std::size_t>{0, 1}));
+}
+
+TEST(DocState, change_indices_since_walks_back_from_heads) {
+    // 0 <- 1 <- 2 <- 3 and a concurrent 4 on top of 1
+    auto state = make_state();
+    auto hashes = std::vector<ChangeHash>{};
+    auto add = [&](std::uint64_t seq, std::vector<ChangeHash> deps) {
+        auto change = make_change(seq);
+        change.deps = std::move(deps);
+        hashes.push_back(DocState::compute_change_hash(change));
+        state.change_history.push_back(std::move(change), hashes.back());
+    };
+    add(1, {});
+    add(2, {hashes[0]});
+    add(3, {hashes[1]});
+    add(4, {hashes[2]});
+    add(5, {hashes[1]});
+    state.heads = {hashes[3], hashes[4]};
+
+    EXPECT_EQ(state.change_indices_since({hashes[3]}), (std::vector<std::size_t>{4}));
+    EXPECT_EQ(state.change_indices_since({hashes[4]}), (std::vector<std::size_t>{2, 3}));
+    EXPECT_EQ(state.change_indices_since({hashes[0]}), (std::vector<std::size_t>{1, 2, 3, 4}));
+    EXPECT_TRUE(state.change_indices_since(state.heads).empty());
+
+    // A dep recorded after its dependent: the result still excludes ancestors
+    auto late = make_state();
+    auto child = make_change(2);
+    child.deps = {hashes[0]};
+    auto child_hash = DocState::compute_change_hash(child);
+    late.change_history.push_back(std::move(child), child_hash);
+    late.change_history.push_back(make_change(1), hashes[0]);
+    late.heads = {child_hash};
+    EXPECT_TRUE(late.change_indices_since({child_hash}).empty());
+    EXPECT_EQ(late.change_indices_since({hashes[0]}), (std::vector<std::size_t>{0}));
+}
+
+TEST(DocState, change_dag_has_dense_deps_and_generations) {
+    // 0 <- 1 <- 2 and a concurrent 3 on top of 0; 4 merges 2 and 3
+    auto state = make_state();
+    auto hashes = std::vector<ChangeHash>{};
+    auto add = [&](std::uint64_t seq, std::vector<ChangeHash> deps) {
+        auto change = make_change(seq);
+        change.deps = std::move(deps);
+        hashes.push_back(DocState::compute_change_hash(change));
+        state.change_history.push_back(std::move(change), hashes.back());
+    };
+    add(1, {});
+    add(2, {hashes[0]});
+    add(3, {hashes[1]});
+    add(4, {hashes[0]});
+    add(5, {hashes[2], hashes[3]});
+
+    const auto& dag = state.change_dag();
+    EXPECT_TRUE(dag.ordered);
+    EXPECT_EQ(dag.generation, (std::vector<std::size_t>{1, 2, 3, 2, 4}));
+    EXPECT_EQ(std::vector<std::size_t>(dag.deps_of(4).begin(), dag.deps_of(4).end()),
+              (std::vector<std::size_t>{2, 3}));
+
+    auto candidates = std::vector<std::size_t>{0, 1, 2, 3};
+    EXPECT_EQ(state.ancestors_among({hashes[2]}, candidates),
+              (std::vector<bool>{true, true, true, false}));
+    EXPECT_EQ(state.ancestors_among({hashes[4]}, candidates),
+              (std::vector<bool>{true, true, true, true}));
+
+    // Appended changes extend the index
+    add(6, {hashes[4]});
+    EXPECT_EQ(state.change_dag().generation.back(), 5u);
+}
+
+TEST(DocState, change_dag_falls_back_when_dep_arrives_late) {
+    auto first = make_change(1);
+    auto first_hash = DocState::compute_change_hash(first);
+    auto child = make_change(2);
+    child.deps = {first_hash};
+    auto child_hash = DocState::compute_change_hash(child);
+
+    auto state = make_state();
+    state.change_history.push_back(std::move(child), child_hash);
+    EXPECT_TRUE(state.change_dag().ordered);  // dep missing, not yet late
+    state.change_history.push_back(std::move(first), first_hash);
+    EXPECT_FALSE(state.change_dag().ordered);
+
+    auto candidates = std::vector<std::size_t>{1};
+    EXPECT_EQ(state.ancestors_among({child_hash}, candidates), std::vector<bool>{true});
+    EXPECT_EQ(state.changes_visible_at({child_hash}), (std::vector<std::size_t>{0, 1}));
+}
+
+// -- Historical snapshots -----------------------------------------------------
+
+TEST(DocState, state_at_caches_snapshots_by_visible_set) {
+    auto state = make_state();
+    state.map_put(root, "k", state.next_op_id(), str("v"));
+    append(state.change_history, 1);
+    append(state.change_history, 2);
+
+    auto first = state.state_at(std::vector<std::size_t>{0});
+    EXPECT_EQ(state.state_at(std::vector<std::size_t>{0}), first);
+    EXPECT_NE(state.state_at(std::vector<std::size_t>{0, 1}), first);
+
+    // Copies do not inherit snapshots built for another history
+    auto copy = state;
+    EXPECT_NE(copy.state_at(std::vector<std::size_t>{0}), first);
+}
+
+// -- Checkpoints --------------------------------------------------------------
+
+TEST(DocState, checkpoints_are_spaced_and_bounded) {
+    auto cache = HistoryCache{};
+    cache.checkpoint_interval = 1;
+    for (auto size = std::size_t{1}; size <= 40; ++size) {
+        cache.record_checkpoint(size, std::make_shared<DocState>());
+    }
+    EXPECT_LE(cache.checkpoints.size(), HistoryCache::max_checkpoints);
+    EXPECT_GT(cache.checkpoint_interval, 1u);
+    for (auto i = std::size_t{1}; i < cache.checkpoints.size(); ++i) {
+        EXPECT_LT(cache.checkpoints[i - 1].history_size, cache.checkpoints[i].history_size);
+    }
+}
+
+TEST(DocState, state_at_replays_from_checkpoint) {
+    auto state = make_state();
+    state.history_cache_.checkpoint_interval = 2;
+    for (auto seq = std::uint64_t{1}; seq <= 3; ++seq) append(state.change_history, seq);
+
+    // Only the checkpoint carries this key; replaying the (empty) changes would not
+    auto checkpoint = std::make_shared<DocState>();
+    checkpoint->map_put(root, "k", checkpoint->next_op_id(), str("v"));
+    state.history_cache_.record_checkpoint(2, checkpoint);
+
+    EXPECT_TRUE(state.state_at(std::vector<std::size_t>{0, 1})->map_get(root, "k").has_value());
+    EXPECT_FALSE(state.state_at(std::vector<std::size_t>{0})->map_get(root, "k").has_value());
+}
+
+TEST(DocState, replay_of_history_prefix_leaves_checkpoints) {
+    auto state = make_state();
+    state.history_cache_.checkpoint_interval = 2;
+    for (auto seq = std::uint64_t{1}; seq <= 5; ++seq) append(state.change_history, seq);
+
+    state.state_at(std::vector<std::size_t>{0, 1, 2, 3});
+    const auto& checkpoints = state.history_cache_.checkpoints;
+    ASSERT_EQ(checkpoints.size(), 2u);
+    EXPECT_EQ(checkpoints[0].history_size, 2u);
+    EXPECT_EQ(checkpoints[1].history_size, 4u);
+
+    // Copies keep checkpoints (they share the history prefix)
+    auto copy = state;
+    EXPECT_EQ(copy.history_cache_.checkpoints.size(), 2u);
+}
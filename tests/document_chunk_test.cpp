@@ -0,0 +1,269 @@
+#include <automerge-cpp/automerge.hpp>
+
+#include "../src/doc_state.hpp"
+#include "../src/storage/document_chunk.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace automerge_cpp;
+using namespace automerge_cpp::storage;
+using automerge_cpp::detail::DocState;
+
+namespace {
+
+auto make_actor(std::uint8_t id) -> ActorId {
+    auto actor = ActorId{};
+    actor.bytes[15] = static_cast<std::byte>(id);
+    return actor;
+}
+
+auto put(ActorId actor, std::uint64_t counter, std::string key, std::int64_t value) -> Op {
+    return Op{
+        .id = OpId{counter, actor},
+        .obj = root,
+        .key = std::move(key),
+        .action = OpType::put,
+        .value = Value{ScalarValue{value}},
+        .pred = {},
+    };
+}
+
+auto hashes_of(const std::vector<Change>& changes) -> std::vector<ChangeHash> {
+    auto hashes = std::vector<ChangeHash>{};
+    for (const auto& change : changes) hashes.push_back(DocState::compute_change_hash(change));
+    return hashes;
+}
+
+// Older saves store one length-prefixed change body per change
+// (change `corrupt` is replaced by garbage when given).
+auto save_per_change(const Document& doc, std::optional<std::size_t> corrupt = std::nullopt)
+    -> std::vector<std::byte> {
+    auto changes = doc.get_changes();
+    auto heads = doc.get_heads();
+    auto actor = doc.actor_id();
+
+    auto body = std::vector<std::byte>{};
+    encoding::encode_uleb128(1, body);
+    encoding::encode_uleb128(ActorId::size, body);
+    body.insert(body.end(), actor.bytes.begin(), actor.bytes.end());
+    encoding::encode_uleb128(heads.size(), body);
+    for (const auto& h : heads) body.insert(body.end(), h.bytes.begin(), h.bytes.end());
+    encoding::encode_uleb128(changes.size(), body);
+    for (std::size_t i = 0; i < changes.size(); ++i) {
+        auto change_body = serialize_change_body(changes[i], {actor});
+        if (i == corrupt) std::ranges::fill(change_body, std::byte{0xFF});
+        encoding::encode_uleb128(change_body.size(), body);
+        body.insert(body.end(), change_body.begin(), change_body.end());
+    }
+    encoding::encode_uleb128(0, body);                   // local actor index
+    encoding::encode_uleb128(changes.size() + 1, body);  // next_counter (one op per change)
+    encoding::encode_uleb128(changes.size(), body);      // local_seq
+    encoding::encode_uleb128(1, body);                   // clock entries
+    encoding::encode_uleb128(0, body);
+    encoding::encode_uleb128(changes.size(), body);
+    auto bytes = std::vector<std::byte>{};
+    write_chunk(ChunkType::document, body, bytes);
+    return bytes;
+}
+
+auto round_trip(const std::vector<Change>& changes, const std::vector<ActorId>& actor_table)
+    -> std::optional<std::vector<Change>> {
+    auto body = std::vector<std::byte>{};
+    write_document_changes(changes, hashes_of(changes), actor_table, body);
+    auto pos = std::size_t{0};
+    auto parsed = parse_document_changes(body, pos, actor_table, changes.size(),
+                                         &DocState::compute_change_hash);
+    EXPECT_EQ(pos, body.size());
+    return parsed;
+}
+
+}  // namespace
+
+// -- Round trips --------------------------------------------------------------
+
+TEST(DocumentChunk, round_trip_preserves_changes) {
+    auto a = make_actor(1);
+    auto b = make_actor(2);
+    auto actor_table = std::vector<ActorId>{a, b};
+
+    auto first = Change{.actor = a, .seq = 1, .start_op = 1, .timestamp = 1000,
+                        .message = std::string{"init"}, .deps = {},
+                        .operations = {put(a, 1, "x", 1), put(a, 2, "y", 2)}};
+    auto second = Change{.actor = b, .seq = 1, .start_op = 3, .timestamp = 900,
+                         .message = std::nullopt,
+                         .deps = {DocState::compute_change_hash(first)},
+                         .operations = {put(b, 3, "x", 3)}};
+    auto changes = std::vector<Change>{first, second};
+
+    auto parsed = round_trip(changes, actor_table);
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_EQ(*parsed, changes);
+}
+
+TEST(DocumentChunk, deps_outside_earlier_rows_keep_raw_hashes) {
+    auto a = make_actor(1);
+    auto actor_table = std::vector<ActorId>{a};
+
+    auto unknown = ChangeHash{};
+    unknown.bytes[0] = std::byte{0xAB};
+    auto later = Change{.actor = a, .seq = 2, .start_op = 2, .timestamp = 0,
+                        .message = std::nullopt, .deps = {},
+                        .operations = {put(a, 2, "k", 2)}};
+    // Depends on a change outside the document and on a later row
+    auto earlier = Change{.actor = a, .seq = 1, .start_op = 1, .timestamp = 0,
+                          .message = std::nullopt,
+                          .deps = {unknown, DocState::compute_change_hash(later)},
+                          .operations = {put(a, 1, "k", 1)}};
+    auto changes = std::vector<Change>{earlier, later};
+
+    auto parsed = round_trip(changes, actor_table);
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_EQ(*parsed, changes);
+}
+
+TEST(DocumentChunk, truncated_columns_are_rejected) {
+    auto a = make_actor(1);
+    auto actor_table = std::vector<ActorId>{a};
+    auto changes = std::vector<Change>{
+        Change{.actor = a, .seq = 1, .start_op = 1, .timestamp = 0, .message = std::nullopt,
+               .deps = {}, .operations = {put(a, 1, "k", 1), put(a, 2, "j", 2)}},
+    };
+    auto body = std::vector<std::byte>{};
+    write_document_changes(changes, hashes_of(changes), actor_table, body);
+    body.resize(body.size() / 2);
+
+    auto pos = std::size_t{0};
+    EXPECT_FALSE(parse_document_changes(body, pos, actor_table, changes.size(),
+                                        &DocState::compute_change_hash).has_value());
+}
+
+TEST(DocumentChunk, columns_span_changes) {
+    auto a = make_actor(1);
+    auto actor_table = std::vector<ActorId>{a};
+    auto changes = std::vector<Change>{};
+    for (auto i = std::uint64_t{1}; i <= 200; ++i) {
+        auto deps = changes.empty() ? std::vector<ChangeHash>{}
+                                    : std::vector{DocState::compute_change_hash(changes.back())};
+        changes.push_back(Change{.actor = a, .seq = i, .start_op = i, .timestamp = 0,
+                                 .message = std::nullopt, .deps = std::move(deps),
+                                 .operations = {put(a, i, "counter", static_cast<std::int64_t>(i))}});
+    }
+
+    auto columnar = std::vector<std::byte>{};
+    write_document_changes(changes, hashes_of(changes), actor_table, columnar);
+    auto per_change = std::size_t{0};
+    for (const auto& change : changes) {
+        per_change += serialize_change_body(change, actor_table).size();
+    }
+    EXPECT_LT(columnar.size() * 10, per_change);
+}
+
+// -- Document save/load -------------------------------------------------------
+
+TEST(DocumentChunk, load_reads_per_change_layout) {
+    auto source = Document{1u};
+    source.transact([](auto& tx) { tx.put(root, "k", std::int64_t{1}); });
+    source.transact([](auto& tx) { tx.put(root, "k", std::int64_t{2}); });
+
+    auto loaded = Document::load(save_per_change(source));
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->get<std::int64_t>(root, "k"), 2);
+    EXPECT_EQ(loaded->get_heads(), source.get_heads());
+    EXPECT_EQ(loaded->get_changes(), source.get_changes());
+}
+
+TEST(DocumentChunk, save_round_trips_many_changes) {
+    auto doc = Document{1u};
+    auto text_id = doc.transact([](auto& tx) { return tx.put_object(root, "text", ObjType::text); });
+    for (int i = 0; i < 300; ++i) {
+        doc.transact([&](auto& tx) {
+            tx.splice_text(text_id, static_cast<std::size_t>(i), 0, "x");
+            tx.put(root, "n", std::int64_t{i});
+        });
+    }
+
+    auto loaded = Document::load(doc.save());
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->text(text_id), doc.text(text_id));
+    EXPECT_EQ(loaded->get<std::int64_t>(root, "n"), 299);
+    EXPECT_EQ(loaded->get_heads(), doc.get_heads());
+    EXPECT_EQ(loaded->get_changes().size(), doc.get_changes().size());
+}
+
+// -- Parallel load ------------------------------------------------------------
+
+TEST(DocumentChunk, load_with_pool_decodes_per_change_layout) {
+    auto source = Document{1u};
+    for (int i = 0; i < 200; ++i) {
+        source.transact([&](auto& tx) { tx.put(root, "k" + std::to_string(i % 7), std::int64_t{i}); });
+    }
+    auto bytes = save_per_change(source);
+
+    auto pool = std::make_shared<thread_pool>(4);
+    auto loaded = Document::load(bytes, pool);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->get_thread_pool(), pool);
+    EXPECT_EQ(loaded->get_heads(), source.get_heads());
+    EXPECT_EQ(loaded->get_changes(), source.get_changes());
+}
+
+TEST(DocumentChunk, load_with_pool_matches_sequential_load) {
+    auto doc = Document{1u};
+    auto list_id = doc.transact([](auto& tx) { return tx.put_object(root, "items", ObjType::list); });
+    for (int i = 0; i < 500; ++i) {
+        doc.transact([&](auto& tx) {
+            tx.insert(list_id, static_cast<std::size_t>(i), "item " + std::to_string(i));
+        });
+    }
+    auto bytes = doc.save();
+
+    auto sequential = Document::load(bytes);
+    auto parallel = Document::load(bytes, std::make_shared<thread_pool>(4));
+    ASSERT_TRUE(sequential.has_value());
+    ASSERT_TRUE(parallel.has_value());
+    EXPECT_EQ(parallel->length(list_id), 500u);
+    EXPECT_EQ(parallel->get_heads(), sequential->get_heads());
+    EXPECT_EQ(parallel->save(), bytes);
+}
+
+TEST(DocumentChunk, load_with_pool_rejects_corrupt_change) {
+    auto source = Document{1u};
+    for (int i = 0; i < 100; ++i) {
+        source.transact([&](auto& tx) { tx.put(root, "k", std::int64_t{i}); });
+    }
+    auto bytes = save_per_change(source, 57);
+
+    EXPECT_FALSE(Document::load(bytes, std::make_shared<thread_pool>(4)).has_value());
+}
+
+// -- Parallel save ------------------------------------------------------------
+
+TEST(DocumentChunk, save_with_pool_matches_sequential_save) {
+    auto pool = std::make_shared<thread_pool>(4);
+    auto doc = Document{pool};
+    auto text_id = doc.transact([](auto& tx) { return tx.put_object(root, "text", ObjType::text); });
+    auto list_id = doc.transact([](auto& tx) { return tx.put_object(root, "items", ObjType::list); });
+    for (int i = 0; i < 400; ++i) {
+        doc.transact([&](auto& tx) {
+            tx.splice_text(text_id, static_cast<std::size_t>(i), 0, "ab");
+            tx.insert(list_id, static_cast<std::size_t>(i), "item " + std::to_string(i));
+            tx.put(root, "k" + std::to_string(i % 9), std::int64_t{i});
+            if (i % 50 == 0) tx.mark(text_id, 0, 1, "bold", ScalarValue{true});
+        });
+    }
+
+    for (auto level : {-1, 0}) {
+        auto options = SaveOptions{.compression_level = level};
+        auto parallel = doc.save(options);
+        auto sequential = Document::load(parallel);
+        ASSERT_TRUE(sequential.has_value());
+        ASSERT_EQ(sequential->get_thread_pool(), nullptr);
+        EXPECT_EQ(sequential->save(options), parallel) << "level " << level;
+        EXPECT_EQ(sequential->text(text_id), doc.text(text_id));
+    }
+}
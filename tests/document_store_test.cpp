@@ -0,0 +1,262 @@
+#include <automerge-cpp/document_store.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace automerge_cpp;
+
+namespace {
+
+// Records what the store hands over.
+class RecordingBackend final : public DocumentBackend {
+public:
+    void store(const std::string& id, std::vector<std::byte> bytes) override {
+        ++stores;
+        bytes_[id] = std::move(bytes);
+    }
+
+    void append(const std::string& id, std::span<const std::byte> bytes) override {
+        ++appends;
+        auto& stored = bytes_[id];
+        stored.insert(stored.end(), bytes.begin(), bytes.end());
+    }
+
+    auto fetch(const std::string& id) -> std::optional<std::vector<std::byte>> override {
+        auto it = bytes_.find(id);
+        if (it == bytes_.end()) return std::nullopt;
+        return it->second;
+    }
+
+    void remove(const std::string& id) override { bytes_.erase(id); }
+
+    auto has(const std::string& id) const -> bool { return bytes_.contains(id); }
+
+    int stores = 0;
+    int appends = 0;
+
+private:
+    std::map<std::string, std::vector<std::byte>> bytes_;
+};
+
+void put(Document& doc, const std::string& key, std::int64_t value) {
+    doc.transact([&](auto& tx) { tx.put(root, key, value); });
+}
+
+}  // namespace
+
+TEST(DocumentStore, create_and_open_resident_document) {
+    auto store = DocumentStore{};
+    auto doc = store.create("a");
+    put(*doc, "x", 1);
+    doc.reset();
+
+    auto again = store.open("a");
+    ASSERT_NE(again, nullptr);
+    EXPECT_EQ(again->get<std::int64_t>(root, "x"), 1);
+    EXPECT_EQ(store.open("missing"), nullptr);
+
+    auto metrics = store.metrics();
+    EXPECT_EQ(metrics.hits, 1u);
+    EXPECT_EQ(metrics.misses, 1u);
+    EXPECT_EQ(metrics.documents, 1u);
+    EXPECT_EQ(metrics.resident_documents, 1u);
+}
+
+TEST(DocumentStore, evicts_least_recently_used_beyond_max_resident) {
+    auto backend = std::make_shared<RecordingBackend>();
+    auto store = DocumentStore{{.max_resident = 2, .backend = backend}};
+    for (auto id : {"a", "b", "c"}) put(*store.create(id), "k", 1);
+
+    EXPECT_FALSE(store.is_resident("a"));
+    EXPECT_TRUE(store.is_resident("b"));
+    EXPECT_TRUE(store.is_resident("c"));
+    EXPECT_TRUE(backend->has("a"));
+
+    // Opening a brings it back and pushes out b, now the coldest
+    auto a = store.open("a");
+    ASSERT_NE(a, nullptr);
+    EXPECT_EQ(a->get<std::int64_t>(root, "k"), 1);
+    EXPECT_FALSE(store.is_resident("b"));
+
+    auto metrics = store.metrics();
+    EXPECT_EQ(metrics.evictions, 2u);
+    EXPECT_EQ(metrics.misses, 1u);
+    EXPECT_EQ(metrics.resident_documents, 2u);
+}
+
+TEST(DocumentStore, held_documents_are_not_evicted) {
+    auto store = DocumentStore{{.max_resident = 1}};
+    auto a = store.create("a");
+    auto b = store.create("b");
+    EXPECT_TRUE(store.is_resident("a"));
+    EXPECT_TRUE(store.is_resident("b"));
+    EXPECT_FALSE(store.evict("a"));
+
+    put(*a, "k", 7);
+    a.reset();
+    b.reset();
+    EXPECT_TRUE(store.evict("a"));
+    EXPECT_EQ(store.open("a")->get<std::int64_t>(root, "k"), 7);
+}
+
+TEST(DocumentStore, writes_back_only_what_changed) {
+    auto backend = std::make_shared<RecordingBackend>();
+    auto store = DocumentStore{{.backend = backend}};
+    auto doc = store.create("a");
+    for (std::int64_t i = 0; i < 50; ++i) put(*doc, "k" + std::to_string(i), i);
+    doc.reset();
+    ASSERT_TRUE(store.evict("a"));
+    EXPECT_EQ(backend->stores, 1);
+
+    // Unchanged: nothing written
+    store.open("a");
+    ASSERT_TRUE(store.evict("a"));
+    EXPECT_EQ(backend->stores, 1);
+    EXPECT_EQ(backend->appends, 0);
+
+    // A small edit appends its change
+    put(*store.open("a"), "extra", 99);
+    ASSERT_TRUE(store.evict("a"));
+    EXPECT_EQ(backend->stores, 1);
+    EXPECT_EQ(backend->appends, 1);
+
+    auto restored = store.open("a");
+    EXPECT_EQ(restored->get<std::int64_t>(root, "extra"), 99);
+    EXPECT_EQ(restored->get<std::int64_t>(root, "k49"), 49);
+    EXPECT_EQ(store.metrics().incremental_saves, 1u);
+}
+
+TEST(DocumentStore, memory_budget_limits_resident_bytes) {
+    auto store = DocumentStore{{
+        .max_resident = 0,
+        .memory_budget = 250,
+        .estimate_memory = [](const Document&) { return std::size_t{100}; },
+    }};
+    for (auto id : {"a", "b", "c", "d"}) store.create(id);
+    auto metrics = store.metrics();
+    EXPECT_EQ(metrics.resident_documents, 2u);
+    EXPECT_EQ(metrics.resident_bytes, 200u);
+    EXPECT_EQ(metrics.evictions, 2u);
+}
+
+TEST(DocumentStore, default_estimate_tracks_stats) {
+    auto store = DocumentStore{};
+    auto doc = store.create("a");
+    ObjId text;
+    doc->transact([&](auto& tx) { text = tx.put_object(root, "text", ObjType::text); });
+    for (std::size_t i = 0; i < 2'000; ++i) {
+        doc->transact([&](auto& tx) { tx.splice_text(text, i, 0, "x"); });
+        put(*doc, "k" + std::to_string(i % 50), static_cast<std::int64_t>(i));
+    }
+    auto again = store.open("a");  // re-estimates, without a walk
+
+    const auto estimated = static_cast<double>(store.metrics().resident_bytes);
+    const auto walked = static_cast<double>(doc->stats().memory.total());
+    EXPECT_GT(estimated, walked / 2);
+    EXPECT_LT(estimated, walked * 2);
+}
+
+TEST(DocumentStore, opens_documents_already_in_the_backend) {
+    auto backend = std::make_shared<RecordingBackend>();
+    auto doc = Document{};
+    put(doc, "k", 3);
+    backend->store("saved", doc.save());
+
+    auto store = DocumentStore{{.backend = backend}};
+    EXPECT_FALSE(store.contains("saved"));
+    auto opened = store.open("saved");
+    ASSERT_NE(opened, nullptr);
+    EXPECT_EQ(opened->get<std::int64_t>(root, "k"), 3);
+    EXPECT_TRUE(store.contains("saved"));
+
+    backend->store("bad", std::vector<std::byte>{std::byte{1}, std::byte{2}});
+    EXPECT_EQ(store.open("bad"), nullptr);
+    EXPECT_EQ(store.metrics().load_failures, 1u);
+}
+
+TEST(DocumentStore, erase_and_flush) {
+    auto backend = std::make_shared<RecordingBackend>();
+    auto store = DocumentStore{{.backend = backend}};
+    put(*store.create("a"), "k", 1);
+    store.flush();
+    EXPECT_TRUE(backend->has("a"));
+    EXPECT_TRUE(store.is_resident("a"));
+
+    EXPECT_TRUE(store.erase("a"));
+    EXPECT_FALSE(store.erase("a"));
+    EXPECT_FALSE(backend->has("a"));
+    EXPECT_EQ(store.open("a"), nullptr);
+}
+
+TEST(DocumentStore, documents_share_the_store_pool) {
+    auto pool = std::make_shared<thread_pool>(2);
+    auto store = DocumentStore{{.max_resident = 1, .pool = pool}};
+    put(*store.create("a"), "k", 1);
+    store.create("b");
+    EXPECT_EQ(store.open("a")->get_thread_pool(), pool);
+    EXPECT_EQ(store.get_thread_pool(), pool);
+}
+
+TEST(DocumentStore, inserted_documents_keep_their_pool_until_evicted) {
+    auto pool = std::make_shared<thread_pool>(2);
+    auto own = std::make_shared<thread_pool>(1);
+    auto store = DocumentStore{{.max_resident = 1, .pool = pool}};
+    auto doc = Document{own};
+    put(doc, "k", 1);
+    EXPECT_EQ(store.insert("a", std::move(doc))->get_thread_pool(), own);
+    EXPECT_EQ(store.open("a")->get_thread_pool(), own);
+
+    store.create("b");
+    ASSERT_FALSE(store.is_resident("a"));
+    auto again = store.open("a");
+    EXPECT_EQ(again->get_thread_pool(), pool);
+    EXPECT_EQ(again->get<std::int64_t>(root, "k"), 1);
+}
+
+TEST(DocumentStore, lazily_loaded_documents_count_as_decoded) {
+    auto backend = std::make_shared<RecordingBackend>();
+    auto doc = Document{};
+    for (std::int64_t i = 0; i < 1'000; ++i) put(doc, "k", i);
+    backend->store("a", doc.save());  // deflated to a few hundred bytes
+
+    auto store = DocumentStore{{.backend = backend}};
+    auto opened = store.open("a");
+    ASSERT_FALSE(opened->is_materialized());
+    const auto lazy = store.metrics().resident_bytes;
+
+    // Once decoded, the next open() counts it again
+    EXPECT_EQ(opened->get<std::int64_t>(root, "k"), 999);
+    store.open("a");
+    const auto decoded = store.metrics().resident_bytes;
+    const auto walked = opened->stats().memory.total();
+    for (auto estimated : {lazy, decoded}) {
+        EXPECT_GT(estimated, walked / 2);
+        EXPECT_LT(estimated, walked * 2);
+    }
+}
+
+TEST(DocumentStore, lazily_loaded_documents_count_every_op) {
+    auto backend = std::make_shared<RecordingBackend>();
+    auto doc = Document{};
+    for (std::int64_t i = 0; i < 20; ++i) {
+        doc.transact([&](auto& tx) {
+            for (std::int64_t k = 0; k < 100; ++k) tx.put(root, "k" + std::to_string(k), i);
+        });
+    }
+    backend->store("a", doc.save());
+
+    auto store = DocumentStore{{.backend = backend}};
+    auto opened = store.open("a");
+    ASSERT_FALSE(opened->is_materialized());
+    const auto lazy = store.metrics().resident_bytes;
+    EXPECT_EQ(opened->get<std::int64_t>(root, "k0"), 19);
+    store.open("a");
+    const auto decoded = store.metrics().resident_bytes;
+    EXPECT_GT(lazy, decoded / 2);
+    EXPECT_LT(lazy, decoded * 2);
+}
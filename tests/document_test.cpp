@@ -7,10 +7,15 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cstddef>
+#include <iterator>
 #include <map>
+#include <memory_resource>
+#include <optional>
 #include <set>
 #include <string>
 #include <thread>
+#include <tuple>
 #include <vector>
 
 using namespace automerge_cpp;
@@ -449,6 +454,122 @@ TEST(Document, copy_creates_independent_document) {
     EXPECT_EQ(std::get<std::int64_t>(std::get<ScalarValue>(*doc2.get(root, "x"))), 2);
 }
 
+// -- Memory resources ---------------------------------------------------------
+
+namespace {
+
+// Counts bytes outstanding, forwarding to the default resource.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    std::size_t outstanding = 0;
+    std::size_t allocations = 0;
+
+private:
+    auto do_allocate(std::size_t bytes, std::size_t align) -> void* override {
+        outstanding += bytes;
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+        outstanding -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+    auto do_is_equal(const memory_resource& other) const noexcept -> bool override {
+        return this == &other;
+    }
+};
+
+void fill(Document& doc) {
+    doc.transact([](auto& tx) {
+        tx.put(root, "title", std::string{"resource"});
+        auto list = tx.put_object(root, "list", ObjType::list);
+        for (int i = 0; i < 200; ++i) tx.insert(list, static_cast<std::size_t>(i), std::int64_t{i});
+        auto text = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(text, 0, 0, "hello world");
+        auto nested = tx.put_object(root, "nested", ObjType::map);
+        for (int i = 0; i < 50; ++i) tx.put(nested, "k" + std::to_string(i), std::int64_t{i});
+    });
+}
+
+}  // namespace
+
+TEST(Document, state_allocates_from_its_memory_resource) {
+    auto resource = CountingResource{};
+    {
+        auto doc = Document{resource};
+        EXPECT_EQ(doc.memory_resource(), &resource);
+        fill(doc);
+        EXPECT_GT(resource.allocations, 0u);
+        EXPECT_GT(resource.outstanding, 0u);
+
+        auto copy = doc;
+        auto forked = doc.fork();
+        EXPECT_EQ(forked.memory_resource(), &resource);
+        forked.transact([](auto& tx) { tx.put(root, "title", std::string{"fork"}); });
+        EXPECT_EQ(get_scalar<std::string>(copy.get(root, "title")), "resource");
+        EXPECT_EQ(get_scalar<std::string>(forked.get(root, "title")), "fork");
+
+        auto loaded = Document::load(doc.save(), resource);
+        ASSERT_TRUE(loaded.has_value());
+        EXPECT_EQ(loaded->memory_resource(), &resource);
+        EXPECT_EQ(loaded->text(*loaded->get_obj_id(root, "text")), "hello world");
+        EXPECT_EQ(loaded->length(*loaded->get_obj_id(root, "list")), 200u);
+    }
+    EXPECT_EQ(resource.outstanding, 0u);
+}
+
+TEST(Document, snapshot_reads_do_not_outlive_a_resource_document) {
+    auto resource = CountingResource{};
+    auto read = std::atomic<bool>{false};
+    auto destroyed = std::atomic<bool>{false};
+    auto reader = std::thread{};
+    {
+        auto doc = Document{resource};
+        doc.set_snapshot_reads(true);
+        fill(doc);
+        EXPECT_EQ(get_scalar<std::string>(doc.get(root, "title")), "resource");
+        reader = std::thread{[&] {
+            EXPECT_EQ(doc.length(root), 4u);
+            read.store(true);
+            while (!destroyed.load()) std::this_thread::yield();
+        }};
+        while (!read.load()) std::this_thread::yield();
+    }
+    // Neither this thread nor the still running reader holds a snapshot
+    EXPECT_EQ(resource.outstanding, 0u);
+    destroyed.store(true);
+    reader.join();
+}
+
+TEST(Document, fork_onto_another_resource_copies_objects) {
+    auto first = CountingResource{};
+    auto second = CountingResource{};
+    auto forked = std::optional<Document>{};
+    {
+        auto doc = Document{first};
+        fill(doc);
+        forked = doc.fork(second);
+    }
+    // Nothing of the fork is left on the first resource
+    EXPECT_EQ(first.outstanding, 0u);
+    EXPECT_GT(second.outstanding, 0u);
+    EXPECT_EQ(forked->text(*forked->get_obj_id(root, "text")), "hello world");
+    EXPECT_EQ(forked->length(*forked->get_obj_id(root, "nested")), 50u);
+    forked->transact([](auto& tx) { tx.put(root, "more", true); });
+    EXPECT_EQ(forked->length(root), 5u);
+}
+
+TEST(Document, document_in_a_monotonic_arena) {
+    auto arena = std::pmr::monotonic_buffer_resource{};
+    auto doc = Document{arena};
+    fill(doc);
+    auto merged = Document{arena};
+    merged.merge(doc);
+    EXPECT_EQ(merged.values(root).size(), 4u);
+    EXPECT_EQ(get_scalar<std::int64_t>(merged.get(*merged.get_obj_id(root, "list"), std::size_t{199})),
+              199);
+}
+
 // -- Multiple transactions ----------------------------------------------------
 
 TEST(Document, multiple_transactions_accumulate) {
@@ -766,6 +887,64 @@ TEST(Document, merge_is_idempotent) {
     EXPECT_EQ(doc1.get(root, "y"), y_first);
 }
 
+TEST(Document, merge_only_applies_changes_missing_from_heads) {
+    auto doc1 = make_doc(1);
+    for (int i = 0; i < 50; ++i) {
+        doc1.transact([i](auto& tx) { tx.put(root, "k", std::int64_t{i}); });
+    }
+    auto doc2 = doc1.fork();
+    doc2.transact([](auto& tx) { tx.put(root, "a", std::int64_t{1}); });
+    doc2.transact([](auto& tx) { tx.put(root, "b", std::int64_t{2}); });
+    doc1.transact([](auto& tx) { tx.put(root, "c", std::int64_t{3}); });
+
+    doc1.merge(doc2);
+    EXPECT_EQ(doc1.get_changes().size(), 53u);
+    EXPECT_EQ(doc1.get_heads().size(), 2u);
+    EXPECT_EQ(doc1.get(root, "b"), Value{ScalarValue{std::int64_t{2}}});
+
+    // Merging into the superset adopts its heads
+    doc2.merge(doc1);
+    auto heads1 = doc1.get_heads();
+    auto heads2 = doc2.get_heads();
+    std::ranges::sort(heads1);
+    std::ranges::sort(heads2);
+    EXPECT_EQ(heads1, heads2);
+    EXPECT_EQ(doc2.get_changes().size(), 53u);
+}
+
+TEST(Document, merge_all_matches_pairwise_merges) {
+    auto base = make_doc(1);
+    base.transact([](auto& tx) { tx.put(root, "base", std::int64_t{0}); });
+
+    // Overlapping inputs: c is a fork of b, so b's change reaches us twice
+    auto peers = std::vector<Document>{};
+    peers.push_back(base.fork());
+    peers.push_back(base.fork());
+    peers[0].transact([](auto& tx) { tx.put(root, "a", std::int64_t{1}); });
+    peers[1].transact([](auto& tx) { tx.put(root, "b", std::int64_t{2}); });
+    peers.push_back(peers[1].fork());
+    peers[2].transact([](auto& tx) { tx.put(root, "c", std::int64_t{3}); });
+    base.transact([](auto& tx) { tx.put(root, "local", std::int64_t{4}); });
+
+    auto pairwise = base;
+    for (const auto& peer : peers) pairwise.merge(peer);
+
+    auto all = base;
+    all.merge_all(peers);
+    EXPECT_EQ(all.get_changes().size(), 5u);
+    auto heads = all.get_heads();
+    auto expected_heads = pairwise.get_heads();
+    std::ranges::sort(heads);
+    std::ranges::sort(expected_heads);
+    EXPECT_EQ(heads, expected_heads);
+    EXPECT_EQ(all.values(root), pairwise.values(root));
+
+    // Null, repeated and self inputs are skipped; merging again is a no-op
+    const Document* inputs[] = {&peers[2], nullptr, &all, &peers[2]};
+    all.merge_all(inputs);
+    EXPECT_EQ(all.get_changes().size(), 5u);
+}
+
 TEST(Document, merge_has_identity) {
     auto doc = make_doc(1);
     doc.transact([](auto& tx) {
@@ -833,6 +1012,71 @@ TEST(Document, get_changes_returns_history) {
     EXPECT_EQ(changes[0].actor, doc.actor_id());
 }
 
+TEST(Document, get_changes_since_returns_only_new_changes) {
+    auto doc = make_doc(1);
+    for (auto i = 0; i < 5; ++i) {
+        doc.transact([&](auto& tx) { tx.put(root, "x", std::int64_t{i}); });
+    }
+    auto seen = doc.get_heads();
+    doc.transact([](auto& tx) { tx.put(root, "y", std::int64_t{1}); });
+    doc.transact([](auto& tx) { tx.put(root, "y", std::int64_t{2}); });
+
+    auto all = doc.get_changes();
+    auto since = doc.get_changes_since(seen);
+    ASSERT_EQ(since.size(), 2u);
+    EXPECT_EQ(since[0], all[5]);
+    EXPECT_EQ(since[1], all[6]);
+    EXPECT_TRUE(doc.get_changes_since(doc.get_heads()).empty());
+    EXPECT_EQ(doc.get_changes_since({}), all);
+}
+
+TEST(Document, get_changes_since_handles_concurrent_branches) {
+    auto doc1 = make_doc(1);
+    doc1.transact([](auto& tx) { tx.put(root, "base", std::int64_t{0}); });
+    auto doc2 = doc1.fork();
+    doc1.transact([](auto& tx) { tx.put(root, "a", std::int64_t{1}); });
+    doc1.transact([](auto& tx) { tx.put(root, "a", std::int64_t{2}); });
+    doc2.transact([](auto& tx) { tx.put(root, "b", std::int64_t{1}); });
+    auto their_heads = doc2.get_heads();
+    doc1.merge(doc2);
+
+    // Only doc1's own branch is new to doc2, whichever order history is in
+    auto since = doc1.get_changes_since(their_heads);
+    ASSERT_EQ(since.size(), 2u);
+    for (const auto& change : since) EXPECT_EQ(change.actor, doc1.actor_id());
+
+    auto unknown = ChangeHash{};
+    unknown.bytes.fill(std::byte{0xAB});
+    EXPECT_EQ(doc1.get_changes_since({unknown}), doc1.get_changes());
+    EXPECT_EQ(doc1.get_changes_since({unknown, their_heads[0]}), since);
+}
+
+TEST(Document, for_each_change_since_visits_in_history_order) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    auto seen = doc.get_heads();
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{2}); });
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{3}); });
+
+    auto seqs = std::vector<std::uint64_t>{};
+    doc.for_each_change_since(seen, [&](const Change& change) {
+        seqs.push_back(change.seq);
+        EXPECT_EQ(get_int_val(doc.get(root, "x")), 3);  // lock already released
+    });
+    EXPECT_EQ(seqs, (std::vector<std::uint64_t>{2, 3}));
+}
+
+TEST(Document, get_change_by_hash_finds_one_change) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{2}); });
+
+    auto change = doc.get_change_by_hash(doc.get_heads()[0]);
+    ASSERT_TRUE(change.has_value());
+    EXPECT_EQ(*change, doc.get_changes()[1]);
+    EXPECT_FALSE(doc.get_change_by_hash(ChangeHash{}).has_value());
+}
+
 TEST(Document, apply_changes_from_another_doc) {
     auto doc1 = make_doc(1);
     doc1.transact([](auto& tx) {
@@ -847,6 +1091,106 @@ TEST(Document, apply_changes_from_another_doc) {
     EXPECT_EQ(get_int_val(val), 42);
 }
 
+TEST(Document, apply_changes_holds_changes_until_deps_arrive) {
+    auto doc1 = make_doc(1);
+    doc1.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    doc1.transact([](auto& tx) { tx.put(root, "x", std::int64_t{2}); });
+    doc1.transact([](auto& tx) { tx.put(root, "y", std::int64_t{3}); });
+    auto changes = doc1.get_changes();
+
+    auto doc2 = make_doc(2);
+    doc2.apply_changes({changes[2]});
+    doc2.apply_changes({changes[1]});
+    EXPECT_EQ(doc2.pending_change_count(), 2u);
+    EXPECT_TRUE(doc2.get_changes().empty());
+    EXPECT_FALSE(doc2.get(root, "y").has_value());
+
+    doc2.apply_changes({changes[0]});
+    EXPECT_EQ(doc2.pending_change_count(), 0u);
+    EXPECT_EQ(doc2.get_changes(), changes);
+    EXPECT_EQ(doc2.get_heads(), doc1.get_heads());
+    EXPECT_EQ(get_int_val(doc2.get(root, "x")), 2);
+    EXPECT_EQ(get_int_val(doc2.get(root, "y")), 3);
+}
+
+TEST(Document, apply_changes_orders_a_shuffled_batch) {
+    auto doc1 = make_doc(1);
+    doc1.transact([](auto& tx) { tx.put(root, "base", std::int64_t{0}); });
+    auto doc2 = doc1.fork();
+    doc1.transact([](auto& tx) { tx.put(root, "a", std::int64_t{1}); });
+    doc2.transact([](auto& tx) { tx.put(root, "b", std::int64_t{2}); });
+    doc1.merge(doc2);
+    doc1.transact([](auto& tx) { tx.put(root, "c", std::int64_t{3}); });
+
+    auto changes = doc1.get_changes();
+    std::ranges::reverse(changes);
+    changes.push_back(changes.front());  // a repeat is dropped, not held
+
+    auto doc3 = make_doc(3);
+    doc3.apply_changes(changes);
+    EXPECT_EQ(doc3.pending_change_count(), 0u);
+    EXPECT_EQ(doc3.get_changes().size(), 4u);
+    EXPECT_EQ(doc3.get_heads(), doc1.get_heads());
+    EXPECT_EQ(get_int_val(doc3.get(root, "c")), 3);
+    EXPECT_EQ(get_int_val(doc3.get(root, "b")), 2);
+}
+
+TEST(Document, merge_drops_held_changes_it_applies) {
+    auto doc1 = make_doc(1);
+    doc1.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    doc1.transact([](auto& tx) { tx.put(root, "x", std::int64_t{2}); });
+    auto changes = doc1.get_changes();
+
+    auto doc2 = make_doc(2);
+    doc2.apply_changes({changes[1]});
+    EXPECT_EQ(doc2.pending_change_count(), 1u);
+    doc2.merge(doc1);
+    EXPECT_EQ(doc2.pending_change_count(), 0u);
+
+    doc2.apply_changes({changes[0]});
+    EXPECT_EQ(doc2.get_changes(), changes);
+    EXPECT_EQ(doc2.get_heads(), doc1.get_heads());
+}
+
+TEST(Document, merge_and_load_incremental_release_held_changes) {
+    auto doc1 = make_doc(1);
+    doc1.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    auto before = doc1.fork();
+    auto saved = doc1.save();
+    doc1.transact([](auto& tx) { tx.put(root, "y", std::int64_t{2}); });
+    auto last = doc1.get_changes().back();
+
+    auto merged = make_doc(2);
+    merged.apply_changes({last});
+    merged.merge(before);
+    EXPECT_EQ(merged.pending_change_count(), 0u);
+    EXPECT_EQ(merged.get_heads(), doc1.get_heads());
+    EXPECT_EQ(get_int_val(merged.get(root, "y")), 2);
+
+    auto loaded = make_doc(3);
+    loaded.apply_changes({last});
+    EXPECT_EQ(loaded.load_incremental(saved), 2u);
+    EXPECT_EQ(loaded.pending_change_count(), 0u);
+    EXPECT_EQ(loaded.get_changes(), doc1.get_changes());
+    EXPECT_EQ(loaded.get_heads(), doc1.get_heads());
+}
+
+TEST(Document, sync_asks_for_the_deps_of_held_changes) {
+    auto doc1 = make_doc(1);
+    doc1.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    auto first = doc1.get_heads();
+    doc1.transact([](auto& tx) { tx.put(root, "x", std::int64_t{2}); });
+
+    auto doc2 = make_doc(2);
+    doc2.apply_changes({doc1.get_changes().back()});
+    auto state = SyncState{};
+    doc2.receive_sync_message(state, SyncMessage{.heads = doc1.get_heads(), .need = {},
+                                                 .have = {}, .changes = {}});
+    auto message = doc2.generate_sync_message(state);
+    ASSERT_TRUE(message.has_value());
+    EXPECT_EQ(message->need, first);  // not the held head itself
+}
+
 TEST(Document, merge_nested_objects) {
     auto doc1 = make_doc(1);
     auto nested_id = ObjId{};
@@ -880,6 +1224,225 @@ TEST(Document, merge_nested_objects) {
     EXPECT_FALSE(std::get<bool>(std::get<ScalarValue>(*verbose_val)));
 }
 
+TEST(Document, merge_large_concurrent_pastes_do_not_interleave) {
+    auto doc1 = make_doc(1);
+    auto text_id = ObjId{};
+    doc1.transact([&](auto& tx) {
+        text_id = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(text_id, 0, 0, "[]");
+    });
+    auto doc2 = doc1.fork();
+
+    const auto paste1 = std::string(3000, 'a');
+    const auto paste2 = std::string(3000, 'b');
+    doc1.transact([&](auto& tx) { tx.splice_text(text_id, 1, 0, paste1); });
+    doc2.transact([&](auto& tx) { tx.splice_text(text_id, 1, 0, paste2); });
+
+    auto merged1 = doc1.fork();
+    merged1.merge(doc2);
+    auto merged2 = doc2.fork();
+    merged2.merge(doc1);
+
+    auto result = merged1.text(text_id);
+    EXPECT_EQ(result, merged2.text(text_id));
+    EXPECT_EQ(result.size(), 6002u);
+    // RGA keeps each concurrent run contiguous
+    EXPECT_TRUE(result == "[" + paste1 + paste2 + "]" ||
+                result == "[" + paste2 + paste1 + "]");
+}
+
+TEST(Document, splice_text_emits_one_op_per_insert) {
+    auto doc = make_doc(1);
+    auto text_id = ObjId{};
+    doc.transact([&](auto& tx) {
+        text_id = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(text_id, 0, 0, "Hello World");
+    });
+
+    auto changes = doc.get_changes();
+    ASSERT_EQ(changes.size(), 1u);
+    ASSERT_EQ(changes[0].operations.size(), 2u);  // make_object + one splice
+    const auto& splice = changes[0].operations[1];
+    EXPECT_EQ(splice.action, OpType::splice_text);
+    EXPECT_EQ(splice.width(), 11u);
+
+    // The next op's counter follows the splice's range
+    doc.transact([&](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    auto next = doc.get_changes()[1];
+    EXPECT_EQ(next.start_op, splice.id.counter + 11);
+}
+
+TEST(Document, batched_splice_round_trips_save_and_merge) {
+    auto doc1 = make_doc(1);
+    auto text_id = ObjId{};
+    doc1.transact([&](auto& tx) {
+        text_id = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(text_id, 0, 0, "Hello World");
+    });
+    auto doc2 = doc1.fork();
+    doc1.transact([&](auto& tx) { tx.splice_text(text_id, 5, 0, ", dear"); });
+    doc2.transact([&](auto& tx) { tx.splice_text(text_id, 6, 5, "C++"); });
+
+    doc1.merge(doc2);
+    doc2.merge(doc1);
+    EXPECT_EQ(doc1.text(text_id), "Hello, dear C++");
+    EXPECT_EQ(doc2.text(text_id), doc1.text(text_id));
+
+    auto loaded = Document::load(doc1.save());
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->text(text_id), "Hello, dear C++");
+
+    // Elements inside a batched splice stay individually addressable
+    auto cursor = doc1.cursor(text_id, 8);
+    ASSERT_TRUE(cursor.has_value());
+    doc1.transact([&](auto& tx) { tx.splice_text(text_id, 0, 0, ">> "); });
+    EXPECT_EQ(doc1.resolve_cursor(text_id, *cursor), std::optional<std::size_t>{11});
+}
+
+TEST(Document, compact_drops_stable_tombstones) {
+    auto doc = make_doc(1);
+    auto text_id = ObjId{};
+    doc.transact([&](auto& tx) {
+        text_id = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(text_id, 0, 0, "Hello cruel World");
+    });
+    doc.transact([&](auto& tx) { tx.splice_text(text_id, 5, 6, ""); });
+    auto stable = doc.get_heads();
+
+    auto reference = doc.fork();
+    EXPECT_GT(doc.compact(stable), 0u);
+    EXPECT_EQ(doc.text(text_id), "Hello World");
+    EXPECT_EQ(doc.length(text_id), 11u);
+
+    // Later concurrent edits converge with an uncompacted replica
+    auto peer = doc.fork();
+    doc.transact([&](auto& tx) { tx.splice_text(text_id, 5, 0, "!!"); });
+    peer.transact([&](auto& tx) { tx.splice_text(text_id, 5, 0, "??"); });
+    reference.merge(doc);
+    reference.merge(peer);
+    doc.merge(peer);
+    EXPECT_EQ(doc.text(text_id), reference.text(text_id));
+
+    // History is untouched: save/load and historical reads still see it all
+    auto loaded = Document::load(doc.save());
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->text(text_id), doc.text(text_id));
+    EXPECT_EQ(doc.text_at(text_id, stable), "Hello World");
+}
+
+TEST(Document, compact_keeps_tombstones_with_unstable_inserts) {
+    auto doc1 = make_doc(1);
+    auto list_id = ObjId{};
+    doc1.transact([&](auto& tx) {
+        list_id = tx.put_object(root, "list", ObjType::list);
+        tx.insert(list_id, 0, std::string{"a"});
+        tx.insert(list_id, 1, std::string{"b"});
+        tx.insert(list_id, 2, std::string{"c"});
+    });
+    auto doc2 = doc1.fork();
+    doc1.transact([&](auto& tx) { tx.delete_index(list_id, 1); });
+    auto stable = doc1.get_heads();
+    // Concurrent with the delete: inserted after "b"
+    doc2.transact([&](auto& tx) { tx.insert(list_id, 2, std::string{"x"}); });
+    doc1.merge(doc2);
+
+    auto reference = doc1.fork();
+    doc1.compact(stable);
+    EXPECT_EQ(doc1.values(list_id), reference.values(list_id));
+
+    // A later concurrent insert next to the pinned tombstone still lands identically
+    auto doc3 = doc2.fork();
+    doc3.transact([&](auto& tx) { tx.insert(list_id, 2, std::string{"y"}); });
+    doc1.merge(doc3);
+    reference.merge(doc3);
+    EXPECT_EQ(doc1.values(list_id), reference.values(list_id));
+}
+
+TEST(Document, compact_without_stable_deletes_is_a_noop) {
+    auto doc = make_doc(1);
+    auto text_id = ObjId{};
+    doc.transact([&](auto& tx) {
+        text_id = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(text_id, 0, 0, "abc");
+    });
+    auto before_delete = doc.get_heads();
+    doc.transact([&](auto& tx) { tx.splice_text(text_id, 0, 1, ""); });
+
+    EXPECT_EQ(doc.compact(before_delete), 0u);
+    EXPECT_EQ(doc.compact({}), 0u);
+    EXPECT_EQ(doc.text(text_id), "bc");
+}
+
+TEST(Document, stats_counts_objects_by_type) {
+    auto doc1 = make_doc(1);
+    auto list_id = ObjId{};
+    auto text_id = ObjId{};
+    doc1.transact([&](auto& tx) {
+        tx.put(root, "title", std::string{"stats"});
+        list_id = tx.put_object(root, "list", ObjType::list);
+        tx.insert(list_id, 0, std::int64_t{1});
+        tx.insert(list_id, 1, std::int64_t{2});
+        tx.insert(list_id, 2, std::int64_t{3});
+        text_id = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(text_id, 0, 0, "Hello");
+        tx.mark(text_id, 0, 5, "bold", true);
+    });
+    auto doc2 = doc1.fork();
+    doc1.transact([&](auto& tx) {
+        tx.put(root, "title", std::string{"one"});
+        tx.delete_index(list_id, 1);
+    });
+    doc2.transact([&](auto& tx) { tx.put(root, "title", std::string{"two"}); });
+    doc1.merge(doc2);
+
+    auto stats = doc1.stats();
+    EXPECT_TRUE(stats.decoded);
+    EXPECT_EQ(stats.maps.objects, 1u);
+    EXPECT_EQ(stats.maps.map_entries, 3u);
+    EXPECT_EQ(stats.maps.conflicts, 1u);
+    EXPECT_EQ(stats.lists.objects, 1u);
+    EXPECT_EQ(stats.lists.list_elements, 2u);
+    EXPECT_EQ(stats.lists.tombstones, 1u);
+    EXPECT_EQ(stats.texts.list_elements, 5u);
+    EXPECT_EQ(stats.texts.marks, 1u);
+    EXPECT_EQ(stats.tables.objects, 0u);
+    EXPECT_EQ(stats.objects().objects, 3u);
+    EXPECT_EQ(stats.changes, 3u);
+    EXPECT_EQ(stats.actors, 2u);
+    EXPECT_EQ(stats.heads, 2u);
+    EXPECT_GT(stats.ops, 0u);
+    EXPECT_GT(stats.memory.objects, 0u);
+    EXPECT_GT(stats.memory.change_history, 0u);
+    EXPECT_GE(stats.memory.total(), stats.memory.objects + stats.memory.change_history);
+
+    auto list_stats = doc1.object_stats(list_id);
+    ASSERT_TRUE(list_stats.has_value());
+    EXPECT_EQ(list_stats->list_elements, 2u);
+    EXPECT_EQ(list_stats->tombstones, 1u);
+    EXPECT_FALSE(doc1.object_stats(ObjId{OpId{99, doc1.actor_id()}}).has_value());
+
+    // Compaction shows up in the stats
+    doc1.compact(doc1.get_heads());
+    EXPECT_EQ(doc1.stats().lists.tombstones, 0u);
+}
+
+TEST(Document, stats_of_lazily_loaded_document_is_its_bytes) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    auto bytes = doc.save();
+
+    auto lazy = Document::load_lazy(bytes);
+    ASSERT_TRUE(lazy.has_value());
+    auto stats = lazy->stats();
+    EXPECT_FALSE(stats.decoded);
+    EXPECT_EQ(stats.memory.pending_load, bytes.size());
+    EXPECT_EQ(stats.heads, 1u);
+
+    EXPECT_TRUE(lazy->get(root, "x").has_value());  // decodes
+    EXPECT_TRUE(lazy->stats().decoded);
+    EXPECT_EQ(lazy->stats().changes, 1u);
+}
+
 TEST(Document, get_heads_tracks_dag) {
     auto doc = make_doc(1);
     EXPECT_TRUE(doc.get_heads().empty());
@@ -1244,6 +1807,32 @@ TEST(Document, save_and_load_can_merge_after_load) {
     EXPECT_EQ(get_int_val(loaded->get(root, "y")), 2);
 }
 
+TEST(Document, save_to_streams_the_saved_bytes) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) {
+        auto list = tx.put_object(root, "items", ObjType::list);
+        for (std::size_t i = 0; i < 300; ++i) tx.insert(list, i, std::string(i % 7, 'x'));
+    });
+
+    for (auto level : {-1, 0}) {
+        auto options = SaveOptions{.compression_level = level};
+        auto streamed = std::vector<std::byte>{};
+        auto written = doc.save_to([&](std::span<const std::byte> bytes) {
+            streamed.insert(streamed.end(), bytes.begin(), bytes.end());
+        }, options);
+        EXPECT_EQ(written, streamed.size());
+        EXPECT_EQ(streamed, doc.save(options));
+    }
+
+    auto streamed = std::vector<std::byte>{};
+    doc.save_to([&](std::span<const std::byte> bytes) {
+        streamed.insert(streamed.end(), bytes.begin(), bytes.end());
+    });
+    auto loaded = Document::load(streamed);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->length(*loaded->get_obj_id(root, "items")), 300u);
+}
+
 TEST(Document, save_and_load_deeply_nested) {
     auto doc = make_doc(1);
     auto level1 = ObjId{};
@@ -1287,6 +1876,242 @@ TEST(Document, save_and_load_negative_int) {
     EXPECT_EQ(get_int_val(loaded->get(root, "neg")), -999);
 }
 
+// -- Incremental save ---------------------------------------------------------
+
+TEST(Document, save_incremental_emits_only_new_changes) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    auto first = doc.save_incremental();
+    EXPECT_FALSE(first.empty());
+    EXPECT_TRUE(doc.save_incremental().empty());
+
+    doc.transact([](auto& tx) { tx.put(root, "y", std::int64_t{2}); });
+    auto second = doc.save_incremental();
+    EXPECT_FALSE(second.empty());
+    EXPECT_LT(second.size(), doc.save().size());
+}
+
+TEST(Document, load_reads_appended_change_chunks) {
+    auto doc = make_doc(1);
+    auto list = doc.transact([](auto& tx) { return tx.put_object(root, "items", ObjType::list); });
+    auto bytes = doc.save();
+    for (int i = 0; i < 5; ++i) {
+        doc.transact([&](auto& tx) { tx.insert(list, static_cast<std::size_t>(i), std::int64_t{i}); });
+        auto delta = doc.save_incremental();
+        bytes.insert(bytes.end(), delta.begin(), delta.end());
+    }
+
+    auto loaded = Document::load(bytes);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->length(list), 5u);
+    EXPECT_EQ(get_int_val(loaded->get(list, std::size_t{4})), 4);
+    EXPECT_EQ(loaded->get_heads(), doc.get_heads());
+    EXPECT_EQ(loaded->get_changes().size(), doc.get_changes().size());
+    EXPECT_TRUE(loaded->save_incremental().empty());
+
+    auto lazy = Document::load_lazy(bytes);
+    ASSERT_TRUE(lazy.has_value());
+    EXPECT_EQ(lazy->length(list), 5u);
+    EXPECT_EQ(lazy->get_heads(), doc.get_heads());
+}
+
+TEST(Document, load_after_incremental_save_continues_editing) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    auto bytes = doc.save();
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{2}); });
+    auto delta = doc.save_incremental();
+    bytes.insert(bytes.end(), delta.begin(), delta.end());
+
+    auto loaded = Document::load(bytes);
+    ASSERT_TRUE(loaded.has_value());
+    loaded->transact([](auto& tx) { tx.put(root, "x", std::int64_t{3}); });
+    auto last = loaded->get_changes().back();
+    EXPECT_EQ(last.seq, 3u);
+    EXPECT_EQ(last.start_op, 3u);
+    EXPECT_EQ(last.deps, doc.get_heads());
+}
+
+TEST(Document, load_incremental_applies_new_changes_once) {
+    auto doc1 = make_doc(1);
+    doc1.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    auto doc2 = doc1.fork();
+    doc1.transact([](auto& tx) { tx.put(root, "y", std::int64_t{2}); });
+    auto delta = doc1.save_since(doc2.get_heads());
+
+    EXPECT_EQ(doc2.load_incremental(delta), 1u);
+    EXPECT_EQ(doc2.load_incremental(delta), 0u);
+    EXPECT_EQ(get_int_val(doc2.get(root, "y")), 2);
+    EXPECT_EQ(doc2.get_heads(), doc1.get_heads());
+
+    auto fresh = Document{};
+    EXPECT_EQ(fresh.load_incremental(doc1.save()), 2u);
+    EXPECT_EQ(fresh.get_heads(), doc1.get_heads());
+}
+
+TEST(Document, save_since_empty_heads_covers_all_changes) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{2}); });
+    EXPECT_TRUE(doc.save_since(doc.get_heads()).empty());
+
+    auto fresh = Document{};
+    EXPECT_EQ(fresh.load_incremental(doc.save_since({})), 2u);
+    EXPECT_EQ(fresh.get_changes(), doc.get_changes());
+}
+
+TEST(Document, load_incremental_rejects_corrupt_chunk) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    doc.transact([](auto& tx) { tx.put(root, "y", std::int64_t{2}); });
+    auto delta = doc.save_since({});
+    delta[delta.size() - 2] ^= std::byte{0xFF};
+
+    auto target = Document{};
+    EXPECT_FALSE(target.load_incremental(delta).has_value());
+    EXPECT_TRUE(target.get_changes().empty());
+
+    auto bytes = doc.save();
+    bytes.insert(bytes.end(), delta.begin(), delta.end());
+    EXPECT_FALSE(Document::load(bytes).has_value());
+}
+
+// -- Lazy load ----------------------------------------------------------------
+
+TEST(Document, load_lazy_defers_decode_until_read) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) {
+        tx.put(root, "title", std::string{"draft"});
+        tx.put(root, "n", std::int64_t{7});
+    });
+    auto bytes = doc.save();
+
+    auto lazy = Document::load_lazy(bytes);
+    ASSERT_TRUE(lazy.has_value());
+    EXPECT_FALSE(lazy->is_materialized());
+    EXPECT_EQ(lazy->get_heads(), doc.get_heads());
+    EXPECT_EQ(lazy->actor_id(), doc.actor_id());
+    EXPECT_EQ(lazy->save(), bytes);
+    EXPECT_FALSE(lazy->is_materialized());
+
+    EXPECT_EQ(get_int_val(lazy->get(root, "n")), 7);
+    EXPECT_TRUE(lazy->is_materialized());
+    EXPECT_EQ(lazy->get_changes(), doc.get_changes());
+}
+
+TEST(Document, load_lazy_save_to_passes_loaded_bytes) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    auto bytes = doc.save();
+
+    auto lazy = Document::load_lazy(bytes);
+    ASSERT_TRUE(lazy.has_value());
+    auto streamed = std::vector<std::byte>{};
+    auto written = lazy->save_to([&](std::span<const std::byte> chunk) {
+        streamed.insert(streamed.end(), chunk.begin(), chunk.end());
+    });
+    EXPECT_EQ(written, bytes.size());
+    EXPECT_EQ(streamed, bytes);
+    EXPECT_FALSE(lazy->is_materialized());
+}
+
+TEST(Document, load_options_can_skip_checksum_verification) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    auto bytes = doc.save();
+    doc.transact([](auto& tx) { tx.put(root, "y", std::int64_t{2}); });
+    auto delta = doc.save_incremental();
+
+    // Bytes 4..7 of a chunk are its checksum
+    auto bad_checksum = bytes;
+    bad_checksum[4] ^= std::byte{0xFF};
+    auto trusted = LoadOptions{.verify_checksum = false};
+    EXPECT_FALSE(Document::load(bad_checksum).has_value());
+    EXPECT_FALSE(Document::load_lazy(bad_checksum).has_value());
+
+    auto loaded = Document::load(bad_checksum, trusted);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(get_int_val(loaded->get(root, "x")), 1);
+    EXPECT_EQ(loaded->get_heads(), Document::load(bytes)->get_heads());
+    auto lazy = Document::load_lazy(bad_checksum, nullptr, trusted);
+    ASSERT_TRUE(lazy.has_value());
+    EXPECT_EQ(get_int_val(lazy->get(root, "x")), 1);
+
+    auto bad_delta = delta;
+    bad_delta[4] ^= std::byte{0xFF};
+    EXPECT_FALSE(loaded->load_incremental(bad_delta).has_value());
+    EXPECT_EQ(loaded->load_incremental(bad_delta, trusted), std::optional<std::size_t>{1});
+    EXPECT_EQ(get_int_val(loaded->get(root, "y")), 2);
+
+    // Structural checks still apply
+    auto truncated = std::vector<std::byte>(bad_checksum.begin(), bad_checksum.end() - 3);
+    EXPECT_FALSE(Document::load(truncated, trusted).has_value());
+}
+
+TEST(Document, load_lazy_decodes_on_write) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+
+    auto lazy = Document::load_lazy(doc.save());
+    ASSERT_TRUE(lazy.has_value());
+    lazy->transact([](auto& tx) { tx.put(root, "y", std::int64_t{2}); });
+
+    EXPECT_TRUE(lazy->is_materialized());
+    EXPECT_EQ(lazy->length(root), 2u);
+    EXPECT_EQ(lazy->get_changes().size(), 2u);
+    auto reloaded = Document::load(lazy->save());
+    ASSERT_TRUE(reloaded.has_value());
+    EXPECT_EQ(get_int_val(reloaded->get(root, "x")), 1);
+}
+
+TEST(Document, load_lazy_copies_decode_independently) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+
+    auto lazy = Document::load_lazy(doc.save());
+    ASSERT_TRUE(lazy.has_value());
+    auto copy = *lazy;
+    EXPECT_EQ(get_int_val(copy.get(root, "x")), 1);
+    EXPECT_TRUE(copy.is_materialized());
+    EXPECT_FALSE(lazy->is_materialized());
+
+    auto other = make_doc(2);
+    other.merge(*lazy);
+    EXPECT_EQ(get_int_val(other.get(root, "x")), 1);
+}
+
+TEST(Document, load_lazy_concurrent_first_reads) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) {
+        for (int i = 0; i < 100; ++i) {
+            tx.put(root, "k" + std::to_string(i), std::int64_t{i});
+        }
+    });
+    auto lazy = Document::load_lazy(doc.save());
+    ASSERT_TRUE(lazy.has_value());
+
+    auto threads = std::vector<std::thread>{};
+    auto sums = std::vector<std::int64_t>(4, 0);
+    for (std::size_t t = 0; t < sums.size(); ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 100; ++i) {
+                sums[t] += get_int_val(lazy->get(root, "k" + std::to_string(i)));
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    for (auto sum : sums) EXPECT_EQ(sum, 4950);
+}
+
+TEST(Document, load_lazy_rejects_corrupt_data) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    auto bytes = doc.save();
+    bytes[bytes.size() / 2] ^= std::byte{0xFF};
+
+    EXPECT_FALSE(Document::load_lazy(bytes).has_value());
+}
+
 // -- Corrupt data handling ----------------------------------------------------
 
 TEST(Document, load_empty_data_returns_nullopt) {
@@ -1574,6 +2399,266 @@ TEST(Document, sync_incremental_changes) {
     EXPECT_EQ(get_int_val(doc1.get(root, "w")), 99);
 }
 
+TEST(Document, sync_have_summary_tracks_local_changes) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+
+    auto state = SyncState{};
+    auto first = doc.generate_sync_message(state);
+    ASSERT_TRUE(first.has_value());
+
+    doc.transact([](auto& tx) { tx.put(root, "y", std::int64_t{2}); });
+    auto second = doc.generate_sync_message(state);
+    ASSERT_TRUE(second.has_value());
+    EXPECT_NE(second->have, first->have);
+
+    // The incrementally extended summary matches one computed from scratch
+    auto fresh = SyncState{};
+    auto expected = doc.generate_sync_message(fresh);
+    ASSERT_TRUE(expected.has_value());
+    EXPECT_EQ(second->have, expected->have);
+}
+
+TEST(Document, parallel_apply_matches_serial_apply) {
+    // Enough ops across enough objects to take the partitioned path
+    auto source = make_doc(1);
+    auto lists = std::vector<ObjId>{};
+    auto maps = std::vector<ObjId>{};
+    auto text = ObjId{};
+    source.transact([&](auto& tx) {
+        for (int i = 0; i < 16; ++i) {
+            lists.push_back(tx.put(root, "list_" + std::to_string(i), ObjType::list));
+            maps.push_back(tx.put(root, "map_" + std::to_string(i), ObjType::map));
+        }
+        text = tx.put(root, "text", ObjType::text);
+    });
+    for (int round = 0; round < 4; ++round) {
+        source.transact([&](auto& tx) {
+            for (std::size_t i = 0; i < lists.size(); ++i) {
+                for (int j = 0; j < 40; ++j) tx.insert(lists[i], 0, std::int64_t{round * 100 + j});
+                tx.delete_index(lists[i], 3);
+                for (int j = 0; j < 30; ++j) {
+                    tx.put(maps[i], "k" + std::to_string(j % 10), std::int64_t{round * j});
+                }
+            }
+            tx.splice_text(text, 0, 0, "round " + std::to_string(round) + "; ");
+        });
+    }
+    auto changes = source.get_changes();
+
+    auto expect_same = [&](const Document& doc) {
+        EXPECT_EQ(doc.get_heads(), source.get_heads());
+        EXPECT_EQ(doc.text(text), source.text(text));
+        for (std::size_t i = 0; i < lists.size(); ++i) {
+            EXPECT_EQ(doc.values(lists[i]), source.values(lists[i]));
+            EXPECT_EQ(doc.values(maps[i]), source.values(maps[i]));
+        }
+    };
+
+    auto applied = Document{4u};
+    applied.apply_changes(changes);
+    expect_same(applied);
+
+    auto merged = Document{4u};
+    merged.merge(source);
+    expect_same(merged);
+
+    auto loaded = Document::load(source.save(), applied.get_thread_pool());
+    ASSERT_TRUE(loaded.has_value());
+    expect_same(*loaded);
+
+    // An arena is not thread-safe: the pool is not used to apply into it
+    auto arena = std::pmr::monotonic_buffer_resource{};
+    auto in_arena = Document{arena, applied.get_thread_pool()};
+    in_arena.apply_changes(changes);
+    expect_same(in_arena);
+
+    auto pool_resource = std::pmr::synchronized_pool_resource{};
+    auto in_pool = Document{pool_resource, applied.get_thread_pool()};
+    in_pool.merge(source);
+    expect_same(in_pool);
+}
+
+TEST(Document, generate_sync_messages_matches_per_peer_generation) {
+    auto doc = Document{2u};
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+
+    // Peers at different points: fresh, and synced to the first change
+    auto peer = make_doc(2);
+    auto synced = SyncState{};
+    auto peer_state = SyncState{};
+    for (int round = 0; round < 4; ++round) {
+        if (auto msg = doc.generate_sync_message(synced)) peer.receive_sync_message(peer_state, *msg);
+        if (auto msg = peer.generate_sync_message(peer_state)) doc.receive_sync_message(synced, *msg);
+    }
+    doc.transact([](auto& tx) { tx.put(root, "y", std::int64_t{2}); });
+
+    auto states = std::vector<SyncState>{};
+    for (int i = 0; i < 12; ++i) states.push_back(i % 2 ? synced : SyncState{});
+    auto expected_states = states;
+
+    auto pointers = std::vector<SyncState*>{};
+    for (auto& state : states) pointers.push_back(&state);
+    auto messages = doc.generate_sync_messages(pointers);
+
+    ASSERT_EQ(messages.size(), states.size());
+    for (std::size_t i = 0; i < states.size(); ++i) {
+        EXPECT_EQ(messages[i], doc.generate_sync_message(expected_states[i])) << "peer " << i;
+    }
+}
+
+TEST(Document, generate_sync_messages_encoded_matches_per_peer_encoding) {
+    auto doc = Document{2u};
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    doc.transact([](auto& tx) { tx.put(root, "y", std::string{"two"}); });
+
+    auto states = std::vector<SyncState>(12);
+    auto pointers = std::vector<SyncState*>{};
+    for (auto& state : states) pointers.push_back(&state);
+
+    // Round 1 carries only summaries; round 2 answers each peer's reply
+    auto peers = std::vector<Document>{};
+    auto peer_states = std::vector<SyncState>(states.size());
+    for (std::size_t i = 0; i < states.size(); ++i) peers.push_back(make_doc(static_cast<std::uint8_t>(i + 2)));
+    for (int round = 0; round < 2; ++round) {
+        auto expected_states = states;
+        // Called from a task on the document's own pool
+        auto messages = doc.get_thread_pool()->submit([&] {
+            return doc.generate_sync_messages_encoded(pointers);
+        }).get();
+        ASSERT_EQ(messages.size(), states.size());
+        for (std::size_t i = 0; i < states.size(); ++i) {
+            EXPECT_EQ(messages[i], doc.generate_sync_message_encoded(expected_states[i])) << "peer " << i;
+            ASSERT_TRUE(messages[i].has_value());
+            auto decoded = SyncMessage::decode(*messages[i]);
+            ASSERT_TRUE(decoded.has_value());
+            peers[i].receive_sync_message(peer_states[i], *decoded);
+            if (auto reply = peers[i].generate_sync_message(peer_states[i])) {
+                doc.receive_sync_message(states[i], *reply);
+            }
+        }
+    }
+    for (const auto& peer : peers) EXPECT_EQ(peer.get_heads(), doc.get_heads());
+}
+
+TEST(Document, sync_message_encode_decode_round_trip) {
+    auto doc1 = make_doc(1);
+    doc1.transact([](auto& tx) {
+        tx.put(root, "x", std::int64_t{1});
+        tx.put(root, "s", std::string{"hello"});
+    });
+    auto doc2 = make_doc(2);
+    auto s1 = SyncState{};
+    auto s2 = SyncState{};
+
+    // Drive the protocol over the wire format only
+    for (int round = 0; round < 6; ++round) {
+        if (auto msg = doc1.generate_sync_message(s1)) {
+            auto decoded = SyncMessage::decode(msg->encode());
+            ASSERT_TRUE(decoded.has_value());
+            EXPECT_EQ(*decoded, *msg);
+            doc2.receive_sync_message(s2, *decoded);
+        }
+        if (auto msg = doc2.generate_sync_message(s2)) {
+            auto decoded = SyncMessage::decode(msg->encode());
+            ASSERT_TRUE(decoded.has_value());
+            doc1.receive_sync_message(s1, *decoded);
+        }
+    }
+    EXPECT_EQ(get_str(doc2.get(root, "s")), "hello");
+    EXPECT_EQ(doc1.get_heads(), doc2.get_heads());
+}
+
+TEST(Document, sync_message_decode_rejects_invalid_data) {
+    EXPECT_FALSE(SyncMessage::decode(std::vector<std::byte>{}).has_value());
+    EXPECT_FALSE(SyncMessage::decode(std::vector<std::byte>{std::byte{0x43}}).has_value());
+
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    auto msg = SyncMessage{.heads = doc.get_heads(), .need = {}, .have = {},
+                           .changes = doc.get_changes()};
+    auto bytes = msg.encode();
+    bytes.resize(bytes.size() - 1);
+    EXPECT_FALSE(SyncMessage::decode(bytes).has_value());
+}
+
+TEST(Document, generate_sync_message_encoded_matches_encode) {
+    auto doc = make_doc(1);
+    for (int i = 0; i < 3; ++i) {
+        doc.transact([i](auto& tx) { tx.put(root, "k", std::int64_t{i}); });
+    }
+    auto peer = make_doc(2);
+    auto peer_state = SyncState{};
+    auto hello = peer.generate_sync_message(peer_state);
+    ASSERT_TRUE(hello.has_value());
+
+    // Two peers in the same position: the second reuses the cached chunks
+    for (int peer_index = 0; peer_index < 2; ++peer_index) {
+        auto state = SyncState{};
+        auto expected_state = SyncState{};
+        doc.receive_sync_message(state, *hello);
+        doc.receive_sync_message(expected_state, *hello);
+        auto encoded = doc.generate_sync_message_encoded(state);
+        auto expected = doc.generate_sync_message(expected_state);
+        ASSERT_TRUE(encoded.has_value());
+        ASSERT_TRUE(expected.has_value());
+        EXPECT_EQ(expected->changes.size(), 3u);
+        EXPECT_EQ(*encoded, expected->encode());
+    }
+}
+
+TEST(Document, sync_message_budget_streams_catch_up) {
+    auto doc1 = make_doc(1);
+    for (int i = 0; i < 10; ++i) {
+        doc1.transact([i](auto& tx) { tx.put(root, "k" + std::to_string(i), std::int64_t{i}); });
+    }
+    auto doc2 = make_doc(2);
+    auto s1 = SyncState{};
+    auto s2 = SyncState{};
+    s1.set_message_budget(3, 0);
+
+    auto hello = doc2.generate_sync_message(s2);
+    ASSERT_TRUE(hello.has_value());
+    doc1.receive_sync_message(s1, *hello);
+
+    // Several messages go out back to back, without waiting for replies
+    auto batches = std::vector<std::size_t>{};
+    while (auto msg = doc1.generate_sync_message(s1)) {
+        if (msg->changes.empty()) break;
+        batches.push_back(msg->changes.size());
+        doc2.receive_sync_message(s2, *msg);
+    }
+    EXPECT_EQ(batches, (std::vector<std::size_t>{3, 3, 3, 1}));
+    EXPECT_EQ(doc2.length(root), 10u);
+
+    sync_docs(doc1, doc2);
+    EXPECT_EQ(doc1.get_heads(), doc2.get_heads());
+}
+
+TEST(Document, sync_message_byte_budget_sends_at_least_one_change) {
+    auto doc1 = make_doc(1);
+    for (int i = 0; i < 4; ++i) {
+        doc1.transact([i](auto& tx) { tx.put(root, "k", std::string(100, 'a' + i)); });
+    }
+    auto doc2 = make_doc(2);
+    auto s1 = SyncState{};
+    auto s2 = SyncState{};
+    s1.set_message_budget(0, 1);  // smaller than any change
+
+    auto hello = doc2.generate_sync_message(s2);
+    ASSERT_TRUE(hello.has_value());
+    doc1.receive_sync_message(s1, *hello);
+    auto messages = 0;
+    while (auto msg = doc1.generate_sync_message(s1)) {
+        if (msg->changes.empty()) break;
+        EXPECT_EQ(msg->changes.size(), 1u);
+        doc2.receive_sync_message(s2, *msg);
+        ++messages;
+    }
+    EXPECT_EQ(messages, 4);
+    EXPECT_EQ(get_str(doc2.get(root, "k")), std::string(100, 'd'));
+}
+
 TEST(Document, sync_with_counter_increments) {
     auto doc1 = make_doc(1);
     doc1.transact([](auto& tx) {
@@ -1837,47 +2922,264 @@ TEST(Document, transact_with_patches_splice_text_replace) {
     EXPECT_EQ(splice->delete_count, 6u);
     EXPECT_EQ(splice->text, " C++23");
 
-    // Verify final text
-    EXPECT_EQ(doc.text(text_id), "Hello C++23");
+    // Verify final text
+    EXPECT_EQ(doc.text(text_id), "Hello C++23");
+}
+
+TEST(Document, transact_with_patches_counter_increment) {
+    auto doc = Document{};
+    doc.transact([](auto& tx) {
+        tx.put(root, "views", Counter{0});
+    });
+
+    auto patches = doc.transact_with_patches([](auto& tx) {
+        tx.increment(root, "views", 5);
+    });
+
+    EXPECT_EQ(patches.size(), 1u);
+    auto* inc = std::get_if<PatchIncrement>(&patches[0].action);
+    ASSERT_NE(inc, nullptr);
+    EXPECT_EQ(inc->delta, 5);
+}
+
+TEST(Document, transact_with_patches_make_object) {
+    auto doc = Document{};
+    auto patches = doc.transact_with_patches([](auto& tx) {
+        tx.put_object(root, "nested", ObjType::map);
+    });
+
+    EXPECT_EQ(patches.size(), 1u);
+    auto* put = std::get_if<PatchPut>(&patches[0].action);
+    ASSERT_NE(put, nullptr);
+    auto* obj_type = std::get_if<ObjType>(&put->value);
+    ASSERT_NE(obj_type, nullptr);
+    EXPECT_EQ(*obj_type, ObjType::map);
+}
+
+TEST(Document, transact_with_patches_empty_transaction) {
+    auto doc = Document{};
+    auto patches = doc.transact_with_patches([](auto& /*tx*/) {
+        // no ops
+    });
+
+    EXPECT_TRUE(patches.empty());
+}
+
+// Replays the list/text patches for obj onto a copy of its earlier contents.
+auto replay_list_patches(std::vector<Value> list, const ObjId& obj,
+                         const std::vector<Patch>& patches) -> std::vector<Value> {
+    for (const auto& patch : patches) {
+        if (patch.obj != obj) continue;
+        std::visit(overload{
+            [&](const PatchInsert& p) {
+                list.insert(list.begin() + static_cast<std::ptrdiff_t>(p.index), p.value);
+            },
+            [&](const PatchDelete& p) {
+                auto first = list.begin() + static_cast<std::ptrdiff_t>(p.index);
+                list.erase(first, first + static_cast<std::ptrdiff_t>(p.count));
+            },
+            [&](const PatchPut& p) { list[std::get<std::size_t>(patch.key)] = p.value; },
+            [](const auto&) { FAIL() << "unexpected patch on a list"; },
+        }, patch.action);
+    }
+    return list;
+}
+
+TEST(Document, merge_with_patches_reports_remote_edits) {
+    auto doc = make_doc(1);
+    auto [list, text] = doc.transact([](auto& tx) {
+        auto l = tx.put_object(root, "items", ObjType::list);
+        for (std::int64_t i = 0; i < 10; ++i) tx.insert(l, static_cast<std::size_t>(i), i);
+        auto t = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(t, 0, 0, "hello");
+        tx.put(root, "title", "old");
+        tx.put(root, "gone", true);
+        tx.put(root, "views", Counter{1});
+        return std::pair{l, t};
+    });
+    auto list_before = doc.values(list);
+
+    auto peer = make_doc(2);
+    peer.merge(doc);
+    peer.transact([&](auto& tx) {
+        tx.delete_index(list, 2);
+        tx.delete_index(list, 2);
+        tx.insert(list, 0, "first");
+        tx.set(list, 5, std::int64_t{50});
+        tx.splice_text(text, 5, 0, " world");
+        tx.put(root, "title", "new");
+        tx.delete_key(root, "gone");
+        tx.increment(root, "views", 4);
+    });
+
+    auto patches = doc.merge_with_patches(peer);
+
+    EXPECT_EQ(replay_list_patches(list_before, list, patches), doc.values(list));
+    auto deletes = std::ranges::count_if(patches, [&](const Patch& p) {
+        return p.obj == list && std::holds_alternative<PatchDelete>(p.action);
+    });
+    EXPECT_EQ(deletes, 1);  // the two deletes at index 2 fold into one patch
+
+    auto text_patch = std::ranges::find_if(patches, [&](const Patch& p) { return p.obj == text; });
+    ASSERT_NE(text_patch, patches.end());
+    EXPECT_EQ(text_patch->action, (PatchAction{PatchSpliceText{5, 0, " world"}}));
+
+    auto root_patches = std::vector<Patch>{};
+    std::ranges::copy_if(patches, std::back_inserter(root_patches),
+                         [](const Patch& p) { return p.obj == root; });
+    ASSERT_EQ(root_patches.size(), 3u);
+    EXPECT_EQ(root_patches[0], (Patch{root, Prop{std::string{"title"}},
+                                      PatchPut{Value{ScalarValue{std::string{"new"}}}, false}}));
+    EXPECT_EQ(root_patches[1], (Patch{root, Prop{std::string{"gone"}}, PatchDelete{0, 1}}));
+    EXPECT_EQ(root_patches[2], (Patch{root, Prop{std::string{"views"}}, PatchIncrement{4}}));
+
+    EXPECT_TRUE(doc.merge_with_patches(peer).empty());  // nothing new
+}
+
+TEST(Document, merge_with_patches_reports_conflicts) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "k", "base"); });
+    auto low = make_doc(2);
+    auto high = make_doc(3);
+    low.merge(doc);
+    high.merge(doc);
+    low.transact([](auto& tx) { tx.put(root, "k", "low"); });
+    high.transact([](auto& tx) { tx.put(root, "k", "high"); });
+
+    auto first = doc.merge_with_patches(high);
+    ASSERT_EQ(first.size(), 1u);
+    EXPECT_EQ(std::get<PatchPut>(first[0].action),
+              (PatchPut{Value{ScalarValue{std::string{"high"}}}, false}));
+
+    // The losing concurrent value leaves the winner in place, now conflicted.
+    auto second = doc.merge_with_patches(low);
+    ASSERT_EQ(second.size(), 1u);
+    EXPECT_EQ(std::get<PatchPut>(second[0].action),
+              (PatchPut{Value{ScalarValue{std::string{"high"}}}, true}));
+    EXPECT_EQ(doc.get<std::string>(root, "k"), "high");
+}
+
+TEST(Document, receive_sync_message_with_patches_tracks_concurrent_inserts) {
+    auto a = make_doc(1);
+    auto list = a.transact([](auto& tx) {
+        auto l = tx.put_object(root, "items", ObjType::list);
+        for (std::size_t i = 0; i < 5; ++i) tx.insert(l, i, std::int64_t{0});
+        return l;
+    });
+    auto b = make_doc(2);
+    b.merge(a);
+    a.transact([&](auto& tx) {
+        tx.insert(list, 1, "a1");
+        tx.insert(list, 5, "a2");
+        tx.delete_index(list, 0);
+    });
+    b.transact([&](auto& tx) {
+        tx.insert(list, 1, "b1");
+        tx.delete_index(list, 4);
+    });
+
+    auto b_view = b.values(list);
+    auto sa = SyncState{};
+    auto sb = SyncState{};
+    for (int round = 0; round < 10; ++round) {
+        auto progress = false;
+        if (auto msg = a.generate_sync_message(sa)) {
+            auto patches = b.receive_sync_message_with_patches(sb, *msg);
+            b_view = replay_list_patches(std::move(b_view), list, patches);
+            progress = true;
+        }
+        if (auto msg = b.generate_sync_message(sb)) {
+            a.receive_sync_message(sa, *msg);
+            progress = true;
+        }
+        if (!progress) break;
+    }
+
+    EXPECT_EQ(a.values(list), b.values(list));
+    EXPECT_EQ(b_view, b.values(list));
 }
 
-TEST(Document, transact_with_patches_counter_increment) {
-    auto doc = Document{};
-    doc.transact([](auto& tx) {
-        tx.put(root, "views", Counter{0});
+TEST(Document, apply_changes_with_patches_matches_applied_state) {
+    auto source = make_doc(1);
+    source.transact([](auto& tx) {
+        auto l = tx.put_object(root, "items", ObjType::list);
+        tx.insert(l, 0, "x");
+        auto m = tx.insert_object(l, 1, ObjType::map);
+        tx.put(m, "y", std::int64_t{2});
     });
 
-    auto patches = doc.transact_with_patches([](auto& tx) {
-        tx.increment(root, "views", 5);
-    });
+    auto doc = make_doc(2);
+    auto patches = doc.apply_changes_with_patches(source.get_changes());
+    auto list = *doc.get_obj_id(root, "items");
+    auto map = *doc.get_obj_id(list, std::size_t{1});
 
-    EXPECT_EQ(patches.size(), 1u);
-    auto* inc = std::get_if<PatchIncrement>(&patches[0].action);
-    ASSERT_NE(inc, nullptr);
-    EXPECT_EQ(inc->delta, 5);
+    auto items = Path{std::string{"items"}};
+    ASSERT_EQ(patches.size(), 4u);
+    EXPECT_EQ(patches[0], (Patch{root, Prop{std::string{"items"}}, PatchPut{Value{ObjType::list}, false}, {}}));
+    EXPECT_EQ(patches[1], (Patch{list, Prop{std::size_t{0}}, PatchInsert{0, Value{ScalarValue{std::string{"x"}}}}, items}));
+    EXPECT_EQ(patches[2], (Patch{list, Prop{std::size_t{1}}, PatchInsert{1, Value{ObjType::map}}, items}));
+    EXPECT_EQ(patches[3], (Patch{map, Prop{std::string{"y"}}, PatchPut{Value{ScalarValue{std::int64_t{2}}}, false},
+                                 Path{std::string{"items"}, std::size_t{1}}}));
 }
 
-TEST(Document, transact_with_patches_make_object) {
-    auto doc = Document{};
-    auto patches = doc.transact_with_patches([](auto& tx) {
-        tx.put_object(root, "nested", ObjType::map);
+TEST(Document, path_of_follows_parent_links) {
+    auto doc = make_doc(1);
+    auto [config, list, item] = doc.transact([](auto& tx) {
+        auto c = tx.put_object(root, "config", ObjType::map);
+        auto l = tx.put_object(c, "servers", ObjType::list);
+        tx.insert(l, 0, "a");
+        auto i = tx.insert_object(l, 1, ObjType::map);
+        tx.put(i, "host", "b");
+        return std::tuple{c, l, i};
+    });
+
+    EXPECT_EQ(doc.path_of(root), Path{});
+    EXPECT_EQ(doc.path_of(config), (Path{std::string{"config"}}));
+    EXPECT_EQ(doc.path_of(item), (Path{std::string{"config"}, std::string{"servers"}, std::size_t{1}}));
+    EXPECT_EQ(doc.get_path("config", "servers", std::size_t{1}, "host"),
+              Value{ScalarValue{std::string{"b"}}});
+
+    // List indices in the path track inserts and deletes before the item
+    doc.transact([&](auto& tx) {
+        tx.insert(list, 0, "z");
+        tx.insert(list, 0, "y");
+        tx.delete_index(list, 2);
     });
+    EXPECT_EQ(doc.path_of(item), (Path{std::string{"config"}, std::string{"servers"}, std::size_t{2}}));
 
-    EXPECT_EQ(patches.size(), 1u);
-    auto* put = std::get_if<PatchPut>(&patches[0].action);
-    ASSERT_NE(put, nullptr);
-    auto* obj_type = std::get_if<ObjType>(&put->value);
-    ASSERT_NE(obj_type, nullptr);
-    EXPECT_EQ(*obj_type, ObjType::map);
+    // Parent links survive save/load and merge
+    auto loaded = Document::load(doc.save());
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->path_of(item), doc.path_of(item));
+    auto merged = make_doc(2);
+    merged.merge(doc);
+    EXPECT_EQ(merged.path_of(item), doc.path_of(item));
+
+    // Deleted or overwritten objects, and everything under them, are unreachable
+    doc.transact([&](auto& tx) { tx.delete_index(list, 2); });
+    EXPECT_FALSE(doc.path_of(item).has_value());
+    doc.transact([](auto& tx) { tx.put(root, "config", "flat"); });
+    EXPECT_FALSE(doc.path_of(list).has_value());
+    EXPECT_FALSE(doc.path_of(config).has_value());
+    EXPECT_FALSE(doc.path_of(ObjId{OpId{999, ActorId{}}}).has_value());
 }
 
-TEST(Document, transact_with_patches_empty_transaction) {
-    auto doc = Document{};
-    auto patches = doc.transact_with_patches([](auto& /*tx*/) {
-        // no ops
+TEST(Document, patches_carry_the_path_of_their_object) {
+    auto doc = make_doc(1);
+    auto text = doc.transact([](auto& tx) {
+        auto notes = tx.put_object(root, "notes", ObjType::list);
+        return tx.insert_object(notes, 0, ObjType::text);
     });
+    auto local = doc.transact_with_patches([&](auto& tx) { tx.splice_text(text, 0, 0, "hi"); });
+    ASSERT_EQ(local.size(), 1u);
+    EXPECT_EQ(local[0].path, (Path{std::string{"notes"}, std::size_t{0}}));
 
-    EXPECT_TRUE(patches.empty());
+    auto peer = make_doc(2);
+    peer.merge(doc);
+    peer.transact([&](auto& tx) { tx.splice_text(text, 2, 0, "!"); });
+    auto remote = doc.merge_with_patches(peer);
+    ASSERT_EQ(remote.size(), 1u);
+    EXPECT_EQ(remote[0].path, (Path{std::string{"notes"}, std::size_t{0}}));
 }
 
 // =============================================================================
@@ -2005,6 +3307,102 @@ TEST(Document, text_at_reads_past_text) {
     EXPECT_EQ(doc.text_at(text_id, heads_v1), "Hello");
 }
 
+TEST(Document, view_at_answers_reads_at_past_heads) {
+    auto doc = Document{};
+    ObjId text_id;
+    doc.transact([&](auto& tx) {
+        tx.put(root, "title", std::string{"draft"});
+        text_id = tx.put_object(root, "body", ObjType::text);
+        tx.splice_text(text_id, 0, 0, "Hello");
+    });
+    auto heads_v1 = doc.get_heads();
+
+    doc.transact([&](auto& tx) {
+        tx.put(root, "title", std::string{"final"});
+        tx.put(root, "extra", std::int64_t{1});
+        tx.splice_text(text_id, 5, 0, " World");
+    });
+
+    auto past = doc.view_at(heads_v1);
+    EXPECT_EQ(past.get<std::string>(root, "title"), "draft");
+    EXPECT_EQ(past.text(text_id), "Hello");
+    EXPECT_EQ(past.keys(root), (std::vector<std::string>{"body", "title"}));
+    EXPECT_EQ(past.get_heads(), heads_v1);
+    EXPECT_EQ(past.get_changes().size(), 1u);
+
+    // The live document is unaffected by the view
+    EXPECT_EQ(doc.get<std::string>(root, "title"), "final");
+    EXPECT_EQ(doc.text(text_id), "Hello World");
+}
+
+TEST(Document, view_at_current_heads_matches_document) {
+    auto doc = Document{};
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    doc.transact([](auto& tx) { tx.put(root, "y", std::int64_t{2}); });
+
+    auto view = doc.view_at(doc.get_heads());
+    EXPECT_EQ(view.keys(root), doc.keys(root));
+    EXPECT_EQ(view.get_heads(), doc.get_heads());
+    EXPECT_NE(view.actor_id(), doc.actor_id());
+
+    // Writing to the document after the view does not leak into it
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{9}); });
+    EXPECT_EQ(view.get<std::int64_t>(root, "x"), 1);
+}
+
+TEST(Document, historical_reads_reuse_earlier_snapshots) {
+    auto doc = Document{};
+    auto history = std::vector<std::vector<ChangeHash>>{};
+    for (auto i = std::int64_t{0}; i < 8; ++i) {
+        doc.transact([&](auto& tx) { tx.put(root, "n", i); });
+        history.push_back(doc.get_heads());
+    }
+
+    // Walk forwards (each read extends the previous snapshot), then back
+    for (auto i = std::size_t{0}; i < history.size(); ++i) {
+        EXPECT_EQ(doc.get_at(root, "n", history[i]), Value{ScalarValue{static_cast<std::int64_t>(i)}});
+    }
+    for (auto i = history.size(); i-- > 0;) {
+        EXPECT_EQ(doc.view_at(history[i]).get<std::int64_t>(root, "n"),
+                  static_cast<std::int64_t>(i));
+    }
+}
+
+TEST(Document, view_at_concurrent_heads_merges_both_branches) {
+    auto doc1 = Document{};
+    doc1.transact([](auto& tx) { tx.put(root, "base", std::int64_t{0}); });
+    auto doc2 = doc1.fork();
+    doc1.transact([](auto& tx) { tx.put(root, "a", std::int64_t{1}); });
+    doc2.transact([](auto& tx) { tx.put(root, "b", std::int64_t{2}); });
+    doc1.merge(doc2);
+    auto merged_heads = doc1.get_heads();
+    doc1.transact([](auto& tx) { tx.put(root, "c", std::int64_t{3}); });
+
+    auto view = doc1.view_at(merged_heads);
+    EXPECT_EQ(view.keys(root), (std::vector<std::string>{"a", "b", "base"}));
+    auto heads = view.get_heads();
+    std::ranges::sort(heads);
+    std::ranges::sort(merged_heads);
+    EXPECT_EQ(heads, merged_heads);
+}
+
+TEST(Document, historical_reads_across_checkpoints) {
+    auto doc = Document{};
+    auto heads = std::vector<std::vector<ChangeHash>>{};
+    for (auto i = std::int64_t{0}; i < 2500; ++i) {
+        doc.transact([&](auto& tx) { tx.put(root, "n", i); });
+        if (i % 500 == 0) heads.push_back(doc.get_heads());
+    }
+
+    auto loaded = Document::load(doc.save());
+    ASSERT_TRUE(loaded.has_value());
+    for (auto i = std::size_t{0}; i < heads.size(); ++i) {
+        auto expected = Value{ScalarValue{static_cast<std::int64_t>(i * 500)}};
+        EXPECT_EQ(doc.get_at(root, "n", heads[i]), expected);
+        EXPECT_EQ(loaded->get_at(root, "n", heads[i]), expected);
+    }
+}
+
 TEST(Document, get_at_missing_key_returns_nullopt) {
     auto doc = Document{};
     doc.transact([](auto& tx) {
@@ -2201,6 +3599,43 @@ TEST(Document, cursor_on_text) {
     EXPECT_EQ(doc.text(text_id), ">>> Hello");
 }
 
+TEST(Document, batch_cursors_match_single_cursor_calls) {
+    auto doc = Document{};
+    ObjId text_id;
+    doc.transact([&](auto& tx) {
+        text_id = tx.put_object(root, "content", ObjType::text);
+        tx.splice_text(text_id, 0, 0, "Hello, world");
+    });
+
+    const auto indices = std::vector<std::size_t>{0, 4, 7, 11, 12};
+    auto curs = doc.cursors(text_id, indices);
+    ASSERT_EQ(curs.size(), indices.size());
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        EXPECT_EQ(curs[i], doc.cursor(text_id, indices[i]));
+    }
+    EXPECT_FALSE(curs[4].has_value());  // past the end
+
+    doc.transact([&](auto& tx) {
+        tx.splice_text(text_id, 0, 0, ">> ");  // shift everything right
+        tx.splice_text(text_id, 7, 1, "");     // delete 'o' (old index 4)
+    });
+
+    auto live = std::vector<Cursor>{*curs[0], *curs[1], *curs[2], *curs[3]};
+    auto resolved = doc.resolve_cursors(text_id, live);
+    ASSERT_EQ(resolved.size(), 4u);
+    EXPECT_EQ(resolved[0], std::optional<std::size_t>{3});
+    EXPECT_FALSE(resolved[1].has_value());
+    EXPECT_EQ(resolved[2], std::optional<std::size_t>{9});
+    EXPECT_EQ(resolved[3], std::optional<std::size_t>{13});
+    for (std::size_t i = 0; i < live.size(); ++i) {
+        EXPECT_EQ(resolved[i], doc.resolve_cursor(text_id, live[i]));
+    }
+
+    auto missing = ObjId{OpId{99, ActorId{}}};
+    EXPECT_EQ(doc.resolve_cursors(missing, live).size(), live.size());
+    EXPECT_FALSE(doc.resolve_cursors(missing, live)[0].has_value());
+}
+
 TEST(Document, cursor_survives_merge) {
     auto doc1 = Document{};
     const std::uint8_t raw1[16] = {1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
@@ -2601,6 +4036,21 @@ TEST(Document, fork_shares_thread_pool) {
     EXPECT_EQ(doc.get_thread_pool(), forked.get_thread_pool());
 }
 
+TEST(Document, load_does_not_create_a_pool) {
+    auto doc = Document{4u};
+    doc.transact([](auto& tx) {
+        tx.put(root, "key", std::string{"value"});
+    });
+    auto bytes = doc.save();
+
+    EXPECT_EQ(Document{}.get_thread_pool(), nullptr);
+    EXPECT_EQ(Document::load(bytes)->get_thread_pool(), nullptr);
+    EXPECT_EQ(Document::load_lazy(bytes)->get_thread_pool(), nullptr);
+    EXPECT_EQ(Document::load(bytes, doc.get_thread_pool())->get_thread_pool(),
+              doc.get_thread_pool());
+    EXPECT_EQ(doc.view_at(doc.get_heads()).get_thread_pool(), doc.get_thread_pool());
+}
+
 TEST(Document, concurrent_reads_are_safe) {
     auto doc = Document{};
     doc.transact([](auto& tx) {
@@ -2632,6 +4082,398 @@ TEST(Document, concurrent_reads_are_safe) {
     EXPECT_EQ(errors.load(), 0);
 }
 
+TEST(Document, concurrent_history_reads_are_safe) {
+    // The first readers to need the hash index and change DAG build them
+    for (auto snapshot_reads : {false, true}) {
+        auto doc = Document{};
+        doc.set_snapshot_reads(snapshot_reads);
+        auto hashes = std::vector<ChangeHash>{};
+        for (std::int64_t i = 0; i < 2000; ++i) {
+            doc.transact([i](auto& tx) { tx.put(root, "v", i); });
+            if (i % 100 == 0) hashes.push_back(doc.get_heads()[0]);
+        }
+        auto heads = doc.get_heads();
+
+        auto errors = std::atomic<int>{0};
+        auto threads = std::vector<std::thread>{};
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t]() {
+                for (std::size_t i = 0; i < hashes.size(); ++i) {
+                    const auto& hash = hashes[(i + t * 5) % hashes.size()];
+                    if (!doc.get_change_by_hash(hash)) errors.fetch_add(1);
+                    if (doc.get_changes_since({hash}).empty() == (hash != heads[0])) {
+                        errors.fetch_add(1);
+                    }
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        EXPECT_EQ(errors.load(), 0) << "snapshot_reads=" << snapshot_reads;
+    }
+}
+
+TEST(Document, snapshot_reads_see_only_committed_transactions) {
+    auto doc = Document{};
+    doc.set_snapshot_reads(true);
+    EXPECT_TRUE(doc.snapshot_reads());
+    doc.transact([](auto& tx) {
+        tx.put(root, "a", std::int64_t{0});
+        tx.put(root, "b", std::int64_t{0});
+    });
+
+    // Each transaction writes a and b together; a reader must never see them differ
+    auto done = std::atomic<bool>{false};
+    auto errors = std::atomic<int>{0};
+    auto readers = std::vector<std::thread>{};
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&]() {
+            while (!done.load(std::memory_order_acquire)) {
+                auto a = get_int_val(doc.get(root, "a"));
+                auto b = get_int_val(doc.get(root, "b"));
+                if (a > b) errors.fetch_add(1, std::memory_order_relaxed);
+                if (doc.keys(root).size() != 2) errors.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (std::int64_t i = 1; i <= 200; ++i) {
+        doc.transact([i](auto& tx) {
+            tx.put(root, "b", i);
+            tx.put(root, "a", i);
+        });
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& t : readers) t.join();
+
+    EXPECT_EQ(errors.load(), 0);
+    EXPECT_EQ(get_int_val(doc.get(root, "a")), 200);
+    EXPECT_EQ(doc.get_changes().size(), 201u);
+    EXPECT_EQ(doc.get_heads().size(), 1u);
+}
+
+TEST(Document, snapshot_reads_cache_is_per_document_version) {
+    // One thread alternating between documents must never see the other's snapshot
+    auto a = Document{};
+    auto b = Document{};
+    a.set_snapshot_reads(true);
+    b.set_snapshot_reads(true);
+    for (std::int64_t i = 0; i < 5; ++i) {
+        a.transact([i](auto& tx) { tx.put(root, "v", i); });
+        EXPECT_EQ(get_int_val(a.get(root, "v")), i);
+        b.transact([i](auto& tx) { tx.put(root, "v", i * 10); });
+        EXPECT_EQ(get_int_val(b.get(root, "v")), i * 10);
+        EXPECT_EQ(get_int_val(a.get(root, "v")), i);
+    }
+
+    // A copy publishes its own snapshot, which later writes to a don't touch
+    auto copy = a;
+    a.transact([](auto& tx) { tx.put(root, "v", std::int64_t{99}); });
+    EXPECT_EQ(get_int_val(copy.get(root, "v")), 4);
+    EXPECT_EQ(get_int_val(a.get(root, "v")), 99);
+}
+
+TEST(Document, assignment_carries_read_settings_and_snapshot) {
+    auto source = Document{};
+    source.set_snapshot_reads(true);
+    source.set_read_locking(false);
+    source.transact([](auto& tx) { tx.put(root, "v", std::int64_t{1}); });
+
+    // Moved into a document that was publishing snapshots of other content
+    auto target = Document{};
+    target.set_snapshot_reads(true);
+    target.transact([](auto& tx) { tx.put(root, "v", std::int64_t{2}); });
+    EXPECT_EQ(get_int_val(target.get(root, "v")), 2);
+    target = std::move(source);
+    EXPECT_TRUE(target.snapshot_reads());
+    EXPECT_FALSE(target.read_locking());
+    EXPECT_EQ(get_int_val(target.get(root, "v")), 1);
+
+    // Assigned a document without snapshot reads: the old snapshot is gone
+    auto plain = Document{};
+    plain.transact([](auto& tx) { tx.put(root, "v", std::int64_t{3}); });
+    target = plain;
+    EXPECT_FALSE(target.snapshot_reads());
+    EXPECT_TRUE(target.read_locking());
+    EXPECT_EQ(get_int_val(target.get(root, "v")), 3);
+    target = std::move(plain);
+    EXPECT_EQ(get_int_val(target.get(root, "v")), 3);
+}
+
+TEST(Document, snapshot_reads_publish_lazily_loaded_documents) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+
+    auto lazy = Document::load_lazy(doc.save());
+    ASSERT_TRUE(lazy.has_value());
+    lazy->set_snapshot_reads(true);
+    EXPECT_FALSE(lazy->is_materialized());
+    EXPECT_EQ(lazy->get_heads(), doc.get_heads());
+    EXPECT_EQ(get_int_val(lazy->get(root, "x")), 1);
+
+    lazy->transact([](auto& tx) { tx.put(root, "x", std::int64_t{2}); });
+    EXPECT_EQ(get_int_val(lazy->get(root, "x")), 2);
+    lazy->set_snapshot_reads(false);
+    EXPECT_EQ(get_int_val(lazy->get(root, "x")), 2);
+}
+
+TEST(Document, read_view_matches_copying_reads) {
+    auto doc = Document{};
+    ObjId list_id;
+    ObjId text_id;
+    doc.transact([&](auto& tx) {
+        tx.put(root, "name", std::string{"a fairly long string value"});
+        tx.put(root, "blob", Bytes{std::byte{1}, std::byte{2}, std::byte{3}});
+        tx.put(root, "n", std::int64_t{7});
+        list_id = tx.put_object(root, "items", ObjType::list);
+        tx.insert(list_id, 0, std::string{"x"});
+        tx.insert(list_id, 1, std::int64_t{2});
+        tx.insert(list_id, 2, std::string{"z"});
+        text_id = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(text_id, 0, 0, "Hello world");
+    });
+    doc.transact([&](auto& tx) {
+        tx.delete_index(list_id, 1);
+        tx.splice_text(text_id, 5, 1, ", ");
+    });
+
+    auto view = doc.read_view();
+    EXPECT_EQ(get_scalar<std::string_view>(view.get(root, "name")), "a fairly long string value");
+    auto blob = get_scalar<std::span<const std::byte>>(view.get(root, "blob"));
+    ASSERT_TRUE(blob.has_value());
+    EXPECT_EQ(Bytes(blob->begin(), blob->end()), (Bytes{std::byte{1}, std::byte{2}, std::byte{3}}));
+    EXPECT_EQ(get_scalar<std::int64_t>(view.get(root, "n")), 7);
+    EXPECT_FALSE(view.get(root, "missing").has_value());
+    EXPECT_EQ(view.get_obj_id(root, "items"), list_id);
+    EXPECT_EQ(view.object_type(text_id), ObjType::text);
+
+    auto keys = std::vector<std::string>{};
+    for (auto key : view.keys(root)) keys.emplace_back(key);
+    EXPECT_EQ(keys, doc.keys(root));
+    auto values = std::vector<Value>{};
+    for (const auto& value : view.values(root)) values.push_back(to_value(value));
+    EXPECT_EQ(values, doc.values(root));
+
+    auto elements = std::vector<Value>{};
+    for (const auto& element : view.elements(list_id)) elements.push_back(to_value(element.value));
+    EXPECT_EQ(elements, doc.values(list_id));
+    EXPECT_EQ(view.elements(list_id).size(), 2u);
+    EXPECT_EQ(get_scalar<std::string_view>(view.get(list_id, std::size_t{1})), "z");
+    EXPECT_FALSE(view.get(list_id, std::size_t{2}).has_value());
+
+    auto text = std::string{};
+    for (auto chunk : view.text_chunks(text_id)) text.append(chunk);
+    EXPECT_EQ(text, doc.text(text_id));
+    EXPECT_EQ(std::ranges::distance(view.elements(text_id)), 12);
+    EXPECT_TRUE(view.elements(root).empty());
+    EXPECT_TRUE(view.entries(list_id).empty());
+}
+
+TEST(Document, read_view_pins_its_snapshot) {
+    auto doc = Document{};
+    doc.set_snapshot_reads(true);
+    doc.transact([](auto& tx) { tx.put(root, "title", std::string{"first version of the title"}); });
+
+    auto view = doc.read_view();
+    auto title = *get_scalar<std::string_view>(view.get(root, "title"));
+    doc.transact([](auto& tx) {
+        tx.put(root, "title", std::string{"second version of the title"});
+        tx.put(root, "extra", std::int64_t{1});
+    });
+
+    // The view still sees, and its borrowed string still points into, the old state
+    EXPECT_EQ(title, "first version of the title");
+    EXPECT_EQ(get_scalar<std::string_view>(view.get(root, "title")), "first version of the title");
+    EXPECT_EQ(view.length(root), 1u);
+    EXPECT_EQ(get_scalar<std::string_view>(doc.read_view().get(root, "title")),
+              "second version of the title");
+}
+
+TEST(Document, read_views_of_a_fragmented_text_survive_later_edits) {
+    // Each view shares the text with the document; an edit copies only the
+    // part it changes, never what an older view reads
+    auto doc = Document{};
+    doc.set_snapshot_reads(true);
+    ObjId text;
+    doc.transact([&](auto& tx) { text = tx.put_object(root, "text", ObjType::text); });
+    auto model = std::string{};
+    for (std::size_t i = 0; i < 20'000; ++i) {
+        const auto pos = (i * 7919) % (model.size() + 1);
+        doc.transact([&](auto& tx) { tx.splice_text(text, pos, 0, "x"); });
+        model.insert(pos, "x");
+    }
+
+    auto views = std::vector<std::pair<ReadView, std::string>>{};
+    for (std::size_t i = 0; i < 200; ++i) {
+        if (i % 20 == 0) views.emplace_back(doc.read_view(), model);
+        const auto pos = (i * 104'729) % (model.size() + 1);
+        if (i % 3 == 0) {
+            doc.transact([&](auto& tx) { tx.splice_text(text, pos % model.size(), 1, ""); });
+            model.erase(pos % model.size(), 1);
+        } else {
+            doc.transact([&](auto& tx) { tx.splice_text(text, pos, 0, "y"); });
+            model.insert(pos, "y");
+        }
+    }
+
+    EXPECT_EQ(doc.text(text), model);
+    for (const auto& [view, expected] : views) {
+        auto seen = std::string{};
+        for (auto chunk : view.text_chunks(text)) seen.append(chunk);
+        EXPECT_EQ(seen, expected);
+        EXPECT_EQ(view.length(text), expected.size());
+    }
+}
+
+TEST(Document, walk_pins_its_snapshot_across_reentrant_reads) {
+    auto doc = Document{};
+    doc.set_snapshot_reads(true);
+    doc.transact([](auto& tx) {
+        for (int i = 0; i < 64; ++i) tx.put(root, "key" + std::to_string(i), std::string(40, 'a'));
+    });
+    auto other = Document{};
+    other.set_snapshot_reads(true);
+    other.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+
+    // On the first key, another thread commits to the walked document, then
+    // the visitor reads the other one: this thread's cached snapshot moves on
+    struct Visitor final : TreeVisitor {
+        Document& doc;
+        Document& other;
+        std::vector<std::string> keys;
+        std::size_t scalars = 0;
+        Visitor(Document& d, Document& o) : doc{d}, other{o} {}
+        void begin_map() override {}
+        void key(std::string_view key) override {
+            if (keys.empty()) {
+                std::thread{[&] { doc.transact([](auto& tx) { tx.put(root, "late", true); }); }}.join();
+                EXPECT_TRUE(other.get(root, "x").has_value());
+            }
+            keys.emplace_back(key);
+        }
+        void end_map() override {}
+        void begin_list(std::size_t) override {}
+        void end_list() override {}
+        void text(std::string_view) override {}
+        void scalar(const ScalarValue&) override { ++scalars; }
+    } visitor{doc, other};
+    doc.walk(root, visitor);
+
+    EXPECT_EQ(visitor.keys.size(), 64u);
+    EXPECT_EQ(visitor.scalars, 64u);
+    EXPECT_EQ(doc.length(root), 65u);
+}
+
+TEST(Document, scalar_chunks_view_packed_samples) {
+    auto doc = Document{};
+    ObjId samples;
+    ObjId counts;
+    doc.transact([&](auto& tx) {
+        samples = tx.put_object(root, "samples", ObjType::list);
+        counts = tx.put_object(root, "counts", ObjType::list);
+        for (int i = 0; i < 1000; ++i) tx.insert(samples, static_cast<std::size_t>(i), i * 0.25);
+        for (int i = 0; i < 1000; ++i) tx.insert(counts, static_cast<std::size_t>(i), std::int64_t{i});
+    });
+    doc.transact([&](auto& tx) {
+        tx.delete_index(samples, 500);
+        tx.set(samples, 10, std::string{"gap"});
+    });
+
+    auto view = doc.read_view();
+    auto sum = 0.0;
+    auto seen = std::size_t{0};
+    auto chunks = 0;
+    for (auto chunk : view.scalar_chunks<double>(samples)) {
+        for (auto x : chunk) sum += x;
+        seen += chunk.size();
+        ++chunks;
+    }
+    // The string at index 10 is skipped; the delete splits the run
+    EXPECT_EQ(seen, view.length(samples) - 1);
+    EXPECT_EQ(chunks, 3);
+    EXPECT_DOUBLE_EQ(sum, 0.25 * (999 * 1000 / 2 - 500 - 10));
+
+    auto total = std::int64_t{0};
+    for (auto chunk : view.scalar_chunks<std::int64_t>(counts)) {
+        EXPECT_EQ(chunk.size(), 1000u);
+        for (auto x : chunk) total += x;
+    }
+    EXPECT_EQ(total, 999 * 1000 / 2);
+    EXPECT_EQ(view.scalar_chunks<std::int64_t>(samples).begin(),
+              view.scalar_chunks<std::int64_t>(samples).end());
+    EXPECT_EQ(view.scalar_chunks<double>(root).begin(), view.scalar_chunks<double>(root).end());
+
+    auto loaded = Document::load(doc.save());
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->values(samples), doc.values(samples));
+}
+
+TEST(Document, for_each_entry_visits_map_in_key_order) {
+    auto doc = Document{};
+    ObjId child;
+    doc.transact([&](auto& tx) {
+        tx.put(root, "b", std::int64_t{2});
+        tx.put(root, "a", std::string{"one"});
+        child = tx.put_object(root, "c", ObjType::map);
+        tx.put(child, "x", true);
+    });
+
+    auto keys = std::vector<std::string>{};
+    auto values = std::vector<Value>{};
+    doc.for_each_entry(root, [&](const MapEntryRef& entry) {
+        keys.emplace_back(entry.key);
+        values.push_back(to_value(entry.value));
+        if (entry.key == "c") {
+            EXPECT_EQ(ObjId{entry.id}, child);
+        }
+    });
+    EXPECT_EQ(keys, doc.keys(root));
+    EXPECT_EQ(values, doc.values(root));
+
+    auto calls = 0;
+    doc.for_each_entry(ObjId{OpId{999, ActorId{}}}, [&](const MapEntryRef&) { ++calls; });
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(Document, for_each_element_visits_a_range_of_visible_elements) {
+    auto doc = Document{};
+    ObjId list_id;
+    doc.transact([&](auto& tx) {
+        list_id = tx.put_object(root, "list", ObjType::list);
+        for (std::int64_t i = 0; i < 200; ++i) {
+            tx.insert(list_id, static_cast<std::size_t>(i), i);
+        }
+    });
+    doc.transact([&](auto& tx) {
+        for (std::size_t i = 0; i < 50; ++i) tx.delete_index(list_id, 10);  // hide 10..59
+    });
+    auto nested = ObjId{};
+    doc.transact([&](auto& tx) { nested = tx.insert_object(list_id, 0, ObjType::map); });
+
+    auto all = std::vector<Value>{};
+    auto next_index = std::size_t{0};
+    doc.for_each_element(list_id, [&](const ElementRef& element) {
+        EXPECT_EQ(element.index, next_index++);
+        all.push_back(to_value(element.value));
+    });
+    EXPECT_EQ(all, doc.values(list_id));
+    EXPECT_EQ(get_scalar<std::int64_t>(all.back()), 199);
+
+    auto slice = std::vector<std::int64_t>{};
+    doc.for_each_element(list_id, 5, 15, [&](const ElementRef& element) {
+        slice.push_back(*get_scalar<std::int64_t>(element.value));
+        EXPECT_EQ(get_scalar<std::int64_t>(doc.get(list_id, element.index)),
+                  get_scalar<std::int64_t>(element.value));
+    });
+    EXPECT_EQ(slice, (std::vector<std::int64_t>{4, 5, 6, 7, 8, 9, 60, 61, 62, 63}));
+
+    auto tail = std::size_t{0};
+    doc.for_each_element(list_id, 148, 1000, [&](const ElementRef&) { ++tail; });
+    EXPECT_EQ(tail, 3u);
+    doc.for_each_element(list_id, 7, 7, [&](const ElementRef&) { ADD_FAILURE(); });
+    doc.for_each_element(list_id, 0, 1, [&](const ElementRef& element) {
+        EXPECT_EQ(ObjId{element.id}, nested);
+    });
+}
+
 TEST(Document, fork_merge_batch_put) {
     // Simulate parallel batch put via fork/merge
     auto doc = Document{1u};  // sequential base
@@ -3398,6 +5240,24 @@ TEST(Document, save_load_large_values_for_compression) {
     EXPECT_EQ(s, std::string(10000, 'x'));
 }
 
+TEST(Document, save_with_compression_levels_round_trips) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "big", std::string(10000, 'x')); });
+
+    auto standard = doc.save();
+    auto raw = doc.save({.compression_level = 0});
+    auto fast = doc.save({.compression_level = 1});
+    EXPECT_GT(raw.size(), standard.size());
+    for (const auto& bytes : {raw, fast}) {
+        auto loaded = Document::load(bytes);
+        ASSERT_TRUE(loaded.has_value());
+        EXPECT_EQ(loaded->get<std::string>(root, "big"), std::string(10000, 'x'));
+    }
+
+    auto fresh = Document{};
+    EXPECT_EQ(fresh.load_incremental(doc.save_since({}, {.compression_level = 0})), 1u);
+}
+
 // =============================================================================
 // Rust parity: sync protocol edge cases
 //
@@ -3608,9 +5468,9 @@ TEST(Document, text_delete_entire_contents) {
 // Rust parity: marks edge cases
 // =============================================================================
 
-TEST(Document, mark_overwrite_creates_new_mark_entry) {
-    // Adding a mark and then adding another with the same name creates
-    // multiple mark entries. The marks() query returns all entries.
+TEST(Document, mark_overwrite_replaces_mark_entry) {
+    // Marking the same range with the same name again replaces the earlier
+    // mark instead of accumulating entries.
     auto doc = make_doc(1);
     auto text_id = ObjId{};
     doc.transact([&](auto& tx) {
@@ -3633,15 +5493,62 @@ TEST(Document, mark_overwrite_creates_new_mark_entry) {
     });
 
     auto marks_after = doc.marks(text_id);
-    // Both mark entries should be present
-    EXPECT_GE(marks_after.size(), 1u);
+    ASSERT_EQ(marks_after.size(), 1u);
+    EXPECT_EQ(marks_after[0].name, "bold");
+    EXPECT_EQ(marks_after[0].value, ScalarValue{std::string{"strong"}});
+}
 
-    // At least one should be named "bold"
-    bool found_bold = false;
-    for (const auto& m : marks_after) {
-        if (m.name == "bold") found_bold = true;
+TEST(Document, concurrent_marks_on_same_range_converge) {
+    auto doc1 = make_doc(1);
+    auto text_id = doc1.transact([](auto& tx) {
+        auto t = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(t, 0, 0, "abcdefg");
+        return t;
+    });
+    auto doc2 = make_doc(2);
+    doc2.merge(doc1);
+    doc1.transact([&](auto& tx) { tx.mark(text_id, 1, 4, "color", std::string{"red"}); });
+    doc2.transact([&](auto& tx) { tx.mark(text_id, 1, 4, "color", std::string{"blue"}); });
+
+    doc1.merge(doc2);
+    doc2.merge(doc1);
+    ASSERT_EQ(doc1.marks(text_id).size(), 1u);
+    EXPECT_EQ(doc1.marks(text_id), doc2.marks(text_id));
+}
+
+TEST(Document, marks_range_query_matches_filtered_marks) {
+    auto doc = make_doc(1);
+    auto text_id = doc.transact([](auto& tx) {
+        auto t = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(t, 0, 0, std::string(2000, 'x'));
+        return t;
+    });
+    doc.transact([&](auto& tx) {
+        for (std::size_t i = 0; i < 300; ++i) {
+            auto start = (i * 37) % 1900;
+            auto len = (i % 10 == 0) ? 600 : 1 + (i * 13) % 40;  // a few long marks
+            tx.mark(text_id, start, std::min<std::size_t>(start + len, 2000),
+                    i % 2 ? "bold" : "link", static_cast<std::int64_t>(i));
+        }
+    });
+    // Shift positions and hide some endpoints; the index must not care
+    doc.transact([&](auto& tx) {
+        tx.splice_text(text_id, 0, 0, "prefix ");
+        tx.splice_text(text_id, 500, 25, "");
+        tx.splice_text(text_id, 1200, 0, "middle");
+    });
+
+    auto all = doc.marks(text_id);
+    ASSERT_TRUE(std::ranges::is_sorted(all, {}, &Mark::start));
+    const std::pair<std::size_t, std::size_t> ranges[] = {
+        {0, 10}, {0, 5000}, {480, 560}, {1000, 1001}, {1950, 1990}, {3000, 3100}, {7, 7},
+    };
+    for (auto [start, end] : ranges) {
+        auto expected = std::vector<Mark>{};
+        std::ranges::copy_if(all, std::back_inserter(expected),
+                             [&](const Mark& m) { return m.start < end && m.end > start; });
+        EXPECT_EQ(doc.marks(text_id, start, end), expected) << start << ".." << end;
     }
-    EXPECT_TRUE(found_bold);
 }
 
 TEST(Document, marks_survive_concurrent_text_edits) {
@@ -4555,6 +6462,85 @@ TEST(Document, sync_in_flight_does_not_lose_concurrent_changes) {
     EXPECT_TRUE(doc2.get(root, "concurrent").has_value());
 }
 
+TEST(Document, sync_settles_when_heads_are_in_different_orders) {
+    // hub learns doc2's change first, doc1 its own: same heads, other order
+    auto hub = make_doc(1);
+    auto doc1 = make_doc(2);
+    auto doc2 = make_doc(3);
+    doc1.transact([](auto& tx) { tx.put(root, "a", std::int64_t{1}); });
+    doc2.transact([](auto& tx) { tx.put(root, "b", std::int64_t{2}); });
+    sync_docs(hub, doc2);
+    sync_docs(hub, doc1);
+    sync_docs(hub, doc2);
+
+    auto count = sync_docs(hub, doc1);
+    EXPECT_LT(count, 20);
+    auto a = hub.get_heads();
+    auto b = doc1.get_heads();
+    std::ranges::sort(a);
+    std::ranges::sort(b);
+    EXPECT_EQ(a, b);
+}
+
+TEST(Document, receive_sync_message_skips_changes_it_has) {
+    // Gossip: the same changes arrive from two peers
+    auto source = make_doc(1);
+    source.transact([](auto& tx) { tx.put(root, "a", std::int64_t{1}); });
+    source.transact([](auto& tx) { tx.put(root, "b", std::int64_t{2}); });
+    auto message = SyncMessage{.heads = source.get_heads(), .need = {}, .have = {},
+                               .changes = source.get_changes()};
+
+    auto doc = make_doc(2);
+    auto from_peer1 = SyncState{};
+    auto from_peer2 = SyncState{};
+    doc.receive_sync_message(from_peer1, message);
+    doc.receive_sync_message(from_peer2, message);
+
+    EXPECT_EQ(doc.get_changes().size(), 2u);
+    EXPECT_EQ(doc.get_heads(), source.get_heads());
+}
+
+TEST(Document, receive_sync_message_holds_changes_until_deps_arrive) {
+    auto source = make_doc(1);
+    source.transact([](auto& tx) { tx.put(root, "a", std::int64_t{1}); });
+    source.transact([](auto& tx) { tx.put(root, "b", std::int64_t{2}); });
+    auto changes = source.get_changes();
+
+    // The second change arrives before the first
+    auto doc = make_doc(2);
+    auto state = SyncState{};
+    doc.receive_sync_message(state, SyncMessage{.heads = source.get_heads(), .need = {},
+                                                .have = {}, .changes = {changes[1]}});
+    EXPECT_EQ(doc.pending_change_count(), 1u);
+    EXPECT_TRUE(doc.get_changes().empty());
+    doc.receive_sync_message(state, SyncMessage{.heads = source.get_heads(), .need = {},
+                                                .have = {}, .changes = {changes[0]}});
+
+    EXPECT_EQ(doc.pending_change_count(), 0u);
+    EXPECT_EQ(doc.get_changes(), changes);
+    EXPECT_EQ(doc.get_heads(), source.get_heads());
+}
+
+TEST(Document, sync_and_apply_changes_share_the_pending_queue) {
+    auto source = make_doc(1);
+    source.transact([](auto& tx) { tx.put(root, "a", std::int64_t{1}); });
+    source.transact([](auto& tx) { tx.put(root, "b", std::int64_t{2}); });
+    auto changes = source.get_changes();
+
+    // Held by apply_changes, then delivered again by sync
+    auto doc = make_doc(2);
+    auto state = SyncState{};
+    doc.apply_changes({changes[1]});
+    doc.receive_sync_message(state, SyncMessage{.heads = source.get_heads(), .need = {},
+                                                .have = {}, .changes = {changes[1]}});
+    EXPECT_EQ(doc.pending_change_count(), 1u);
+    doc.apply_changes({changes[0]});
+
+    EXPECT_EQ(doc.pending_change_count(), 0u);
+    EXPECT_EQ(doc.get_changes(), changes);
+    EXPECT_EQ(doc.get_heads(), source.get_heads());
+}
+
 // =============================================================================
 // Serializer round-trip tests (previously failing patterns)
 // =============================================================================
@@ -4940,6 +6926,80 @@ TEST(Document, insert_range_from_vector) {
     EXPECT_EQ(*doc.get<std::int64_t>(list_id, std::size_t{2}), 30);
 }
 
+TEST(Document, insert_range_matches_single_inserts) {
+    auto values = std::vector<ScalarValue>{
+        ScalarValue{std::int64_t{1}}, ScalarValue{std::int64_t{2}}, ScalarValue{1.5},
+        ScalarValue{2.5}, ScalarValue{std::string{"a"}}, ScalarValue{std::string{"bc"}},
+        ScalarValue{true}, ScalarValue{std::int64_t{3}},
+    };
+    auto build = [&](bool batched) {
+        auto doc = make_doc(1);
+        doc.transact([&](auto& tx) {
+            auto list = tx.put_object(root, "items", ObjType::list);
+            tx.insert(list, 0, std::string{"head"});
+            tx.insert(list, 1, std::string{"tail"});
+            if (batched) {
+                tx.insert_range(list, 1, std::span<const ScalarValue>{values});
+            } else {
+                for (std::size_t i = 0; i < values.size(); ++i) tx.insert(list, 1 + i, values[i]);
+            }
+        });
+        return doc;
+    };
+    auto batched = build(true);
+    auto single = build(false);
+    auto list = *batched.get_obj_id(root, "items");
+    ASSERT_EQ(batched.length(list), values.size() + 2);
+    for (std::size_t i = 0; i < batched.length(list); ++i) {
+        EXPECT_EQ(batched.get(list, i), single.get(list, i)) << "index " << i;
+    }
+
+    // The ops are the same too: the saved documents match and reload
+    EXPECT_EQ(batched.save(), single.save());
+    auto loaded = Document::load(batched.save());
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->get<double>(list, std::size_t{4}), 2.5);
+}
+
+TEST(Document, append_extends_a_list) {
+    auto doc = make_doc(1);
+    auto list_id = ObjId{};
+    doc.transact([&](auto& tx) {
+        list_id = tx.put_object(root, "nums", ObjType::list);
+        tx.insert(list_id, 0, std::int64_t{0});
+        tx.append(list_id, std::vector<ScalarValue>{ScalarValue{std::int64_t{1}},
+                                                    ScalarValue{std::int64_t{2}}});
+        tx.append(list_id, std::vector<std::int64_t>{3, 4});
+    });
+    ASSERT_EQ(doc.length(list_id), 5u);
+    for (std::size_t i = 0; i < 5; ++i) {
+        EXPECT_EQ(*doc.get<std::int64_t>(list_id, i), static_cast<std::int64_t>(i));
+    }
+}
+
+TEST(Document, put_many_overwrites_in_order) {
+    auto doc = make_doc(1);
+    doc.transact([](auto& tx) { tx.put(root, "x", std::int64_t{1}); });
+    auto peer = doc.fork();
+
+    auto entries = std::vector<std::pair<std::string_view, ScalarValue>>{
+        {"x", ScalarValue{std::int64_t{2}}},
+        {"y", ScalarValue{std::string{"first"}}},
+        {"y", ScalarValue{std::string{"second"}}},
+    };
+    doc.transact([&](auto& tx) { tx.put_many(root, entries); });
+    EXPECT_EQ(*doc.get<std::int64_t>(root, "x"), 2);
+    EXPECT_EQ(*doc.get<std::string>(root, "y"), "second");
+    EXPECT_EQ(doc.get_all(root, "x").size(), 1u);
+    EXPECT_EQ(doc.get_all(root, "y").size(), 1u);
+
+    // Each put overwrote its predecessor, so a peer sees no conflicts
+    peer.merge(doc);
+    EXPECT_EQ(*peer.get<std::int64_t>(root, "x"), 2);
+    EXPECT_EQ(peer.get_all(root, "x").size(), 1u);
+    EXPECT_EQ(peer.get_all(root, "y").size(), 1u);
+}
+
 // =============================================================================
 // Phase 12A: Modern C++ API — operator[] and get_path
 // =============================================================================
@@ -8,6 +8,7 @@
 
 #include <cstdint>
 #include <map>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -369,6 +370,65 @@ TEST(JsonExport, counter_as_number) {
     EXPECT_EQ(j["views"], 100);
 }
 
+TEST(JsonDump, matches_export_json_dump) {
+    auto doc = am::Document{};
+    doc.transact([](am::Transaction& tx) {
+        tx.put(am::root, "quote", "say \"hi\"\n\tback\\slash \x01");
+        tx.put(am::root, "int", -7);
+        tx.put(am::root, "uint", std::uint64_t{18446744073709551615ULL});
+        tx.put(am::root, "pi", 3.14);
+        tx.put(am::root, "whole", 1.0);
+        tx.put(am::root, "flag", false);
+        tx.put(am::root, "none", am::Null{});
+        tx.put(am::root, "views", am::Counter{5});
+        tx.put(am::root, "at", am::Timestamp{1234567890});
+        tx.put(am::root, "raw", am::Bytes{std::byte{0xDE}, std::byte{0xAD}});
+        auto list = tx.put_object(am::root, "list", am::ObjType::list);
+        tx.insert(list, 0, "gone");
+        tx.insert(list, 1, 1);
+        auto inner = tx.insert_object(list, 2, am::ObjType::map);
+        tx.put(inner, "k", "v");
+        auto text = tx.insert_object(list, 3, am::ObjType::text);
+        tx.splice_text(text, 0, 0, "héllo");
+        tx.insert_object(list, 4, am::ObjType::list);
+        tx.delete_index(list, 0);
+    });
+    EXPECT_EQ(am::json::dump_json(doc), am::json::export_json(doc).dump());
+    EXPECT_EQ(json::parse(am::json::dump_json(doc)), am::json::export_json(doc));
+}
+
+TEST(JsonDump, subtree_and_missing_object) {
+    auto doc = am::Document{};
+    auto child = doc.transact([](am::Transaction& tx) {
+        auto c = tx.put_object(am::root, "child", am::ObjType::map);
+        tx.put(c, "x", 1);
+        return c;
+    });
+    EXPECT_EQ(am::json::dump_json(doc, child), R"({"x":1})");
+    EXPECT_EQ(am::json::dump_json(am::Document{}), "{}");
+    EXPECT_EQ(am::json::dump_json(doc, am::ObjId{am::OpId{99, am::ActorId{}}}), "null");
+    EXPECT_TRUE(am::json::export_json(doc, am::ObjId{am::OpId{99, am::ActorId{}}}).is_null());
+}
+
+TEST(JsonDump, write_json_streams_large_list) {
+    auto doc = am::Document{};
+    doc.transact([](am::Transaction& tx) {
+        auto list = tx.put_object(am::root, "items", am::ObjType::list);
+        for (std::size_t i = 0; i < 20000; ++i) {
+            tx.insert(list, i, "item-" + std::to_string(i));
+        }
+    });
+    auto out = std::ostringstream{};
+    am::json::write_json(doc, out);
+    EXPECT_GT(out.str().size(), 64u * 1024u);
+    EXPECT_EQ(out.str(), am::json::dump_json(doc));
+
+    auto j = json::parse(out.str());
+    ASSERT_EQ(j["items"].size(), 20000u);
+    EXPECT_EQ(j["items"][19999], "item-19999");
+    EXPECT_EQ(am::json::export_json(doc), j);
+}
+
 TEST(JsonExportAt, historical_export) {
     auto doc = am::Document{};
     doc.transact([](am::Transaction& tx) { tx.put(am::root, "x", 1); });
@@ -478,6 +538,84 @@ TEST(JsonImport, array_of_objects) {
     EXPECT_EQ(output, input);
 }
 
+namespace {
+
+// Imports val op by op through the public Transaction API: the reference the
+// bulk import path must reproduce exactly.
+void import_by_ops(am::Transaction& tx, const am::ObjId& obj, const json& val) {
+    if (val.is_object()) {
+        for (const auto& [k, v] : val.items()) {
+            if (v.is_structured()) {
+                auto child = tx.put_object(obj, k, v.is_object() ? am::ObjType::map : am::ObjType::list);
+                import_by_ops(tx, child, v);
+            } else {
+                auto sv = am::ScalarValue{};
+                am::from_json(v, sv);
+                tx.put(obj, k, sv);
+            }
+        }
+        return;
+    }
+    for (std::size_t i = 0; i < val.size(); ++i) {
+        const auto& v = val[i];
+        if (v.is_structured()) {
+            auto child = tx.insert_object(obj, i, v.is_object() ? am::ObjType::map : am::ObjType::list);
+            import_by_ops(tx, child, v);
+        } else {
+            auto sv = am::ScalarValue{};
+            am::from_json(v, sv);
+            tx.insert(obj, i, sv);
+        }
+    }
+}
+
+}  // namespace
+
+TEST(JsonImport, bulk_import_emits_the_same_change_as_individual_ops) {
+    auto input = json::parse(R"({
+        "name": "seed", "n": -3, "big": 18446744073709551615, "pi": 2.5,
+        "ok": true, "none": null,
+        "rows": [[1, 2, [3]], {"a": {"b": []}}, "x", {}],
+        "cfg": {"z": 1, "a": [true, false]}
+    })");
+    auto actor = am::ActorId{};
+    actor.bytes[0] = std::byte{7};
+
+    auto bulk = am::Document{};
+    bulk.set_actor_id(actor);
+    am::json::import_json(bulk, input);
+
+    auto reference = am::Document{};
+    reference.set_actor_id(actor);
+    reference.transact([&](am::Transaction& tx) { import_by_ops(tx, am::root, input); });
+
+    EXPECT_EQ(am::json::export_json(bulk), input);
+    EXPECT_EQ(bulk.save(), reference.save());
+    EXPECT_EQ(bulk.get_heads(), reference.get_heads());
+}
+
+TEST(JsonImport, bulk_imported_lists_stay_editable_and_mergeable) {
+    auto items = json::array();
+    for (int i = 0; i < 1000; ++i) items.push_back(i);
+    auto doc = am::Document{};
+    am::json::import_json(doc, json{{"items", items}});
+
+    auto loaded = am::Document::load(doc.save());
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(am::json::export_json(*loaded), am::json::export_json(doc));
+
+    auto list = *doc.get_obj_id(am::root, "items");
+    auto peer = doc.fork();
+    doc.transact([&](am::Transaction& tx) { tx.insert(list, 500, "mine"); });
+    peer.transact([&](am::Transaction& tx) { tx.delete_index(list, 0); });
+    doc.merge(peer);
+
+    EXPECT_EQ(doc.length(list), 1000u);
+    EXPECT_EQ(doc.get<std::int64_t>(list, std::size_t{0}), 1);
+    EXPECT_EQ(doc.get<std::string>(list, std::size_t{499}), "mine");
+    EXPECT_EQ(doc.get<std::int64_t>(list, std::size_t{999}), 999);
+}
+
 // =============================================================================
 // JSON Pointer tests (Phase 12D)
 // =============================================================================
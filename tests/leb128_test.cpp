@@ -200,3 +200,33 @@ TEST(Leb128, decode_multiple_uleb128_values_from_stream) {
     ASSERT_TRUE(r3.has_value());
     EXPECT_EQ(r3->value, 300u);
 }
+
+// -- Batch decode -------------------------------------------------------------
+
+TEST(Leb128, decode_uleb128_batch_matches_scalar) {
+    auto values = std::vector<std::uint64_t>{};
+    for (std::uint64_t i = 0; i < 40; ++i) values.push_back(i);        // single-byte run
+    values.insert(values.end(), {300, 5, 1ull << 40, 127, 128, 0});     // mixed widths
+    for (std::uint64_t i = 0; i < 9; ++i) values.push_back(100 - i);
+    values.push_back(std::numeric_limits<std::uint64_t>::max());
+
+    auto bytes = std::vector<std::byte>{};
+    for (auto v : values) encode_uleb128(v, bytes);
+
+    auto out = std::vector<std::uint64_t>(values.size());
+    auto used = decode_uleb128_batch(bytes, out);
+    ASSERT_TRUE(used.has_value());
+    EXPECT_EQ(*used, bytes.size());
+    EXPECT_EQ(out, values);
+}
+
+TEST(Leb128, decode_uleb128_batch_truncated_returns_nullopt) {
+    auto bytes = std::vector<std::byte>{};
+    for (std::uint64_t i = 0; i < 10; ++i) encode_uleb128(i, bytes);
+    auto out = std::vector<std::uint64_t>(11);
+    EXPECT_FALSE(decode_uleb128_batch(bytes, out).has_value());
+
+    bytes.back() |= std::byte{0x80};  // last value never terminates
+    out.resize(10);
+    EXPECT_FALSE(decode_uleb128_batch(bytes, out).has_value());
+}
@@ -0,0 +1,296 @@
+#include "../src/map_table.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace automerge_cpp;
+using automerge_cpp::detail::MapEntry;
+using automerge_cpp::detail::MapTable;
+using automerge_cpp::detail::MapValues;
+using automerge_cpp::detail::StringPool;
+
+namespace {
+
+auto pool() -> StringPool& {
+    static auto strings = StringPool{};
+    return strings;
+}
+
+auto make_actor(std::uint8_t n = 1) -> ActorId {
+    std::uint8_t raw[16] = {};
+    raw[0] = n;
+    return ActorId{raw};
+}
+
+auto entry(std::uint64_t counter, std::uint8_t actor = 1) -> MapEntry {
+    return MapEntry{.op_id = OpId{counter, make_actor(actor)},
+                    .value = Value{ScalarValue{std::int64_t(counter)}}};
+}
+
+auto ids(const MapValues& values) -> std::vector<std::uint64_t> {
+    auto result = std::vector<std::uint64_t>{};
+    values.for_each([&](const MapEntry& e) { result.push_back(e.op_id.counter); });
+    return result;
+}
+
+auto sorted_keys(const MapTable& table) -> std::vector<std::string> {
+    auto result = std::vector<std::string>{};
+    table.for_each_sorted([&](std::string_view key, const MapValues&) { result.emplace_back(key); });
+    return result;
+}
+
+}  // namespace
+
+TEST(StringPool, interning_returns_one_symbol_per_string) {
+    auto strings = StringPool{};
+    auto a = strings.intern("description");
+    auto b = strings.intern(std::string{"descrip"} + "tion");
+    auto c = strings.intern("created_at_utc");
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a.view().data(), b.view().data());
+    EXPECT_FALSE(a == c);
+    EXPECT_EQ(a.view(), "description");
+    EXPECT_EQ(c.view(), "created_at_utc");
+    EXPECT_EQ(strings.size(), 2u);
+}
+
+TEST(StringPool, short_strings_are_stored_in_the_symbol) {
+    auto strings = StringPool{};
+    auto a = strings.intern("status");
+    auto b = strings.intern("status");
+    auto c = strings.intern("statu");
+    EXPECT_EQ(a, b);
+    EXPECT_FALSE(a == c);
+    EXPECT_EQ(a.view(), "status");
+    EXPECT_EQ(strings.intern("1234567").view(), "1234567");
+    EXPECT_EQ(strings.size(), 0u);
+    EXPECT_EQ(detail::Symbol{}.view(), "");
+    EXPECT_EQ(strings.intern(""), detail::Symbol{});
+    EXPECT_FALSE(strings.intern("12345678") == strings.intern("1234567"));
+    EXPECT_EQ(strings.size(), 1u);
+}
+
+TEST(StringPool, long_strings_survive_many_inserts) {
+    auto strings = StringPool{};
+    auto symbols = std::vector<detail::Symbol>{};
+    for (int i = 0; i < 5000; ++i) {
+        symbols.push_back(strings.intern("long_key_" + std::to_string(i)));
+    }
+    symbols.push_back(strings.intern(std::string(10'000, 'x')));
+    for (int i = 0; i < 5000; ++i) {
+        EXPECT_EQ(symbols[i].view(), "long_key_" + std::to_string(i));
+        EXPECT_EQ(strings.intern("long_key_" + std::to_string(i)), symbols[i]);
+    }
+    EXPECT_EQ(symbols.back().view(), std::string(10'000, 'x'));
+    EXPECT_EQ(strings.size(), 5001u);
+}
+
+TEST(MapTable, tables_share_interned_keys) {
+    auto strings = StringPool{};
+    auto rows = std::vector<MapTable>(100);
+    for (auto& row : rows) {
+        row.assign("identifier", entry(1), strings);
+        row.assign("display_name", entry(2), strings);
+    }
+    EXPECT_EQ(strings.size(), 2u);
+    auto first = std::string_view{};
+    rows[0].for_each([&](std::string_view key, const MapValues&) {
+        if (key == "identifier") first = key;
+    });
+    rows[99].for_each([&](std::string_view key, const MapValues&) {
+        if (key == "identifier") {
+            EXPECT_EQ(key.data(), first.data());
+        }
+    });
+}
+
+TEST(MapTable, empty_table_finds_nothing) {
+    auto table = MapTable{};
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(table.find("a"), nullptr);
+    EXPECT_FALSE(table.remove("a", {}));
+    table.erase("a");
+    EXPECT_EQ(table.size(), 0u);
+}
+
+TEST(MapTable, assign_replaces_all_values) {
+    auto table = MapTable{};
+    table.assign("k", entry(1), pool());
+    table.put("k", {}, entry(2, 2), pool());
+    ASSERT_TRUE(table.find("k")->conflicted());
+
+    table.assign("k", entry(3), pool());
+    const auto* values = table.find("k");
+    ASSERT_NE(values, nullptr);
+    EXPECT_FALSE(values->conflicted());
+    EXPECT_EQ(values->winner().op_id.counter, 3u);
+    EXPECT_EQ(table.size(), 1u);
+}
+
+TEST(MapTable, concurrent_puts_keep_highest_op_as_winner) {
+    auto table = MapTable{};
+    table.put("k", {}, entry(5, 1), pool());
+    table.put("k", {}, entry(3, 2), pool());
+    table.put("k", {}, entry(7, 3), pool());
+
+    const auto* values = table.find("k");
+    ASSERT_NE(values, nullptr);
+    EXPECT_EQ(values->winner().op_id.counter, 7u);
+    EXPECT_EQ(values->size(), 3u);
+    EXPECT_EQ(ids(*values), (std::vector<std::uint64_t>{3, 5, 7}));
+}
+
+TEST(MapTable, put_removes_predecessors) {
+    auto table = MapTable{};
+    table.put("k", {}, entry(1, 1), pool());
+    table.put("k", {}, entry(2, 2), pool());
+
+    const auto pred = std::vector<OpId>{entry(1, 1).op_id, entry(2, 2).op_id};
+    const auto& values = table.put("k", pred, entry(3, 1), pool());
+    EXPECT_FALSE(values.conflicted());
+    EXPECT_EQ(ids(values), (std::vector<std::uint64_t>{3}));
+}
+
+TEST(MapTable, removing_the_winner_promotes_the_next_highest) {
+    auto table = MapTable{};
+    table.put("k", {}, entry(1, 1), pool());
+    table.put("k", {}, entry(2, 2), pool());
+    table.put("k", {}, entry(3, 3), pool());
+
+    const auto pred = std::vector<OpId>{entry(3, 3).op_id};
+    EXPECT_TRUE(table.remove("k", pred));
+    const auto* values = table.find("k");
+    ASSERT_NE(values, nullptr);
+    EXPECT_EQ(values->winner().op_id.counter, 2u);
+    EXPECT_EQ(ids(*values), (std::vector<std::uint64_t>{1, 2}));
+}
+
+TEST(MapTable, removing_every_value_erases_the_key) {
+    auto table = MapTable{};
+    table.put("k", {}, entry(1, 1), pool());
+    table.put("k", {}, entry(2, 2), pool());
+
+    const auto pred = std::vector<OpId>{entry(1, 1).op_id, entry(2, 2).op_id};
+    EXPECT_TRUE(table.remove("k", pred));
+    EXPECT_EQ(table.find("k"), nullptr);
+    EXPECT_TRUE(table.empty());
+}
+
+TEST(MapTable, sorted_iteration_orders_keys) {
+    auto table = MapTable{};
+    for (const auto* key : {"pear", "apple", "fig", "banana"}) {
+        table.assign(key, entry(1), pool());
+    }
+    EXPECT_EQ(sorted_keys(table),
+              (std::vector<std::string>{"apple", "banana", "fig", "pear"}));
+}
+
+TEST(MapTable, sorted_iteration_orders_keys_with_shared_prefixes) {
+    auto table = MapTable{};
+    auto keys = std::vector<std::string>{
+        "", "a", "prefix", "prefix_l", "prefix_long_a", "prefix_long_b", "prefix_lo",
+        std::string{"prefix\0", 7}, "\xff", "prefix_long_a_more"};
+    for (const auto& key : keys) table.assign(key, entry(1), pool());
+    std::ranges::sort(keys);
+    EXPECT_EQ(sorted_keys(table), keys);
+}
+
+TEST(MapTable, copies_are_independent) {
+    auto table = MapTable{};
+    table.put("k", {}, entry(1, 1), pool());
+    table.put("k", {}, entry(2, 2), pool());
+
+    auto copy = table;
+    copy.assign("k", entry(9), pool());
+    copy.assign("other", entry(4), pool());
+
+    EXPECT_EQ(ids(*table.find("k")), (std::vector<std::uint64_t>{1, 2}));
+    EXPECT_EQ(table.find("other"), nullptr);
+    EXPECT_EQ(ids(*copy.find("k")), (std::vector<std::uint64_t>{9}));
+}
+
+TEST(MapTable, copies_taken_while_growing_keep_their_contents) {
+    // Copies share entries until written; writes after the copy go to
+    // whichever side made them.
+    auto table = MapTable{};
+    auto model = std::map<std::string, std::uint64_t>{};
+    auto copies = std::vector<std::pair<MapTable, std::map<std::string, std::uint64_t>>>{};
+    auto rng = std::mt19937{3};
+
+    for (std::uint64_t op = 1; op <= 5'000; ++op) {
+        if (op % 500 == 0) copies.emplace_back(table, model);
+        auto key = "key" + std::to_string(rng() % 300);
+        if (rng() % 4 == 0) {
+            table.erase(key);
+            model.erase(key);
+        } else {
+            table.assign(key, entry(op), pool());
+            model[key] = op;
+        }
+    }
+    for (auto& [copy, expected] : copies) {
+        copy.assign("key0", entry(9'999), pool());
+        expected["key0"] = 9'999;
+    }
+    copies.emplace_back(std::move(table), std::move(model));
+
+    for (const auto& [copy, expected] : copies) {
+        ASSERT_EQ(copy.size(), expected.size());
+        for (const auto& [key, op] : expected) {
+            const auto* values = copy.find(key);
+            ASSERT_NE(values, nullptr) << key;
+            EXPECT_EQ(values->winner().op_id.counter, op) << key;
+        }
+    }
+}
+
+TEST(MapTable, memory_usage_counts_conflicts_and_long_strings) {
+    auto table = MapTable{};
+    table.put("k", {}, entry(1, 1), pool());
+    auto single = table.memory_usage();
+    EXPECT_GT(single, 0u);
+
+    table.put("k", {}, entry(2, 2), pool());
+    auto conflicted = table.memory_usage();
+    EXPECT_GT(conflicted, single);
+
+    table.assign("s", MapEntry{.op_id = OpId{3, make_actor()},
+                               .value = ScalarValue{std::string(100, 'x')}}, pool());
+    EXPECT_GE(table.memory_usage(), conflicted + 100);
+}
+
+TEST(MapTable, random_operations_match_std_map) {
+    auto table = MapTable{};
+    auto model = std::map<std::string, std::uint64_t>{};
+    auto rng = std::mt19937{42};
+
+    for (std::uint64_t op = 1; op <= 20'000; ++op) {
+        auto key = "key" + std::to_string(rng() % 500);
+        if (rng() % 3 == 0) {
+            table.erase(key);
+            model.erase(key);
+        } else {
+            table.assign(key, entry(op), pool());
+            model[key] = op;
+        }
+    }
+
+    ASSERT_EQ(table.size(), model.size());
+    for (const auto& [key, op] : model) {
+        const auto* values = table.find(key);
+        ASSERT_NE(values, nullptr) << key;
+        EXPECT_EQ(values->winner().op_id.counter, op);
+    }
+    auto keys = std::vector<std::string>{};
+    for (const auto& [key, op] : model) keys.push_back(key);
+    EXPECT_EQ(sorted_keys(table), keys);
+    for (int i = 0; i < 500; ++i) {
+        auto key = "key" + std::to_string(i);
+        EXPECT_EQ(table.find(key) != nullptr, model.contains(key)) << key;
+    }
+}
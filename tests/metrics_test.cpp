@@ -0,0 +1,106 @@
+#include <automerge-cpp/document.hpp>
+#include <automerge-cpp/metrics.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <numeric>
+#include <string>
+
+using namespace automerge_cpp;
+
+namespace {
+
+auto make_doc(std::uint8_t actor_byte) -> Document {
+    auto doc = Document{};
+    std::uint8_t raw[16] = {};
+    raw[0] = actor_byte;
+    doc.set_actor_id(ActorId{raw});
+    return doc;
+}
+
+// Some of every phase: edits, save, load, a sync round trip.
+void exercise() {
+    auto doc1 = make_doc(1);
+    doc1.transact([](auto& tx) {
+        auto text = tx.put_object(root, "text", ObjType::text);
+        tx.splice_text(text, 0, 0, std::string(4096, 'x'));  // big enough to deflate
+    });
+    auto loaded = Document::load(doc1.save());
+    ASSERT_TRUE(loaded.has_value());
+
+    auto doc2 = make_doc(2);
+    auto s1 = SyncState{};
+    auto s2 = SyncState{};
+    for (int round = 0; round < 10; ++round) {
+        auto progress = false;
+        if (auto m = doc1.generate_sync_message(s1)) {
+            doc2.receive_sync_message(s2, *m);
+            progress = true;
+        }
+        if (auto m = doc2.generate_sync_message(s2)) {
+            doc1.receive_sync_message(s1, *m);
+            progress = true;
+        }
+        if (!progress) break;
+    }
+    EXPECT_EQ(doc2.get_heads(), doc1.get_heads());
+}
+
+}  // namespace
+
+TEST(Metrics, phase_names) {
+    EXPECT_EQ(metrics::to_string_view(metrics::Phase::apply_op), "apply_op");
+    EXPECT_EQ(metrics::to_string_view(metrics::Phase::write_lock_wait), "write_lock_wait");
+    EXPECT_EQ(metrics::to_string_view(metrics::Phase::read_lock_hold), "read_lock_hold");
+}
+
+TEST(Metrics, records_phases_when_enabled) {
+    metrics::reset();
+    exercise();
+    auto snapshot = metrics::snapshot();
+
+    if constexpr (!metrics::enabled) {
+        for (const auto& phase : snapshot.phases) EXPECT_EQ(phase.count, 0u);
+        return;
+    }
+    for (auto phase : {metrics::Phase::apply_op, metrics::Phase::hash_changes,
+                       metrics::Phase::bloom_build, metrics::Phase::column_encode,
+                       metrics::Phase::column_decode, metrics::Phase::deflate,
+                       metrics::Phase::inflate, metrics::Phase::transaction_commit,
+                       metrics::Phase::save, metrics::Phase::load,
+                       metrics::Phase::sync_generate, metrics::Phase::sync_receive,
+                       metrics::Phase::write_lock_wait, metrics::Phase::write_lock_hold,
+                       metrics::Phase::read_lock_wait, metrics::Phase::read_lock_hold}) {
+        const auto& stats = snapshot[phase];
+        EXPECT_GT(stats.count, 0u) << metrics::to_string_view(phase);
+        EXPECT_GE(stats.total_ns, stats.max_ns) << metrics::to_string_view(phase);
+        EXPECT_EQ(std::accumulate(stats.histogram.begin(), stats.histogram.end(), std::uint64_t{0}),
+                  stats.count) << metrics::to_string_view(phase);
+    }
+    // Every wait is paired with a hold
+    EXPECT_EQ(snapshot[metrics::Phase::write_lock_wait].count,
+              snapshot[metrics::Phase::write_lock_hold].count);
+
+    metrics::reset();
+    EXPECT_EQ(metrics::snapshot()[metrics::Phase::save].count, 0u);
+}
+
+TEST(Metrics, sink_sees_every_event) {
+    auto events = std::atomic<std::uint64_t>{0};
+    metrics::reset();
+    metrics::set_sink([&](metrics::Phase, std::uint64_t) { ++events; });
+    exercise();
+    metrics::set_sink(nullptr);
+    auto snapshot = metrics::snapshot();
+
+    auto recorded = std::uint64_t{0};
+    for (const auto& phase : snapshot.phases) recorded += phase.count;
+    EXPECT_EQ(events.load(), recorded);
+    EXPECT_EQ(recorded > 0, metrics::enabled);
+
+    auto after = events.load();
+    exercise();
+    EXPECT_EQ(events.load(), after);  // removed
+}
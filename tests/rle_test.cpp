@@ -1224,3 +1224,51 @@ TEST(RleEncoder, int64_single_delta_null_delta) {
     auto v2 = dec.next(); ASSERT_TRUE(v2.has_value() && v2->has_value()); EXPECT_EQ(**v2, 1);
     EXPECT_FALSE(dec.next().has_value());
 }
+
+// -- Bulk decode --------------------------------------------------------------
+
+TEST(RleDecoder, next_n_matches_next) {
+    auto enc = RleEncoder<std::uint64_t>{};
+    for (int i = 0; i < 100; ++i) enc.append(7);                                  // run
+    for (std::uint64_t i = 0; i < 150; ++i) enc.append(i * 3);                    // literals
+    for (int i = 0; i < 20; ++i) enc.append_null();                               // null run
+    for (std::uint64_t i = 0; i < 5; ++i) enc.append(1000 + i);
+    enc.finish();
+
+    auto expected = std::vector<std::optional<std::uint64_t>>{};
+    auto one = RleDecoder<std::uint64_t>{enc.data()};
+    while (auto v = one.next()) expected.push_back(*v);
+    ASSERT_EQ(expected.size(), 275u);
+
+    // Odd chunk size so chunks straddle run boundaries
+    auto bulk = RleDecoder<std::uint64_t>{enc.data()};
+    auto actual = std::vector<std::optional<std::uint64_t>>{};
+    auto chunk = std::vector<std::optional<std::uint64_t>>(37);
+    while (true) {
+        auto n = bulk.next_n(chunk);
+        ASSERT_TRUE(n.has_value());
+        actual.insert(actual.end(), chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(*n));
+        if (*n < chunk.size()) break;
+    }
+    EXPECT_EQ(actual, expected);
+    EXPECT_TRUE(bulk.done());
+}
+
+TEST(RleDecoder, next_n_strings_and_truncation) {
+    auto enc = RleEncoder<std::string>{};
+    enc.append("a");
+    enc.append("a");
+    enc.append("b");
+    enc.append_null();
+    enc.finish();
+
+    auto dec = RleDecoder<std::string>{enc.data()};
+    auto out = std::vector<std::optional<std::string>>(4);
+    EXPECT_EQ(dec.next_n(out), 4u);
+    EXPECT_EQ(out, (std::vector<std::optional<std::string>>{"a", "a", "b", std::nullopt}));
+
+    auto truncated = enc.data();
+    truncated.pop_back();
+    auto bad = RleDecoder<std::string>{truncated};
+    EXPECT_FALSE(bad.next_n(out).has_value());
+}
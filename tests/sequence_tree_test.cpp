@@ -0,0 +1,449 @@
+#include "../src/sequence_tree.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+using namespace automerge_cpp;
+using automerge_cpp::detail::ListElement;
+using automerge_cpp::detail::SequenceTree;
+
+namespace {
+
+auto make_actor() -> ActorId {
+    constexpr std::uint8_t raw[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    return ActorId{raw};
+}
+
+auto elem(std::uint64_t counter) -> ListElement {
+    return ListElement{
+        .insert_id = OpId{counter, make_actor()},
+        .insert_after = std::nullopt,
+        .value = Value{ScalarValue{std::int64_t(counter)}},
+        .visible = true,
+    };
+}
+
+// A text element typed by `actor` right after `origin`.
+auto text_elem(std::uint64_t counter, std::optional<std::uint64_t> origin, char ch,
+               ActorId actor = make_actor()) -> ListElement {
+    return ListElement{
+        .insert_id = OpId{counter, actor},
+        .insert_after = origin ? std::optional{OpId{*origin, actor}} : std::nullopt,
+        .value = Value{ScalarValue{std::string(1, ch)}},
+        .visible = true,
+    };
+}
+
+// Type `text` as one chain of elements with counters starting at `first`.
+auto typed(const std::string& text, std::uint64_t first = 1) -> SequenceTree {
+    auto tree = SequenceTree{};
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        auto origin = i == 0 ? std::nullopt : std::optional{first + i - 1};
+        tree.push_back(text_elem(first + i, origin, text[i]));
+    }
+    return tree;
+}
+
+auto visible_text(const SequenceTree& tree) -> std::string {
+    auto out = std::string{};
+    tree.append_visible_text(out);
+    return out;
+}
+
+auto counters(const SequenceTree& tree) -> std::vector<std::uint64_t> {
+    auto result = std::vector<std::uint64_t>{};
+    for (const auto& e : tree) result.push_back(e.insert_id.counter);
+    return result;
+}
+
+}  // namespace
+
+// -- Basic structure -----------------------------------------------------------
+
+TEST(SequenceTree, empty_tree) {
+    auto tree = SequenceTree{};
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(tree.size(), 0u);
+    EXPECT_EQ(tree.visible_size(), 0u);
+    EXPECT_EQ(tree.find_visible(0), 0u);
+    EXPECT_EQ(tree.begin(), tree.end());
+}
+
+TEST(SequenceTree, append_keeps_order_across_splits) {
+    auto tree = SequenceTree{};
+    for (std::uint64_t i = 0; i < 5000; ++i) tree.push_back(elem(i));
+
+    ASSERT_EQ(tree.size(), 5000u);
+    EXPECT_EQ(tree.visible_size(), 5000u);
+    auto seen = counters(tree);
+    ASSERT_EQ(seen.size(), 5000u);
+    for (std::uint64_t i = 0; i < 5000; ++i) EXPECT_EQ(seen[i], i);
+    EXPECT_EQ(tree.at(4321).insert_id.counter, 4321u);
+}
+
+TEST(SequenceTree, insert_front_and_middle_matches_vector) {
+    auto tree = SequenceTree{};
+    auto model = std::vector<std::uint64_t>{};
+    for (std::uint64_t i = 0; i < 3000; ++i) {
+        auto pos = static_cast<std::size_t>((i * 7919) % (model.size() + 1));
+        tree.insert(pos, elem(i));
+        model.insert(model.begin() + static_cast<std::ptrdiff_t>(pos), i);
+    }
+    EXPECT_EQ(counters(tree), model);
+    for (std::size_t i = 0; i < model.size(); i += 97) {
+        EXPECT_EQ(tree.at(i).insert_id.counter, model[i]);
+    }
+}
+
+// -- Visible counts ------------------------------------------------------------
+
+TEST(SequenceTree, find_visible_skips_tombstones) {
+    auto tree = SequenceTree{};
+    for (std::uint64_t i = 0; i < 1000; ++i) tree.push_back(elem(i));
+    // Hide every even element
+    for (std::size_t i = 0; i < 1000; i += 2) tree.set_visible(i, false);
+
+    EXPECT_EQ(tree.size(), 1000u);
+    EXPECT_EQ(tree.visible_size(), 500u);
+    for (std::size_t k = 0; k < 500; ++k) {
+        EXPECT_EQ(tree.find_visible(k), 2 * k + 1);
+    }
+    EXPECT_EQ(tree.find_visible(500), 1000u);  // past the end
+}
+
+TEST(SequenceTree, visible_rank_counts_visible_before_position) {
+    auto tree = SequenceTree{};
+    for (std::uint64_t i = 0; i < 1000; ++i) tree.push_back(elem(i));
+    for (std::size_t i = 0; i < 1000; i += 3) tree.set_visible(i, false);
+
+    auto expected = std::size_t{0};
+    for (std::size_t pos = 0; pos <= 1000; ++pos) {
+        EXPECT_EQ(tree.visible_rank(pos), expected) << "at pos=" << pos;
+        if (pos < 1000 && tree.at(pos).visible) ++expected;
+    }
+}
+
+TEST(SequenceTree, set_visible_is_idempotent) {
+    auto tree = SequenceTree{};
+    tree.push_back(elem(1));
+    tree.set_visible(0, false);
+    tree.set_visible(0, false);
+    EXPECT_EQ(tree.visible_size(), 0u);
+    tree.set_visible(0, true);
+    EXPECT_EQ(tree.visible_size(), 1u);
+}
+
+TEST(SequenceTree, position_of_round_trips_iterator_at) {
+    auto tree = SequenceTree{};
+    for (std::uint64_t i = 0; i < 2000; ++i) tree.insert(i / 2, elem(i));
+    for (std::size_t pos = 0; pos < tree.size(); pos += 37) {
+        EXPECT_EQ(tree.position_of(tree.iterator_at(pos)), pos);
+    }
+    EXPECT_EQ(tree.position_of(tree.end()), tree.size());
+}
+
+// -- Element index -------------------------------------------------------------
+
+TEST(SequenceTree, find_by_insert_id_after_splits) {
+    auto tree = SequenceTree{};
+    for (std::uint64_t i = 0; i < 3000; ++i) tree.insert(0, elem(i));  // reversed
+
+    for (std::uint64_t i = 0; i < 3000; i += 13) {
+        auto pos = tree.find(OpId{i, make_actor()});
+        ASSERT_TRUE(pos.has_value()) << "counter=" << i;
+        EXPECT_EQ(*pos, 2999u - i);
+        EXPECT_TRUE(tree.contains(OpId{i, make_actor()}));
+    }
+    EXPECT_FALSE(tree.find(OpId{5000, make_actor()}).has_value());
+    EXPECT_EQ(tree.find_iterator(OpId{5000, make_actor()}), tree.end());
+}
+
+TEST(SequenceTree, copy_rebuilds_element_index) {
+    auto tree = SequenceTree{};
+    for (std::uint64_t i = 0; i < 300; ++i) tree.push_back(elem(i));
+    auto copy = tree;
+    copy.insert(0, elem(1000));
+
+    EXPECT_EQ(tree.find(OpId{150, make_actor()}), std::optional<std::size_t>{150});
+    EXPECT_EQ(copy.find(OpId{150, make_actor()}), std::optional<std::size_t>{151});
+    EXPECT_FALSE(tree.contains(OpId{1000, make_actor()}));
+}
+
+// -- Text runs -----------------------------------------------------------------
+
+TEST(SequenceTree, typing_forms_a_single_run) {
+    auto text = std::string(2000, 'x');
+    for (std::size_t i = 0; i < text.size(); ++i) text[i] = static_cast<char>('a' + i % 26);
+    auto tree = typed(text);
+
+    EXPECT_EQ(tree.size(), 2000u);
+    EXPECT_EQ(tree.run_count(), 1u);
+    EXPECT_EQ(visible_text(tree), text);
+
+    auto mid = tree.at(1234);
+    EXPECT_EQ(mid.insert_id.counter, 1235u);
+    ASSERT_TRUE(mid.insert_after.has_value());
+    EXPECT_EQ(mid.insert_after->counter, 1234u);
+    EXPECT_EQ(std::get<std::string>(std::get<ScalarValue>(mid.value)), std::string(1, text[1234]));
+    EXPECT_EQ(tree.find(OpId{1235, make_actor()}), std::optional<std::size_t>{1234});
+}
+
+TEST(SequenceTree, delete_inside_run_splits_and_undo_remerges) {
+    auto tree = typed("hello world");
+    tree.set_visible(4, false);
+
+    EXPECT_EQ(visible_text(tree), "hell world");
+    EXPECT_EQ(tree.visible_size(), 10u);
+    EXPECT_EQ(tree.run_count(), 3u);
+    EXPECT_FALSE(tree.at(4).visible);
+    EXPECT_EQ(tree.find_visible(4), 5u);
+
+    tree.set_visible(4, true);
+    EXPECT_EQ(visible_text(tree), "hello world");
+    EXPECT_EQ(tree.run_count(), 1u);
+}
+
+TEST(SequenceTree, consecutive_deletes_share_a_tombstone_run) {
+    auto tree = typed("abcdefgh");
+    for (std::size_t i = 2; i < 6; ++i) tree.set_visible(i, false);
+
+    EXPECT_EQ(visible_text(tree), "abgh");
+    EXPECT_EQ(tree.run_count(), 3u);
+}
+
+TEST(SequenceTree, concurrent_insert_splits_run) {
+    constexpr std::uint8_t other_raw[16] = {9};
+    auto tree = typed("abcdef");
+    // Another actor inserts after 'c' (counter 3)
+    tree.insert(3, ListElement{
+        .insert_id = OpId{100, ActorId{other_raw}},
+        .insert_after = OpId{3, make_actor()},
+        .value = Value{ScalarValue{std::string{"X"}}},
+        .visible = true,
+    });
+
+    EXPECT_EQ(visible_text(tree), "abcXdef");
+    EXPECT_EQ(tree.run_count(), 3u);
+    EXPECT_EQ(tree.find(OpId{4, make_actor()}), std::optional<std::size_t>{4});
+    auto d = tree.at(4);
+    ASSERT_TRUE(d.insert_after.has_value());
+    EXPECT_EQ(d.insert_after->counter, 3u);  // origin survives the split
+}
+
+TEST(SequenceTree, set_value_inside_run) {
+    auto tree = typed("abc");
+    tree.set_value(1, Value{ScalarValue{std::string{"B"}}});
+    EXPECT_EQ(visible_text(tree), "aBc");
+    EXPECT_EQ(tree.run_count(), 1u);
+
+    tree.set_value(1, Value{ScalarValue{std::int64_t{7}}});
+    EXPECT_EQ(visible_text(tree), "ac");
+    EXPECT_EQ(tree.run_count(), 3u);
+    EXPECT_EQ(std::get<std::int64_t>(std::get<ScalarValue>(tree.at(1).value)), 7);
+}
+
+TEST(SequenceTree, multi_byte_values_are_not_run_encoded) {
+    auto tree = SequenceTree{};
+    tree.push_back(ListElement{.insert_id = OpId{1, make_actor()}, .insert_after = std::nullopt,
+                               .value = Value{ScalarValue{std::string{"ab"}}}, .visible = true});
+    tree.push_back(text_elem(2, 1, 'c'));
+    EXPECT_EQ(tree.run_count(), 2u);
+    EXPECT_EQ(visible_text(tree), "abc");
+}
+
+TEST(SequenceTree, number_chains_are_packed) {
+    auto tree = SequenceTree{};
+    for (std::uint64_t i = 1; i <= 300; ++i) {
+        auto origin = i == 1 ? std::nullopt : std::optional{OpId{i - 1, make_actor()}};
+        tree.push_back(ListElement{.insert_id = OpId{i, make_actor()}, .insert_after = origin,
+                                   .value = Value{ScalarValue{i * 0.5}}, .visible = true});
+    }
+    EXPECT_EQ(tree.run_count(), 1u);
+    EXPECT_EQ(tree.begin().run_numbers<double>().size(), 300u);
+    EXPECT_TRUE(tree.begin().run_numbers<std::int64_t>().empty());
+    EXPECT_EQ(std::get<double>(std::get<ScalarValue>(tree.at(199).value)), 100.0);
+
+    // Same-type edits stay in place; anything else splits the run
+    tree.set_value(10, Value{ScalarValue{-1.0}});
+    EXPECT_EQ(tree.run_count(), 1u);
+    EXPECT_EQ(tree.iterator_at(10).run_numbers<double>().front(), -1.0);
+    tree.set_visible(100, false);
+    EXPECT_EQ(tree.run_count(), 3u);
+    tree.set_value(200, Value{ScalarValue{std::int64_t{7}}});
+    EXPECT_EQ(tree.run_count(), 5u);
+    EXPECT_EQ(tree.iterator_at(101).run_numbers<double>().size(), 99u);
+    EXPECT_EQ(std::get<std::int64_t>(std::get<ScalarValue>(tree.at(200).value)), 7);
+    EXPECT_EQ(std::get<double>(std::get<ScalarValue>(tree.at(201).value)), 101.0);
+    EXPECT_EQ(tree.find(OpId{250, make_actor()}), std::optional<std::size_t>{249});
+
+    tree.set_visible(100, true);
+    EXPECT_EQ(tree.run_count(), 3u);
+}
+
+TEST(SequenceTree, insert_values_packs_each_kind) {
+    auto tree = SequenceTree{};
+    tree.push_back(elem(1));
+    tree.push_back(elem(2));
+    auto values = std::vector<Value>{};
+    for (auto i = 0; i < 4; ++i) values.push_back(Value{ScalarValue{std::int64_t{i}}});
+    for (auto i = 0; i < 3; ++i) values.push_back(Value{ScalarValue{i * 0.5}});
+    values.push_back(Value{ScalarValue{std::string{"a"}}});
+    values.push_back(Value{ScalarValue{std::string{"b"}}});
+    values.push_back(Value{ScalarValue{true}});
+    values.push_back(Value{ScalarValue{std::int64_t{9}}});
+    tree.insert_values(1, OpId{10, make_actor()}, OpId{1, make_actor()}, values);
+
+    // elem 1, then integer, real and text runs, the bool, the lone int, elem 2
+    EXPECT_EQ(tree.size(), 13u);
+    EXPECT_EQ(tree.run_count(), 7u);
+    EXPECT_EQ(tree.iterator_at(1).run_numbers<std::int64_t>().size(), 4u);
+    EXPECT_EQ(tree.iterator_at(5).run_numbers<double>().size(), 3u);
+    EXPECT_EQ(tree.iterator_at(8).run_text(), "ab");
+    EXPECT_EQ(counters(tree), (std::vector<std::uint64_t>{1, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+                                                         19, 20, 2}));
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        auto e = tree.at(1 + i);
+        EXPECT_EQ(e.value, values[i]);
+        EXPECT_EQ(e.insert_after, (OpId{i == 0 ? 1 : 9 + i, make_actor()}));
+    }
+}
+
+TEST(SequenceTree, memory_usage_tracks_runs) {
+    auto runs = SequenceTree{};
+    for (auto i = std::uint64_t{1}; i <= 500; ++i) runs.push_back(elem(i));
+    auto text = typed(std::string(500, 'x'));
+    EXPECT_EQ(text.run_count(), 1u);
+    EXPECT_GT(runs.memory_usage(), text.memory_usage());
+    EXPECT_GT(text.memory_usage(), SequenceTree{}.memory_usage());
+}
+
+// -- Value semantics -----------------------------------------------------------
+
+TEST(SequenceTree, copy_is_independent) {
+    auto tree = SequenceTree{};
+    for (std::uint64_t i = 0; i < 500; ++i) tree.push_back(elem(i));
+
+    auto copy = tree;
+    copy.insert(0, elem(9999));
+    copy.set_visible(10, false);
+
+    EXPECT_EQ(tree.size(), 500u);
+    EXPECT_EQ(tree.visible_size(), 500u);
+    EXPECT_EQ(tree.at(0).insert_id.counter, 0u);
+    EXPECT_EQ(copy.size(), 501u);
+    EXPECT_EQ(copy.visible_size(), 500u);
+    EXPECT_EQ(copy.at(0).insert_id.counter, 9999u);
+    EXPECT_EQ(counters(copy).size(), 501u);
+}
+
+TEST(SequenceTree, interleaved_copies_stay_independent) {
+    // Copies share nodes; each write must copy only what it changes, and
+    // never touch what an earlier copy still sees. Enough elements to
+    // split leaves and grow the tree while copies are held.
+    struct Copy {
+        SequenceTree tree;
+        std::vector<std::uint64_t> ids;
+        std::vector<bool> visible;
+    };
+    auto rng = std::mt19937{7};
+    auto tree = SequenceTree{};
+    auto ids = std::vector<std::uint64_t>{};
+    auto visible = std::vector<bool>{};
+    auto copies = std::vector<Copy>{};
+
+    for (std::uint64_t op = 1; op <= 30'000; ++op) {
+        if (op % 1000 == 0) copies.push_back({tree, ids, visible});
+        if (!ids.empty() && rng() % 5 == 0) {
+            const auto pos = rng() % ids.size();
+            tree.set_visible(pos, false);
+            visible[pos] = false;
+        } else {
+            const auto pos = rng() % (ids.size() + 1);
+            tree.insert(pos, elem(op));
+            ids.insert(ids.begin() + static_cast<std::ptrdiff_t>(pos), op);
+            visible.insert(visible.begin() + static_cast<std::ptrdiff_t>(pos), true);
+        }
+    }
+    // Now write to every copy; the original and the other copies must not move
+    for (std::size_t c = 0; c < copies.size(); ++c) {
+        auto& copy = copies[c];
+        copy.tree.insert(0, elem(100'000 + c));
+        copy.ids.insert(copy.ids.begin(), 100'000 + c);
+        copy.visible.insert(copy.visible.begin(), true);
+        if (copy.ids.size() > 1) {
+            copy.tree.set_visible(copy.ids.size() - 1, false);
+            copy.visible.back() = false;
+        }
+    }
+    copies.push_back({std::move(tree), std::move(ids), std::move(visible)});
+
+    for (const auto& copy : copies) {
+        ASSERT_EQ(counters(copy.tree), copy.ids);
+        auto pos = std::size_t{0};
+        for (const auto& e : copy.tree) {
+            EXPECT_EQ(e.visible, copy.visible[pos]) << pos;
+            ++pos;
+        }
+        for (std::size_t i = 0; i < copy.ids.size(); i += 97) {
+            EXPECT_EQ(copy.tree.find(OpId{copy.ids[i], make_actor()}), i);
+        }
+    }
+}
+
+TEST(SequenceTree, copy_preserves_text_runs) {
+    auto tree = typed(std::string(500, 'q'));
+    auto copy = tree;
+    copy.set_visible(250, false);
+
+    EXPECT_EQ(tree.run_count(), 1u);
+    EXPECT_EQ(copy.run_count(), 3u);
+    EXPECT_EQ(copy.find(OpId{400, make_actor()}), std::optional<std::size_t>{399});
+    EXPECT_EQ(visible_text(tree).size(), 500u);
+    EXPECT_EQ(visible_text(copy).size(), 499u);
+}
+
+TEST(SequenceTree, move_leaves_source_empty) {
+    auto tree = SequenceTree{};
+    for (std::uint64_t i = 0; i < 100; ++i) tree.push_back(elem(i));
+
+    auto moved = std::move(tree);
+    EXPECT_EQ(moved.size(), 100u);
+    EXPECT_TRUE(tree.empty());  // NOLINT(bugprone-use-after-move)
+    tree.push_back(elem(1));
+    EXPECT_EQ(tree.size(), 1u);
+}
+
+TEST(SequenceTree, ids_round_trip_across_many_actors) {
+    // Past the actor table's linear scan, lookups go through its hash index
+    auto actor = [](std::uint8_t n) {
+        std::uint8_t raw[16] = {};
+        raw[15] = n;
+        return ActorId{raw};
+    };
+    auto tree = SequenceTree{};
+    for (std::uint8_t a = 0; a < 40; ++a) {
+        for (std::uint64_t c = 1; c <= 5; ++c) {
+            tree.push_back(ListElement{.insert_id = OpId{c, actor(a)},
+                                       .insert_after = OpId{c + 100, actor(39 - a)},
+                                       .value = Value{ScalarValue{std::int64_t(a)}},
+                                       .visible = true});
+        }
+    }
+    auto copy = tree;
+    auto moved = std::move(tree);
+    for (const auto* t : {&copy, &moved}) {
+        auto pos = std::size_t{0};
+        for (auto it = t->begin(); it != t->end(); ++it, ++pos) {
+            const auto a = static_cast<std::uint8_t>(pos / 5);
+            EXPECT_EQ(it.insert_id(), (OpId{pos % 5 + 1, actor(a)}));
+            EXPECT_EQ(it.insert_after(), (OpId{pos % 5 + 101, actor(39 - a)}));
+            EXPECT_EQ(t->find(it.insert_id()), pos);
+        }
+        EXPECT_EQ(pos, 200u);
+        EXPECT_FALSE(t->contains(OpId{1, actor(200)}));
+        EXPECT_FALSE(t->contains(OpId{6, actor(3)}));
+    }
+    EXPECT_FALSE(tree.contains(OpId{1, actor(0)}));  // NOLINT(bugprone-use-after-move)
+}
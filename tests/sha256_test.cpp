@@ -85,3 +85,34 @@ TEST(Sha256, span_overload_matches_vector_overload) {
     auto digest2 = sha256(std::span<const std::byte>{input});
     EXPECT_EQ(digest1, digest2);
 }
+
+TEST(Sha256, million_a) {
+    auto digest = sha256_string(std::string(1000000, 'a'));
+    EXPECT_EQ(digest, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST(Sha256, active_backend_matches_portable) {
+    // Every padding shape: tails of 0..63 bytes, one or two padding blocks
+    auto input = std::vector<std::byte>(1000);
+    for (std::size_t i = 0; i < input.size(); ++i) {
+        input[i] = static_cast<std::byte>((i * 131 + 7) & 0xFF);
+    }
+    for (std::size_t len = 0; len <= input.size(); len += (len < 200 ? 1 : 97)) {
+        auto prefix = std::span<const std::byte>{input}.first(len);
+        EXPECT_EQ(sha256(prefix), detail::sha256_with(&detail::process_blocks_portable, prefix))
+            << "length " << len << ", backend " << sha256_backend();
+    }
+}
+
+TEST(Sha256, many_matches_single) {
+    auto storage = std::vector<std::vector<std::byte>>{};
+    for (std::size_t len : {0, 3, 55, 56, 64, 119, 200}) {
+        storage.emplace_back(len, std::byte{0x5a});
+    }
+    auto inputs = std::vector<std::span<const std::byte>>(storage.begin(), storage.end());
+    auto digests = std::vector<std::array<std::byte, 32>>(inputs.size());
+    sha256_many(inputs, digests);
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        EXPECT_EQ(digests[i], sha256(inputs[i])) << "input " << i;
+    }
+}
@@ -0,0 +1,226 @@
+#include <automerge-cpp/sync_session.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace automerge_cpp;
+
+namespace {
+
+// Queues outgoing messages for the test to deliver.
+struct QueueTransport {
+    std::vector<std::vector<std::byte>> sent;
+    void send(std::vector<std::byte> message) { sent.push_back(std::move(message)); }
+};
+
+template <typename Session>
+auto deliver(QueueTransport& from, Session& to) -> bool {
+    auto messages = std::move(from.sent);
+    from.sent.clear();
+    for (const auto& m : messages) EXPECT_TRUE(to.receive(m));
+    return !messages.empty();
+}
+
+// Hands each message straight to the other session, until the link is cut.
+struct Link {
+    std::mutex mutex;
+    bool open = true;
+
+    void cut() {
+        auto lock = std::scoped_lock{mutex};
+        open = false;
+    }
+};
+
+struct DirectTransport {
+    Link* link = nullptr;
+    std::function<void(std::vector<std::byte>)> deliver = nullptr;
+
+    void send(std::vector<std::byte> message) {
+        auto lock = std::scoped_lock{link->mutex};
+        if (link->open) deliver(std::move(message));
+    }
+};
+
+// Throws on its first `failures` sends, then queues like QueueTransport.
+struct FailingTransport {
+    int failures = 1;
+    std::vector<std::vector<std::byte>> sent;
+
+    void send(std::vector<std::byte> message) {
+        if (failures > 0) {
+            --failures;
+            throw std::runtime_error{"link down"};
+        }
+        sent.push_back(std::move(message));
+    }
+};
+
+auto sorted_heads(const Document& doc) -> std::vector<ChangeHash> {
+    auto heads = doc.get_heads();
+    std::ranges::sort(heads);
+    return heads;
+}
+
+auto make_doc(std::uint8_t id, std::shared_ptr<thread_pool> pool = nullptr) -> Document {
+    std::uint8_t raw[16] = {id};
+    auto doc = Document{std::move(pool)};
+    doc.set_actor_id(ActorId{raw});
+    return doc;
+}
+
+void put(Document& doc, const std::string& key, std::int64_t value) {
+    doc.transact([&](auto& tx) { tx.put(root, key, value); });
+}
+
+}  // namespace
+
+TEST(SyncSession, polled_sessions_converge) {
+    auto a = make_doc(1);
+    auto b = make_doc(2);
+    put(a, "x", 1);
+    put(b, "y", 2);
+
+    auto to_b = QueueTransport{};
+    auto to_a = QueueTransport{};
+    auto session_a = SyncSession{a, to_b};
+    auto session_b = SyncSession{b, to_a};
+    session_a.notify_local_change();
+    session_b.notify_local_change();
+
+    for (int round = 0; round < 20; ++round) {
+        session_a.poll();
+        session_b.poll();
+        auto moved = deliver(to_b, session_b);
+        moved = deliver(to_a, session_a) || moved;
+        if (!moved) break;
+    }
+    EXPECT_EQ(sorted_heads(a), sorted_heads(b));
+    EXPECT_EQ(b.get<std::int64_t>(root, "x"), 1);
+    EXPECT_EQ(a.get<std::int64_t>(root, "y"), 2);
+}
+
+TEST(SyncSession, queued_messages_are_applied_in_one_batch) {
+    auto a = make_doc(1);
+    auto b = make_doc(2);
+    auto to_b = QueueTransport{};
+    auto a_state = SyncState{};
+    for (int i = 0; i < 5; ++i) {
+        put(a, "k" + std::to_string(i), i);
+        auto message = a.generate_sync_message_encoded(a_state);
+        ASSERT_TRUE(message.has_value());
+        to_b.sent.push_back(std::move(*message));
+        a_state = SyncState{};  // each message stands alone
+    }
+
+    auto to_a = QueueTransport{};
+    auto session_b = SyncSession{b, to_a};
+    deliver(to_b, session_b);
+    session_b.poll();
+
+    auto metrics = session_b.metrics();
+    EXPECT_EQ(metrics.messages_received, 5u);
+    EXPECT_EQ(metrics.receive_batches, 1u);
+    EXPECT_EQ(metrics.rounds, 1u);
+    EXPECT_EQ(metrics.messages_sent, 1u);  // one reply to the lot
+}
+
+TEST(SyncSession, burst_of_local_changes_is_one_round) {
+    auto doc = Document{};
+    auto transport = QueueTransport{};
+    auto session = SyncSession{doc, transport};
+    for (int i = 0; i < 10; ++i) {
+        put(doc, "k", i);
+        session.notify_local_change();
+    }
+    EXPECT_EQ(session.poll(), 1u);
+    EXPECT_EQ(session.metrics().rounds, 1u);
+    EXPECT_EQ(transport.sent.size(), 1u);
+    EXPECT_EQ(session.poll(), 0u);  // nothing new
+}
+
+TEST(SyncSession, rejects_malformed_messages) {
+    auto doc = Document{};
+    auto transport = QueueTransport{};
+    auto session = SyncSession{doc, transport};
+    auto junk = std::vector<std::byte>{std::byte{0x01}, std::byte{0x02}};
+    EXPECT_FALSE(session.receive(junk));
+    EXPECT_EQ(session.metrics().messages_rejected, 1u);
+    EXPECT_EQ(session.poll(), 0u);
+}
+
+TEST(SyncSession, throwing_transport_leaves_polled_session_usable) {
+    auto doc = make_doc(1);
+    put(doc, "x", 1);
+    auto transport = FailingTransport{};
+    auto session = SyncSession{doc, transport};
+    session.notify_local_change();
+
+    EXPECT_THROW(session.poll(), std::runtime_error);
+    EXPECT_EQ(session.metrics().rounds_failed, 1u);
+    session.wait_idle();  // not left busy
+
+    // The change is still pending, so the next round sends it
+    EXPECT_EQ(session.poll(), 1u);
+    EXPECT_EQ(transport.sent.size(), 1u);
+}
+
+TEST(SyncSession, throwing_transport_leaves_pool_session_usable) {
+    auto pool = std::make_shared<thread_pool>(2);
+    auto doc = make_doc(1, pool);
+    put(doc, "x", 1);
+    auto transport = FailingTransport{};
+    {
+        auto session = SyncSession{doc, transport};
+        session.notify_local_change();
+        EXPECT_THROW(session.wait_idle(), std::runtime_error);
+        session.wait_idle();  // reported once
+
+        session.notify_local_change();
+        session.wait_idle();
+        EXPECT_EQ(transport.sent.size(), 1u);
+        EXPECT_EQ(session.metrics().rounds_failed, 1u);
+    }  // the destructor does not wait forever
+}
+
+TEST(SyncSession, pool_sessions_converge) {
+    auto pool = std::make_shared<thread_pool>(2);
+    auto a = make_doc(1, pool);
+    auto b = make_doc(2, pool);
+    put(a, "x", 1);
+    put(b, "y", 2);
+
+    auto link = Link{};
+    auto to_b = DirectTransport{.link = &link};
+    auto to_a = DirectTransport{.link = &link};
+    auto session_a = SyncSession{a, to_b};
+    auto session_b = SyncSession{b, to_a};
+    to_b.deliver = [&](std::vector<std::byte> m) { session_b.receive(m); };
+    to_a.deliver = [&](std::vector<std::byte> m) { session_a.receive(m); };
+    session_a.notify_local_change();
+    session_b.notify_local_change();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+    while (std::chrono::steady_clock::now() < deadline) {
+        session_a.wait_idle();
+        session_b.wait_idle();
+        if (sorted_heads(a) == sorted_heads(b)) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    link.cut();
+    session_a.wait_idle();
+    session_b.wait_idle();
+    EXPECT_EQ(sorted_heads(a), sorted_heads(b));
+    EXPECT_EQ(b.get<std::int64_t>(root, "x"), 1);
+    EXPECT_EQ(a.get<std::int64_t>(root, "y"), 2);
+}
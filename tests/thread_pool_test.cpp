@@ -0,0 +1,84 @@
+#include <automerge-cpp/thread_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+using namespace automerge_cpp;
+
+TEST(ThreadPool, submit_returns_value) {
+    auto pool = thread_pool{4};
+    auto future = pool.submit([]() { return 42; });
+    EXPECT_EQ(future.get(), 42);
+
+    auto done = pool.submit([](int a, int b) { EXPECT_EQ(a + b, 3); }, 1, 2);
+    EXPECT_TRUE(done.get());
+}
+
+TEST(ThreadPool, submit_propagates_exceptions) {
+    auto pool = thread_pool{2};
+    auto future = pool.submit([]() -> int { throw std::runtime_error{"boom"}; });
+    EXPECT_THROW(future.get(), std::runtime_error);
+}
+
+TEST(ThreadPool, large_tasks_are_stored_on_the_heap) {
+    auto pool = thread_pool{2};
+    auto big = std::array<std::uint64_t, 32>{};
+    std::iota(big.begin(), big.end(), std::uint64_t{1});
+    auto future = pool.submit([big]() { return std::accumulate(big.begin(), big.end(), std::uint64_t{0}); });
+    EXPECT_EQ(future.get(), 528u);
+}
+
+TEST(ThreadPool, parallelize_loop_covers_every_index_once) {
+    auto pool = thread_pool{4};
+    auto hits = std::vector<std::atomic<int>>(1000);
+    pool.parallelize_loop(0, 1000, [&](int start, int end) {
+        for (int i = start; i < end; ++i) hits[i].fetch_add(1);
+    }, 16);
+    for (const auto& hit : hits) EXPECT_EQ(hit.load(), 1);
+}
+
+TEST(ThreadPool, nested_parallelize_loop_does_not_deadlock) {
+    // Every worker is busy in an outer block; the inner loops finish because
+    // a waiting thread runs queued blocks itself.
+    auto pool = thread_pool{2};
+    auto total = std::atomic<int>{0};
+    pool.parallelize_loop(0, 4, [&](int start, int end) {
+        for (int i = start; i < end; ++i) {
+            pool.parallelize_loop(0, 100, [&](int s, int e) { total.fetch_add(e - s); });
+        }
+    }, 4);
+    EXPECT_EQ(total.load(), 400);
+}
+
+TEST(ThreadPool, wait_for_tasks_waits_for_all_tasks) {
+    auto pool = thread_pool{3};
+    auto count = std::atomic<int>{0};
+    for (int i = 0; i < 500; ++i) {
+        pool.push_task([&count]() { count.fetch_add(1); });
+    }
+    pool.wait_for_tasks();
+    EXPECT_EQ(count.load(), 500);
+    EXPECT_EQ(pool.get_tasks_total(), 0u);
+    EXPECT_EQ(pool.get_tasks_queued(), 0u);
+}
+
+TEST(ThreadPool, paused_tasks_run_after_reset_and_resume) {
+    auto pool = thread_pool{2};
+    pool.paused = true;
+    auto count = std::atomic<int>{0};
+    for (int i = 0; i < 10; ++i) {
+        pool.push_task([&count]() { count.fetch_add(1); });
+    }
+    pool.reset(3);
+    EXPECT_EQ(pool.get_thread_count(), 3u);
+    EXPECT_EQ(count.load(), 0);
+    pool.paused = false;
+    pool.wait_for_tasks();
+    EXPECT_EQ(count.load(), 10);
+}
@@ -1,8 +1,10 @@
 #include <automerge-cpp/value.hpp>
+#include <automerge-cpp/value_ref.hpp>
 
 #include <gtest/gtest.h>
 
 #include <string>
+#include <vector>
 
 using namespace automerge_cpp;
 
@@ -141,3 +143,37 @@ TEST(Value, all_obj_types_round_trip) {
         EXPECT_EQ(std::get<ObjType>(v), type);
     }
 }
+
+// -- ValueRef -----------------------------------------------------------------
+
+TEST(ValueRef, borrows_strings_and_bytes) {
+    const auto s = Value{ScalarValue{std::string{"a string long enough to allocate"}}};
+    const auto b = Value{ScalarValue{Bytes{std::byte{1}, std::byte{2}}}};
+    const auto& str = std::get<std::string>(std::get<ScalarValue>(s));
+    const auto& bytes = std::get<Bytes>(std::get<ScalarValue>(b));
+
+    EXPECT_EQ(get_scalar<std::string_view>(value_ref(s))->data(), str.data());
+    EXPECT_EQ(get_scalar<std::span<const std::byte>>(value_ref(b))->data(), bytes.data());
+    EXPECT_FALSE(get_scalar<std::string_view>(value_ref(b)).has_value());
+}
+
+TEST(ValueRef, copies_back_to_equal_values) {
+    const auto values = std::vector<Value>{
+        Value{ObjType::list},
+        Value{ScalarValue{Null{}}},
+        Value{ScalarValue{true}},
+        Value{ScalarValue{std::int64_t{-3}}},
+        Value{ScalarValue{std::uint64_t{3}}},
+        Value{ScalarValue{2.5}},
+        Value{ScalarValue{Counter{4}}},
+        Value{ScalarValue{Timestamp{5}}},
+        Value{ScalarValue{std::string{"text"}}},
+        Value{ScalarValue{Bytes{std::byte{9}}}},
+    };
+    for (const auto& v : values) {
+        EXPECT_EQ(to_value(value_ref(v)), v);
+        EXPECT_EQ(value_ref(v).index(), v.index());
+    }
+    EXPECT_EQ(to_scalar(scalar_ref(ScalarValue{std::string{"x"}})), ScalarValue{std::string{"x"}});
+    EXPECT_EQ(get_scalar<std::int64_t>(value_ref(values[3])), -3);
+}